@@ -0,0 +1,261 @@
+#include "AllocationTracker.h"
+
+#ifndef KRAKEN_ALLOCATION_TRACKER
+#error "AllocationTracker.cpp is built with KRAKEN_ALLOCATION_TRACKER only"
+#endif
+
+#include <unistd.h>
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+// the glibc allocator behind the replaced functions
+extern "C" {
+void* __libc_malloc(size_t size);
+void __libc_free(void* ptr);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace allocation_tracker {
+namespace {
+constexpr size_t kMaxThreads = 64u;
+constexpr size_t kMaxStages = 16u;
+constexpr size_t kNameSize = 24u;
+
+enum ArmState : int { kDisarmed, kWarmingUp, kArmed };
+
+// everything below is constant initialized and never allocates, the
+// hooks run before main and inside the allocator's callers
+struct StageStats {
+    // the stage pointer, entry 0 collects the allocations outside stages
+    std::atomic<const char*> key{nullptr};
+    char name[kNameSize]{};
+    std::atomic<std::uint64_t> allocations{0u};
+    std::atomic<std::uint64_t> bytes{0u};
+    std::atomic<std::uint64_t> armedAllocations{0u};
+};
+
+struct ThreadStats {
+    char name[kNameSize]{};
+    std::atomic<bool> hot{false};
+    std::atomic<std::uint64_t> frees{0u};
+    StageStats stages[kMaxStages];
+};
+
+// slot 0 counts the unregistered threads, their stages are not told apart
+ThreadStats gThreads[kMaxThreads];
+std::atomic<size_t> gNextThread{1u};
+std::atomic<int> gArmState{kDisarmed};
+std::atomic<std::int64_t> gArmDeadlineNs{0};
+std::atomic<ArmAction> gArmAction{ArmAction::Report};
+
+thread_local ThreadStats* tThread = nullptr;
+thread_local const char* tStage = nullptr;
+
+std::int64_t NowNs() {
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<std::int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+void CopyName(char* target, const char* name) {
+    std::strncpy(target, nullptr == name ? "?" : name, kNameSize - 1u);
+    target[kNameSize - 1u] = '\0';
+}
+
+StageStats& FindStage(ThreadStats& thread, const char* stage) {
+    auto& outside = thread.stages[0];
+    if (nullptr == stage || &gThreads[0] == &thread) {
+        return outside;
+    }
+
+    // only the owning thread adds stages, readers see the name first
+    for (size_t i = 1; i < kMaxStages; ++i) {
+        auto& entry = thread.stages[i];
+        const auto key = entry.key.load(std::memory_order_relaxed);
+        if (stage == key) {
+            return entry;
+        }
+        if (nullptr == key) {
+            CopyName(entry.name, stage);
+            entry.key.store(stage, std::memory_order_release);
+            return entry;
+        }
+    }
+    return outside;
+}
+
+bool IsArmed() {
+    const auto state = gArmState.load(std::memory_order_relaxed);
+    if (kArmed == state) {
+        return true;
+    }
+    if (kWarmingUp == state &&
+        NowNs() >= gArmDeadlineNs.load(std::memory_order_relaxed)) {
+        gArmState.store(kArmed, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void Record(const size_t size) {
+    auto& thread = nullptr == tThread ? gThreads[0] : *tThread;
+    auto& stage = FindStage(thread, tStage);
+    stage.allocations.fetch_add(1u, std::memory_order_relaxed);
+    stage.bytes.fetch_add(size, std::memory_order_relaxed);
+
+    if (not thread.hot.load(std::memory_order_relaxed) || not IsArmed()) {
+        return;
+    }
+    stage.armedAllocations.fetch_add(1u, std::memory_order_relaxed);
+    if (ArmAction::Abort == gArmAction.load(std::memory_order_relaxed)) {
+        // no logger here, it would allocate
+        char message[128];
+        const auto length = snprintf(message,
+                                     sizeof(message),
+                                     "Allocation of %zu bytes in %s/%s\n",
+                                     size,
+                                     thread.name,
+                                     nullptr == tStage ? "-" : stage.name);
+        if (length > 0) {
+            write(STDERR_FILENO, message, static_cast<size_t>(length));
+        }
+        abort();
+    }
+}
+
+void RecordFree() {
+    auto& thread = nullptr == tThread ? gThreads[0] : *tThread;
+    thread.frees.fetch_add(1u, std::memory_order_relaxed);
+}
+}  // namespace
+
+void RegisterThread(const char* name, const bool hotPath) {
+    const auto slot = gNextThread.fetch_add(1u);
+    if (slot >= kMaxThreads) {
+        // counted with the unregistered threads
+        return;
+    }
+    auto& thread = gThreads[slot];
+    CopyName(thread.name, name);
+    thread.hot.store(hotPath, std::memory_order_release);
+    tThread = &thread;
+}
+
+const char* SetStage(const char* stage) {
+    const auto previous = tStage;
+    tStage = stage;
+    return previous;
+}
+
+void Arm(const std::chrono::milliseconds warmUp, const ArmAction action) {
+    gArmAction.store(action);
+    gArmDeadlineNs.store(
+        NowNs() +
+        std::chrono::duration_cast<std::chrono::nanoseconds>(warmUp).count());
+    gArmState.store(kWarmingUp);
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Allocations: hot threads checked after %lld ms, %s",
+                   static_cast<long long>(warmUp.count()),
+                   ArmAction::Abort == action ? "abort" : "report");
+}
+
+void Disarm() {
+    gArmState.store(kDisarmed);
+}
+
+void PrintReport() {
+    const auto threads = std::min(gNextThread.load(), kMaxThreads);
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Allocations (%s):",
+                   kArmed == gArmState.load() ? "armed" : "not armed");
+    for (size_t slot = 0; slot < threads; ++slot) {
+        const auto& thread = gThreads[slot];
+        const auto* name = 0u == slot ? "unregistered" : thread.name;
+        for (const auto& stage : thread.stages) {
+            const auto allocations = stage.allocations.load();
+            if (0u == allocations) {
+                continue;
+            }
+            const auto* key = stage.key.load(std::memory_order_acquire);
+            SoapySDR::logf(SOAPY_SDR_INFO,
+                           "  %-16s %-16s %10llu allocs %12llu bytes "
+                           "%8llu armed",
+                           name,
+                           nullptr == key ? "-" : stage.name,
+                           static_cast<unsigned long long>(allocations),
+                           static_cast<unsigned long long>(stage.bytes.load()),
+                           static_cast<unsigned long long>(
+                               stage.armedAllocations.load()));
+        }
+        if (0u != thread.frees.load()) {
+            SoapySDR::logf(SOAPY_SDR_INFO,
+                           "  %-16s %-16s %10llu frees",
+                           name,
+                           "-",
+                           static_cast<unsigned long long>(
+                               thread.frees.load()));
+        }
+    }
+}
+
+}  // namespace allocation_tracker
+
+// the replacements glibc documents for a custom allocator, they count and
+// forward to the glibc allocator so the heap stays the same
+extern "C" {
+void* malloc(size_t size) {
+    allocation_tracker::Record(size);
+    return __libc_malloc(size);
+}
+
+void free(void* ptr) {
+    if (nullptr != ptr) {
+        allocation_tracker::RecordFree();
+    }
+    __libc_free(ptr);
+}
+
+void* calloc(size_t count, size_t size) {
+    allocation_tracker::Record(count * size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    allocation_tracker::Record(size);
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    allocation_tracker::Record(size);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    allocation_tracker::Record(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (0u == alignment || 0u != (alignment & (alignment - 1u)) ||
+        0u != alignment % sizeof(void*)) {
+        return EINVAL;
+    }
+    allocation_tracker::Record(size);
+    auto* ptr = __libc_memalign(alignment, size);
+    if (nullptr == ptr) {
+        return ENOMEM;
+    }
+    *out = ptr;
+    return 0;
+}
+}
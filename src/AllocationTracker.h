@@ -0,0 +1,86 @@
+#ifndef __ALLOCATION_TRACKER_H__
+#define __ALLOCATION_TRACKER_H__
+
+#include <chrono>
+
+/**
+ * Heap allocation tracking, built in with the CMake option
+ * KRAKEN_ALLOCATION_TRACKER. It replaces the malloc family, so operator
+ * new, kfr's aligned allocator and the C libraries are all counted in one
+ * place. Without the option every call below is an empty inline.
+ */
+namespace allocation_tracker {
+enum class ArmAction {
+    // count the allocations of the hot threads, shown by PrintReport
+    Report,
+    // abort on the first allocation of a hot thread, for soak tests
+    Abort
+};
+
+#ifdef KRAKEN_ALLOCATION_TRACKER
+constexpr bool kEnabled = true;
+
+/**
+ * @brief Names the calling thread in the report, the allocations of
+ * unregistered threads are counted together
+ * @param name thread name, copied
+ * @param hotPath true for the stream and DSP threads checked when armed
+ */
+void RegisterThread(const char* name, const bool hotPath);
+
+/**
+ * @brief Sets the stage the allocations of the calling thread are
+ * attributed to
+ * @param stage name that outlives the stage, nullptr - no stage
+ * @return the previous stage
+ */
+const char* SetStage(const char* stage);
+
+/**
+ * @brief Arms the check of the hot threads once the warm up has passed
+ */
+void Arm(const std::chrono::milliseconds warmUp, const ArmAction action);
+
+void Disarm();
+
+/**
+ * @brief Logs the allocations, bytes and frees per thread and stage and
+ * the allocations made while armed
+ */
+void PrintReport();
+#else
+constexpr bool kEnabled = false;
+
+inline void RegisterThread(const char*, const bool) {}
+
+inline const char* SetStage(const char*) {
+    return nullptr;
+}
+
+inline void Arm(const std::chrono::milliseconds, const ArmAction) {}
+
+inline void Disarm() {}
+
+inline void PrintReport() {}
+#endif
+
+/**
+ * @brief Attributes the allocations of the calling thread to a stage
+ * until the end of the scope
+ */
+class CStageScope {
+   public:
+    explicit CStageScope(const char* stage) : mPrevious(SetStage(stage)) {}
+    CStageScope(const CStageScope&) = delete;
+    CStageScope& operator=(const CStageScope&) = delete;
+    ~CStageScope() {
+        SetStage(mPrevious);
+    }
+
+   private:
+    const char* const mPrevious;
+};
+
+}  // namespace allocation_tracker
+
+#endif  // __ALLOCATION_TRACKER_H__
@@ -0,0 +1,589 @@
+#include <getopt.h>
+#include <sys/utsname.h>
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <kfr/base.hpp>
+#include <kfr/dft.hpp>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "DataQueue.h"
+#include "DemodBank.h"
+#include "DspKernels.h"
+#include "FastFir.h"
+#include "IqCodec.h"
+#include "SparseMonitor.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr auto kSchemaVersion = 1;
+constexpr auto kLatencyPacing = std::chrono::microseconds(200);
+
+struct BenchOptions {
+    // every measurement repeats its operation for at least this time
+    std::chrono::milliseconds minTime{500};
+    // only benchmarks whose name contains the filter run
+    std::string filter;
+    // JSON destination, empty - stdout
+    std::string outputPath;
+};
+
+// one JSON object of the "results" array, values are kept in insertion
+// order so runs diff cleanly
+struct Result {
+    Result& Add(const std::string& key, const double value) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.6g", value);
+        mFields.emplace_back(key, buffer);
+        return *this;
+    }
+
+    Result& Add(const std::string& key, const std::string& value) {
+        mFields.emplace_back(key, "\"" + value + "\"");
+        return *this;
+    }
+
+    std::vector<std::pair<std::string, std::string>> mFields;
+};
+
+// keeps results alive so the measured code is not optimized out
+volatile float gSink(0.0f);
+
+double ElapsedNs(const Clock::time_point since) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - since)
+        .count();
+}
+
+/**
+ * @brief Runs the operation until minTime passed, after one warm up call
+ * @return mean time of one call in ns
+ */
+template <class Operation>
+double MeasureNsPerCall(const BenchOptions& options, Operation&& operation) {
+    operation();
+
+    size_t calls(0u);
+    const auto start = Clock::now();
+    const auto deadline = start + options.minTime;
+    do {
+        operation();
+        ++calls;
+    } while (Clock::now() < deadline);
+
+    return ElapsedNs(start) / calls;
+}
+
+double Percentile(std::vector<double>& values, const double ratio) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    const auto index = static_cast<size_t>(ratio * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+std::vector<std::int8_t> RandomIq(const size_t bytes) {
+    std::mt19937 generator(1u);
+    std::uniform_int_distribution<int> distribution(-128, 127);
+
+    std::vector<std::int8_t> data(bytes);
+    for (auto& value : data) {
+        value = static_cast<std::int8_t>(distribution(generator));
+    }
+    return data;
+}
+
+double BlockAgeNs(const data_queue::DataBlock<sample_types::CS8>& block) {
+    return static_cast<double>(latency_tracer::NowNs() -
+                               block.stamps.enqueue);
+}
+
+/**
+ * @brief One producer pushes blocks into a RawQueue, one consumer pops
+ * them the way CDataHandler does
+ * @param paced false - the producer pushes as fast as it can (throughput),
+ * true - one block per kLatencyPacing (wake up latency)
+ */
+Result BenchQueue(const BenchOptions& options,
+                  const size_t blockSize,
+                  const bool paced) {
+    data_queue::RawQueue queue;
+    std::vector<double> latencies;
+    size_t consumed(0u);
+
+    std::thread consumer([&queue, &latencies, &consumed]() {
+        data_queue::DataBlock<sample_types::CS8> block;
+        while (not queue.IsQueueStopped()) {
+            queue.WaitDataReady();
+            while (queue.Pop(block)) {
+                latencies.push_back(BlockAgeNs(block));
+                ++consumed;
+            }
+        }
+    });
+
+    data_queue::DataBlock<sample_types::CS8> block;
+    block.data.resize(blockSize);
+    size_t produced(0u);
+    const auto start = Clock::now();
+    const auto deadline = start + options.minTime;
+    auto nextPush = start;
+    while (Clock::now() < deadline) {
+        if (paced) {
+            std::this_thread::sleep_until(nextPush);
+            nextPush += kLatencyPacing;
+        }
+        block.stamps.enqueue = latency_tracer::NowNs();
+        queue.Push(block);
+        ++produced;
+    }
+    queue.WaitQueueProcessed();
+    const auto elapsedNs = ElapsedNs(start);
+
+    queue.StopQueue();
+    consumer.join();
+
+    Result result;
+    result.Add("benchmark", paced ? "queue_latency" : "queue_throughput")
+        .Add("block_bytes", blockSize)
+        .Add("blocks", consumed)
+        .Add("blocks_per_s", produced / elapsedNs * 1e9)
+        .Add("mb_per_s", produced * blockSize / elapsedNs * 1e3)
+        .Add("latency_p50_ns", Percentile(latencies, 0.5))
+        .Add("latency_p99_ns", Percentile(latencies, 0.99))
+        .Add("latency_max_ns", Percentile(latencies, 1.0));
+    return result;
+}
+
+/**
+ * @param corrected true - the conversion fused with the DC and IQ
+ * imbalance correction
+ */
+template <class Sample>
+Result BenchConvert(const BenchOptions& options,
+                    const size_t samples,
+                    const bool corrected) {
+    using Component = typename Sample::Component;
+
+    // random bit patterns, floats are squashed into the -1.0 .. 1.0 range
+    const auto bytes = RandomIq(2u * samples * sizeof(Component));
+    std::vector<Component> data(2u * samples);
+    std::memcpy(data.data(), bytes.data(), bytes.size());
+    if constexpr (std::is_floating_point_v<Component>) {
+        for (auto& value : data) {
+            value = std::isfinite(value) ? std::tanh(value) : 0.0f;
+        }
+    }
+    kfr::univector<dsp_kernels::Complex> out(samples);
+    const dsp_kernels::IqCoefficients coefficients{0.01f, -0.01f, 1.02f, 0.03f};
+    dsp_kernels::IqMoments moments;
+
+    const auto ns = MeasureNsPerCall(options, [&]() {
+        if (corrected) {
+            dsp_kernels::ConvertCorrected<Sample>(
+                data.data(), samples, coefficients, out.data(), moments);
+        } else {
+            dsp_kernels::Convert<Sample>(data.data(), samples, out.data());
+        }
+        gSink = out[samples - 1].real();
+    });
+
+    // lower case keeps the convert_cs8 name of earlier result files
+    std::string name = std::string(corrected ? "convert_corrected_"
+                                             : "convert_") +
+                       Sample::kFormat;
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    Result result;
+    result.Add("benchmark", name)
+        .Add("samples", samples)
+        .Add("ns_per_op", ns)
+        .Add("msps", samples / ns * 1e3);
+    return result;
+}
+
+Result BenchFft(const BenchOptions& options, const size_t size) {
+    const auto data = RandomIq(2u * size);
+    kfr::univector<dsp_kernels::Complex> in(size);
+    kfr::univector<dsp_kernels::Complex> out(size);
+    dsp_kernels::Convert<sample_types::CS8>(data.data(), size, in.data());
+
+    const auto planStart = Clock::now();
+    const kfr::dft_plan<kfr::fbase> plan(size);
+    const auto planNs = ElapsedNs(planStart);
+    kfr::univector<kfr::u8> temp(plan.temp_size);
+
+    const auto ns = MeasureNsPerCall(options, [&]() {
+        plan.execute(out, in, temp);
+        gSink = out[0].real();
+    });
+
+    Result result;
+    result.Add("benchmark", "fft")
+        .Add("size", size)
+        .Add("power_of_two", 0u == (size & (size - 1u)) ? 1.0 : 0.0)
+        .Add("plan_ns", planNs)
+        .Add("ns_per_op", ns)
+        .Add("msps", size / ns * 1e3);
+    return result;
+}
+
+Result BenchStats(const BenchOptions& options, const size_t size) {
+    const auto data = RandomIq(2u * size);
+    kfr::univector<dsp_kernels::Complex> spectrum(size);
+    kfr::univector<kfr::fbase> dB(size);
+    dsp_kernels::Convert<sample_types::CS8>(data.data(), size, spectrum.data());
+
+    const auto ns = MeasureNsPerCall(options, [&]() {
+        dsp_kernels::MagnitudeDb(spectrum, dB);
+        gSink = dsp_kernels::ComputeStats(dB).rms;
+    });
+
+    Result result;
+    result.Add("benchmark", "db_stats")
+        .Add("size", size)
+        .Add("ns_per_op", ns)
+        .Add("msps", size / ns * 1e3);
+    return result;
+}
+
+Result BenchHolds(const BenchOptions& options, const size_t size) {
+    const auto data = RandomIq(2u * size);
+    kfr::univector<dsp_kernels::Complex> spectrum(size);
+    kfr::univector<kfr::fbase> dB(size);
+    dsp_kernels::Convert<sample_types::CS8>(data.data(), size, spectrum.data());
+    dsp_kernels::MagnitudeDb(spectrum, dB);
+    std::vector<float> maxHold(dB.begin(), dB.end());
+    std::vector<float> minHold(dB.begin(), dB.end());
+
+    const auto ns = MeasureNsPerCall(options, [&]() {
+        dsp_kernels::MaxHold(dB.data(), size, maxHold.data());
+        dsp_kernels::MinHold(dB.data(), size, minHold.data());
+        gSink = dsp_kernels::RangeMax(maxHold.data(), size);
+    });
+
+    Result result;
+    result.Add("benchmark", "holds")
+        .Add("size", size)
+        .Add("ns_per_op", ns)
+        .Add("msps", size / ns * 1e3);
+    return result;
+}
+
+/**
+ * @brief Overlap-save filter of a 16384 sample block, the direct form
+ * costs taps multiply-adds per sample for comparison
+ */
+Result BenchFir(const BenchOptions& options, const size_t taps) {
+    constexpr size_t kBlock = 16384u;
+    const auto data = RandomIq(2u * kBlock);
+    kfr::univector<dsp_kernels::Complex> in(kBlock);
+    kfr::univector<dsp_kernels::Complex> out;
+    out.reserve(2u * kBlock);
+    dsp_kernels::Convert<sample_types::CS8>(data.data(), kBlock, in.data());
+
+    fast_fir::CFastFir fir(taps);
+    fir.SetTaps(fast_fir::DesignLowpass(taps, 0.1));
+
+    const auto ns = MeasureNsPerCall(options, [&]() {
+        out.clear();
+        fir.Process(in.data(), kBlock, out);
+        gSink = out.empty() ? 0.0f : out[0].real();
+    });
+
+    Result result;
+    result.Add("benchmark", "fir")
+        .Add("taps", taps)
+        .Add("fft_size", fir.FftSize())
+        .Add("ns_per_op", ns)
+        .Add("msps", kBlock / ns * 1e3);
+    return result;
+}
+
+/**
+ * @brief Compressed recording coder on one core, CS8 like a tuner at
+ * moderate gain: noise of 10 codes rms under a tone of 40 codes
+ * @param bits high bits kept of each component, 8 - lossless
+ */
+Result BenchCodec(const BenchOptions& options, const unsigned bits) {
+    constexpr size_t kBlock = 16384u;
+    std::mt19937 generator(1u);
+    std::normal_distribution<float> noise(0.0f, 10.0f);
+    std::vector<std::int8_t> data(2u * kBlock);
+    for (size_t i = 0; i < kBlock; ++i) {
+        const auto phase = 0.05f * static_cast<float>(i);
+        data[2u * i] = static_cast<std::int8_t>(std::clamp(
+            std::lround(40.0f * std::cos(phase) + noise(generator)), -128L,
+            127L));
+        data[2u * i + 1u] = static_cast<std::int8_t>(std::clamp(
+            std::lround(40.0f * std::sin(phase) + noise(generator)), -128L,
+            127L));
+    }
+
+    const iq_codec::CBlockCodec<sample_types::CS8> codec(8u - bits);
+    std::vector<std::uint8_t> encoded;
+    std::vector<std::int8_t> decoded(2u * kBlock);
+    const auto encodeNs = MeasureNsPerCall(options, [&]() {
+        codec.Encode(data.data(), kBlock, encoded);
+        gSink = encoded.back();
+    });
+    const auto method = codec.Encode(data.data(), kBlock, encoded);
+    const auto decodeNs = MeasureNsPerCall(options, [&]() {
+        codec.Decode(
+            method, encoded.data(), encoded.size(), kBlock, decoded.data());
+        gSink = decoded.back();
+    });
+
+    Result result;
+    result.Add("benchmark", "codec")
+        .Add("bits", bits)
+        .Add("ratio", static_cast<double>(data.size()) / encoded.size())
+        .Add("encode_msps", kBlock / encodeNs * 1e3)
+        .Add("decode_msps", kBlock / decodeNs * 1e3);
+    return result;
+}
+
+/**
+ * @brief Goertzel monitor of a number of frequencies evaluating every
+ * sample of 16384 sample blocks, compare the cost with the fft of the
+ * block
+ */
+Result BenchMonitor(const BenchOptions& options, const size_t frequencies) {
+    constexpr size_t kBlock = 16384u;
+    const auto data = RandomIq(2u * kBlock);
+    kfr::univector<dsp_kernels::Complex> in(kBlock);
+    dsp_kernels::Convert<sample_types::CS8>(data.data(), kBlock, in.data());
+
+    sparse_monitor::MonitorConfig config;
+    config.sampleRate = 2.4e6;
+    config.rate = 1e9;
+    for (size_t i = 0; i < frequencies; ++i) {
+        config.frequencies.push_back((i + 0.5) * 2e6 / frequencies - 1e6);
+    }
+    sparse_monitor::CSparseMonitor monitor(0, config);
+
+    const auto ns = MeasureNsPerCall(options, [&]() {
+        monitor.AddSamples(in.data(), kBlock);
+        gSink = in[0].real();
+    });
+
+    Result result;
+    result.Add("benchmark", "monitor")
+        .Add("frequencies", frequencies)
+        .Add("ns_per_op", ns)
+        .Add("msps", kBlock / ns * 1e3);
+    return result;
+}
+
+/**
+ * @brief Demodulator bank of a number of FM channels across the band fed
+ * 16384 sample blocks, the audio is discarded
+ */
+Result BenchDemod(const BenchOptions& options, const size_t channels) {
+    constexpr size_t kBlock = 16384u;
+    const auto data = RandomIq(2u * kBlock);
+    kfr::univector<dsp_kernels::Complex> in(kBlock);
+    dsp_kernels::Convert<sample_types::CS8>(data.data(), kBlock, in.data());
+
+    demod_bank::DemodConfig config;
+    config.sampleRate = 2.4e6;
+    for (size_t i = 0; i < channels; ++i) {
+        config.channels.push_back(
+            {(i + 0.5) * 2e6 / channels - 1e6, demod_bank::Mode::Fm, 0.0});
+    }
+    demod_bank::CDemodBank bank(0, config);
+
+    const auto ns = MeasureNsPerCall(options, [&]() {
+        bank.AddSamples(in.data(), kBlock);
+        gSink = in[0].real();
+    });
+
+    Result result;
+    result.Add("benchmark", "demod")
+        .Add("channels", channels)
+        .Add("ns_per_op", ns)
+        .Add("msps", kBlock / ns * 1e3);
+    return result;
+}
+
+std::string SystemJson(const BenchOptions& options) {
+    utsname name{};
+    uname(&name);
+
+    char timestamp[32];
+    const auto now = std::time(nullptr);
+    std::strftime(
+        timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    return std::string("  \"schema\": ") + std::to_string(kSchemaVersion) +
+           ",\n  \"timestamp\": \"" + timestamp +
+           "\",\n  \"system\": {\"machine\": \"" + name.machine +
+           "\", \"release\": \"" + name.release + "\", \"compiler\": \"" +
+           __VERSION__ + "\", \"cpus\": " +
+           std::to_string(std::thread::hardware_concurrency()) +
+           "},\n  \"min_time_ms\": " +
+           std::to_string(options.minTime.count()) + ",\n";
+}
+
+std::string ResultsJson(const std::vector<Result>& results) {
+    std::string json = "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        json += "    {";
+        const auto& fields = results[i].mFields;
+        for (size_t j = 0; j < fields.size(); ++j) {
+            json += (0u == j ? "\"" : ", \"") + fields[j].first +
+                    "\": " + fields[j].second;
+        }
+        json += i + 1u < results.size() ? "},\n" : "}\n";
+    }
+    return json + "  ]\n";
+}
+
+bool Selected(const BenchOptions& options, const std::string& name) {
+    return options.filter.empty() ||
+           std::string::npos != name.find(options.filter);
+}
+
+int printHelp() {
+    std::cout << "Usage KrakenSDRBench [options]" << std::endl;
+    std::cout << "  Options summary:" << std::endl;
+    std::cout << "    --help \t\t\t Print this help message" << std::endl;
+    std::cout << "    --min-time=ms \t\t Minimal time per measurement"
+              << std::endl;
+    std::cout << "    --filter=name \t\t Run benchmarks containing the name: "
+                 "queue, convert, fft, stats, holds, fir, codec, monitor, "
+                 "demod"
+              << std::endl;
+    std::cout << "    --out=path \t\t\t JSON file, stdout by default"
+              << std::endl;
+    std::cout << std::endl;
+
+    return 0;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) try {
+    static option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"min-time", required_argument, nullptr, 't'},
+        {"filter", required_argument, nullptr, 'f'},
+        {"out", required_argument, nullptr, 'o'},
+        {nullptr, no_argument, nullptr, '\0'}};
+
+    BenchOptions options;
+
+    auto long_index = 0;
+    auto option = 0;
+    while ((option = getopt_long_only(
+                argc, argv, "", long_options, &long_index)) != -1) {
+        switch (option) {
+            case 'h':
+                return printHelp();
+            case 't':
+                options.minTime = std::chrono::milliseconds(std::stol(optarg));
+                break;
+            case 'f':
+                options.filter = optarg;
+                break;
+            case 'o':
+                options.outputPath = optarg;
+                break;
+        }
+    }
+
+    // the benchmarked objects trace and log their setup, keep it out of
+    // the report
+    SoapySDR::setLogLevel(SOAPY_SDR_WARNING);
+
+    std::vector<Result> results;
+    for (const auto blockSize : {4096u, 32768u, 262144u}) {
+        if (Selected(options, "queue_throughput")) {
+            results.push_back(BenchQueue(options, blockSize, false));
+        }
+        if (Selected(options, "queue_latency")) {
+            results.push_back(BenchQueue(options, blockSize, true));
+        }
+    }
+    for (const auto samples : {4096u, 65536u}) {
+        for (const auto format :
+             {SOAPY_SDR_CS8, SOAPY_SDR_CU8, SOAPY_SDR_CS16, SOAPY_SDR_CF32}) {
+            if (Selected(options, "convert")) {
+                sample_types::DispatchFormat(format, [&](auto sample) {
+                    using Sample = decltype(sample);
+                    results.push_back(
+                        BenchConvert<Sample>(options, samples, false));
+                    results.push_back(
+                        BenchConvert<Sample>(options, samples, true));
+                });
+            }
+        }
+    }
+    for (const auto size :
+         {256u, 1024u, 4096u, 16384u, 65536u, 1000u, 3000u, 12000u, 48000u}) {
+        if (Selected(options, "fft")) {
+            results.push_back(BenchFft(options, size));
+        }
+    }
+    for (const auto size : {1024u, 16384u}) {
+        if (Selected(options, "db_stats")) {
+            results.push_back(BenchStats(options, size));
+        }
+        if (Selected(options, "holds")) {
+            results.push_back(BenchHolds(options, size));
+        }
+    }
+    for (const auto taps : {64u, 512u, 4096u}) {
+        if (Selected(options, "fir")) {
+            results.push_back(BenchFir(options, taps));
+        }
+    }
+    for (const auto bits : {8u, 6u, 4u}) {
+        if (Selected(options, "codec")) {
+            results.push_back(BenchCodec(options, bits));
+        }
+    }
+
+    for (const auto frequencies : {8u, 64u, 256u}) {
+        if (Selected(options, "monitor")) {
+            results.push_back(BenchMonitor(options, frequencies));
+        }
+    }
+    for (const auto channels : {8u, 32u, 64u}) {
+        if (Selected(options, "demod")) {
+            results.push_back(BenchDemod(options, channels));
+        }
+    }
+
+    const auto json =
+        "{\n" + SystemJson(options) + ResultsJson(results) + "}\n";
+    if (options.outputPath.empty()) {
+        std::cout << json;
+        return EXIT_SUCCESS;
+    }
+
+    auto file = fopen(options.outputPath.c_str(), "w");
+    if (nullptr == file) {
+        std::cerr << "Can't open " << options.outputPath << std::endl;
+        return EXIT_FAILURE;
+    }
+    fwrite(json.data(), 1u, json.size(), file);
+    fclose(file);
+
+    return EXIT_SUCCESS;
+} catch (const std::runtime_error& error) {
+    std::cerr << "Exception: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,323 @@
+#include "BurstExtractor.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#include "Metrics.h"
+
+namespace burst_extractor {
+namespace {
+constexpr size_t kFormatSize = 8u;
+// the floor follows a quieter stream faster than a louder one, so a burst
+// below the on threshold barely lifts it. A wider ratio biases it low.
+constexpr float kFloorDown = 1.0f / 256.0f;
+constexpr float kFloorUp = 1.0f / 1024.0f;
+// -120 dB full scale, a silent stream doesn't open a burst per envelope
+constexpr float kMinFloor = 1e-12f;
+// the SNR of a burst no stronger than the floor
+constexpr float kMinSnr = 1e-3f;
+
+std::int64_t NowUnixNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+#pragma pack(push, 1)
+struct PacketHeader {
+    char magic[4];
+    std::uint32_t size;
+    char format[kFormatSize];
+    std::uint64_t firstSample;
+    std::int64_t timeNs;
+    std::int64_t durationNs;
+    std::uint64_t samples;
+    double centerFrequency;
+    double sampleRate;
+    float snrDb;
+    float noiseDb;
+    std::uint32_t flags;
+};
+#pragma pack(pop)
+}  // namespace
+
+struct CBurstExtractor::Impl {
+    Impl(const int deviceNumber,
+         const BurstConfig& config,
+         const std::string& format,
+         const size_t sampleSize)
+        : mConfig(config)
+        , mFormat(format)
+        , mSampleSize(sampleSize)
+        , mEnvelope(std::max<size_t>(1u, config.envelopeSamples))
+        , mMaxSamples(std::max(mEnvelope, config.maxSamples))
+        , mOnRatio(std::pow(10.0f, config.onDb / 10.0f))
+        , mOffRatio(std::pow(10.0f, config.offDb / 10.0f))
+        , mTuned(config.tunedFrequency)
+        , mRequestedTuned(config.tunedFrequency)
+        , mBursts(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_bursts_total",
+              "Burst packets cut out of the stream",
+              {{"device", std::to_string(deviceNumber)}}))
+        , mInputSamples(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_burst_samples_total",
+              "Samples fed to the burst extractor and sent in its packets",
+              {{"device", std::to_string(deviceNumber)}, {"side", "in"}}))
+        , mOutputSamples(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_burst_samples_total",
+              "Samples fed to the burst extractor and sent in its packets",
+              {{"device", std::to_string(deviceNumber)}, {"side", "out"}})) {}
+
+    size_t TakePending(std::vector<std::uint8_t>& out);
+    size_t Decide(const float power, std::vector<std::uint8_t>& out);
+    void Emit(const std::uint64_t end,
+              const std::uint32_t flags,
+              std::vector<std::uint8_t>& out);
+    void Drop(const std::uint64_t end);
+    std::int64_t TimeOf(const std::uint64_t index) const;
+
+    const BurstConfig mConfig;
+    const std::string mFormat;
+    const size_t mSampleSize;
+    const size_t mEnvelope;
+    const size_t mMaxSamples;
+    const float mOnRatio;
+    const float mOffRatio;
+    double mTuned;
+
+    // raw samples from mBufferStart on: the pre padding while idle, the
+    // open packet and what follows it while active
+    std::vector<std::uint8_t> mBuffer;
+    std::uint64_t mBufferStart{0u};
+    // index of the next sample
+    std::uint64_t mIndex{0u};
+    // the first sample of the current block and its time
+    std::uint64_t mBlockIndex{0u};
+    std::int64_t mBlockTimeNs{0};
+
+    // the envelope being summed
+    float mPower{0.0f};
+    size_t mFill{0u};
+    float mFloor{0.0f};
+    bool mHasFloor{false};
+
+    bool mActive{false};
+    std::uint64_t mStart{0u};
+    // end of the last envelope above the off threshold
+    std::uint64_t mLastActive{0u};
+    double mSignalPower{0.0};
+    size_t mSignalEnvelopes{0u};
+    std::uint32_t mFlags{0u};
+
+    // set by SetTunedFrequency, taken at a block boundary
+    std::mutex mPendingLock;
+    double mRequestedTuned;
+    std::atomic<bool> mHasPending{false};
+
+    metrics::CCounter& mBursts;
+    metrics::CCounter& mInputSamples;
+    metrics::CCounter& mOutputSamples;
+};
+
+size_t CBurstExtractor::Impl::TakePending(std::vector<std::uint8_t>& out) {
+    if (not mHasPending.exchange(false, std::memory_order_acquire)) {
+        return 0u;
+    }
+    {
+        std::lock_guard lock(mPendingLock);
+        mTuned = mRequestedTuned;
+    }
+
+    // the samples so far belong to the old frequency, so do the floor and
+    // the pre padding
+    size_t packets(0u);
+    if (mActive) {
+        Emit(mIndex - mFill, mFlags | kBurstRetuned, out);
+        mActive = false;
+        packets = 1u;
+    }
+    Drop(mIndex - mFill);
+    mHasFloor = false;
+    return packets;
+}
+
+size_t CBurstExtractor::Impl::Decide(const float power,
+                                     std::vector<std::uint8_t>& out) {
+    const auto end = mIndex;
+    if (not mActive) {
+        if (not mHasFloor) {
+            mFloor = std::max(kMinFloor, power);
+            mHasFloor = true;
+            return 0u;
+        }
+        if (power < mFloor * mOnRatio) {
+            const auto alpha = power < mFloor ? kFloorDown : kFloorUp;
+            mFloor = std::max(kMinFloor, mFloor + alpha * (power - mFloor));
+            return 0u;
+        }
+
+        // the pre padding reaches back as far as the stream does
+        const auto start = end - mEnvelope;
+        mStart = std::max(mBufferStart,
+                          start > mConfig.preSamples
+                              ? start - mConfig.preSamples
+                              : std::uint64_t(0u));
+        mActive = true;
+        mSignalPower = 0.0;
+        mSignalEnvelopes = 0u;
+        mFlags = 0u;
+    }
+
+    if (power >= mFloor * mOffRatio) {
+        mLastActive = end;
+        mSignalPower += power;
+        ++mSignalEnvelopes;
+    } else if (end - mLastActive >= mConfig.postSamples) {
+        Emit(mLastActive + mConfig.postSamples, mFlags, out);
+        mActive = false;
+        return 1u;
+    }
+
+    if (end - mStart >= mMaxSamples) {
+        Emit(end, mFlags | kBurstSplit, out);
+        mStart = end;
+        mSignalPower = 0.0;
+        mSignalEnvelopes = 0u;
+        mFlags = kBurstContinued;
+        return 1u;
+    }
+    return 0u;
+}
+
+void CBurstExtractor::Impl::Emit(const std::uint64_t end,
+                                 const std::uint32_t flags,
+                                 std::vector<std::uint8_t>& out) {
+    const auto samples = end - mStart;
+    const auto bytes = samples * mSampleSize;
+    const auto signal =
+        0u == mSignalEnvelopes ? mFloor : mSignalPower / mSignalEnvelopes;
+
+    PacketHeader header{};
+    std::memcpy(header.magic, "KBP1", sizeof(header.magic));
+    header.size = static_cast<std::uint32_t>(sizeof(header) + bytes);
+    mFormat.copy(header.format, kFormatSize);
+    header.firstSample = mStart;
+    header.timeNs = TimeOf(mStart);
+    header.durationNs =
+        mConfig.sampleRate > 0.0
+            ? std::llround(samples * 1e9 / mConfig.sampleRate)
+            : 0;
+    header.samples = samples;
+    header.centerFrequency = mTuned;
+    header.sampleRate = mConfig.sampleRate;
+    header.snrDb = 10.0f * std::log10(std::max(
+                               kMinSnr, static_cast<float>(signal / mFloor) -
+                                            1.0f));
+    header.noiseDb = 10.0f * std::log10(mFloor);
+    header.flags = flags;
+
+    const auto* headerBytes = reinterpret_cast<const std::uint8_t*>(&header);
+    const auto* first =
+        mBuffer.data() + (mStart - mBufferStart) * mSampleSize;
+    out.insert(out.end(), headerBytes, headerBytes + sizeof(header));
+    out.insert(out.end(), first, first + bytes);
+
+    mBursts.Add();
+    mOutputSamples.Add(samples);
+    Drop(end);
+}
+
+void CBurstExtractor::Impl::Drop(const std::uint64_t end) {
+    if (end <= mBufferStart) {
+        return;
+    }
+    const auto bytes = std::min<size_t>((end - mBufferStart) * mSampleSize,
+                                        mBuffer.size());
+    mBuffer.erase(mBuffer.begin(), mBuffer.begin() + bytes);
+    mBufferStart = end;
+}
+
+std::int64_t CBurstExtractor::Impl::TimeOf(const std::uint64_t index) const {
+    if (mConfig.sampleRate <= 0.0) {
+        return mBlockTimeNs;
+    }
+    // the pre padding may start in an earlier block
+    const auto offset = static_cast<double>(
+        static_cast<std::int64_t>(index - mBlockIndex));
+    return mBlockTimeNs + std::llround(offset * 1e9 / mConfig.sampleRate);
+}
+
+CBurstExtractor::CBurstExtractor(const int deviceNumber,
+                                 const BurstConfig& config,
+                                 const std::string& format,
+                                 const size_t sampleSize)
+    : mImpl(std::make_unique<CBurstExtractor::Impl>(
+          deviceNumber, config, format, sampleSize)) {
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Bursts device #%d: on %.1f dB, off %.1f dB above the "
+                   "floor, padding %zu + %zu samples",
+                   deviceNumber,
+                   config.onDb,
+                   config.offDb,
+                   config.preSamples,
+                   config.postSamples);
+}
+
+CBurstExtractor::~CBurstExtractor() = default;
+
+void CBurstExtractor::SetTunedFrequency(const double frequency) {
+    std::lock_guard lock(mImpl->mPendingLock);
+    mImpl->mRequestedTuned = frequency;
+    mImpl->mHasPending.store(true, std::memory_order_release);
+}
+
+size_t CBurstExtractor::AddBlock(const void* data,
+                                 const dsp_kernels::Complex* samples,
+                                 const size_t count,
+                                 const long long timeNs,
+                                 std::vector<std::uint8_t>& out) {
+    auto& impl = *mImpl;
+    auto packets = impl.TakePending(out);
+
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    impl.mBuffer.insert(
+        impl.mBuffer.end(), bytes, bytes + count * impl.mSampleSize);
+    impl.mBlockIndex = impl.mIndex;
+    impl.mBlockTimeNs = 0 != timeNs ? timeNs : NowUnixNs();
+    impl.mInputSamples.Add(count);
+
+    for (size_t i = 0; i < count;) {
+        const auto take = std::min(count - i, impl.mEnvelope - impl.mFill);
+        float power(0.0f);
+        for (size_t j = i; j < i + take; ++j) {
+            power += samples[j].real() * samples[j].real() +
+                     samples[j].imag() * samples[j].imag();
+        }
+        impl.mPower += power;
+        impl.mFill += take;
+        impl.mIndex += take;
+        i += take;
+
+        if (impl.mEnvelope == impl.mFill) {
+            packets += impl.Decide(impl.mPower / impl.mEnvelope, out);
+            impl.mPower = 0.0f;
+            impl.mFill = 0u;
+        }
+    }
+
+    if (not impl.mActive) {
+        // keeps the pre padding of the envelope being summed
+        const auto start = impl.mIndex - impl.mFill;
+        if (start > impl.mConfig.preSamples) {
+            impl.Drop(start - impl.mConfig.preSamples);
+        }
+    }
+    return packets;
+}
+
+}  // namespace burst_extractor
@@ -0,0 +1,106 @@
+#ifndef __BURST_EXTRACTOR_H__
+#define __BURST_EXTRACTOR_H__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DspKernels.h"
+
+namespace burst_extractor {
+struct BurstConfig {
+    // a burst starts when the envelope reaches onDb above the noise floor
+    // and ends once it stayed offDb above it or lower for postSamples
+    float onDb{10.0f};
+    float offDb{6.0f};
+    // samples kept before the first and after the last active envelope
+    size_t preSamples{1024u};
+    size_t postSamples{1024u};
+    // samples averaged into one envelope value
+    size_t envelopeSamples{64u};
+    // a longer burst is cut into packets of this many samples
+    size_t maxSamples{1u << 20};
+    // samples per second of the stream and center frequency the device is
+    // tuned to
+    double sampleRate{0.0};
+    double tunedFrequency{0.0};
+};
+
+/**
+ * @brief Packet flags
+ */
+enum BurstFlags : std::uint32_t {
+    // the burst goes on in the next packet
+    kBurstSplit = 1u,
+    // the packet continues the burst of the previous one
+    kBurstContinued = 2u,
+    // a retune of the device cut the burst short
+    kBurstRetuned = 4u
+};
+
+/**
+ * @brief Cuts the active segments out of a stream: the mean power of
+ * every envelopeSamples samples is compared with a noise floor that
+ * follows the idle stream, quickly down and slowly up. A burst opens at
+ * onDb above the floor and closes postSamples after the envelope last
+ * was above offDb, the floor is held meanwhile. A burst reopening inside
+ * the post padding is the same burst.
+ *
+ * Each burst is a self-describing packet, little-endian:
+ *   "KBP1", u32 packet bytes including this header, char[8] format, u64
+ *   index of the first sample in the stream, i64 time of the first sample
+ *   in ns, i64 duration in ns, u64 samples, f64 center frequency in Hz,
+ *   f64 sample rate, f32 SNR in dB, f32 noise floor in dB full scale,
+ *   u32 flags (BurstFlags), then the interleaved samples as they were
+ *   read
+ * The time is the hardware time of the blocks when they have one, the
+ * wall clock in ns since the epoch otherwise.
+ */
+class CBurstExtractor {
+   public:
+    /**
+     * @param deviceNumber number device, labels the metrics
+     * @param config thresholds, padding and stream of the extractor
+     * @param format stream element format, e.g. "CS8"
+     * @param sampleSize bytes of one complex sample
+     */
+    CBurstExtractor(const int deviceNumber,
+                    const BurstConfig& config,
+                    const std::string& format,
+                    const size_t sampleSize);
+    CBurstExtractor(const CBurstExtractor&) = delete;
+    CBurstExtractor& operator=(const CBurstExtractor&) = delete;
+    ~CBurstExtractor();
+
+    /**
+     * @brief Tells the extractor about a retune of the device, thread
+     * safe, applied at the next block. An open burst is closed.
+     */
+    void SetTunedFrequency(const double frequency);
+
+    /**
+     * @brief Feeds a block, appends the packets of the bursts it
+     * completes. Called by one thread at a time.
+     * @param data interleaved samples as read
+     * @param samples the same samples converted, the envelope is taken
+     * of them
+     * @param count number of samples
+     * @param timeNs time of the first sample, 0 if the block has none
+     * @param out the packets are appended back to back
+     * @return number of packets appended
+     */
+    size_t AddBlock(const void* data,
+                    const dsp_kernels::Complex* samples,
+                    const size_t count,
+                    const long long timeNs,
+                    std::vector<std::uint8_t>& out);
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace burst_extractor
+
+#endif  // __BURST_EXTRACTOR_H__
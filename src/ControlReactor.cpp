@@ -0,0 +1,310 @@
+#include "ControlReactor.h"
+
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <map>
+#include <sstream>
+#include <system_error>
+
+#include "Utility.h"
+
+namespace control_reactor {
+namespace {
+constexpr auto kMaxEvents = 8;
+constexpr auto kConsoleBufferSize = 256u;
+// a longer console line is discarded up to its newline
+constexpr size_t kMaxConsoleLine = 1024u;
+
+class CFileDescriptor {
+   public:
+    explicit CFileDescriptor(const int fd, const char* what) : mFd(fd) {
+        if (mFd < 0) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+    }
+    CFileDescriptor(const CFileDescriptor&) = delete;
+    CFileDescriptor& operator=(const CFileDescriptor&) = delete;
+    ~CFileDescriptor() {
+        close(mFd);
+    }
+
+    int Get() const {
+        return mFd;
+    }
+
+   private:
+    const int mFd;
+};
+
+sigset_t ShutdownSignals() {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    return mask;
+}
+
+sigset_t BlockShutdownSignals() {
+    const auto mask = ShutdownSignals();
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    return mask;
+}
+}  // namespace
+
+struct CControlReactor::Impl {
+    Impl()
+        : mSignalMask(BlockShutdownSignals())
+        , mEpoll(epoll_create1(EPOLL_CLOEXEC), "epoll_create1")
+        , mSignal(signalfd(-1, &mSignalMask, SFD_NONBLOCK | SFD_CLOEXEC),
+                  "signalfd")
+        , mTimer(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC),
+                 "timerfd_create")
+        , mEvent(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "eventfd") {
+        Watch(mSignal.Get());
+        Watch(mTimer.Get());
+        Watch(mEvent.Get());
+    }
+
+    void Watch(const int fd) const;
+    void OnSignal();
+    void OnTimer();
+    void OnEvent();
+    void OnConsole();
+    void Dispatch(const std::string& commandLine);
+    void PrintHelp() const;
+
+    struct Command {
+        std::string mHelp;
+        CommandHandler mHandler;
+    };
+
+    const sigset_t mSignalMask;
+    const CFileDescriptor mEpoll;
+    const CFileDescriptor mSignal;
+    const CFileDescriptor mTimer;
+    const CFileDescriptor mEvent;
+    int mConsoleFd{-1};
+    std::string mConsoleLine;
+    // the line passed kMaxConsoleLine, the rest up to the newline is dropped
+    bool mConsoleOverlong{false};
+
+    TimerHandler mTimerHandler;
+    std::map<std::string, Command> mCommands;
+
+    std::atomic_bool mStopRequested{false};
+};
+
+void CControlReactor::Impl::Watch(const int fd) const {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (0 != epoll_ctl(mEpoll.Get(), EPOLL_CTL_ADD, fd, &event)) {
+        throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+    }
+}
+
+void CControlReactor::Impl::OnSignal() {
+    signalfd_siginfo info{};
+    while (sizeof(info) == read(mSignal.Get(), &info, sizeof(info))) {
+        SoapySDR::logf(
+            SOAPY_SDR_NOTICE, "Signal %u received, stopping", info.ssi_signo);
+        mStopRequested = true;
+    }
+}
+
+void CControlReactor::Impl::OnTimer() {
+    std::uint64_t expirations(0);
+    if (sizeof(expirations) ==
+            read(mTimer.Get(), &expirations, sizeof(expirations)) &&
+        mTimerHandler) {
+        mTimerHandler();
+    }
+}
+
+void CControlReactor::Impl::OnEvent() {
+    // RequestStop wakes the loop, the flag is checked by Run
+    std::uint64_t count(0);
+    [[maybe_unused]] const auto size =
+        read(mEvent.Get(), &count, sizeof(count));
+}
+
+void CControlReactor::Impl::OnConsole() {
+    char buffer[kConsoleBufferSize];
+    const auto size = read(mConsoleFd, buffer, sizeof(buffer));
+
+    if (size <= 0) {
+        // EOF, e.g. started detached with stdin on /dev/null
+        epoll_ctl(mEpoll.Get(), EPOLL_CTL_DEL, mConsoleFd, nullptr);
+        mConsoleFd = -1;
+        return;
+    }
+
+    for (auto i = 0; i < size; ++i) {
+        if ('\n' != buffer[i]) {
+            if (mConsoleOverlong) {
+                continue;
+            }
+            if (kMaxConsoleLine == mConsoleLine.size()) {
+                SoapySDR::logf(SOAPY_SDR_WARNING,
+                               "Console line longer than %zu characters "
+                               "discarded",
+                               kMaxConsoleLine);
+                mConsoleLine.clear();
+                mConsoleOverlong = true;
+                continue;
+            }
+            mConsoleLine.push_back(buffer[i]);
+            continue;
+        }
+
+        if (not mConsoleOverlong) {
+            Dispatch(mConsoleLine);
+        }
+        mConsoleLine.clear();
+        mConsoleOverlong = false;
+    }
+}
+
+void CControlReactor::Impl::Dispatch(const std::string& commandLine) {
+    std::istringstream stream(commandLine);
+    std::string name;
+    if (not(stream >> name)) {
+        return;
+    }
+
+    CommandArgs args;
+    for (std::string arg; stream >> arg;) {
+        args.push_back(arg);
+    }
+
+    const auto it = mCommands.find(name);
+    if (mCommands.end() == it) {
+        SoapySDR::logf(SOAPY_SDR_WARNING,
+                       "Unknown command: %s, try \"help\"",
+                       name.c_str());
+        return;
+    }
+
+    try {
+        it->second.mHandler(args);
+    } catch (const std::exception& error) {
+        SoapySDR::logf(
+            SOAPY_SDR_ERROR, "Command %s: %s", name.c_str(), error.what());
+    }
+}
+
+void CControlReactor::Impl::PrintHelp() const {
+    for (const auto& command : mCommands) {
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "  %-8s %s",
+                       command.first.c_str(),
+                       command.second.mHelp.c_str());
+    }
+}
+
+CControlReactor::CControlReactor()
+    : mImpl(std::make_unique<CControlReactor::Impl>()) {
+    RegisterCommand(
+        "help", "print this list", [impl = mImpl.get()](const CommandArgs&) {
+            impl->PrintHelp();
+        });
+    RegisterCommand("quit",
+                    "stop streaming and exit",
+                    [impl = mImpl.get()](const CommandArgs&) {
+                        impl->mStopRequested = true;
+                    });
+}
+
+CControlReactor::CControlReactor(CControlReactor&&) = default;
+
+CControlReactor::~CControlReactor() = default;
+
+void CControlReactor::SetStatusTimer(const std::chrono::milliseconds period,
+                                     TimerHandler handler) {
+    mImpl->mTimerHandler = std::move(handler);
+
+    const auto seconds =
+        std::chrono::duration_cast<std::chrono::seconds>(period);
+    itimerspec spec{};
+    spec.it_interval.tv_sec = seconds.count();
+    spec.it_interval.tv_nsec =
+        std::chrono::nanoseconds(period - seconds).count();
+    spec.it_value = spec.it_interval;
+
+    timerfd_settime(mImpl->mTimer.Get(), 0, &spec, nullptr);
+}
+
+void CControlReactor::RegisterCommand(const std::string& name,
+                                      const std::string& help,
+                                      CommandHandler handler) {
+    mImpl->mCommands[name] = Impl::Command{help, std::move(handler)};
+}
+
+bool CControlReactor::EnableConsoleCommands(const int fd) {
+    try {
+        mImpl->Watch(fd);
+    } catch (const std::system_error& error) {
+        // regular files and /dev/null can't be polled
+        SoapySDR::logf(SOAPY_SDR_NOTICE,
+                       "Console commands disabled: %s",
+                       error.what());
+        return false;
+    }
+
+    mImpl->mConsoleFd = fd;
+    return true;
+}
+
+void CControlReactor::RequestStop() {
+    mImpl->mStopRequested = true;
+
+    const std::uint64_t one(1);
+    [[maybe_unused]] const auto size =
+        write(mImpl->mEvent.Get(), &one, sizeof(one));
+}
+
+bool CControlReactor::IsStopRequested() const {
+    return mImpl->mStopRequested;
+}
+
+void CControlReactor::Run() {
+    LOG_FUNC();
+
+    auto& impl = *mImpl;
+
+    while (not impl.mStopRequested) {
+        epoll_event events[kMaxEvents];
+        const auto count =
+            epoll_wait(impl.mEpoll.Get(), events, kMaxEvents, -1);
+
+        if (count < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            throw std::system_error(
+                errno, std::generic_category(), "epoll_wait");
+        }
+
+        for (auto i = 0; i < count; ++i) {
+            const auto fd = events[i].data.fd;
+            if (impl.mSignal.Get() == fd) {
+                impl.OnSignal();
+            } else if (impl.mTimer.Get() == fd) {
+                impl.OnTimer();
+            } else if (impl.mEvent.Get() == fd) {
+                impl.OnEvent();
+            } else if (impl.mConsoleFd == fd) {
+                impl.OnConsole();
+            }
+        }
+    }
+}
+
+}  // namespace control_reactor
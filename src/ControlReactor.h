@@ -0,0 +1,78 @@
+#ifndef __CONTROL_REACTOR_H__
+#define __CONTROL_REACTOR_H__
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace control_reactor {
+class CControlReactor {
+   public:
+    using CommandArgs = std::vector<std::string>;
+    using CommandHandler = std::function<void(const CommandArgs& args)>;
+    using TimerHandler = std::function<void()>;
+
+    /**
+     * @brief ctor, blocks SIGINT and SIGTERM in the calling thread so
+     * threads started afterwards inherit the mask and the signals are only
+     * delivered through the reactor. Create it before any other thread.
+     * @throw std::system_error if a descriptor can't be created
+     */
+    CControlReactor();
+    CControlReactor(const CControlReactor&) = delete;
+    CControlReactor& operator=(const CControlReactor&) = delete;
+    CControlReactor(CControlReactor&&);
+    ~CControlReactor();
+
+    /**
+     * @brief Arms the periodic status timer
+     * @param period interval between handler calls, zero disarms the timer
+     * @param handler called from the reactor thread
+     */
+    void SetStatusTimer(const std::chrono::milliseconds period,
+                        TimerHandler handler);
+
+    /**
+     * @brief Registers a runtime command, the first word of a command line
+     * selects the handler, the rest is passed as arguments
+     * @param name command word
+     * @param help one line description printed by the "help" command
+     * @param handler called from the reactor thread
+     */
+    void RegisterCommand(const std::string& name,
+                         const std::string& help,
+                         CommandHandler handler);
+
+    /**
+     * @brief Reads command lines from the descriptor (stdin by default)
+     * @param fd a readable descriptor, stays owned by the caller
+     * @return false if the descriptor can't be polled, otherwise true
+     */
+    bool EnableConsoleCommands(const int fd = 0);
+
+    /**
+     * @brief Makes Run return, thread safe
+     */
+    void RequestStop();
+
+    /**
+     * @brief Indicates if a stop was requested or a signal received
+     */
+    bool IsStopRequested() const;
+
+    /**
+     * @brief Blocks the calling thread dispatching signals, timers and
+     * commands until SIGINT, SIGTERM or RequestStop
+     */
+    void Run();
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace control_reactor
+
+#endif  // __CONTROL_REACTOR_H__
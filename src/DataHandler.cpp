@@ -1,16 +1,168 @@
 #include "DataHandler.h"
 
+#include <SoapySDR/Constants.h>
+#include <algorithm>
+#include <chrono>
 #include <complex>
 #include <future>
 #include <kfr/base.hpp>
 #include <kfr/dft.hpp>
 #include <kfr/dsp.hpp>
-#include <kfr/io.hpp>
 
+#include "AllocationTracker.h"
+#include "DspKernels.h"
+#include "Metrics.h"
+#include "ThreadPlacement.h"
 #include "Utility.h"
 
 namespace data_handler {
-struct CDataHandler::Impl {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+std::uint64_t ElapsedNs(const Clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                                since)
+        .count();
+}
+
+struct HandlerMetrics {
+    explicit HandlerMetrics(const int deviceNumber)
+        : HandlerMetrics(metrics::CMetricsRegistry::Instance(),
+                         std::to_string(deviceNumber)) {}
+
+    HandlerMetrics(metrics::CMetricsRegistry& registry,
+                   const std::string& device)
+        : mBlocks(registry.GetCounter("kraken_blocks_processed_total",
+                                      "Blocks taken from the data queue",
+                                      {{"device", device}}))
+        , mFftFrames(registry.GetCounter("kraken_fft_frames_total",
+                                         "FFT frames computed",
+                                         {{"device", device}}))
+        , mConvertTime(registry.GetHistogram(
+              "kraken_stage_seconds",
+              "Processing time per block and stage",
+              {{"device", device}, {"stage", "convert"}}))
+        , mFftTime(registry.GetHistogram(
+              "kraken_stage_seconds",
+              "Processing time per block and stage",
+              {{"device", device}, {"stage", "fft"}}))
+        , mStatsTime(registry.GetHistogram(
+              "kraken_stage_seconds",
+              "Processing time per block and stage",
+              {{"device", device}, {"stage", "stats"}}))
+        , mWaterfallTime(registry.GetHistogram(
+              "kraken_stage_seconds",
+              "Processing time per block and stage",
+              {{"device", device}, {"stage", "waterfall"}}))
+        , mReducerTime(registry.GetHistogram(
+              "kraken_stage_seconds",
+              "Processing time per block and stage",
+              {{"device", device}, {"stage", "reducer"}}))
+        , mZoomTime(registry.GetHistogram(
+              "kraken_stage_seconds",
+              "Processing time per block and stage",
+              {{"device", device}, {"stage", "zoom"}}))
+        , mMonitorTime(registry.GetHistogram(
+              "kraken_stage_seconds",
+              "Processing time per block and stage",
+              {{"device", device}, {"stage", "monitor"}}))
+        , mDemodTime(registry.GetHistogram(
+              "kraken_stage_seconds",
+              "Processing time per block and stage",
+              {{"device", device}, {"stage", "demod"}})) {}
+
+    metrics::CCounter& mBlocks;
+    metrics::CCounter& mFftFrames;
+    metrics::CHistogram& mConvertTime;
+    metrics::CHistogram& mFftTime;
+    metrics::CHistogram& mStatsTime;
+    metrics::CHistogram& mWaterfallTime;
+    metrics::CHistogram& mReducerTime;
+    metrics::CHistogram& mZoomTime;
+    metrics::CHistogram& mMonitorTime;
+    metrics::CHistogram& mDemodTime;
+};
+
+// work buffers of the transform, kept between blocks so the steady state
+// neither allocates nor touches new pages
+struct FftBuffers {
+    void Prepare(const size_t size) {
+        if (size == mSize) {
+            return;
+        }
+
+        mSize = size;
+        mPlan = std::make_unique<kfr::dft_plan<kfr::fbase>>(size);
+        mIn.resize(size);
+        mOut.resize(size);
+        mTemp.resize(mPlan->temp_size);
+        mDb.resize(size);
+
+        thread_placement::PrefaultBuffer(mIn.data(),
+                                         mIn.size() * sizeof(mIn[0]));
+        thread_placement::PrefaultBuffer(mOut.data(),
+                                         mOut.size() * sizeof(mOut[0]));
+        thread_placement::PrefaultBuffer(mTemp.data(), mTemp.size());
+        thread_placement::PrefaultBuffer(mDb.data(),
+                                         mDb.size() * sizeof(mDb[0]));
+
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "FFT size %zu, temp %zu bytes",
+                       size,
+                       mPlan->temp_size);
+    }
+
+    size_t mSize{0u};
+    std::unique_ptr<kfr::dft_plan<kfr::fbase>> mPlan;
+    kfr::univector<kfr::complex<kfr::fbase>> mIn;
+    kfr::univector<kfr::complex<kfr::fbase>> mOut;
+    kfr::univector<kfr::u8> mTemp;
+    kfr::univector<kfr::fbase> mDb;
+};
+}  // namespace
+
+template <class Sample>
+struct CDataHandler<Sample>::Impl {
+    // bytes of one complex sample in the blocks
+    static constexpr size_t kSampleSize =
+        2u * sizeof(typename Sample::Component);
+
+    Impl(const int deviceNumber, const HandlerConfig& config)
+        : mDeviceNumber(deviceNumber)
+        , mSpectrum(config.spectrum)
+        , mMetrics(deviceNumber)
+        , mGovernor(deviceNumber, config.governor)
+        , mResults(deviceNumber, config.results) {
+        if (0u != config.correction.updateBlocks) {
+            mCorrector = std::make_unique<iq_correction::CIqCorrector>(
+                deviceNumber, config.correction);
+        }
+        if (not config.waterfall.outputDir.empty()) {
+            mWaterfall = std::make_unique<waterfall::CWaterfall>(
+                deviceNumber, config.waterfall);
+        }
+        if (not config.reducer.outputDir.empty()) {
+            mReducer = std::make_unique<spectrum_reducer::CSpectrumReducer>(
+                deviceNumber, config.reducer);
+        }
+        if (not config.capture.outputDir.empty()) {
+            mCapture = std::make_unique<triggered_capture::CTriggeredCapture>(
+                deviceNumber, config.capture, Sample::kFormat, kSampleSize);
+        }
+        if (not config.zoom.outputDir.empty()) {
+            mZoom = std::make_unique<zoom_fft::CZoomFft>(deviceNumber,
+                                                         config.zoom);
+        }
+        if (not config.monitor.outputDir.empty()) {
+            mMonitor = std::make_unique<sparse_monitor::CSparseMonitor>(
+                deviceNumber, config.monitor);
+        }
+        if (not config.demod.outputDir.empty()) {
+            mDemod = std::make_unique<demod_bank::CDemodBank>(deviceNumber,
+                                                              config.demod);
+        }
+    }
+
     ~Impl() {
         LOG_FUNC();
 
@@ -20,82 +172,278 @@ struct CDataHandler::Impl {
     }
 
     void DataHandler();
-    data_queue::RawQueue mQueue;
+    // ends the trace of a sampled block, called on every way out of a
+    // block so shed and monitor-only blocks stay in the histogram
+    void RecordLatency(latency_tracer::BlockStamps& stamps) {
+        if (stamps.sampled) {
+            stamps.processEnd = latency_tracer::NowNs();
+            mLatencyTracer.Record(stamps);
+        }
+    }
+    void Convert(const data_queue::DataBlock<Sample>& block,
+                 const size_t count,
+                 dsp_kernels::Complex* out);
+    data_queue::BlockQueue<Sample> mQueue;
+    const int mDeviceNumber;
+    const bool mSpectrum;
+    HandlerMetrics mMetrics;
+    latency_tracer::CLatencyTracer mLatencyTracer;
+    load_governor::CLoadGovernor mGovernor;
+    result_log::CResultLog mResults;
+    FftBuffers mBuffers;
+    // the reduced FFT size of the governor, kept apart so a level change
+    // back and forth doesn't plan again
+    FftBuffers mSmallBuffers;
+    std::unique_ptr<iq_correction::CIqCorrector> mCorrector;
+    std::unique_ptr<waterfall::CWaterfall> mWaterfall;
+    std::unique_ptr<spectrum_reducer::CSpectrumReducer> mReducer;
+    std::unique_ptr<triggered_capture::CTriggeredCapture> mCapture;
+    std::unique_ptr<zoom_fft::CZoomFft> mZoom;
+    std::unique_ptr<sparse_monitor::CSparseMonitor> mMonitor;
+    std::unique_ptr<demod_bank::CDemodBank> mDemod;
+    // the whole block converted for the zoom, the monitor and the
+    // demodulators, the transform copies from it
+    kfr::univector<dsp_kernels::Complex> mBlockIn;
     std::future<void> mQueueHandle;
 };
 
-void CDataHandler::Impl::DataHandler() {
+template <class Sample>
+void CDataHandler<Sample>::Impl::Convert(
+    const data_queue::DataBlock<Sample>& block,
+    const size_t count,
+    dsp_kernels::Complex* out) {
+    if (mCorrector) {
+        mCorrector->Convert<Sample>(block.data.data(), count, out);
+    } else {
+        dsp_kernels::Convert<Sample>(block.data.data(), count, out);
+    }
+}
+
+template <class Sample>
+void CDataHandler<Sample>::Impl::DataHandler() {
     LOG_FUNC();
 
+    thread_placement::ApplyCurrentThread(
+        thread_placement::ThreadRole::Dsp,
+        "kraken-dsp" + std::to_string(mDeviceNumber));
+
+    // reused for every block, the copy from the queue keeps its capacity
+    data_queue::DataBlock<Sample> block;
     while (not mQueue.IsQueueStopped()) {
         mQueue.WaitDataReady();
 
-        std::vector<std::int8_t> data;
-        while (mQueue.Pop(data)) {
-            SoapySDR::logf(
-                SOAPY_SDR_INFO, "Received msg size: %u", data.size());
-
-            // fft size
-            const size_t size = data.size() * 0.5;
-            std::vector<kfr::complex<kfr::fbase>> complexData(size * 0.5);
-            for (size_t i = 0; i < data.size() - 1; i += 2) {
-                complexData.push_back(
-                    kfr::complex<kfr::fbase>(data[i], data[i + 1]));
+        // stamped before each pop, the dispatch is the pop and the copy
+        // of the block out of the queue
+        for (auto ready = latency_tracer::NowNs(); mQueue.Pop(block);
+             ready = latency_tracer::NowNs()) {
+            auto& stamps = block.stamps;
+            if (stamps.sampled) {
+                // a block pushed after the stamp waited for no one
+                stamps.dequeue = std::max(stamps.enqueue, ready);
+                stamps.processStart = latency_tracer::NowNs();
+            }
+
+            mMetrics.mBlocks.Add();
+
+            // one complex sample per I/Q pair
+            const size_t samples = block.Samples();
+            if (0u == samples) {
+                RecordLatency(stamps);
+                continue;
             }
+            const auto blockStart = Clock::now();
 
-            // initialize input & output buffers
-            // kfr::univector<kfr::complex<kfr::fbase>, size> in = kfr::sin(
-            //     kfr::linspace(0.0, kfr::c_pi<kfr::fbase, 2> * 4.0, size));
-            kfr::univector<kfr::complex<kfr::fbase>> in(complexData.begin(),
-                                                        complexData.end());
+            // the capture keeps every block, whatever the governor sheds
+            if (mCapture) {
+                allocation_tracker::CStageScope stage("capture");
+                mCapture->AddBlock(block.data.data(), samples * kSampleSize);
+            }
 
-            kfr::univector<kfr::complex<kfr::fbase>> out(size);
-            out = kfr::scalar(kfr::qnan);
+            // the zoom, the monitor and the demodulators need every sample
+            // whatever the governor sheds, the block is converted once for
+            // them and the transform
+            const auto convertAll = mZoom || mMonitor || mDemod;
+            if (convertAll) {
+                const auto convertStart = Clock::now();
+                allocation_tracker::CStageScope stage("convert");
+                mBlockIn.resize(samples);
+                Convert(block, samples, mBlockIn.data());
+                mMetrics.mConvertTime.Observe(ElapsedNs(convertStart));
+            }
+            if (mZoom) {
+                const auto zoomStart = Clock::now();
+                allocation_tracker::CStageScope stage("zoom");
+                mZoom->AddSamples(mBlockIn.data(), samples);
+                mMetrics.mZoomTime.Observe(ElapsedNs(zoomStart));
+            }
+            if (mMonitor) {
+                const auto monitorStart = Clock::now();
+                allocation_tracker::CStageScope stage("monitor");
+                mMonitor->AddSamples(mBlockIn.data(), samples);
+                mMetrics.mMonitorTime.Observe(ElapsedNs(monitorStart));
+            }
+            if (mDemod) {
+                const auto demodStart = Clock::now();
+                allocation_tracker::CStageScope stage("demod");
+                mDemod->AddSamples(mBlockIn.data(), samples);
+                mMetrics.mDemodTime.Observe(ElapsedNs(demodStart));
+            }
 
-            // initialize fft
-            const kfr::dft_plan<kfr::fbase> dft(size);
+            if (not mSpectrum) {
+                RecordLatency(stamps);
+                mGovernor.Account(ElapsedNs(blockStart), mQueue.Size());
+                continue;
+            }
 
-            dft.dump();
+            const auto plan = mGovernor.Plan(samples);
+            if (not plan.transform) {
+                RecordLatency(stamps);
+                mGovernor.Account(ElapsedNs(blockStart), mQueue.Size());
+                continue;
+            }
 
-            SoapySDR::logf(SOAPY_SDR_INFO, "dft.temp_size: %u", dft.temp_size);
+            // fft size, the whole block at full quality
+            const auto size = plan.fftSize;
+            auto& buffers = samples == size ? mBuffers : mSmallBuffers;
+            auto stageStart = Clock::now();
+            allocation_tracker::SetStage("convert");
+            buffers.Prepare(size);
 
-            // allocate work buffer for fft (if needed)
-            kfr::univector<kfr::u8> temp(dft.temp_size);
+            auto& in = buffers.mIn;
+            if (convertAll) {
+                std::copy(
+                    mBlockIn.begin(), mBlockIn.begin() + size, in.begin());
+            } else {
+                Convert(block, size, in.data());
+                mMetrics.mConvertTime.Observe(ElapsedNs(stageStart));
+            }
+            stageStart = Clock::now();
+            allocation_tracker::SetStage("fft");
 
             // perform forward fft
-            dft.execute(out, in, temp);
+            auto& out = buffers.mOut;
+            buffers.mPlan->execute(out, in, buffers.mTemp);
 
             // scale output
             out = out / size;
+            mMetrics.mFftTime.Observe(ElapsedNs(stageStart));
+            mMetrics.mFftFrames.Add();
+            stageStart = Clock::now();
+            allocation_tracker::SetStage("stats");
 
             // get magnitude and convert to decibels
-            kfr::univector<kfr::fbase> dB = kfr::amp_to_dB(kfr::cabs(out));
+            auto& dB = buffers.mDb;
+            dsp_kernels::MagnitudeDb(out, dB);
+            const auto stats = dsp_kernels::ComputeStats(dB);
 
-            kfr::println("max dB: ", kfr::maxof(dB));
-            kfr::println("min dB: ", kfr::minof(dB));
-            kfr::println("mean dB: ", kfr::mean(dB));
-            kfr::println("rms dB: ", kfr::rms(dB));
+            mResults.Add(stats,
+                         dB.data(),
+                         dB.size(),
+                         0 != (block.flags & SOAPY_SDR_HAS_TIME)
+                             ? block.timeNs
+                             : 0);
+            mMetrics.mStatsTime.Observe(ElapsedNs(stageStart));
 
-            // kfr::println(in);
-            // kfr::println();
-            // kfr::println(dB);
+            if (mCapture) {
+                mCapture->CheckLevel(stats.max);
+            }
+
+            if (mWaterfall && plan.display) {
+                stageStart = Clock::now();
+                allocation_tracker::SetStage("waterfall");
+                mWaterfall->AddFrame(dB);
+                mMetrics.mWaterfallTime.Observe(ElapsedNs(stageStart));
+            }
+
+            if (mReducer && plan.display) {
+                stageStart = Clock::now();
+                allocation_tracker::SetStage("reducer");
+                mReducer->AddFrame(dB);
+                mMetrics.mReducerTime.Observe(ElapsedNs(stageStart));
+            }
+
+            RecordLatency(stamps);
+            allocation_tracker::SetStage(nullptr);
+            mGovernor.Account(ElapsedNs(blockStart), mQueue.Size());
         }
     }
 }
 
-CDataHandler::CDataHandler() : mImpl(std::make_unique<CDataHandler::Impl>()) {}
-CDataHandler::~CDataHandler() = default;
-CDataHandler::CDataHandler(CDataHandler&&) = default;
+template <class Sample>
+CDataHandler<Sample>::CDataHandler(const int deviceNumber,
+                                   const HandlerConfig& config)
+    : mImpl(std::make_unique<CDataHandler<Sample>::Impl>(deviceNumber,
+                                                         config)) {}
+
+template <class Sample>
+CDataHandler<Sample>::~CDataHandler() = default;
 
-void CDataHandler::StartHandling() const {
+template <class Sample>
+CDataHandler<Sample>::CDataHandler(CDataHandler&&) = default;
+
+template <class Sample>
+void CDataHandler<Sample>::StartHandling() const {
     LOG_FUNC();
 
-    mImpl->mQueueHandle = std::async(
-        std::launch::async, &CDataHandler::Impl::DataHandler, mImpl.get());
+    mImpl->mQueueHandle =
+        std::async(std::launch::async,
+                   &CDataHandler<Sample>::Impl::DataHandler,
+                   mImpl.get());
+}
+
+template <class Sample>
+void CDataHandler<Sample>::StopQueue() const {
+    mImpl->mQueue.StopQueue();
+}
+
+template <class Sample>
+size_t CDataHandler<Sample>::GetQueueSize() const {
+    return mImpl->mQueue.Size();
+}
+
+template <class Sample>
+latency_tracer::CLatencyTracer& CDataHandler<Sample>::GetLatencyTracer()
+    const {
+    return mImpl->mLatencyTracer;
+}
+
+template <class Sample>
+bool CDataHandler<Sample>::TriggerCapture() const {
+    if (not mImpl->mCapture) {
+        return false;
+    }
+
+    mImpl->mCapture->Trigger(triggered_capture::TriggerSource::Command);
+    return true;
 }
 
-data_queue::RawQueue& CDataHandler::GetQueue() const {
+template <class Sample>
+bool CDataHandler<Sample>::SetZoomBand(const double center,
+                                       const double span) const {
+    return mImpl->mZoom && mImpl->mZoom->SetBand(center, span);
+}
+
+template <class Sample>
+void CDataHandler<Sample>::SetTunedFrequency(const double frequency) const {
+    if (mImpl->mZoom) {
+        mImpl->mZoom->SetTunedFrequency(frequency);
+    }
+    if (mImpl->mMonitor) {
+        mImpl->mMonitor->SetTunedFrequency(frequency);
+    }
+    if (mImpl->mDemod) {
+        mImpl->mDemod->SetTunedFrequency(frequency);
+    }
+}
+
+template <class Sample>
+data_queue::BlockQueue<Sample>& CDataHandler<Sample>::GetQueue() const {
     return mImpl->mQueue;
 }
 
+template class CDataHandler<sample_types::CS8>;
+template class CDataHandler<sample_types::CU8>;
+template class CDataHandler<sample_types::CS16>;
+template class CDataHandler<sample_types::CF32>;
+
 }  // namespace data_handler
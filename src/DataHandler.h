@@ -4,16 +4,116 @@
 #include <memory>
 
 #include "DataQueue.h"
+#include "DemodBank.h"
+#include "IqCorrection.h"
+#include "LatencyTracer.h"
+#include "LoadGovernor.h"
+#include "ResultLog.h"
+#include "SparseMonitor.h"
+#include "SpectrumReducer.h"
+#include "TriggeredCapture.h"
+#include "Waterfall.h"
+#include "ZoomFft.h"
 
 namespace data_handler {
-class CDataHandler {
+struct HandlerConfig {
+    // DC and IQ imbalance correction fused with the conversion
+    iq_correction::CorrectionConfig correction;
+    // waterfall tiles of the spectra, off while outputDir is empty
+    waterfall::WaterfallConfig waterfall;
+    // display traces of the spectra, off while outputDir is empty
+    spectrum_reducer::ReducerConfig reducer;
+    // raw captures around triggers, off while outputDir is empty
+    triggered_capture::CaptureConfig capture;
+    // degrades the processing while the handler falls behind
+    load_governor::GovernorConfig governor;
+    // high resolution spectrum of a narrow band, off while outputDir is
+    // empty
+    zoom_fft::ZoomConfig zoom;
+    // power of a list of frequencies, off while outputDir is empty
+    sparse_monitor::MonitorConfig monitor;
+    // audio of a list of narrowband channels, off while outputDir is empty
+    demod_bank::DemodConfig demod;
+    // records and console summary of the spectra
+    result_log::ResultConfig results;
+    // false - no full transform per block, only the stages that take the
+    // samples run, e.g. when the monitor or the demodulators are all that
+    // is wanted
+    bool spectrum{true};
+};
+
+/**
+ * @brief Format independent view of a handler, used by the device manager
+ */
+class IDataHandler {
    public:
-    CDataHandler();
+    virtual void StartHandling() const = 0;
+
+    /**
+     * @brief Stops the input queue, the handler thread finishes
+     */
+    virtual void StopQueue() const = 0;
+
+    /**
+     * @brief Returns the number of blocks waiting in the input queue
+     */
+    virtual size_t GetQueueSize() const = 0;
+
+    /**
+     * @brief Returns the latency histograms of the sampled blocks
+     */
+    virtual latency_tracer::CLatencyTracer& GetLatencyTracer() const = 0;
+
+    /**
+     * @brief Captures the raw samples around now, thread safe
+     * @return false if the handler has no triggered capture
+     */
+    virtual bool TriggerCapture() const = 0;
+
+    /**
+     * @brief Moves the band of the zoom spectrum, thread safe
+     * @param center absolute center in Hz, 0 - follows the device center
+     * @param span width in Hz
+     * @return false if the handler has no zoom or the span is not valid
+     */
+    virtual bool SetZoomBand(const double center, const double span) const = 0;
+
+    /**
+     * @brief Tells the stages labelled in absolute Hz about a retune,
+     * thread safe
+     */
+    virtual void SetTunedFrequency(const double frequency) const = 0;
+
+    virtual ~IDataHandler(){};
+};
+
+/**
+ * @brief Processes the blocks of one device
+ * @tparam Sample stream element type from SampleTypes.h, instantiated for
+ * CS8, CU8, CS16 and CF32
+ */
+template <class Sample>
+class CDataHandler : public IDataHandler {
+   public:
+    /**
+     * @brief ctor
+     * @param deviceNumber number device, labels metrics and threads
+     * @param config optional stages applied to every spectrum
+     */
+    explicit CDataHandler(const int deviceNumber = 0,
+                          const HandlerConfig& config = HandlerConfig());
     CDataHandler(CDataHandler&&);
-    ~CDataHandler();
+    ~CDataHandler() override;
+
+    void StartHandling() const override;
+    void StopQueue() const override;
+    size_t GetQueueSize() const override;
+    latency_tracer::CLatencyTracer& GetLatencyTracer() const override;
+    bool TriggerCapture() const override;
+    bool SetZoomBand(const double center, const double span) const override;
+    void SetTunedFrequency(const double frequency) const override;
 
-    void StartHandling() const;
-    data_queue::RawQueue& GetQueue() const;
+    data_queue::BlockQueue<Sample>& GetQueue() const;
 
    private:
     struct Impl;
@@ -22,4 +122,4 @@ class CDataHandler {
 
 }  // namespace data_handler
 
-#endif  // __DATA_HANDLER_H__
\ No newline at end of file
+#endif  // __DATA_HANDLER_H__
@@ -4,6 +4,7 @@
 #include <condition_variable>
 #include <mutex>
 
+#include "Metrics.h"
 #include "Utility.h"
 
 namespace data_queue {
@@ -12,6 +13,9 @@ struct CDataQueue<DataType, Queue>::Impl {
     Queue mQueue;
     std::mutex mDataGuard;
     std::condition_variable mDataCV;
+    size_t mCapacity{0u};
+    // updated under mDataGuard, so it matches the queue after a stop
+    metrics::CGauge* mDepth{nullptr};
     volatile std::atomic_bool mIsStopped{false};
 };
 
@@ -42,23 +46,24 @@ size_t CDataQueue<DataType, Queue>::Size() const {
 }
 
 template <typename DataType, class Queue>
-void CDataQueue<DataType, Queue>::Push(const DataType& val) {
-    LOG_FUNC();
-
+bool CDataQueue<DataType, Queue>::Push(const DataType& val) {
     std::lock_guard lock(mImpl->mDataGuard);
 
     if (mImpl->mIsStopped) {
-        return;
+        return false;
     }
 
     mImpl->mQueue.push(val);
+    if (nullptr != mImpl->mDepth) {
+        mImpl->mDepth->Set(mImpl->mQueue.size());
+    }
     mImpl->mDataCV.notify_all();
+
+    return true;
 }
 
 template <typename DataType, class Queue>
 bool CDataQueue<DataType, Queue>::Pop(DataType& val) {
-    LOG_FUNC();
-
     std::lock_guard lock(mImpl->mDataGuard);
 
     if (mImpl->mQueue.empty()) {
@@ -67,15 +72,17 @@ bool CDataQueue<DataType, Queue>::Pop(DataType& val) {
 
     val = mImpl->mQueue.front();
     mImpl->mQueue.pop();
-    mImpl->mDataCV.notify_one();
+    if (nullptr != mImpl->mDepth) {
+        mImpl->mDepth->Set(mImpl->mQueue.size());
+    }
+    // wakes WaitQueueProcessed as well as a producer in WaitSpaceAvailable
+    mImpl->mDataCV.notify_all();
 
     return true;
 }
 
 template <typename DataType, class Queue>
 void CDataQueue<DataType, Queue>::WaitDataReady() {
-    LOG_FUNC();
-
     std::unique_lock lock(mImpl->mDataGuard);
 
     if (not mImpl->mIsStopped) {
@@ -98,6 +105,41 @@ void CDataQueue<DataType, Queue>::WaitQueueProcessed() {
     }
 }
 
+template <typename DataType, class Queue>
+void CDataQueue<DataType, Queue>::SetCapacity(const size_t capacity) {
+    std::lock_guard lock(mImpl->mDataGuard);
+    mImpl->mCapacity = capacity;
+    mImpl->mDataCV.notify_all();
+}
+
+template <typename DataType, class Queue>
+size_t CDataQueue<DataType, Queue>::Capacity() const {
+    std::lock_guard lock(mImpl->mDataGuard);
+    return mImpl->mCapacity;
+}
+
+template <typename DataType, class Queue>
+void CDataQueue<DataType, Queue>::WaitSpaceAvailable() {
+    std::unique_lock lock(mImpl->mDataGuard);
+
+    if (not mImpl->mIsStopped) {
+        mImpl->mDataCV.wait(lock, [impl = mImpl.get()]() {
+            return (0u == impl->mCapacity ||
+                    impl->mQueue.size() < impl->mCapacity ||
+                    impl->mIsStopped);
+        });
+    }
+}
+
+template <typename DataType, class Queue>
+void CDataQueue<DataType, Queue>::SetDepthGauge(metrics::CGauge* gauge) {
+    std::lock_guard lock(mImpl->mDataGuard);
+    mImpl->mDepth = gauge;
+    if (nullptr != gauge) {
+        gauge->Set(mImpl->mQueue.size());
+    }
+}
+
 template <typename DataType, class Queue>
 bool CDataQueue<DataType, Queue>::IsQueueStopped() const {
     return mImpl->mIsStopped;
@@ -119,6 +161,9 @@ void CDataQueue<DataType, Queue>::StopQueue() {
         Queue queue;
         mImpl->mQueue.swap(queue);
     }
+    if (nullptr != mImpl->mDepth) {
+        mImpl->mDepth->Set(0);
+    }
 
     mImpl->mDataCV.notify_all();
 }
@@ -135,9 +180,18 @@ void CDataQueue<DataType, Queue>::ResetData() {
         Queue queue;
         mImpl->mQueue.swap(queue);
     }
+    if (nullptr != mImpl->mDepth) {
+        mImpl->mDepth->Set(0);
+    }
 }
 
-template class CDataQueue<std::vector<std::int8_t>,
-                          std::queue<std::vector<std::int8_t>>>;
+template class CDataQueue<DataBlock<sample_types::CS8>,
+                          std::queue<DataBlock<sample_types::CS8>>>;
+template class CDataQueue<DataBlock<sample_types::CU8>,
+                          std::queue<DataBlock<sample_types::CU8>>>;
+template class CDataQueue<DataBlock<sample_types::CS16>,
+                          std::queue<DataBlock<sample_types::CS16>>>;
+template class CDataQueue<DataBlock<sample_types::CF32>,
+                          std::queue<DataBlock<sample_types::CF32>>>;
 
 }  // namespace data_queue
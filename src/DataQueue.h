@@ -2,13 +2,46 @@
 #define __DATA_QUEUE_H__
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <queue>
 #include <vector>
 
+#include "LatencyTracer.h"
+#include "SampleTypes.h"
+
+namespace metrics {
+class CGauge;
+}  // namespace metrics
+
 namespace data_queue {
+/**
+ * @brief Samples of one readStream or writeStream call with their flags,
+ * time and latency stamps
+ * @tparam Sample stream element type from SampleTypes.h
+ */
+template <class Sample>
+struct DataBlock {
+    using Component = typename Sample::Component;
+
+    /**
+     * @brief Returns the number of complex samples
+     */
+    size_t Samples() const {
+        return data.size() / 2u;
+    }
+
+    // interleaved I/Q components
+    std::vector<Component> data;
+    // SOAPY_SDR_HAS_TIME, SOAPY_SDR_END_BURST, ...
+    int flags{0};
+    // RX - hardware time of the first sample, TX - burst time relative to
+    // the stream activation
+    long long timeNs{0};
+    latency_tracer::BlockStamps stamps;
+};
 
-template <class DataType = std::vector<std::int8_t>,
+template <class DataType = DataBlock<sample_types::CS8>,
           class Queue = std::queue<DataType>>
 class CDataQueue {
    public:
@@ -44,8 +77,9 @@ class CDataQueue {
      * after its current last element
      * @param val Value to which the inserted element is initialized.
      * Element to be added to the queue.n
+     * @return false if the queue is stopped and the element is dropped
      */
-    void Push(const DataType& val);
+    bool Push(const DataType& val);
 
     /**
      * @brief Removes the next element
@@ -63,11 +97,35 @@ class CDataQueue {
      */
     void WaitQueueProcessed();
 
+    /**
+     * @brief Bounds the queue for a producer that runs ahead of its
+     * consumer, Push itself never blocks
+     * @param capacity number of elements, 0 - unbounded (default)
+     */
+    void SetCapacity(const size_t capacity);
+
+    /**
+     * @brief Returns the capacity, 0 if the queue is unbounded
+     */
+    size_t Capacity() const;
+
+    /**
+     * @brief Waits until the queue is below its capacity or stopped
+     */
+    void WaitSpaceAvailable();
+
     /**
      * @brief Indicates if the data send in queue is stopped
      */
     bool IsQueueStopped() const;
 
+    /**
+     * @brief Keeps a gauge at the number of queued elements, cleared to 0
+     * when the queue is stopped or reset
+     * @param gauge nullptr - none (default)
+     */
+    void SetDepthGauge(metrics::CGauge* gauge);
+
     /**
      * @brief Stops sending data to the queue
      */
@@ -83,8 +141,11 @@ class CDataQueue {
     std::unique_ptr<Impl> mImpl;
 };
 
-using RawQueue =
-    CDataQueue<std::vector<std::int8_t>, std::queue<std::vector<std::int8_t>>>;
+template <class Sample>
+using BlockQueue =
+    CDataQueue<DataBlock<Sample>, std::queue<DataBlock<Sample>>>;
+
+using RawQueue = BlockQueue<sample_types::CS8>;
 
 }  // namespace data_queue
 
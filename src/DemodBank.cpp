@@ -0,0 +1,786 @@
+#include "DemodBank.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <sstream>
+
+#include "FastFir.h"
+#include "Metrics.h"
+
+namespace demod_bank {
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+// the reduced rate is at least this multiple of the widest bandwidth, the
+// aliases the triangular window lets through then fall at least 34 dB down
+constexpr double kReducedRatio = 4.0;
+constexpr size_t kChannelTaps = 63u;
+constexpr size_t kAudioTaps = 31u;
+// the audio low pass passes this part of the audio rate
+constexpr double kAudioCutoff = 0.45;
+// channels further from the center than this part of the sample rate are
+// in the roll-off of the tuner filters
+constexpr double kUsableHalfBand = 0.45;
+// time constant of the AM carrier level
+constexpr double kCarrierSeconds = 0.1;
+// audio queued per channel while the writer is behind
+constexpr double kMaxQueuedSeconds = 2.0;
+constexpr float kPcmScale = 32767.0f;
+
+double DefaultBandwidth(const Mode mode) {
+    switch (mode) {
+        case Mode::Fm:
+            return 16e3;
+        case Mode::Am:
+            return 10e3;
+        case Mode::Usb:
+        case Mode::Lsb:
+            return 2.8e3;
+    }
+    return 16e3;
+}
+
+/**
+ * @brief atan2 by a 7th order polynomial of the octant, 1e-5 rad off at
+ * most. Selects instead of branching so a loop over it vectorises.
+ */
+inline float FastAtan2(const float y, const float x) {
+    const auto ax = std::fabs(x);
+    const auto ay = std::fabs(y);
+    const auto ratio = std::min(ax, ay) / (std::max(ax, ay) + 1e-30f);
+    const auto square = ratio * ratio;
+    auto angle =
+        ((-0.0464964749f * square + 0.15931422f) * square - 0.327622764f) *
+            square * ratio +
+        ratio;
+    angle = ay > ax ? 1.57079637f - angle : angle;
+    angle = x < 0.0f ? 3.14159274f - angle : angle;
+    return y < 0.0f ? -angle : angle;
+}
+
+/**
+ * @brief Mixes a sample by a row of the table and integrates it twice for
+ * every channel. A function of its own so the compiler trusts the restrict
+ * qualifiers and vectorises across the channels.
+ */
+void Integrate(const float re,
+               const float im,
+               const float* __restrict tableRe,
+               const float* __restrict tableIm,
+               float* __restrict sumRe,
+               float* __restrict sumIm,
+               float* __restrict rampRe,
+               float* __restrict rampIm,
+               const size_t width) {
+    for (size_t slot = 0; slot < width; ++slot) {
+        sumRe[slot] += re * tableRe[slot] - im * tableIm[slot];
+        sumIm[slot] += re * tableIm[slot] + im * tableRe[slot];
+        rampRe[slot] += sumRe[slot];
+        rampIm[slot] += sumIm[slot];
+    }
+}
+
+/**
+ * @brief Writes a row of the channels at position of a delay line of taps
+ * rows, kept twice so the taps read it from any position without wrapping
+ */
+void PushRow(std::vector<float>& line,
+             const size_t taps,
+             const size_t position,
+             const float* row,
+             const size_t width) {
+    std::copy(row, row + width, line.begin() + position * width);
+    std::copy(row, row + width, line.begin() + (position + taps) * width);
+}
+}  // namespace
+
+const char* ModeName(const Mode mode) {
+    switch (mode) {
+        case Mode::Fm:
+            return "fm";
+        case Mode::Am:
+            return "am";
+        case Mode::Usb:
+            return "usb";
+        case Mode::Lsb:
+            return "lsb";
+    }
+    return "?";
+}
+
+bool ParseChannels(const std::string& text,
+                   std::vector<ChannelSpec>& channels) {
+    channels.clear();
+
+    std::string values;
+    std::ifstream file(text);
+    if (file) {
+        std::string line;
+        while (std::getline(file, line)) {
+            values += line.substr(0, line.find('#')) + ' ';
+        }
+    } else {
+        values = text;
+    }
+    std::replace(values.begin(), values.end(), ',', ' ');
+
+    std::istringstream stream(values);
+    std::string item;
+    while (stream >> item) {
+        std::replace(item.begin(), item.end(), ':', ' ');
+        std::istringstream fields(item);
+        ChannelSpec channel;
+        std::string mode;
+        if (not(fields >> channel.frequency)) {
+            return false;
+        }
+        if (fields >> mode) {
+            if ("fm" == mode) {
+                channel.mode = Mode::Fm;
+            } else if ("am" == mode) {
+                channel.mode = Mode::Am;
+            } else if ("usb" == mode) {
+                channel.mode = Mode::Usb;
+            } else if ("lsb" == mode) {
+                channel.mode = Mode::Lsb;
+            } else {
+                return false;
+            }
+        }
+        if (fields >> channel.bandwidth && channel.bandwidth <= 0.0) {
+            return false;
+        }
+        if (not fields.eof()) {
+            return false;
+        }
+        channels.push_back(channel);
+    }
+
+    return not channels.empty();
+}
+
+struct CDemodBank::Impl {
+    Impl(const int deviceNumber, const DemodConfig& config);
+
+    void TakePending();
+    void Configure(const double tuned);
+    void CompleteWindow();
+    void Demodulate();
+    void Queue();
+    void WriterLoop();
+
+    const int mDeviceNumber;
+    const DemodConfig mConfig;
+    // channels across the arrays, ordered by mode
+    const size_t mWidth;
+    // per array slot, the index of the configured channel
+    std::vector<size_t> mOrder;
+    std::vector<double> mBandwidth;
+    // ends of the FM and AM slots, USB and LSB run to mWidth
+    size_t mFmEnd{0u};
+    size_t mAmEnd{0u};
+    size_t mDecimation{1u};
+    double mRate{0.0};
+
+    // mixing of every channel over a hop of decimation samples, relative
+    // to its start
+    std::vector<float> mTableRe;
+    std::vector<float> mTableIm;
+    // the mixed samples of the hop summed once and twice
+    std::vector<float> mSumRe;
+    std::vector<float> mSumIm;
+    std::vector<float> mRampRe;
+    std::vector<float> mRampIm;
+    size_t mHop{0u};
+    // the rising half of the window of the previous hop, mixed and scaled
+    std::vector<float> mRisingRe;
+    std::vector<float> mRisingIm;
+    // 1 / decimation^2, the window sums to one
+    float mScale{1.0f};
+    // mixing phase at the start of the hop
+    std::vector<double> mPhaseRe;
+    std::vector<double> mPhaseIm;
+    std::vector<double> mPhaseStepRe;
+    std::vector<double> mPhaseStepIm;
+    // a reduced sample
+    std::vector<float> mReducedRe;
+    std::vector<float> mReducedIm;
+
+    // channel filter, its taps per channel
+    std::vector<float> mChannelTaps;
+    std::vector<float> mChannelRe;
+    std::vector<float> mChannelIm;
+    size_t mChannelPosition{0u};
+    std::vector<float> mFilteredRe;
+    std::vector<float> mFilteredIm;
+
+    // demodulators
+    std::vector<float> mPreviousRe;
+    std::vector<float> mPreviousIm;
+    std::vector<float> mCarrier;
+    float mCarrierAlpha{1.0f};
+    std::vector<double> mShiftRe;
+    std::vector<double> mShiftIm;
+    std::vector<double> mShiftStepRe;
+    std::vector<double> mShiftStepIm;
+    // 0 for a channel outside the stream
+    std::vector<float> mGain;
+    std::vector<float> mDemodulated;
+    // 1 - no de-emphasis
+    std::vector<float> mDeemphasisAlpha;
+    std::vector<float> mDeemphasized;
+
+    // audio filter and resampler
+    std::vector<float> mAudioTaps;
+    std::vector<float> mAudioLine;
+    size_t mAudioPosition{0u};
+    std::vector<float> mAudio;
+    std::vector<float> mPreviousAudio;
+    // position of the next PCM sample after the previous reduced sample,
+    // in reduced samples
+    double mTime{0.0};
+    double mTimeStep{1.0};
+    // PCM of the block per configured channel
+    std::vector<std::vector<std::int16_t>> mPcm;
+
+    // set by SetTunedFrequency, taken at a block boundary
+    std::mutex mPendingLock;
+    double mRequestedTuned;
+    std::atomic<bool> mHasPending{false};
+
+    // handed to the writer
+    std::mutex mLock;
+    std::condition_variable mWake;
+    std::vector<std::vector<std::int16_t>> mQueued;
+    bool mStopping{false};
+    size_t mMaxQueued{0u};
+    std::vector<FILE*> mFiles;
+    std::future<void> mWriterHandle;
+
+    metrics::CCounter& mAudioSamples;
+    metrics::CCounter& mDropped;
+};
+
+CDemodBank::Impl::Impl(const int deviceNumber, const DemodConfig& config)
+    : mDeviceNumber(deviceNumber)
+    , mConfig(config)
+    , mWidth(config.channels.size())
+    , mPcm(config.channels.size())
+    , mRequestedTuned(config.tunedFrequency)
+    , mQueued(config.channels.size())
+    , mMaxQueued(static_cast<size_t>(kMaxQueuedSeconds * config.audioRate))
+    , mFiles(config.channels.size(), nullptr)
+    , mAudioSamples(metrics::CMetricsRegistry::Instance().GetCounter(
+          "kraken_demod_audio_samples_total",
+          "PCM samples of all channels written by the demodulator bank",
+          {{"device", std::to_string(deviceNumber)}}))
+    , mDropped(metrics::CMetricsRegistry::Instance().GetCounter(
+          "kraken_demod_dropped_samples_total",
+          "PCM samples dropped while the audio writer was behind",
+          {{"device", std::to_string(deviceNumber)}})) {
+    // slots by mode, each demodulator loops over one range
+    const auto append = [this, &config](const Mode mode) {
+        for (size_t index = 0; index < mWidth; ++index) {
+            if (mode == config.channels[index].mode) {
+                mOrder.push_back(index);
+            }
+        }
+        return mOrder.size();
+    };
+    mFmEnd = append(Mode::Fm);
+    mAmEnd = append(Mode::Am);
+    append(Mode::Usb);
+    append(Mode::Lsb);
+
+    double widest(0.0);
+    for (const auto index : mOrder) {
+        const auto& channel = config.channels[index];
+        mBandwidth.push_back(0.0 == channel.bandwidth
+                                 ? DefaultBandwidth(channel.mode)
+                                 : channel.bandwidth);
+        widest = std::max(widest, mBandwidth.back());
+    }
+
+    const auto sampleRate = config.sampleRate;
+    mDecimation = std::max<size_t>(
+        1u, static_cast<size_t>(sampleRate / (kReducedRatio * widest)));
+    mRate = sampleRate / mDecimation;
+    mTimeStep = mRate / config.audioRate;
+    mCarrierAlpha =
+        static_cast<float>(1.0 - std::exp(-1.0 / (mRate * kCarrierSeconds)));
+
+    const auto width = mWidth;
+    mScale = static_cast<float>(1.0 / (static_cast<double>(mDecimation) *
+                                       mDecimation));
+    mTableRe.resize(mDecimation * width);
+    mTableIm.resize(mDecimation * width);
+    for (auto* values : {&mSumRe,
+                         &mSumIm,
+                         &mRampRe,
+                         &mRampIm,
+                         &mRisingRe,
+                         &mRisingIm,
+                         &mReducedRe,
+                         &mReducedIm,
+                         &mFilteredRe,
+                         &mFilteredIm,
+                         &mPreviousRe,
+                         &mPreviousIm,
+                         &mCarrier,
+                         &mGain,
+                         &mDemodulated,
+                         &mDeemphasisAlpha,
+                         &mDeemphasized,
+                         &mAudio,
+                         &mPreviousAudio}) {
+        values->assign(width, 0.0f);
+    }
+    for (auto* phases : {&mPhaseRe,
+                         &mPhaseIm,
+                         &mPhaseStepRe,
+                         &mPhaseStepIm,
+                         &mShiftRe,
+                         &mShiftIm,
+                         &mShiftStepRe,
+                         &mShiftStepIm}) {
+        phases->assign(width, 0.0);
+    }
+
+    // the channel filters stay, only the mixing follows the tuning
+    mChannelTaps.resize(kChannelTaps * width);
+    for (size_t slot = 0; slot < width; ++slot) {
+        const auto taps =
+            fast_fir::DesignLowpass(kChannelTaps, 0.5 * mBandwidth[slot] /
+                                                      mRate);
+        for (size_t tap = 0; tap < kChannelTaps; ++tap) {
+            mChannelTaps[tap * width + slot] = taps[tap];
+        }
+    }
+    mChannelRe.assign(2u * kChannelTaps * width, 0.0f);
+    mChannelIm.assign(2u * kChannelTaps * width, 0.0f);
+
+    mAudioTaps = fast_fir::DesignLowpass(
+        kAudioTaps,
+        std::min(0.5, kAudioCutoff * config.audioRate / mRate));
+    mAudioLine.assign(2u * kAudioTaps * width, 0.0f);
+
+    const auto deemphasis =
+        config.deemphasisUs > 0.0
+            ? static_cast<float>(
+                  1.0 - std::exp(-1.0 / (mRate * config.deemphasisUs * 1e-6)))
+            : 1.0f;
+    for (size_t slot = 0; slot < width; ++slot) {
+        mDeemphasisAlpha[slot] = slot < mFmEnd ? deemphasis : 1.0f;
+    }
+    for (auto& pcm : mPcm) {
+        pcm.reserve(static_cast<size_t>(config.audioRate));
+    }
+
+    // the benchmark runs the demodulators without files
+    if (config.outputDir.empty()) {
+        Configure(config.tunedFrequency);
+        return;
+    }
+    for (size_t index = 0; index < width; ++index) {
+        char name[64];
+        snprintf(name,
+                 sizeof(name),
+                 "/demod_dev%d_ch%zu.s16",
+                 deviceNumber,
+                 index);
+        const auto path = config.outputDir + name;
+        mFiles[index] = fopen(path.c_str(), "wb");
+        if (nullptr == mFiles[index]) {
+            SoapySDR::logf(SOAPY_SDR_ERROR,
+                           "Demod device #%d: can't open %s",
+                           deviceNumber,
+                           path.c_str());
+        }
+    }
+
+    Configure(config.tunedFrequency);
+}
+
+void CDemodBank::Impl::TakePending() {
+    if (not mHasPending.exchange(false, std::memory_order_acquire)) {
+        return;
+    }
+
+    double tuned(0.0);
+    {
+        std::lock_guard lock(mPendingLock);
+        tuned = mRequestedTuned;
+    }
+    Configure(tuned);
+}
+
+void CDemodBank::Impl::Configure(const double tuned) {
+    const auto width = mWidth;
+    const auto decimation = mDecimation;
+    const auto sampleRate = mConfig.sampleRate;
+
+    for (size_t slot = 0; slot < width; ++slot) {
+        const auto& channel = mConfig.channels[mOrder[slot]];
+        const auto bandwidth = mBandwidth[slot];
+        // a sideband is mixed to zero at its middle and shifted back
+        // after the channel filter
+        const auto sideband = Mode::Usb == channel.mode   ? bandwidth / 2.0
+                              : Mode::Lsb == channel.mode ? -bandwidth / 2.0
+                                                          : 0.0;
+        const auto offset = channel.frequency + sideband - tuned;
+        const auto inside =
+            std::abs(offset) + bandwidth / 2.0 <= kUsableHalfBand * sampleRate;
+        if (not inside) {
+            SoapySDR::logf(SOAPY_SDR_WARNING,
+                           "Demod device #%d: channel %zu at %.0f Hz is "
+                           "outside the stream at %.0f Hz, silent",
+                           mDeviceNumber,
+                           mOrder[slot],
+                           channel.frequency,
+                           tuned);
+        }
+
+        const auto omega = -2.0 * kPi * offset / sampleRate;
+        for (size_t tap = 0; tap < decimation; ++tap) {
+            const auto mixed = std::polar(1.0, omega * tap);
+            mTableRe[tap * width + slot] = static_cast<float>(mixed.real());
+            mTableIm[tap * width + slot] = static_cast<float>(mixed.imag());
+        }
+        const auto step = std::polar(1.0, omega * decimation);
+        mPhaseRe[slot] = 1.0;
+        mPhaseIm[slot] = 0.0;
+        mPhaseStepRe[slot] = step.real();
+        mPhaseStepIm[slot] = step.imag();
+
+        const auto shift = std::polar(1.0, 2.0 * kPi * sideband / mRate);
+        mShiftRe[slot] = 1.0;
+        mShiftIm[slot] = 0.0;
+        mShiftStepRe[slot] = shift.real();
+        mShiftStepIm[slot] = shift.imag();
+
+        mGain[slot] =
+            not inside ? 0.0f
+            : Mode::Fm == channel.mode
+                ? static_cast<float>(mRate / (2.0 * kPi * mConfig.deviation))
+                : 1.0f;
+    }
+
+    // the windows and the discriminator restart with the new phases
+    for (auto* values : {&mSumRe,
+                         &mSumIm,
+                         &mRampRe,
+                         &mRampIm,
+                         &mRisingRe,
+                         &mRisingIm}) {
+        std::fill(values->begin(), values->end(), 0.0f);
+    }
+    mHop = 0u;
+}
+
+void CDemodBank::Impl::CompleteWindow() {
+    // over a hop the sum weights every sample by 1 and the ramp by
+    // decimation - h, so the falling half of the triangle is ramp - sum
+    // and the rising half (decimation + 1) sum - ramp. A window is the
+    // rising half of the previous hop and the falling half of this one.
+    const auto width = mWidth;
+    const auto decimation = static_cast<float>(mDecimation);
+    for (size_t slot = 0; slot < width; ++slot) {
+        const auto sumRe = mSumRe[slot];
+        const auto sumIm = mSumIm[slot];
+        const auto fallingRe = mRampRe[slot] - sumRe;
+        const auto fallingIm = mRampIm[slot] - sumIm;
+        const auto risingRe = (decimation + 1.0f) * sumRe - mRampRe[slot];
+        const auto risingIm = (decimation + 1.0f) * sumIm - mRampIm[slot];
+        const auto phaseRe = static_cast<float>(mPhaseRe[slot]) * mScale;
+        const auto phaseIm = static_cast<float>(mPhaseIm[slot]) * mScale;
+
+        mReducedRe[slot] =
+            mRisingRe[slot] + fallingRe * phaseRe - fallingIm * phaseIm;
+        mReducedIm[slot] =
+            mRisingIm[slot] + fallingRe * phaseIm + fallingIm * phaseRe;
+        mRisingRe[slot] = risingRe * phaseRe - risingIm * phaseIm;
+        mRisingIm[slot] = risingRe * phaseIm + risingIm * phaseRe;
+
+        const auto stepRe = mPhaseStepRe[slot];
+        const auto stepIm = mPhaseStepIm[slot];
+        const auto nextRe = mPhaseRe[slot] * stepRe - mPhaseIm[slot] * stepIm;
+        mPhaseIm[slot] = mPhaseRe[slot] * stepIm + mPhaseIm[slot] * stepRe;
+        mPhaseRe[slot] = nextRe;
+    }
+    std::fill(mSumRe.begin(), mSumRe.end(), 0.0f);
+    std::fill(mSumIm.begin(), mSumIm.end(), 0.0f);
+    std::fill(mRampRe.begin(), mRampRe.end(), 0.0f);
+    std::fill(mRampIm.begin(), mRampIm.end(), 0.0f);
+}
+
+void CDemodBank::Impl::Demodulate() {
+    const auto width = mWidth;
+
+    // channel filter
+    // the taps are symmetric, the line is read oldest first
+    PushRow(mChannelRe,
+            kChannelTaps,
+            mChannelPosition,
+            mReducedRe.data(),
+            width);
+    PushRow(mChannelIm,
+            kChannelTaps,
+            mChannelPosition,
+            mReducedIm.data(),
+            width);
+    mChannelPosition = (mChannelPosition + 1u) % kChannelTaps;
+    const auto* lineRe = mChannelRe.data() + mChannelPosition * width;
+    const auto* lineIm = mChannelIm.data() + mChannelPosition * width;
+    auto* __restrict filteredRe = mFilteredRe.data();
+    auto* __restrict filteredIm = mFilteredIm.data();
+    std::fill(filteredRe, filteredRe + width, 0.0f);
+    std::fill(filteredIm, filteredIm + width, 0.0f);
+    for (size_t tap = 0; tap < kChannelTaps; ++tap) {
+        const auto* __restrict taps = mChannelTaps.data() + tap * width;
+        const auto* __restrict re = lineRe + tap * width;
+        const auto* __restrict im = lineIm + tap * width;
+        for (size_t slot = 0; slot < width; ++slot) {
+            filteredRe[slot] += taps[slot] * re[slot];
+            filteredIm[slot] += taps[slot] * im[slot];
+        }
+    }
+
+    auto* __restrict out = mDemodulated.data();
+    const auto* __restrict gain = mGain.data();
+
+    // FM: the phase step between samples
+    auto* __restrict previousRe = mPreviousRe.data();
+    auto* __restrict previousIm = mPreviousIm.data();
+    for (size_t slot = 0; slot < mFmEnd; ++slot) {
+        const auto re = filteredRe[slot] * previousRe[slot] +
+                        filteredIm[slot] * previousIm[slot];
+        const auto im = filteredIm[slot] * previousRe[slot] -
+                        filteredRe[slot] * previousIm[slot];
+        out[slot] = FastAtan2(im, re) * gain[slot];
+        previousRe[slot] = filteredRe[slot];
+        previousIm[slot] = filteredIm[slot];
+    }
+
+    // AM: the envelope relative to the carrier
+    auto* __restrict carrier = mCarrier.data();
+    for (size_t slot = mFmEnd; slot < mAmEnd; ++slot) {
+        const auto envelope = std::sqrt(filteredRe[slot] * filteredRe[slot] +
+                                        filteredIm[slot] * filteredIm[slot]);
+        carrier[slot] += mCarrierAlpha * (envelope - carrier[slot]);
+        out[slot] = (envelope - carrier[slot]) /
+                    std::max(carrier[slot], 1e-9f) * gain[slot];
+    }
+
+    // USB and LSB: the sideband shifted back to start at zero
+    for (size_t slot = mAmEnd; slot < width; ++slot) {
+        const auto shiftRe = mShiftRe[slot];
+        const auto shiftIm = mShiftIm[slot];
+        out[slot] = static_cast<float>(filteredRe[slot] * shiftRe -
+                                       filteredIm[slot] * shiftIm) *
+                    gain[slot];
+        mShiftRe[slot] =
+            shiftRe * mShiftStepRe[slot] - shiftIm * mShiftStepIm[slot];
+        mShiftIm[slot] =
+            shiftRe * mShiftStepIm[slot] + shiftIm * mShiftStepRe[slot];
+    }
+
+    auto* __restrict deemphasized = mDeemphasized.data();
+    const auto* __restrict alpha = mDeemphasisAlpha.data();
+    for (size_t slot = 0; slot < width; ++slot) {
+        deemphasized[slot] += alpha[slot] * (out[slot] - deemphasized[slot]);
+    }
+
+    // audio low pass, then the PCM samples falling before this one
+    PushRow(mAudioLine, kAudioTaps, mAudioPosition, deemphasized, width);
+    mAudioPosition = (mAudioPosition + 1u) % kAudioTaps;
+    const auto* audioLine = mAudioLine.data() + mAudioPosition * width;
+    auto* __restrict audio = mAudio.data();
+    std::fill(audio, audio + width, 0.0f);
+    for (size_t tap = 0; tap < kAudioTaps; ++tap) {
+        const auto weight = mAudioTaps[tap];
+        const auto* __restrict row = audioLine + tap * width;
+        for (size_t slot = 0; slot < width; ++slot) {
+            audio[slot] += weight * row[slot];
+        }
+    }
+
+    const auto* __restrict previous = mPreviousAudio.data();
+    for (; mTime <= 1.0; mTime += mTimeStep) {
+        const auto fraction = static_cast<float>(mTime);
+        for (size_t slot = 0; slot < width; ++slot) {
+            const auto value =
+                previous[slot] + fraction * (audio[slot] - previous[slot]);
+            mPcm[mOrder[slot]].push_back(static_cast<std::int16_t>(
+                std::lround(std::clamp(value, -1.0f, 1.0f) * kPcmScale)));
+        }
+    }
+    mTime -= 1.0;
+    mPreviousAudio.swap(mAudio);
+}
+
+void CDemodBank::Impl::Queue() {
+    if (mConfig.outputDir.empty()) {
+        for (auto& pcm : mPcm) {
+            pcm.clear();
+        }
+        return;
+    }
+
+    size_t dropped(0u);
+    {
+        std::lock_guard lock(mLock);
+        for (size_t index = 0; index < mWidth; ++index) {
+            auto& pcm = mPcm[index];
+            auto& queued = mQueued[index];
+            if (queued.size() + pcm.size() <= mMaxQueued) {
+                queued.insert(queued.end(), pcm.begin(), pcm.end());
+            } else {
+                dropped += pcm.size();
+            }
+            pcm.clear();
+        }
+    }
+    mWake.notify_one();
+    if (0u != dropped) {
+        mDropped.Add(dropped);
+    }
+}
+
+void CDemodBank::Impl::WriterLoop() {
+    std::vector<std::vector<std::int16_t>> writing(mWidth);
+    while (true) {
+        bool stopping(false);
+        {
+            std::unique_lock lock(mLock);
+            mWake.wait(lock, [this] {
+                return mStopping ||
+                       std::any_of(mQueued.begin(),
+                                   mQueued.end(),
+                                   [](const auto& pcm) {
+                                       return not pcm.empty();
+                                   });
+            });
+            stopping = mStopping;
+            // the buffers trade places, both keep their capacity
+            writing.swap(mQueued);
+        }
+
+        // the file I/O runs without the lock, the DSP thread keeps going
+        for (size_t index = 0; index < mWidth; ++index) {
+            auto& pcm = writing[index];
+            if (nullptr != mFiles[index] && not pcm.empty() &&
+                pcm.size() == std::fwrite(pcm.data(),
+                                          sizeof(pcm[0]),
+                                          pcm.size(),
+                                          mFiles[index])) {
+                mAudioSamples.Add(pcm.size());
+            }
+            pcm.clear();
+        }
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+CDemodBank::CDemodBank(const int deviceNumber, const DemodConfig& config)
+    : mImpl(std::make_unique<CDemodBank::Impl>(deviceNumber, config)) {
+    const auto& impl = *mImpl;
+    for (size_t slot = 0; slot < impl.mWidth; ++slot) {
+        const auto index = impl.mOrder[slot];
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "Demod device #%d: channel %zu %.0f Hz %s, %.0f Hz "
+                       "wide",
+                       deviceNumber,
+                       index,
+                       config.channels[index].frequency,
+                       ModeName(config.channels[index].mode),
+                       impl.mBandwidth[slot]);
+    }
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Demod device #%d: %zu channels decimated by %zu to "
+                   "%.0f Hz, %.0f Hz audio to %s",
+                   deviceNumber,
+                   impl.mWidth,
+                   impl.mDecimation,
+                   impl.mRate,
+                   config.audioRate,
+                   config.outputDir.empty() ? "no files"
+                                            : config.outputDir.c_str());
+    if (config.outputDir.empty()) {
+        return;
+    }
+    mImpl->mWriterHandle = std::async(
+        std::launch::async, &CDemodBank::Impl::WriterLoop, mImpl.get());
+}
+
+CDemodBank::~CDemodBank() {
+    {
+        std::lock_guard lock(mImpl->mLock);
+        mImpl->mStopping = true;
+    }
+    mImpl->mWake.notify_one();
+    if (mImpl->mWriterHandle.valid()) {
+        mImpl->mWriterHandle.get();
+    }
+    for (auto* file : mImpl->mFiles) {
+        if (nullptr != file) {
+            fclose(file);
+        }
+    }
+}
+
+void CDemodBank::SetTunedFrequency(const double frequency) {
+    std::lock_guard lock(mImpl->mPendingLock);
+    mImpl->mRequestedTuned = frequency;
+    mImpl->mHasPending.store(true, std::memory_order_release);
+}
+
+void CDemodBank::AddSamples(const dsp_kernels::Complex* in,
+                            const size_t count) {
+    auto& impl = *mImpl;
+    impl.TakePending();
+    if (0u == impl.mWidth) {
+        return;
+    }
+
+    const auto width = impl.mWidth;
+    const auto decimation = impl.mDecimation;
+    for (size_t i = 0; i < count; ++i) {
+        Integrate(in[i].real(),
+                  in[i].imag(),
+                  impl.mTableRe.data() + impl.mHop * width,
+                  impl.mTableIm.data() + impl.mHop * width,
+                  impl.mSumRe.data(),
+                  impl.mSumIm.data(),
+                  impl.mRampRe.data(),
+                  impl.mRampIm.data(),
+                  width);
+        if (++impl.mHop != decimation) {
+            continue;
+        }
+        impl.mHop = 0u;
+        impl.CompleteWindow();
+        impl.Demodulate();
+    }
+
+    // the recursions drift off the unit circle, renormalize per block
+    for (size_t slot = 0; slot < width; ++slot) {
+        const auto phase = std::hypot(impl.mPhaseRe[slot], impl.mPhaseIm[slot]);
+        impl.mPhaseRe[slot] /= phase;
+        impl.mPhaseIm[slot] /= phase;
+        const auto shift = std::hypot(impl.mShiftRe[slot], impl.mShiftIm[slot]);
+        impl.mShiftRe[slot] /= shift;
+        impl.mShiftIm[slot] /= shift;
+    }
+    impl.Queue();
+}
+
+}  // namespace demod_bank
@@ -0,0 +1,113 @@
+#ifndef __DEMOD_BANK_H__
+#define __DEMOD_BANK_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DspKernels.h"
+
+namespace demod_bank {
+enum class Mode { Fm, Am, Usb, Lsb };
+
+/**
+ * @brief Returns "fm", "am", "usb" or "lsb"
+ */
+const char* ModeName(const Mode mode);
+
+struct ChannelSpec {
+    // absolute Hz of the carrier, the suppressed one for USB and LSB
+    double frequency{0.0};
+    Mode mode{Mode::Fm};
+    // Hz passed to the demodulator, 0 - the default of the mode
+    double bandwidth{0.0};
+};
+
+struct DemodConfig {
+    // directory of the audio files, empty - the bank writes no files and
+    // the data handler runs no bank
+    std::string outputDir;
+    std::vector<ChannelSpec> channels;
+    // samples per second of the PCM written
+    double audioRate{16000.0};
+    // time constant of the FM de-emphasis in us, 0 - none
+    double deemphasisUs{75.0};
+    // FM deviation reaching full scale
+    double deviation{5000.0};
+    // samples per second of the stream and center frequency the device is
+    // tuned to, set by the stream factory
+    double sampleRate{0.0};
+    double tunedFrequency{0.0};
+};
+
+/**
+ * @brief Reads the channels of a file, whitespace or comma separated,
+ * '#' starts a comment, or of a comma separated list if no such file
+ * exists. A channel is <Hz>[:fm|am|usb|lsb[:<bandwidth Hz>]], FM by
+ * default.
+ * @return false if there are none or one can't be parsed
+ */
+bool ParseChannels(const std::string& text,
+                   std::vector<ChannelSpec>& channels);
+
+/**
+ * @brief Demodulates a list of narrowband channels of the stream to PCM.
+ *
+ * All channels are processed together in a structure of arrays, every
+ * inner loop runs across the channels and vectorises:
+ *   - each channel is mixed to zero and decimated to a common rate of at
+ *     least four times the widest bandwidth by a triangular window, a
+ *     second order CIC whose nulls fall on the aliases. Per input sample
+ *     and channel it costs a complex multiply by a table row and two
+ *     complex adds, the integrators restart every hop so nothing drifts.
+ *   - a low pass of the bandwidth of each channel at the reduced rate
+ *   - FM by a polar discriminator with a polynomial atan2, AM by the
+ *     envelope over its average, USB and LSB by shifting the sideband to
+ *     start at zero and taking the real part
+ *   - the FM de-emphasis, an audio low pass and a linear interpolation to
+ *     the audio rate sharing one clock
+ * The channels are ordered by mode so each demodulator loops over a
+ * contiguous range.
+ *
+ * The PCM of channel K, signed 16 bit little-endian mono at audioRate, is
+ * queued per block and appended to <outputDir>/demod_dev<N>_ch<K>.s16 by a
+ * writer thread. A queue the writer can't keep up with drops audio. A
+ * channel outside the stream writes silence, so the files stay in step.
+ * Without an outputDir the audio is discarded and no writer runs.
+ */
+class CDemodBank {
+   public:
+    /**
+     * @param deviceNumber number device, names the files and labels the
+     * metrics
+     * @param config channels, audio and stream of the bank
+     */
+    CDemodBank(const int deviceNumber, const DemodConfig& config);
+    CDemodBank(const CDemodBank&) = delete;
+    CDemodBank& operator=(const CDemodBank&) = delete;
+
+    /**
+     * @brief Writes the queued audio, joins the writer thread
+     */
+    ~CDemodBank();
+
+    /**
+     * @brief Tells the bank about a retune of the device, thread safe,
+     * applied at the next block
+     */
+    void SetTunedFrequency(const double frequency);
+
+    /**
+     * @brief Demodulates a block and queues its audio. Called by the DSP
+     * thread only.
+     */
+    void AddSamples(const dsp_kernels::Complex* in, const size_t count);
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace demod_bank
+
+#endif  // __DEMOD_BANK_H__
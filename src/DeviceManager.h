@@ -6,9 +6,11 @@
 #include <stdio.h>
 
 #include <SoapySDR/Types.hpp>
-#include <mutex>
 #include <utility>
 
+#include "SweepScanner.h"
+#include "TxFeeder.h"
+
 namespace device_manager {
 class IDeviceManager {
    public:
@@ -87,6 +89,50 @@ class IDeviceManager {
         const std::string& format = SOAPY_SDR_CF32,
         const std::vector<size_t>& channels = std::vector<size_t>(),
         const SoapySDR::Kwargs& args = SoapySDR::Kwargs()) = 0;
+    /**
+     * @brief Sets up the RX streams of the devices first, then activates
+     * them together at a common epoch, timed where the driver has a
+     * hardware time. The blocks carry the time since the epoch, the
+     * residual skew and the alignment window are logged.
+     * @param deviceNumbers devices to start, empty - every device
+     * @param format buffer format of readStream(), empty selects the
+     * native format
+     * @param channels a list of channels
+     * @param args stream args or empty for defaults.
+     * @return true if every stream is started
+     */
+    virtual bool StartStreamGroup(
+        const std::vector<int>& deviceNumbers = std::vector<int>(),
+        const std::string& format = "",
+        const std::vector<size_t>& channels = std::vector<size_t>(1, 0),
+        const SoapySDR::Kwargs& args = SoapySDR::Kwargs()) = 0;
+    /**
+     * @brief Steps all devices through the frequency plan, the plan is split
+     * between the devices and the spectra are stitched into one wideband
+     * spectrum. Runs in the background until the plan passes are done or
+     * streams are stopped.
+     * @param plan the frequency plan, dwell and output of the sweep
+     * @return true on success, otherwise false
+     */
+    virtual bool StartSweep(const sweep_scanner::SweepPlan& plan) = 0;
+    /**
+     * @brief Setup, activate a TX stream and start transmitting the samples
+     * of a file or a generated tone. Runs in the background until streams
+     * are stopped.
+     * @param deviceNumber number device
+     * @param config source, prefetch and burst settings
+     * @param format buffer format of writeStream() and of the TX file,
+     * empty selects the native format
+     * @param channels a list of channels, all of them send the same samples
+     * @param args stream args or empty for defaults.
+     * @return true on success, otherwise false
+     */
+    virtual bool StartTransmit(
+        const int deviceNumber,
+        const tx_feeder::TxConfig& config,
+        const std::string& format = "",
+        const std::vector<size_t>& channels = std::vector<size_t>(1, 0),
+        const SoapySDR::Kwargs& args = SoapySDR::Kwargs()) = 0;
     /**
      * @brief Shutdown all streams
      */
@@ -128,13 +174,6 @@ class IDeviceManager {
      */
     virtual ~IDeviceManager() {}
 
-    template <typename Fn, class IDMO, typename... Arg, class Lock>
-    auto CallThreadSafe(Lock& lock, IDMO obj, Fn fn, Arg&&... args) const
-        -> decltype((obj->*fn)(std::forward<Arg>(args)...)) {
-        std::lock_guard guard(lock);
-        return (obj->*fn)(std::forward<Arg>(args)...);
-    }
-
     static constexpr auto kMinSampleRate = 30.72e6;
     static constexpr auto kDefFrequency = 433e6;
 };
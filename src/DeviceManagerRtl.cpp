@@ -5,73 +5,310 @@
 #include <SoapySDR/Device.hpp>
 #include <SoapySDR/Formats.hpp>
 #include <atomic>
-#include <csignal>
-#include <thread>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
 #include <vector>
 
-#include "DataHandler.h"
-#include "DeviceStreamRtl.h"
+#include "AllocationTracker.h"
+#include "ControlReactor.h"
+#include "LatencyTracer.h"
+#include "LoadGovernor.h"
+#include "Metrics.h"
+#include "StreamFactory.h"
+#include "SweepScanner.h"
 #include "Utility.h"
 
-extern sig_atomic_t streamLoopDone;
-
 namespace device_manager {
 constexpr auto kDeviceIdent = "serial";
+constexpr auto kStatusPeriod = std::chrono::seconds(5);
+
+using CommandArgs = control_reactor::CControlReactor::CommandArgs;
 
 struct DeviceData {
     DeviceData(std::shared_ptr<SoapySDR::Device> device,
                const SoapySDR::Kwargs& args)
-        : mDevice(std::move(device)), mArgs(args), mStream(), mDataHandler() {}
+        : mDevice(std::move(device))
+        , mArgs(args)
+        , mPipeline()
+        , mTxPipeline() {}
 
-    DeviceData(DeviceData&& rh)
-        : mDevice(std::move(rh.mDevice))
-        , mArgs(std::move(rh.mArgs))
-        , mStream(std::move(rh.mStream))
-        , mDataHandler(std::move(rh.mDataHandler)) {}
-
-    std::shared_ptr<SoapySDR::Device> mDevice;
+    const std::shared_ptr<SoapySDR::Device> mDevice;
     const SoapySDR::Kwargs mArgs;
-    std::unique_ptr<device_stream::CDeviceStreamRtl> mStream;
-    data_handler::CDataHandler mDataHandler;
+    // guards the pipelines only, the stream starts of one device against
+    // the status readers
+    std::mutex mPipelineLock;
+    // typed handler and stream, empty until the stream is started
+    stream_factory::StreamPipeline mPipeline;
+    // typed feeder and TX stream, empty until the transmission is started
+    stream_factory::TxPipeline mTxPipeline;
 };
 
+// a published table is never modified, AddDevice publishes a copy, so a
+// reader can walk its snapshot while devices are added
+using DeviceTable = std::vector<std::shared_ptr<DeviceData>>;
+
+// the table before the first device is added
+const DeviceTable kNoDevices;
+
 struct CDeviceManagerRtl::Impl {
     ~Impl() {
         LOG_FUNC();
 
+        mSweep.reset();
         ShutdownQueues();
     }
 
-    DeviceData* GetDeviceData(const int deviceNumber);
+    const DeviceTable& GetTable() const;
+    std::shared_ptr<DeviceData> GetDeviceData(const int deviceNumber) const;
+    void PublishDevice(std::shared_ptr<DeviceData> deviceData);
+    bool StartRx(const int deviceNumber,
+                 DeviceData& deviceData,
+                 const std::string& format,
+                 const std::vector<size_t>& channels,
+                 const SoapySDR::Kwargs& args,
+                 std::shared_ptr<start_group::CStartGroup> startGroup);
     void ShutdownQueues();
-
-    std::vector<DeviceData> mDeviceStorage;
-    std::mutex mLock;
+    void PrintStatus();
+    void PrintLatency();
+    void ResetLatency();
+    void TriggerCapture(const int deviceNumber);
+    void SetZoomBand(const int deviceNumber,
+                     const double center,
+                     const double span);
+    void SetTunedFrequency(const int deviceNumber, const double frequency);
+
+    // constructed first, blocks the shutdown signals before any thread starts
+    control_reactor::CControlReactor mReactor;
+    // the current table, read with a single acquire load that is wait-free
+    // where std::atomic of a pointer is lock-free, as on x86-64 and
+    // aarch64. PublishDevice replaces it, readers never lock
+    std::atomic<const DeviceTable*> mDevices{&kNoDevices};
+    // serialises the writers of mDevices, readers never take it
+    std::mutex mPublishLock;
+    // every table published, a superseded one stays allocated as a reader
+    // may still walk it. The table only grows on hot-plug, so the
+    // retired tables hold a few pointers per device added
+    std::vector<std::unique_ptr<const DeviceTable>> mTables;
+    std::unique_ptr<sweep_scanner::CSweepScanner> mSweep;
+    // stages of the data handlers created by StartStream
+    data_handler::HandlerConfig mHandlerConfig;
+    std::shared_ptr<const pipeline_graph::GraphSpec> mGraph;
+    // the last grouped start, read and replaced with atomic loads/stores
+    std::shared_ptr<start_group::CStartGroup> mStartGroup;
 };
 
-DeviceData* CDeviceManagerRtl::Impl::GetDeviceData(const int deviceNumber) {
+const DeviceTable& CDeviceManagerRtl::Impl::GetTable() const {
+    return *mDevices.load(std::memory_order_acquire);
+}
+
+std::shared_ptr<DeviceData> CDeviceManagerRtl::Impl::GetDeviceData(
+    const int deviceNumber) const {
     static constexpr auto kMinDevNumber = 1;
 
+    const auto& table = GetTable();
     if (kMinDevNumber > deviceNumber ||
-        static_cast<std::size_t>(deviceNumber) > mDeviceStorage.size()) {
+        static_cast<std::size_t>(deviceNumber) > table.size()) {
         SoapySDR::logf(SOAPY_SDR_ERROR,
                        " Device number not valid, valid range: %d - %u",
                        kMinDevNumber,
-                       mDeviceStorage.size());
+                       table.size());
         return nullptr;
     }
 
-    return &mDeviceStorage[deviceNumber - 1];
+    return table[deviceNumber - 1];
+}
+
+void CDeviceManagerRtl::Impl::PublishDevice(
+    std::shared_ptr<DeviceData> deviceData) {
+    std::lock_guard guard(mPublishLock);
+
+    auto table = std::make_unique<DeviceTable>(GetTable());
+    table->push_back(std::move(deviceData));
+    mDevices.store(table.get(), std::memory_order_release);
+    mTables.push_back(std::move(table));
+}
+
+bool CDeviceManagerRtl::Impl::StartRx(
+    const int deviceNumber,
+    DeviceData& deviceData,
+    const std::string& format,
+    const std::vector<size_t>& channels,
+    const SoapySDR::Kwargs& args,
+    std::shared_ptr<start_group::CStartGroup> startGroup) {
+    std::lock_guard guard(deviceData.mPipelineLock);
+    auto& pipeline = deviceData.mPipeline;
+    if (pipeline.handler) {
+        // a restarted stream gets a new pipeline, the old one is
+        // drained first: the stream thread stops on the stopped queue
+        pipeline.handler->StopQueue();
+        pipeline.stream.reset();
+        pipeline.handler.reset();
+    }
+
+    if (mGraph) {
+        pipeline = stream_factory::StartGraphPipeline(deviceNumber,
+                                                      deviceData.mDevice,
+                                                      format,
+                                                      *mGraph,
+                                                      channels,
+                                                      args,
+                                                      std::move(startGroup));
+    } else {
+        pipeline = stream_factory::StartRxPipeline(deviceNumber,
+                                                   deviceData.mDevice,
+                                                   format,
+                                                   channels,
+                                                   args,
+                                                   mHandlerConfig,
+                                                   std::move(startGroup));
+    }
+
+    return nullptr != pipeline.handler;
 }
 
 void CDeviceManagerRtl::Impl::ShutdownQueues() {
-    for (const auto& deviceData : mDeviceStorage) {
-        deviceData.mDataHandler.GetQueue().StopQueue();
+    for (const auto& deviceData : GetTable()) {
+        std::lock_guard guard(deviceData->mPipelineLock);
+        if (const auto& handler = deviceData->mPipeline.handler) {
+            handler->StopQueue();
+        }
+        if (const auto& feeder = deviceData->mTxPipeline.feeder) {
+            feeder->StopQueue();
+        }
+    }
+}
+
+void CDeviceManagerRtl::Impl::PrintLatency() {
+    const auto& table = GetTable();
+    for (size_t i = 0; i < table.size(); ++i) {
+        auto& deviceData = *table[i];
+        std::lock_guard guard(deviceData.mPipelineLock);
+        if (const auto& handler = deviceData.mPipeline.handler) {
+            const auto report = handler->GetLatencyTracer().Report(
+                "Device #" + std::to_string(i + 1));
+            SoapySDR::logf(SOAPY_SDR_INFO, "%s", report.c_str());
+        }
     }
 }
 
-CDeviceManagerRtl::CDeviceManagerRtl() : mImpl(new CDeviceManagerRtl::Impl) {
+void CDeviceManagerRtl::Impl::ResetLatency() {
+    for (const auto& deviceData : GetTable()) {
+        std::lock_guard guard(deviceData->mPipelineLock);
+        if (const auto& handler = deviceData->mPipeline.handler) {
+            handler->GetLatencyTracer().Reset();
+        }
+    }
+}
+
+void CDeviceManagerRtl::Impl::TriggerCapture(const int deviceNumber) {
+    const auto deviceData = GetDeviceData(deviceNumber);
+    if (not deviceData) {
+        throw std::invalid_argument("no device " +
+                                    std::to_string(deviceNumber));
+    }
+
+    std::lock_guard guard(deviceData->mPipelineLock);
+    const auto& handler = deviceData->mPipeline.handler;
+    if (not handler || not handler->TriggerCapture()) {
+        throw std::invalid_argument("no capture on the stream, see --capture");
+    }
+}
+
+void CDeviceManagerRtl::Impl::SetZoomBand(const int deviceNumber,
+                                          const double center,
+                                          const double span) {
+    const auto deviceData = GetDeviceData(deviceNumber);
+    if (not deviceData) {
+        throw std::invalid_argument("no device " +
+                                    std::to_string(deviceNumber));
+    }
+
+    std::lock_guard guard(deviceData->mPipelineLock);
+    const auto& handler = deviceData->mPipeline.handler;
+    if (not handler || not handler->SetZoomBand(center, span)) {
+        throw std::invalid_argument(
+            "no zoom on the stream or span not valid, see --zoom");
+    }
+}
+
+void CDeviceManagerRtl::Impl::SetTunedFrequency(const int deviceNumber,
+                                                const double frequency) {
+    if (const auto deviceData = GetDeviceData(deviceNumber)) {
+        std::lock_guard guard(deviceData->mPipelineLock);
+        if (const auto& handler = deviceData->mPipeline.handler) {
+            handler->SetTunedFrequency(frequency);
+        }
+    }
+}
+
+void CDeviceManagerRtl::Impl::PrintStatus() {
+    auto& registry = metrics::CMetricsRegistry::Instance();
+    const auto& table = GetTable();
+    for (size_t i = 0; i < table.size(); ++i) {
+        auto& deviceData = *table[i];
+        std::lock_guard guard(deviceData.mPipelineLock);
+        const metrics::Labels labels{{"device", std::to_string(i + 1)}};
+        const auto& handler = deviceData.mPipeline.handler;
+        auto fftLabels = labels;
+        fftLabels["stage"] = "fft";
+        auto displayLabels = labels;
+        displayLabels["stage"] = "display";
+        SoapySDR::logf(
+            SOAPY_SDR_INFO,
+            "Device #%zu: samples %llu overflows %llu underflows %llu "
+            "queue depth %zu fft frames %llu quality %s shed %llu fft / "
+            "%llu display",
+            i + 1,
+            static_cast<unsigned long long>(
+                registry.GetCounterValue("kraken_samples_total", labels)),
+            static_cast<unsigned long long>(
+                registry.GetCounterValue("kraken_overflows_total", labels)),
+            static_cast<unsigned long long>(
+                registry.GetCounterValue("kraken_underflows_total", labels)),
+            handler ? handler->GetQueueSize() : 0u,
+            static_cast<unsigned long long>(
+                registry.GetCounterValue("kraken_fft_frames_total", labels)),
+            load_governor::QualityName(static_cast<load_governor::Quality>(
+                registry.GetGaugeValue("kraken_quality_level", labels))),
+            static_cast<unsigned long long>(registry.GetCounterValue(
+                "kraken_shed_frames_total", fftLabels)),
+            static_cast<unsigned long long>(registry.GetCounterValue(
+                "kraken_shed_frames_total", displayLabels)));
+
+        const auto& feeder = deviceData.mTxPipeline.feeder;
+        if (not feeder) {
+            continue;
+        }
+        auto starvedLabels = labels;
+        starvedLabels["cause"] = "starvation";
+        auto deviceLabels = labels;
+        deviceLabels["cause"] = "device";
+        SoapySDR::logf(
+            SOAPY_SDR_INFO,
+            "Device #%zu: TX samples %llu starvations %llu underflows "
+            "%llu starvation / %llu device, prefetched %zu",
+            i + 1,
+            static_cast<unsigned long long>(
+                registry.GetCounterValue("kraken_tx_samples_total", labels)),
+            static_cast<unsigned long long>(registry.GetCounterValue(
+                "kraken_tx_starvations_total", labels)),
+            static_cast<unsigned long long>(registry.GetCounterValue(
+                "kraken_tx_underflows_total", starvedLabels)),
+            static_cast<unsigned long long>(registry.GetCounterValue(
+                "kraken_tx_underflows_total", deviceLabels)),
+            feeder->GetQueueSize());
+    }
+}
+
+CDeviceManagerRtl::CDeviceManagerRtl(
+    const data_handler::HandlerConfig& handlerConfig,
+    std::shared_ptr<const pipeline_graph::GraphSpec> graph)
+    : mImpl(new CDeviceManagerRtl::Impl) {
     LOG_FUNC();
+
+    mImpl->mHandlerConfig = handlerConfig;
+    mImpl->mGraph = std::move(graph);
 }
 
 CDeviceManagerRtl::CDeviceManagerRtl(CDeviceManagerRtl&&) = default;
@@ -98,11 +335,10 @@ bool CDeviceManagerRtl::DeviceSearch() {
                    devicesArgsList.size());
 
     for (const auto& args : devicesArgsList) {
-        CallThreadSafe(mImpl->mLock, this, &CDeviceManagerRtl::AddDevice, args);
+        AddDevice(args);
     }
 
-    return 0u != CallThreadSafe(
-                     mImpl->mLock, this, &CDeviceManagerRtl::GetCountDevice);
+    return 0u != GetCountDevice();
 }
 
 bool CDeviceManagerRtl::SetSampleRate(const double rate,
@@ -111,8 +347,7 @@ bool CDeviceManagerRtl::SetSampleRate(const double rate,
                                       const size_t channel) {
     LOG_FUNC();
 
-    if (auto device = CallThreadSafe(
-            mImpl->mLock, this, &CDeviceManagerRtl::GetDevice, deviceNumber)) {
+    if (auto device = GetDevice(deviceNumber)) {
         try {
             auto minSampleRate = rate;
 
@@ -155,9 +390,14 @@ bool CDeviceManagerRtl::SetFrequency(
     [[maybe_unused]] const SoapySDR::Kwargs& args) {
     LOG_FUNC();
 
-    if (auto device = CallThreadSafe(
-            mImpl->mLock, this, &CDeviceManagerRtl::GetDevice, deviceNumber)) {
+    if (auto device = GetDevice(deviceNumber)) {
         device->setFrequency(direction, channel, value);
+        if (SOAPY_SDR_RX == direction) {
+            // the tuner lands on its own grid, the stages labelling bins
+            // in absolute Hz get the frequency it reports
+            mImpl->SetTunedFrequency(deviceNumber,
+                                     device->getFrequency(direction, channel));
+        }
         return true;
     }
 
@@ -171,27 +411,116 @@ bool CDeviceManagerRtl::StartStream(const int deviceNumber,
                                     const SoapySDR::Kwargs& args) {
     LOG_FUNC();
 
-    if (auto deviceData =
-            CallThreadSafe(mImpl->mLock,
-                           mImpl.get(),
-                           &CDeviceManagerRtl::Impl::GetDeviceData,
-                           deviceNumber)) {
-        auto& stream = deviceData->mStream;
+    if (auto deviceData = mImpl->GetDeviceData(deviceNumber)) {
+        if (SOAPY_SDR_RX != direction) {
+            SoapySDR::logf(SOAPY_SDR_ERROR,
+                           "Device #%d: TX streams are started by "
+                           "StartTransmit",
+                           deviceNumber);
+            return false;
+        }
 
-        stream = std::make_unique<device_stream::CDeviceStreamRtl>();
+        return mImpl->StartRx(
+            deviceNumber, *deviceData, format, channels, args, nullptr);
+    }
 
-        const auto& dataHandler = deviceData->mDataHandler;
+    return false;
+}
 
-        dataHandler.StartHandling();
+bool CDeviceManagerRtl::StartStreamGroup(const std::vector<int>& deviceNumbers,
+                                         const std::string& format,
+                                         const std::vector<size_t>& channels,
+                                         const SoapySDR::Kwargs& args) {
+    LOG_FUNC();
 
-        stream->RunStreamLoop(dataHandler.GetQueue(),
-                              deviceData->mDevice,
-                              direction,
-                              format,
-                              channels,
-                              args);
+    auto numbers = deviceNumbers;
+    if (numbers.empty()) {
+        for (size_t i = 1; i <= GetCountDevice(); ++i) {
+            numbers.push_back(static_cast<int>(i));
+        }
+    }
 
-        return true;
+    auto group = std::make_shared<start_group::CStartGroup>(numbers.size());
+    std::atomic_store(&mImpl->mStartGroup, group);
+
+    // every stream thread is set up and waits in the group, a stream that
+    // can't start leaves it so the others don't wait for it
+    bool started(true);
+    for (const auto deviceNumber : numbers) {
+        bool running(false);
+        try {
+            if (auto deviceData = mImpl->GetDeviceData(deviceNumber)) {
+                running = mImpl->StartRx(
+                    deviceNumber, *deviceData, format, channels, args, group);
+            }
+        } catch (const std::runtime_error& error) {
+            SoapySDR::logf(SOAPY_SDR_ERROR,
+                           "Device #%d: %s",
+                           deviceNumber,
+                           error.what());
+        }
+        if (not running) {
+            group->Leave();
+            started = false;
+        }
+    }
+
+    return started;
+}
+
+start_group::GroupReport CDeviceManagerRtl::GetStartReport() const {
+    if (const auto group = std::atomic_load(&mImpl->mStartGroup)) {
+        return group->GetReport();
+    }
+
+    return start_group::GroupReport();
+}
+
+bool CDeviceManagerRtl::StartTransmit(const int deviceNumber,
+                                      const tx_feeder::TxConfig& config,
+                                      const std::string& format,
+                                      const std::vector<size_t>& channels,
+                                      const SoapySDR::Kwargs& args) {
+    LOG_FUNC();
+
+    if (auto deviceData = mImpl->GetDeviceData(deviceNumber)) {
+        std::lock_guard guard(deviceData->mPipelineLock);
+        auto& pipeline = deviceData->mTxPipeline;
+        if (pipeline.feeder) {
+            pipeline.feeder->StopQueue();
+            pipeline.stream.reset();
+            pipeline.feeder.reset();
+        }
+
+        pipeline = stream_factory::StartTxPipeline(deviceNumber,
+                                                   deviceData->mDevice,
+                                                   format,
+                                                   config,
+                                                   channels,
+                                                   args);
+
+        return nullptr != pipeline.feeder;
+    }
+
+    return false;
+}
+
+bool CDeviceManagerRtl::StartSweep(const sweep_scanner::SweepPlan& plan) {
+    LOG_FUNC();
+
+    std::vector<std::shared_ptr<SoapySDR::Device>> devices;
+    for (const auto& deviceData : mImpl->GetTable()) {
+        devices.push_back(deviceData->mDevice);
+    }
+
+    try {
+        mImpl->mSweep = std::make_unique<sweep_scanner::CSweepScanner>(
+            plan, std::move(devices));
+        // the sweep is the only workload, let WaitShutdownSignal return
+        return mImpl->mSweep->Start(
+            [reactor = &mImpl->mReactor]() { reactor->RequestStop(); });
+    } catch (const std::runtime_error& error) {
+        SoapySDR::logf(SOAPY_SDR_ERROR, ": %s", error.what());
     }
 
     return false;
@@ -200,7 +529,16 @@ bool CDeviceManagerRtl::StartStream(const int deviceNumber,
 void CDeviceManagerRtl::StopStreams() {
     LOG_FUNC();
 
-    streamLoopDone = true;
+    mImpl->mReactor.RequestStop();
+
+    // streams still waiting for the group start return to their loops
+    if (const auto group = std::atomic_load(&mImpl->mStartGroup)) {
+        group->Cancel();
+    }
+
+    if (mImpl->mSweep) {
+        mImpl->mSweep->Stop();
+    }
 
     mImpl->ShutdownQueues();
 }
@@ -208,13 +546,90 @@ void CDeviceManagerRtl::StopStreams() {
 void CDeviceManagerRtl::WaitShutdownSignal() {
     LOG_FUNC();
 
-    while (not streamLoopDone) {
-        std::this_thread::yield();
+    auto& reactor = mImpl->mReactor;
+
+    // registered here, this instance can't be moved while it blocks in Run
+    reactor.RegisterCommand(
+        "freq",
+        "<device> <Hz> tune the center frequency",
+        [this](const CommandArgs& args) {
+            if (2u != args.size()) {
+                throw std::invalid_argument("usage: freq <device> <Hz>");
+            }
+            SetFrequency(std::stod(args[1]), std::stoi(args[0]));
+        });
+    reactor.RegisterCommand(
+        "rate",
+        "<device> <Sps> set the sample rate",
+        [this](const CommandArgs& args) {
+            if (2u != args.size()) {
+                throw std::invalid_argument("usage: rate <device> <Sps>");
+            }
+            SetSampleRate(std::stod(args[1]), std::stoi(args[0]));
+        });
+    reactor.RegisterCommand(
+        "stats",
+        "print the status of every device",
+        [impl = mImpl.get()](const CommandArgs&) { impl->PrintStatus(); });
+    reactor.RegisterCommand(
+        "latency",
+        "[reset | sample <n>] print block latency percentiles per device",
+        [impl = mImpl.get()](const CommandArgs& args) {
+            if (args.empty()) {
+                impl->PrintLatency();
+            } else if ("reset" == args[0]) {
+                impl->ResetLatency();
+            } else if ("sample" == args[0] && 2u == args.size()) {
+                latency_tracer::SetSampleInterval(std::stoul(args[1]));
+            } else {
+                throw std::invalid_argument(
+                    "usage: latency [reset | sample <n>]");
+            }
+        });
+    reactor.RegisterCommand(
+        "capture",
+        "<device> write the raw samples around now",
+        [impl = mImpl.get()](const CommandArgs& args) {
+            if (1u != args.size()) {
+                throw std::invalid_argument("usage: capture <device>");
+            }
+            impl->TriggerCapture(std::stoi(args[0]));
+        });
+    reactor.RegisterCommand(
+        "zoom",
+        "<device> <center Hz> <span Hz> move the zoom spectrum, center 0 "
+        "follows the tuning",
+        [impl = mImpl.get()](const CommandArgs& args) {
+            if (3u != args.size()) {
+                throw std::invalid_argument(
+                    "usage: zoom <device> <center Hz> <span Hz>");
+            }
+            impl->SetZoomBand(std::stoi(args[0]),
+                              std::stod(args[1]),
+                              std::stod(args[2]));
+        });
+    if (allocation_tracker::kEnabled) {
+        reactor.RegisterCommand(
+            "allocs",
+            "[disarm] print heap allocations per thread and stage",
+            [](const CommandArgs& args) {
+                if (not args.empty() && "disarm" == args[0]) {
+                    allocation_tracker::Disarm();
+                }
+                allocation_tracker::PrintReport();
+            });
     }
+    reactor.SetStatusTimer(kStatusPeriod,
+                           [impl = mImpl.get()]() { impl->PrintStatus(); });
+    reactor.EnableConsoleCommands();
+
+    reactor.Run();
+
+    StopStreams();
 }
 
 std::size_t CDeviceManagerRtl::GetCountDevice() const {
-    return mImpl->mDeviceStorage.size();
+    return mImpl->GetTable().size();
 }
 
 SoapySDR::Kwargs CDeviceManagerRtl::GetHardwareInfo(
@@ -229,14 +644,10 @@ SoapySDR::Kwargs CDeviceManagerRtl::GetHardwareInfo(
 void CDeviceManagerRtl::PrintDeviceInfo(const int deviceNumber) const {
     SoapySDR::logf(SOAPY_SDR_NOTICE, "Device #%d: ", deviceNumber);
 
-    auto args = CallThreadSafe(
-        mImpl->mLock, this, &CDeviceManagerRtl::GetHardwareInfo, deviceNumber);
+    auto args = GetHardwareInfo(deviceNumber);
 
     if (!args.empty()) {
-        args.merge(
-            CallThreadSafe(
-                mImpl->mLock, this, &CDeviceManagerRtl::GetDevice, deviceNumber)
-                ->getHardwareInfo());
+        args.merge(GetDevice(deviceNumber)->getHardwareInfo());
     }
 
     for (const auto& info : args) {
@@ -246,8 +657,7 @@ void CDeviceManagerRtl::PrintDeviceInfo(const int deviceNumber) const {
 }
 
 void CDeviceManagerRtl::PrintDeviceSettings(const int deviceNumber) const {
-    const auto device = CallThreadSafe(
-        mImpl->mLock, this, &CDeviceManagerRtl::GetDevice, deviceNumber);
+    const auto device = GetDevice(deviceNumber);
     if (!device) {
         return;
     }
@@ -303,8 +713,8 @@ bool CDeviceManagerRtl::AddDevice(const SoapySDR::Kwargs& args) {
 
         SoapySDR::logf(SOAPY_SDR_NOTICE, "Device %s made", deviceIdent.c_str());
 
-        mImpl->mDeviceStorage.emplace_back(
-            std::shared_ptr<SoapySDR::Device>(device, deleter), args);
+        mImpl->PublishDevice(std::make_shared<DeviceData>(
+            std::shared_ptr<SoapySDR::Device>(device, deleter), args));
 
         return true;
     }
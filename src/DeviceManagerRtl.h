@@ -3,7 +3,10 @@
 
 #include <memory>
 
+#include "DataHandler.h"
 #include "DeviceManager.h"
+#include "PipelineGraph.h"
+#include "StartGroup.h"
 
 namespace SoapySDR {
 class Device;
@@ -11,7 +14,16 @@ class Device;
 namespace device_manager {
 class CDeviceManagerRtl : public IDeviceManager {
    public:
-    CDeviceManagerRtl();
+    /**
+     * @brief ctor
+     * @param handlerConfig optional stages of the data handlers
+     * @param graph processing graph started per device in place of a
+     * data handler, nullptr - the data handler
+     */
+    explicit CDeviceManagerRtl(
+        const data_handler::HandlerConfig& handlerConfig =
+            data_handler::HandlerConfig(),
+        std::shared_ptr<const pipeline_graph::GraphSpec> graph = nullptr);
     CDeviceManagerRtl(const CDeviceManagerRtl&) = delete;
     CDeviceManagerRtl& operator=(const CDeviceManagerRtl&) = delete;
     CDeviceManagerRtl(CDeviceManagerRtl&&);
@@ -39,6 +51,27 @@ class CDeviceManagerRtl : public IDeviceManager {
         const std::vector<size_t>& channels = std::vector<size_t>(1, 0),
         const SoapySDR::Kwargs& args = SoapySDR::Kwargs()) override;
 
+    bool StartStreamGroup(
+        const std::vector<int>& deviceNumbers = std::vector<int>(),
+        const std::string& format = "",
+        const std::vector<size_t>& channels = std::vector<size_t>(1, 0),
+        const SoapySDR::Kwargs& args = SoapySDR::Kwargs()) override;
+
+    /**
+     * @brief Returns the starts of the last StartStreamGroup, the skew and
+     * the window a cross-device alignment has to search
+     */
+    start_group::GroupReport GetStartReport() const;
+
+    bool StartSweep(const sweep_scanner::SweepPlan& plan) override;
+
+    bool StartTransmit(
+        const int deviceNumber,
+        const tx_feeder::TxConfig& config,
+        const std::string& format = "",
+        const std::vector<size_t>& channels = std::vector<size_t>(1, 0),
+        const SoapySDR::Kwargs& args = SoapySDR::Kwargs()) override;
+
     void StopStreams() override;
 
     void WaitShutdownSignal() override;
@@ -6,23 +6,32 @@
 #include <string>
 #include <vector>
 
-#include "DataQueue.h"
-
 namespace SoapySDR {
 class Device;
 class Stream;
 }  // namespace SoapySDR
 
 namespace device_stream {
+/**
+ * @brief Deactivates and closes a stream while its device is still alive
+ */
+struct CStreamDeleter {
+    CStreamDeleter(std::weak_ptr<SoapySDR::Device> device);
+    void operator()(SoapySDR::Stream* stream);
+
+    std::weak_ptr<SoapySDR::Device> mDevice;
+};
+
+/**
+ * @brief Format independent handle of a running stream, destroying it
+ * joins the stream thread
+ */
 class IDeviceStream {
    public:
-    virtual void RunStreamLoop(
-        data_queue::RawQueue& dataQueue,
-        std::shared_ptr<SoapySDR::Device> device,
-        const int direction,
-        const std::string& format,
-        const std::vector<size_t>& channels = std::vector<size_t>(),
-        const SoapySDR::Kwargs& args = SoapySDR::Kwargs()) = 0;
+    /**
+     * @brief Returns the element format of the stream, e.g. "CS8"
+     */
+    virtual std::string GetFormat() const = 0;
 
     virtual ~IDeviceStream(){};
 };
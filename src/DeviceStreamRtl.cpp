@@ -3,39 +3,110 @@
 #include <SoapySDR/Device.hpp>
 #include <SoapySDR/Formats.hpp>
 #include <chrono>
-#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <future>
 #include <stdexcept>
+#include <thread>
 
+#include "Metrics.h"
+#include "ThreadPlacement.h"
 #include "Utility.h"
 
-sig_atomic_t streamLoopDone = false;
-static void sigHandler(const int) {
-    LOG_FUNC();
-    streamLoopDone = true;
-}
-
 namespace device_stream {
-struct CStreamDeleter {
-    CStreamDeleter(std::weak_ptr<SoapySDR::Device> device)
-        : mDevice(std::move(device)) {}
-    void operator()(SoapySDR::Stream* stream) {
-        LOG_FUNC();
+namespace {
+struct StreamMetrics {
+    explicit StreamMetrics(const int deviceNumber)
+        : StreamMetrics(metrics::CMetricsRegistry::Instance(),
+                        metrics::Labels{
+                            {"device", std::to_string(deviceNumber)}}) {}
+
+    StreamMetrics(metrics::CMetricsRegistry& registry,
+                  const metrics::Labels& labels)
+        : mSamples(registry.GetCounter(
+              "kraken_samples_total", "Samples read from the device", labels))
+        , mOverflows(registry.GetCounter("kraken_overflows_total",
+                                         "Device overflows reported",
+                                         labels))
+        , mUnderflows(registry.GetCounter("kraken_underflows_total",
+                                          "Device underflows reported",
+                                          labels))
+        , mBlocksQueued(registry.GetCounter("kraken_blocks_queued_total",
+                                            "Blocks pushed to the data queue",
+                                            labels))
+        , mQueueDrops(registry.GetCounter("kraken_queue_drops_total",
+                                          "Blocks dropped by a stopped queue",
+                                          labels))
+        , mQueueDepth(registry.GetGauge("kraken_queue_depth",
+                                        "Blocks waiting in the data queue",
+                                        labels)) {}
+
+    metrics::CCounter& mSamples;
+    metrics::CCounter& mOverflows;
+    metrics::CCounter& mUnderflows;
+    metrics::CCounter& mBlocksQueued;
+    metrics::CCounter& mQueueDrops;
+    metrics::CGauge& mQueueDepth;
+};
 
-        if (auto device = mDevice.lock()) {
-            // cleanup stream and device
-            SoapySDR::logf(
-                SOAPY_SDR_NOTICE, "Deactivate & close Stream: %p", stream);
-            device->deactivateStream(stream);
-            device->closeStream(stream);
-        }
+struct TxMetrics {
+    explicit TxMetrics(const int deviceNumber)
+        : TxMetrics(metrics::CMetricsRegistry::Instance(),
+                    std::to_string(deviceNumber)) {}
+
+    TxMetrics(metrics::CMetricsRegistry& registry, const std::string& device)
+        : mSamples(registry.GetCounter("kraken_tx_samples_total",
+                                       "Samples written to the device",
+                                       {{"device", device}}))
+        , mStarvations(registry.GetCounter(
+              "kraken_tx_starvations_total",
+              "TX queue found empty in the middle of a burst",
+              {{"device", device}}))
+        , mStarvedUnderflows(registry.GetCounter(
+              "kraken_tx_underflows_total",
+              "Device underflows, cause starvation follows a TX queue "
+              "starvation",
+              {{"device", device}, {"cause", "starvation"}}))
+        , mDeviceUnderflows(registry.GetCounter(
+              "kraken_tx_underflows_total",
+              "Device underflows, cause starvation follows a TX queue "
+              "starvation",
+              {{"device", device}, {"cause", "device"}})) {}
+
+    metrics::CCounter& mSamples;
+    metrics::CCounter& mStarvations;
+    metrics::CCounter& mStarvedUnderflows;
+    metrics::CCounter& mDeviceUnderflows;
+};
+
+// the TX loop waits this long for the feeder to fill the queue
+constexpr auto kPrimeTimeout = std::chrono::seconds(1);
+// an underflow reported this long after a starvation is blamed on the host
+constexpr auto kStarvationWindow = std::chrono::milliseconds(250);
+constexpr auto kTxStatusPeriod = std::chrono::milliseconds(100);
+constexpr long kWriteTimeoutUs = 100000;
+}  // namespace
+
+CStreamDeleter::CStreamDeleter(std::weak_ptr<SoapySDR::Device> device)
+    : mDevice(std::move(device)) {}
+
+void CStreamDeleter::operator()(SoapySDR::Stream* stream) {
+    LOG_FUNC();
+
+    if (auto device = mDevice.lock()) {
+        // cleanup stream and device
+        SoapySDR::logf(
+            SOAPY_SDR_NOTICE, "Deactivate & close Stream: %p", stream);
+        device->deactivateStream(stream);
+        device->closeStream(stream);
     }
+}
+
+template <class Sample>
+struct CDeviceStreamRtl<Sample>::Impl {
+    // bytes of one complex sample in the stream buffers
+    static constexpr size_t kElemSize = 2u * sizeof(typename Sample::Component);
 
-    std::weak_ptr<SoapySDR::Device> mDevice;
-};
-struct CDeviceStreamRtl::Impl {
     ~Impl() {
         LOG_FUNC();
 
@@ -45,142 +116,188 @@ struct CDeviceStreamRtl::Impl {
         }
     }
 
-    void SetupStream(data_queue::RawQueue& dataQueue,
-                     std::shared_ptr<SoapySDR::Device> device,
-                     const int direction,
-                     const std::string& format,
-                     const std::vector<size_t>& channels,
-                     const SoapySDR::Kwargs& args = SoapySDR::Kwargs());
+    static std::unique_ptr<SoapySDR::Stream, CStreamDeleter> SetupStream(
+        const int direction,
+        const std::shared_ptr<SoapySDR::Device>& device,
+        const std::vector<size_t>& channels,
+        const SoapySDR::Kwargs& args = SoapySDR::Kwargs());
 
-    static std::string StreamLoop(
-        data_queue::RawQueue& dataQueue,
+    static std::string RxLoop(
+        data_queue::BlockQueue<Sample>& dataQueue,
         std::shared_ptr<SoapySDR::Device> device,
         std::unique_ptr<SoapySDR::Stream, CStreamDeleter> stream,
-        const int direction,
         const size_t numChans,
-        const size_t elemSize);
+        const int deviceNumber,
+        StreamMetrics metrics,
+        std::shared_ptr<start_group::CStartGroup> startGroup,
+        const double streamRate);
 
+    static std::string TxLoop(
+        data_queue::BlockQueue<Sample>& dataQueue,
+        std::shared_ptr<SoapySDR::Device> device,
+        std::unique_ptr<SoapySDR::Stream, CStreamDeleter> stream,
+        const size_t numChans,
+        const int deviceNumber,
+        TxMetrics metrics);
+
+    int mDeviceNumber{0};
     std::future<std::string> mThreadHandle;
 };
 
-CDeviceStreamRtl::CDeviceStreamRtl()
-    : mImpl(std::make_unique<CDeviceStreamRtl::Impl>()) {}
+template <class Sample>
+CDeviceStreamRtl<Sample>::CDeviceStreamRtl(const int deviceNumber)
+    : mImpl(std::make_unique<CDeviceStreamRtl<Sample>::Impl>()) {
+    mImpl->mDeviceNumber = deviceNumber;
+}
 
-CDeviceStreamRtl::CDeviceStreamRtl(CDeviceStreamRtl&&) = default;
+template <class Sample>
+CDeviceStreamRtl<Sample>::CDeviceStreamRtl(CDeviceStreamRtl&&) = default;
 
-CDeviceStreamRtl::~CDeviceStreamRtl() {
+template <class Sample>
+CDeviceStreamRtl<Sample>::~CDeviceStreamRtl() {
     LOG_FUNC();
 }
 
-void CDeviceStreamRtl::RunStreamLoop(data_queue::RawQueue& dataQueue,
-                                     std::shared_ptr<SoapySDR::Device> device,
-                                     const int direction,
-                                     const std::string& format,
-                                     const std::vector<size_t>& channels,
-                                     const SoapySDR::Kwargs& args) {
+template <class Sample>
+std::string CDeviceStreamRtl<Sample>::GetFormat() const {
+    return Sample::kFormat;
+}
+
+template <class Sample>
+void CDeviceStreamRtl<Sample>::RunStreamLoop(
+    data_queue::BlockQueue<Sample>& dataQueue,
+    std::shared_ptr<SoapySDR::Device> device,
+    const std::vector<size_t>& channels,
+    const SoapySDR::Kwargs& args,
+    std::shared_ptr<start_group::CStartGroup> startGroup) {
     LOG_FUNC();
 
-    mImpl->SetupStream(
-        dataQueue, std::move(device), direction, format, channels, args);
+    auto stream = Impl::SetupStream(SOAPY_SDR_RX, device, channels, args);
+    const auto streamRate =
+        device->getSampleRate(SOAPY_SDR_RX, channels.front());
+
+    mImpl->mThreadHandle = std::async(std::launch::async,
+                                      Impl::RxLoop,
+                                      std::ref(dataQueue),
+                                      std::move(device),
+                                      std::move(stream),
+                                      channels.size(),
+                                      mImpl->mDeviceNumber,
+                                      StreamMetrics(mImpl->mDeviceNumber),
+                                      std::move(startGroup),
+                                      streamRate);
 }
 
-void CDeviceStreamRtl::Impl::SetupStream(
-    data_queue::RawQueue& dataQueue,
+template <class Sample>
+void CDeviceStreamRtl<Sample>::RunTxStreamLoop(
+    data_queue::BlockQueue<Sample>& dataQueue,
     std::shared_ptr<SoapySDR::Device> device,
+    const std::vector<size_t>& channels,
+    const SoapySDR::Kwargs& args) {
+    LOG_FUNC();
+
+    auto stream = Impl::SetupStream(SOAPY_SDR_TX, device, channels, args);
+
+    mImpl->mThreadHandle = std::async(std::launch::async,
+                                      Impl::TxLoop,
+                                      std::ref(dataQueue),
+                                      std::move(device),
+                                      std::move(stream),
+                                      channels.size(),
+                                      mImpl->mDeviceNumber,
+                                      TxMetrics(mImpl->mDeviceNumber));
+}
+
+template <class Sample>
+std::unique_ptr<SoapySDR::Stream, CStreamDeleter>
+CDeviceStreamRtl<Sample>::Impl::SetupStream(
     const int direction,
-    const std::string& formatStr,
+    const std::shared_ptr<SoapySDR::Device>& device,
     const std::vector<size_t>& channels,
     [[maybe_unused]] const SoapySDR::Kwargs& args) {
     LOG_FUNC();
 
-    // create the stream, use the native format
-    double fullScale(0.0);
-    const auto format = formatStr.empty()
-                            ? device->getNativeStreamFormat(
-                                  direction, channels.front(), fullScale)
-                            : formatStr;
-    const auto elemSize = SoapySDR::formatToSize(format);
-    auto stream = device->setupStream(direction, format, channels);
+    auto stream = device->setupStream(direction, Sample::kFormat, channels);
 
     SoapySDR::logf(SOAPY_SDR_NOTICE, "setupStream: %p", stream);
 
-    SoapySDR::logf(SOAPY_SDR_INFO, "Stream format: %s", format.c_str());
+    SoapySDR::logf(SOAPY_SDR_INFO, "Stream format: %s", Sample::kFormat);
     SoapySDR::logf(SOAPY_SDR_INFO, "Num channels: %u", channels.size());
-    SoapySDR::logf(SOAPY_SDR_INFO, "Element size: %u", elemSize);
+    SoapySDR::logf(SOAPY_SDR_INFO, "Element size: %u", kElemSize);
     SoapySDR::logf(SOAPY_SDR_INFO,
-                   "Begin SOAPY_SDR_RX rate test at %f  Msps",
-                   device->getSampleRate(SOAPY_SDR_RX, channels.front()) / 1e6);
+                   "Begin %s rate test at %f  Msps",
+                   SOAPY_SDR_RX == direction ? "SOAPY_SDR_RX" : "SOAPY_SDR_TX",
+                   device->getSampleRate(direction, channels.front()) / 1e6);
 
-    auto streamUPtr = std::unique_ptr<SoapySDR::Stream, CStreamDeleter>(
+    return std::unique_ptr<SoapySDR::Stream, CStreamDeleter>(
         stream, CStreamDeleter(device));
-
-    mThreadHandle = std::async(std::launch::async,
-                               StreamLoop,
-                               std::ref(dataQueue),
-                               std::move(device),
-                               std::move(streamUPtr),
-                               direction,
-                               channels.size(),
-                               elemSize);
 }
 
-std::string CDeviceStreamRtl::Impl::StreamLoop(
-    data_queue::RawQueue& dataQueue,
+template <class Sample>
+std::string CDeviceStreamRtl<Sample>::Impl::RxLoop(
+    data_queue::BlockQueue<Sample>& dataQueue,
     std::shared_ptr<SoapySDR::Device> device,
     std::unique_ptr<SoapySDR::Stream, CStreamDeleter> stream,
-    const int direction,
     const size_t numChans,
-    const size_t elemSize) {
+    const int deviceNumber,
+    StreamMetrics metrics,
+    std::shared_ptr<start_group::CStartGroup> startGroup,
+    const double streamRate) {
     LOG_FUNC();
 
+    thread_placement::ApplyCurrentThread(
+        thread_placement::ThreadRole::Reader,
+        "kraken-rx" + std::to_string(deviceNumber));
+
+    // the queue keeps the depth, its consumer pops and a stop clears it
+    dataQueue.SetDepthGauge(&metrics.mQueueDepth);
+
     // allocate buffers for the stream read/write
     const auto numElems = device->getStreamMTU(stream.get());
-    std::vector<std::vector<std::int8_t>> buffMem(
-        numChans, std::vector<std::int8_t>(elemSize * numElems));
+    std::vector<data_queue::DataBlock<Sample>> blocks(numChans);
     std::vector<void*> buffs(numChans);
     for (size_t i = 0; i < numChans; i++) {
-        buffs[i] = buffMem[i].data();
+        blocks[i].data.resize(2u * numElems);
+        buffs[i] = blocks[i].data.data();
+        thread_placement::PrefaultBuffer(buffs[i], kElemSize * numElems);
     }
 
     // state collected in this loop
     unsigned int overflows(0);
     unsigned int underflows(0);
     unsigned long long totalSamples(0);
+    unsigned long long blockIndex(0);
 
     const auto startTime = std::chrono::high_resolution_clock::now();
     auto timeLastPrint = std::chrono::high_resolution_clock::now();
-    auto timeLastSpin = std::chrono::high_resolution_clock::now();
     auto timeLastStatus = std::chrono::high_resolution_clock::now();
-    int spinIndex(0);
 
     SoapySDR::logf(SOAPY_SDR_INFO,
                    "Starting stream loop, press Ctrl+C to exit...");
-    device->activateStream(stream.get());
-    signal(SIGINT, sigHandler);
-    signal(SIGTERM, sigHandler);
-    while (not streamLoopDone) {
-        int ret(0);
+    start_group::DeviceStart start;
+    if (startGroup) {
+        start = startGroup->Activate(
+            deviceNumber, *device, stream.get(), streamRate);
+    } else {
+        device->activateStream(stream.get());
+    }
+    // the queue is stopped by CDeviceManagerRtl::StopStreams
+    while (not dataQueue.IsQueueStopped()) {
         int flags(0);
         long long timeNs(0);
-        switch (direction) {
-            case SOAPY_SDR_RX:
-                ret = device->readStream(
-                    stream.get(), buffs.data(), numElems, flags, timeNs);
-                break;
-            case SOAPY_SDR_TX:
-                ret = device->writeStream(
-                    stream.get(), buffs.data(), numElems, flags, timeNs);
-                break;
-        }
+        auto ret = device->readStream(
+            stream.get(), buffs.data(), numElems, flags, timeNs);
 
         if (SOAPY_SDR_TIMEOUT == ret)
             continue;
         if (SOAPY_SDR_OVERFLOW == ret) {
             overflows++;
+            metrics.mOverflows.Add();
             continue;
         }
         if (SOAPY_SDR_UNDERFLOW == ret) {
             underflows++;
+            metrics.mUnderflows.Add();
             continue;
         }
         if (ret < 0) {
@@ -190,14 +307,14 @@ std::string CDeviceStreamRtl::Impl::StreamLoop(
             break;
         }
         totalSamples += ret;
+        metrics.mSamples.Add(ret);
+
+        // only every n-th block pays for the clock reads
+        const auto interval = latency_tracer::GetSampleInterval();
+        const auto sampled = 0u != interval && 0u == blockIndex++ % interval;
+        const auto readNs = sampled ? latency_tracer::NowNs() : 0u;
 
         const auto now = std::chrono::high_resolution_clock::now();
-        if (timeLastSpin + std::chrono::milliseconds(300) < now) {
-            timeLastSpin = now;
-            static const char spin[] = {"|/-\\"};
-            printf("\b%c", spin[(spinIndex++) % 4]);
-            fflush(stdout);
-        }
         // occasionally read out the stream status (non blocking)
         if (timeLastStatus + std::chrono::seconds(1) < now) {
             timeLastStatus = now;
@@ -207,13 +324,16 @@ std::string CDeviceStreamRtl::Impl::StreamLoop(
                 long long timeNs;
                 ret = device->readStreamStatus(
                     stream.get(), chanMask, flags, timeNs, 0);
-                if (SOAPY_SDR_OVERFLOW == ret)
+                if (SOAPY_SDR_OVERFLOW == ret) {
                     overflows++;
-                else if (SOAPY_SDR_UNDERFLOW == ret)
+                    metrics.mOverflows.Add();
+                } else if (SOAPY_SDR_UNDERFLOW == ret) {
                     underflows++;
-                else if (SOAPY_SDR_TIME_ERROR == ret) {
-                } else
+                    metrics.mUnderflows.Add();
+                } else if (SOAPY_SDR_TIME_ERROR == ret) {
+                } else {
                     break;
+                }
             }
         }
         if (timeLastPrint + std::chrono::seconds(5) < now) {
@@ -222,18 +342,39 @@ std::string CDeviceStreamRtl::Impl::StreamLoop(
                 std::chrono::duration_cast<std::chrono::microseconds>(
                     now - startTime);
             const auto sampleRate = double(totalSamples) / timePassed.count();
-            printf("\b%g Msps\t%g MBps",
-                   sampleRate,
-                   sampleRate * numChans * elemSize);
-            if (0u != overflows)
-                printf("\tOverflows %u", overflows);
-            if (0u != underflows)
-                printf("\tUnderflows %u", underflows);
-            printf("\n ");
+            SoapySDR::logf(SOAPY_SDR_INFO,
+                           "Device #%d: %g Msps, %g MBps, overflows %u, "
+                           "underflows %u",
+                           deviceNumber,
+                           sampleRate,
+                           sampleRate * numChans * kElemSize,
+                           overflows,
+                           underflows);
+        }
+
+        // blocks of a grouped start carry the time since the common epoch,
+        // the device time if it has one, otherwise the samples counted
+        if (start.synchronized) {
+            timeNs = start.timed && 0 != (flags & SOAPY_SDR_HAS_TIME)
+                         ? timeNs - start.hwEpochNs
+                         : start.EpochTimeNs(totalSamples - ret);
+            flags |= SOAPY_SDR_HAS_TIME;
         }
 
-        for (const auto& data : buffMem) {
-            dataQueue.Push(data);
+        for (auto& block : blocks) {
+            block.flags = flags;
+            block.timeNs = timeNs;
+            block.stamps = latency_tracer::BlockStamps();
+            if (sampled) {
+                block.stamps.sampled = true;
+                block.stamps.read = readNs;
+                block.stamps.enqueue = latency_tracer::NowNs();
+            }
+            if (dataQueue.Push(block)) {
+                metrics.mBlocksQueued.Add();
+            } else {
+                metrics.mQueueDrops.Add();
+            }
         }
     }
 
@@ -252,7 +393,7 @@ std::string CDeviceStreamRtl::Impl::StreamLoop(
                                    format,
                                    stream.get(),
                                    sampleRate,
-                                   sampleRate * numChans * elemSize,
+                                   sampleRate * numChans * kElemSize,
                                    overflows,
                                    underflows,
                                    totalSamples);
@@ -264,7 +405,7 @@ std::string CDeviceStreamRtl::Impl::StreamLoop(
              format,
              stream.get(),
              sampleRate,
-             sampleRate * numChans * elemSize,
+             sampleRate * numChans * kElemSize,
              overflows,
              underflows,
              totalSamples);
@@ -272,4 +413,167 @@ std::string CDeviceStreamRtl::Impl::StreamLoop(
     return report;
 }
 
+template <class Sample>
+std::string CDeviceStreamRtl<Sample>::Impl::TxLoop(
+    data_queue::BlockQueue<Sample>& dataQueue,
+    std::shared_ptr<SoapySDR::Device> device,
+    std::unique_ptr<SoapySDR::Stream, CStreamDeleter> stream,
+    const size_t numChans,
+    const int deviceNumber,
+    TxMetrics metrics) {
+    LOG_FUNC();
+
+    using Clock = std::chrono::steady_clock;
+
+    thread_placement::ApplyCurrentThread(
+        thread_placement::ThreadRole::Reader,
+        "kraken-tx" + std::to_string(deviceNumber));
+
+    const auto mtu = device->getStreamMTU(stream.get());
+
+    // the device starts with the prefetched blocks queued, otherwise the
+    // first writes race the feeder
+    const auto primeDeadline = Clock::now() + kPrimeTimeout;
+    while (not dataQueue.IsQueueStopped() &&
+           dataQueue.Size() < std::max<size_t>(1u, dataQueue.Capacity()) &&
+           Clock::now() < primeDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // state collected in this loop
+    unsigned int starvations(0);
+    unsigned int starvedUnderflows(0);
+    unsigned int deviceUnderflows(0);
+    unsigned long long totalSamples(0);
+    // the device expects more samples of the current burst
+    bool midBurst(false);
+    auto lastStarvation = Clock::time_point();
+    auto timeLastStatus = Clock::now();
+
+    // host stalls show up as starvations first, only the underflows that
+    // follow one within the window are blamed on the host
+    const auto countUnderflow = [&]() {
+        if (Clock::now() - lastStarvation < kStarvationWindow) {
+            starvedUnderflows++;
+            metrics.mStarvedUnderflows.Add();
+        } else {
+            deviceUnderflows++;
+            metrics.mDeviceUnderflows.Add();
+        }
+    };
+
+    device->activateStream(stream.get());
+    // burst times of the blocks are relative to the activation
+    const auto timeBase = device->getHardwareTime();
+
+    data_queue::DataBlock<Sample> block;
+    std::vector<const void*> buffs(numChans);
+    // the queue is stopped by CDeviceManagerRtl::StopStreams
+    while (not dataQueue.IsQueueStopped()) {
+        if (not dataQueue.Pop(block)) {
+            if (midBurst) {
+                starvations++;
+                metrics.mStarvations.Add();
+            }
+            dataQueue.WaitDataReady();
+            if (midBurst) {
+                lastStarvation = Clock::now();
+            }
+            continue;
+        }
+
+        const auto total = block.Samples();
+        size_t written(0u);
+        bool failed(false);
+        // a zero length block still carries its END_BURST to the device
+        while (true) {
+            const auto count = std::min(mtu, total - written);
+            int flags(0);
+            if (0u == written) {
+                flags |= block.flags & SOAPY_SDR_HAS_TIME;
+            }
+            if (written + count == total) {
+                flags |= block.flags & SOAPY_SDR_END_BURST;
+            }
+            for (auto& buff : buffs) {
+                buff = block.data.data() + 2u * written;
+            }
+
+            const auto ret = device->writeStream(stream.get(),
+                                                 buffs.data(),
+                                                 count,
+                                                 flags,
+                                                 timeBase + block.timeNs,
+                                                 kWriteTimeoutUs);
+            if (SOAPY_SDR_TIMEOUT == ret) {
+                if (dataQueue.IsQueueStopped()) {
+                    break;
+                }
+                continue;
+            }
+            if (SOAPY_SDR_UNDERFLOW == ret) {
+                countUnderflow();
+                continue;
+            }
+            if (ret < 0) {
+                SoapySDR::logf(SOAPY_SDR_ERROR,
+                               "Unexpected stream error %s",
+                               SoapySDR::errToStr(ret));
+                failed = true;
+                break;
+            }
+            written += ret;
+            if (written >= total || dataQueue.IsQueueStopped()) {
+                break;
+            }
+        }
+        if (failed) {
+            break;
+        }
+
+        totalSamples += written;
+        metrics.mSamples.Add(written);
+        midBurst = 0 == (block.flags & SOAPY_SDR_END_BURST);
+
+        // occasionally read out the stream status (non blocking)
+        const auto now = Clock::now();
+        if (timeLastStatus + kTxStatusPeriod < now) {
+            timeLastStatus = now;
+            while (true) {
+                size_t chanMask;
+                int flags;
+                long long timeNs;
+                const auto ret = device->readStreamStatus(
+                    stream.get(), chanMask, flags, timeNs, 0);
+                if (SOAPY_SDR_UNDERFLOW == ret) {
+                    countUnderflow();
+                } else if (SOAPY_SDR_TIME_ERROR == ret) {
+                    SoapySDR::logf(SOAPY_SDR_WARNING,
+                                   "TX burst time already passed");
+                } else {
+                    break;
+                }
+            }
+        }
+    }
+
+    char report[160];
+    snprintf(report,
+             sizeof(report),
+             "TX stream: %p TotalSamples %llu\tStarvations %u\tUnderflows "
+             "%u starvation / %u device",
+             stream.get(),
+             totalSamples,
+             starvations,
+             starvedUnderflows,
+             deviceUnderflows);
+
+    return report;
+}
+
+template class CDeviceStreamRtl<sample_types::CS8>;
+template class CDeviceStreamRtl<sample_types::CU8>;
+template class CDeviceStreamRtl<sample_types::CS16>;
+template class CDeviceStreamRtl<sample_types::CF32>;
+
 }  // namespace device_stream
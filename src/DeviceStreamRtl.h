@@ -4,26 +4,68 @@
 #include <SoapySDR/Errors.hpp>
 #include <SoapySDR/Types.hpp>
 
+#include "DataQueue.h"
 #include "DeviceStream.h"
+#include "StartGroup.h"
 
 namespace device_stream {
 
+/**
+ * @brief RX stream pushing typed blocks to a data queue or TX stream
+ * writing the blocks of a feeder queue
+ * @tparam Sample stream element type from SampleTypes.h, instantiated for
+ * CS8, CU8, CS16 and CF32
+ */
+template <class Sample>
 class CDeviceStreamRtl : public IDeviceStream {
    public:
-    CDeviceStreamRtl();
+    /**
+     * @brief ctor
+     * @param deviceNumber number device, labels the stream metrics
+     */
+    explicit CDeviceStreamRtl(const int deviceNumber = 0);
     CDeviceStreamRtl(const CDeviceStreamRtl&) = delete;
     CDeviceStreamRtl(CDeviceStreamRtl&&);
     CDeviceStreamRtl& operator=(const CDeviceStreamRtl&) = delete;
     CDeviceStreamRtl& operator=(CDeviceStreamRtl&&) = delete;
     ~CDeviceStreamRtl() override;
 
+    std::string GetFormat() const override;
+
+    /**
+     * @brief Sets up an RX stream in the Sample format and starts reading
+     * it in the background until the queue is stopped
+     * @param dataQueue receives one block per channel and read
+     * @param device the device to read
+     * @param channels a list of channels
+     * @param args stream args or empty for defaults
+     * @param startGroup activates the stream together with the other
+     * streams of the group and stamps the blocks with the time since the
+     * common epoch, nullptr - activated at once
+     */
     void RunStreamLoop(
-        data_queue::RawQueue& dataQueue,
+        data_queue::BlockQueue<Sample>& dataQueue,
+        std::shared_ptr<SoapySDR::Device> device,
+        const std::vector<size_t>& channels = std::vector<size_t>(1, 0),
+        const SoapySDR::Kwargs& args = SoapySDR::Kwargs(),
+        std::shared_ptr<start_group::CStartGroup> startGroup = nullptr);
+
+    /**
+     * @brief Sets up a TX stream in the Sample format, waits until the
+     * queue holds its capacity of blocks and writes them in the background
+     * until the queue is stopped. Blocks flagged SOAPY_SDR_HAS_TIME start a
+     * burst at their timeNs after the stream activation.
+     * @param dataQueue blocks to transmit, every channel sends the same
+     * samples
+     * @param device the device to write
+     * @param channels a list of channels
+     * @param args stream args or empty for defaults
+     */
+    void RunTxStreamLoop(
+        data_queue::BlockQueue<Sample>& dataQueue,
         std::shared_ptr<SoapySDR::Device> device,
-        const int direction,
-        const std::string& format,
         const std::vector<size_t>& channels = std::vector<size_t>(1, 0),
-        const SoapySDR::Kwargs& args = SoapySDR::Kwargs()) override;
+        const SoapySDR::Kwargs& args = SoapySDR::Kwargs());
 
    private:
     struct Impl;
@@ -0,0 +1,254 @@
+#include "DspKernels.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace dsp_kernels {
+namespace {
+// four floats per vector on both NEON and SSE2
+constexpr size_t kLanes = 4u;
+
+#if defined(__ARM_NEON)
+float HorizontalMax(const float32x4_t value) {
+    const auto pair = vpmax_f32(vget_low_f32(value), vget_high_f32(value));
+    return vget_lane_f32(vpmax_f32(pair, pair), 0);
+}
+
+float HorizontalMin(const float32x4_t value) {
+    const auto pair = vpmin_f32(vget_low_f32(value), vget_high_f32(value));
+    return vget_lane_f32(vpmin_f32(pair, pair), 0);
+}
+#elif defined(__SSE2__)
+float HorizontalMax(__m128 value) {
+    value = _mm_max_ps(value, _mm_movehl_ps(value, value));
+    value = _mm_max_ss(value, _mm_shuffle_ps(value, value, 1));
+    return _mm_cvtss_f32(value);
+}
+
+float HorizontalMin(__m128 value) {
+    value = _mm_min_ps(value, _mm_movehl_ps(value, value));
+    value = _mm_min_ss(value, _mm_shuffle_ps(value, value, 1));
+    return _mm_cvtss_f32(value);
+}
+#endif
+}  // namespace
+
+template <class Sample>
+void Convert(const typename Sample::Component* data,
+             const size_t count,
+             Complex* out) {
+    constexpr auto scale = 1.0f / Sample::kFullScale;
+    constexpr auto offset = Sample::kOffset;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = Complex((data[2 * i] - offset) * scale,
+                         (data[2 * i + 1] - offset) * scale);
+    }
+}
+
+template <class Sample>
+void ConvertCorrected(const typename Sample::Component* data,
+                      const size_t count,
+                      const IqCoefficients& coefficients,
+                      Complex* out,
+                      IqMoments& moments) {
+    constexpr auto scale = 1.0f / Sample::kFullScale;
+    constexpr auto offset = Sample::kOffset;
+    const auto dcI = coefficients.dcI;
+    const auto dcQ = coefficients.dcQ;
+    const auto gain = coefficients.gain;
+    const auto cross = coefficients.cross;
+
+    // one accumulator per lane, the sums need no reassociation and the
+    // compiler vectorizes the lane loop
+    float sumI[kLanes] = {};
+    float sumQ[kLanes] = {};
+    float sumII[kLanes] = {};
+    float sumQQ[kLanes] = {};
+    float sumIQ[kLanes] = {};
+    size_t i(0u);
+    for (; i + kLanes <= count; i += kLanes) {
+        for (size_t lane = 0; lane < kLanes; ++lane) {
+            const float re = (data[2 * (i + lane)] - offset) * scale;
+            const float im = (data[2 * (i + lane) + 1] - offset) * scale;
+            sumI[lane] += re;
+            sumQ[lane] += im;
+            sumII[lane] += re * re;
+            sumQQ[lane] += im * im;
+            sumIQ[lane] += re * im;
+            const auto centered = re - dcI;
+            out[i + lane] =
+                Complex(centered, gain * (im - dcQ) + cross * centered);
+        }
+    }
+    for (; i < count; ++i) {
+        const float re = (data[2 * i] - offset) * scale;
+        const float im = (data[2 * i + 1] - offset) * scale;
+        sumI[0] += re;
+        sumQ[0] += im;
+        sumII[0] += re * re;
+        sumQQ[0] += im * im;
+        sumIQ[0] += re * im;
+        const auto centered = re - dcI;
+        out[i] = Complex(centered, gain * (im - dcQ) + cross * centered);
+    }
+
+    for (size_t lane = 0; lane < kLanes; ++lane) {
+        moments.i += sumI[lane];
+        moments.q += sumQ[lane];
+        moments.ii += sumII[lane];
+        moments.qq += sumQQ[lane];
+        moments.iq += sumIQ[lane];
+    }
+    moments.count += count;
+}
+
+template void Convert<sample_types::CS8>(const std::int8_t*,
+                                         const size_t,
+                                         Complex*);
+template void Convert<sample_types::CU8>(const std::uint8_t*,
+                                         const size_t,
+                                         Complex*);
+template void Convert<sample_types::CS16>(const std::int16_t*,
+                                          const size_t,
+                                          Complex*);
+template void Convert<sample_types::CF32>(const float*,
+                                          const size_t,
+                                          Complex*);
+
+template void ConvertCorrected<sample_types::CS8>(const std::int8_t*,
+                                                  const size_t,
+                                                  const IqCoefficients&,
+                                                  Complex*,
+                                                  IqMoments&);
+template void ConvertCorrected<sample_types::CU8>(const std::uint8_t*,
+                                                  const size_t,
+                                                  const IqCoefficients&,
+                                                  Complex*,
+                                                  IqMoments&);
+template void ConvertCorrected<sample_types::CS16>(const std::int16_t*,
+                                                   const size_t,
+                                                   const IqCoefficients&,
+                                                   Complex*,
+                                                   IqMoments&);
+template void ConvertCorrected<sample_types::CF32>(const float*,
+                                                   const size_t,
+                                                   const IqCoefficients&,
+                                                   Complex*,
+                                                   IqMoments&);
+
+void MagnitudeDb(const kfr::univector<Complex>& spectrum,
+                 kfr::univector<kfr::fbase>& dB) {
+    dB = kfr::amp_to_dB(kfr::cabs(spectrum));
+}
+
+SpectrumStats ComputeStats(const kfr::univector<kfr::fbase>& dB) {
+    SpectrumStats stats;
+    stats.max = kfr::maxof(dB);
+    stats.min = kfr::minof(dB);
+    stats.mean = kfr::mean(dB);
+    stats.rms = kfr::rms(dB);
+    return stats;
+}
+
+void MaxHold(const float* in, const size_t count, float* hold) {
+    size_t i(0u);
+#if defined(__ARM_NEON)
+    for (; i + kLanes <= count; i += kLanes) {
+        vst1q_f32(hold + i, vmaxq_f32(vld1q_f32(hold + i), vld1q_f32(in + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + kLanes <= count; i += kLanes) {
+        _mm_storeu_ps(hold + i,
+                      _mm_max_ps(_mm_loadu_ps(hold + i), _mm_loadu_ps(in + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        hold[i] = std::max(hold[i], in[i]);
+    }
+}
+
+void MinHold(const float* in, const size_t count, float* hold) {
+    size_t i(0u);
+#if defined(__ARM_NEON)
+    for (; i + kLanes <= count; i += kLanes) {
+        vst1q_f32(hold + i, vminq_f32(vld1q_f32(hold + i), vld1q_f32(in + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + kLanes <= count; i += kLanes) {
+        _mm_storeu_ps(hold + i,
+                      _mm_min_ps(_mm_loadu_ps(hold + i), _mm_loadu_ps(in + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        hold[i] = std::min(hold[i], in[i]);
+    }
+}
+
+void Average(const float* in,
+             const size_t count,
+             const float alpha,
+             float* avg) {
+    // a multiply-add per bin, the compiler vectorizes it on its own
+    for (size_t i = 0; i < count; ++i) {
+        avg[i] += alpha * (in[i] - avg[i]);
+    }
+}
+
+float RangeMax(const float* in, const size_t count) {
+    size_t i(0u);
+    auto result = in[0];
+#if defined(__ARM_NEON)
+    if (count >= kLanes) {
+        auto value = vld1q_f32(in);
+        for (i = kLanes; i + kLanes <= count; i += kLanes) {
+            value = vmaxq_f32(value, vld1q_f32(in + i));
+        }
+        result = HorizontalMax(value);
+    }
+#elif defined(__SSE2__)
+    if (count >= kLanes) {
+        auto value = _mm_loadu_ps(in);
+        for (i = kLanes; i + kLanes <= count; i += kLanes) {
+            value = _mm_max_ps(value, _mm_loadu_ps(in + i));
+        }
+        result = HorizontalMax(value);
+    }
+#endif
+    for (; i < count; ++i) {
+        result = std::max(result, in[i]);
+    }
+    return result;
+}
+
+float RangeMin(const float* in, const size_t count) {
+    size_t i(0u);
+    auto result = in[0];
+#if defined(__ARM_NEON)
+    if (count >= kLanes) {
+        auto value = vld1q_f32(in);
+        for (i = kLanes; i + kLanes <= count; i += kLanes) {
+            value = vminq_f32(value, vld1q_f32(in + i));
+        }
+        result = HorizontalMin(value);
+    }
+#elif defined(__SSE2__)
+    if (count >= kLanes) {
+        auto value = _mm_loadu_ps(in);
+        for (i = kLanes; i + kLanes <= count; i += kLanes) {
+            value = _mm_min_ps(value, _mm_loadu_ps(in + i));
+        }
+        result = HorizontalMin(value);
+    }
+#endif
+    for (; i < count; ++i) {
+        result = std::min(result, in[i]);
+    }
+    return result;
+}
+
+}  // namespace dsp_kernels
@@ -0,0 +1,113 @@
+#ifndef __DSP_KERNELS_H__
+#define __DSP_KERNELS_H__
+
+#include <cstdint>
+#include <kfr/base.hpp>
+
+#include "SampleTypes.h"
+
+namespace dsp_kernels {
+using Complex = kfr::complex<kfr::fbase>;
+
+/**
+ * @brief Correction applied during the conversion:
+ * out = (i - dcI, gain * (q - dcQ) + cross * (i - dcI))
+ */
+struct IqCoefficients {
+    float dcI{0.0f};
+    float dcQ{0.0f};
+    float gain{1.0f};
+    float cross{0.0f};
+};
+
+/**
+ * @brief Sums of the uncorrected, scaled components of a block, the input
+ * of the blind DC and imbalance estimation
+ */
+struct IqMoments {
+    double i{0.0};
+    double q{0.0};
+    double ii{0.0};
+    double qq{0.0};
+    double iq{0.0};
+    size_t count{0u};
+};
+
+struct SpectrumStats {
+    kfr::fbase max{0};
+    kfr::fbase min{0};
+    kfr::fbase mean{0};
+    kfr::fbase rms{0};
+};
+
+/**
+ * @brief Converts interleaved I/Q components to complex samples scaled
+ * to full scale 1.0, the kernel is selected at compile time by the type
+ * @tparam Sample stream element type from SampleTypes.h
+ * @param data interleaved I/Q components, 2 * count values
+ * @param count number of complex samples
+ * @param out destination, at least count samples
+ */
+template <class Sample>
+void Convert(const typename Sample::Component* data,
+             const size_t count,
+             Complex* out);
+
+/**
+ * @brief Convert fused with the DC and IQ imbalance correction, the
+ * moments of the raw samples are gathered in the same pass
+ * @param coefficients correction of the current estimates
+ * @param moments sums of the block are added to it
+ */
+template <class Sample>
+void ConvertCorrected(const typename Sample::Component* data,
+                      const size_t count,
+                      const IqCoefficients& coefficients,
+                      Complex* out,
+                      IqMoments& moments);
+
+/**
+ * @brief Converts the spectrum magnitude to decibels
+ * @param spectrum transform output
+ * @param dB destination, resized to the spectrum size if needed
+ */
+void MagnitudeDb(const kfr::univector<Complex>& spectrum,
+                 kfr::univector<kfr::fbase>& dB);
+
+/**
+ * @brief Returns max, min, mean and rms of the dB spectrum
+ */
+SpectrumStats ComputeStats(const kfr::univector<kfr::fbase>& dB);
+
+/**
+ * @brief hold[i] = max(hold[i], in[i]), NEON or SSE2 with a scalar tail
+ */
+void MaxHold(const float* in, const size_t count, float* hold);
+
+/**
+ * @brief hold[i] = min(hold[i], in[i]), NEON or SSE2 with a scalar tail
+ */
+void MinHold(const float* in, const size_t count, float* hold);
+
+/**
+ * @brief avg[i] += alpha * (in[i] - avg[i]), alpha 1 / n gives the mean
+ * of n frames, a constant alpha the exponential average
+ */
+void Average(const float* in,
+             const size_t count,
+             const float alpha,
+             float* avg);
+
+/**
+ * @brief Returns the largest of count > 0 values
+ */
+float RangeMax(const float* in, const size_t count);
+
+/**
+ * @brief Returns the smallest of count > 0 values
+ */
+float RangeMin(const float* in, const size_t count);
+
+}  // namespace dsp_kernels
+
+#endif  // __DSP_KERNELS_H__
@@ -0,0 +1,227 @@
+#include "FastFir.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <kfr/dft.hpp>
+#include <limits>
+#include <mutex>
+
+namespace fast_fir {
+namespace {
+using Complex = dsp_kernels::Complex;
+using Spectrum = kfr::univector<Complex>;
+
+constexpr size_t kMinFftSize = 16u;
+constexpr size_t kMaxFftSize = 1u << 20;
+constexpr double kPi = 3.14159265358979323846;
+
+void Multiply(const Spectrum& a, const Spectrum& b, Spectrum& product) {
+    for (size_t i = 0; i < a.size(); ++i) {
+        product[i] = a[i] * b[i];
+    }
+}
+}  // namespace
+
+size_t ChooseFftSize(const size_t taps) {
+    const auto length = std::max<size_t>(1u, taps);
+    size_t size(kMinFftSize);
+    while (size < length && size < kMaxFftSize) {
+        size *= 2u;
+    }
+
+    // a forward and an inverse transform per block of size - length + 1
+    // outputs, the spectrum product is linear
+    auto best = size;
+    auto bestCost = std::numeric_limits<double>::infinity();
+    for (; size <= kMaxFftSize; size *= 2u) {
+        const auto cost = (2.0 * size * std::log2(size) + size) /
+                          static_cast<double>(size - length + 1u);
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = size;
+        }
+    }
+    return best;
+}
+
+std::vector<float> DesignLowpass(const size_t taps, const double cutoff) {
+    std::vector<float> filter(std::max<size_t>(1u, taps));
+    const auto center = (filter.size() - 1u) / 2.0;
+    const auto fc = std::clamp(cutoff, 0.0, 0.5);
+
+    double sum(0.0);
+    for (size_t n = 0; n < filter.size(); ++n) {
+        const auto t = n - center;
+        const auto sinc =
+            0.0 == t ? 2.0 * fc : std::sin(2.0 * kPi * fc * t) / (kPi * t);
+        const auto window =
+            filter.size() > 1u
+                ? 0.54 - 0.46 * std::cos(2.0 * kPi * n / (filter.size() - 1u))
+                : 1.0;
+        filter[n] = static_cast<float>(sinc * window);
+        sum += filter[n];
+    }
+    if (0.0 != sum) {
+        for (auto& tap : filter) {
+            tap = static_cast<float>(tap / sum);
+        }
+    }
+    return filter;
+}
+
+struct CFastFir::Impl {
+    explicit Impl(const size_t maxTaps)
+        : mMaxTaps(std::clamp<size_t>(maxTaps, 1u, kMaxFftSize / 2u))
+        , mPlan(ChooseFftSize(mMaxTaps))
+        , mOverlap(mMaxTaps - 1u)
+        , mBlock(mPlan.size - mOverlap)
+        , mInput(mPlan.size)
+        , mSpectrum(mPlan.size)
+        , mProduct(mPlan.size)
+        , mOutput(mPlan.size)
+        , mFaded(mPlan.size)
+        , mTemp(mPlan.temp_size) {
+        std::fill(mInput.begin(), mInput.end(), Complex(0.0f, 0.0f));
+    }
+
+    void TakePending();
+    void FilterBlock(kfr::univector<Complex>& out);
+
+    const size_t mMaxTaps;
+    const kfr::dft_plan<kfr::fbase> mPlan;
+    // the last mOverlap samples of the previous block, then mBlock new
+    const size_t mOverlap;
+    const size_t mBlock;
+    size_t mFill{0u};
+    Spectrum mInput;
+    Spectrum mSpectrum;
+    Spectrum mProduct;
+    Spectrum mOutput;
+    Spectrum mFaded;
+    kfr::univector<kfr::u8> mTemp;
+    std::shared_ptr<const Spectrum> mCurrent;
+    // crossfaded to in the next block
+    std::shared_ptr<const Spectrum> mNext;
+    // set by SetTaps, taken at a block boundary
+    std::mutex mPendingLock;
+    std::shared_ptr<const Spectrum> mPending;
+    std::atomic<bool> mHasPending{false};
+};
+
+void CFastFir::Impl::TakePending() {
+    if (not mHasPending.exchange(false, std::memory_order_acquire)) {
+        return;
+    }
+
+    std::lock_guard lock(mPendingLock);
+    if (mCurrent) {
+        mNext = std::move(mPending);
+    } else {
+        mCurrent = std::move(mPending);
+    }
+}
+
+void CFastFir::Impl::FilterBlock(kfr::univector<Complex>& out) {
+    TakePending();
+
+    mPlan.execute(mSpectrum, mInput, mTemp);
+    Multiply(mSpectrum, *mCurrent, mProduct);
+    mPlan.execute(mOutput, mProduct, mTemp, true);
+
+    // the first mOverlap outputs wrapped around, the rest is the linear
+    // convolution
+    const auto start = out.size();
+    out.resize(start + mBlock);
+    if (mNext) {
+        Multiply(mSpectrum, *mNext, mProduct);
+        mPlan.execute(mFaded, mProduct, mTemp, true);
+        for (size_t i = 0; i < mBlock; ++i) {
+            const auto weight = static_cast<float>(i + 1u) / mBlock;
+            out[start + i] = mOutput[mOverlap + i] * (1.0f - weight) +
+                             mFaded[mOverlap + i] * weight;
+        }
+        mCurrent = std::move(mNext);
+    } else {
+        std::copy(mOutput.begin() + mOverlap, mOutput.end(), &out[start]);
+    }
+
+    std::copy(mInput.end() - mOverlap, mInput.end(), mInput.begin());
+    mFill = 0u;
+}
+
+CFastFir::CFastFir(const size_t maxTaps)
+    : mImpl(std::make_unique<CFastFir::Impl>(maxTaps)) {}
+
+CFastFir::~CFastFir() = default;
+
+bool CFastFir::SetTaps(const std::vector<Complex>& taps) {
+    auto& impl = *mImpl;
+    if (taps.empty() || taps.size() > impl.mMaxTaps) {
+        return false;
+    }
+
+    // computed in the calling thread, the plan is shared read-only
+    const auto size = impl.mPlan.size;
+    Spectrum padded(size);
+    std::fill(padded.begin(), padded.end(), Complex(0.0f, 0.0f));
+    std::copy(taps.begin(), taps.end(), padded.begin());
+    auto spectrum = std::make_shared<Spectrum>(size);
+    kfr::univector<kfr::u8> temp(impl.mPlan.temp_size);
+    impl.mPlan.execute(*spectrum, padded, temp);
+    // the inverse transform is not normalized
+    const auto scale = 1.0f / size;
+    for (auto& bin : *spectrum) {
+        bin *= scale;
+    }
+
+    std::lock_guard lock(impl.mPendingLock);
+    impl.mPending = std::move(spectrum);
+    impl.mHasPending.store(true, std::memory_order_release);
+    return true;
+}
+
+bool CFastFir::SetTaps(const std::vector<float>& taps) {
+    std::vector<Complex> complexTaps(taps.size());
+    std::transform(taps.begin(),
+                   taps.end(),
+                   complexTaps.begin(),
+                   [](const float tap) { return Complex(tap, 0.0f); });
+    return SetTaps(complexTaps);
+}
+
+void CFastFir::Process(const Complex* in,
+                       const size_t count,
+                       kfr::univector<Complex>& out) {
+    auto& impl = *mImpl;
+    if (not impl.mCurrent) {
+        impl.TakePending();
+        if (not impl.mCurrent) {
+            out.insert(out.end(), in, in + count);
+            return;
+        }
+    }
+
+    size_t used(0u);
+    while (used < count) {
+        const auto take = std::min(count - used, impl.mBlock - impl.mFill);
+        std::copy(in + used,
+                  in + used + take,
+                  impl.mInput.begin() + impl.mOverlap + impl.mFill);
+        impl.mFill += take;
+        used += take;
+        if (impl.mFill == impl.mBlock) {
+            impl.FilterBlock(out);
+        }
+    }
+}
+
+size_t CFastFir::FftSize() const {
+    return mImpl->mPlan.size;
+}
+
+size_t CFastFir::BlockSize() const {
+    return mImpl->mBlock;
+}
+
+}  // namespace fast_fir
@@ -0,0 +1,83 @@
+#ifndef __FAST_FIR_H__
+#define __FAST_FIR_H__
+
+#include <kfr/base.hpp>
+#include <memory>
+#include <vector>
+
+#include "DspKernels.h"
+
+namespace fast_fir {
+/**
+ * @brief Returns the power of two FFT size with the lowest cost per
+ * output sample for the tap count, two transforms of the size per
+ * size - taps + 1 outputs
+ */
+size_t ChooseFftSize(const size_t taps);
+
+/**
+ * @brief Designs a Hamming windowed-sinc low pass with unity DC gain
+ * @param taps filter length
+ * @param cutoff cutoff frequency relative to the sample rate, 0.0 .. 0.5
+ */
+std::vector<float> DesignLowpass(const size_t taps, const double cutoff);
+
+/**
+ * @brief Overlap-save fast convolution of a complex stream, the cost per
+ * output sample grows with log(taps) instead of taps.
+ *
+ * The FFT size is chosen for the longest filter the engine accepts, the
+ * filter spectra are computed once when the taps are set. New taps may be
+ * set from any thread while the stream runs: the next block is filtered
+ * with both filters and crossfaded from the old to the new output, so a
+ * swap causes no discontinuity.
+ */
+class CFastFir {
+   public:
+    /**
+     * @param maxTaps longest filter SetTaps accepts, sets the FFT size
+     */
+    explicit CFastFir(const size_t maxTaps);
+    CFastFir(const CFastFir&) = delete;
+    CFastFir& operator=(const CFastFir&) = delete;
+    ~CFastFir();
+
+    /**
+     * @brief Replaces the filter at the next block boundary, thread safe.
+     * The first taps set apply at once, later ones are crossfaded.
+     * @return false if there are no taps or more than maxTaps
+     */
+    bool SetTaps(const std::vector<dsp_kernels::Complex>& taps);
+
+    /**
+     * @brief Real taps, the same filter for I and Q
+     */
+    bool SetTaps(const std::vector<float>& taps);
+
+    /**
+     * @brief Filters count samples and appends the outputs of the blocks
+     * completed, the latency is at most one block. Without taps the
+     * samples pass unfiltered.
+     */
+    void Process(const dsp_kernels::Complex* in,
+                 const size_t count,
+                 kfr::univector<dsp_kernels::Complex>& out);
+
+    /**
+     * @brief Returns the FFT size
+     */
+    size_t FftSize() const;
+
+    /**
+     * @brief Returns the new samples per block, FFT size - maxTaps + 1
+     */
+    size_t BlockSize() const;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace fast_fir
+
+#endif  // __FAST_FIR_H__
@@ -0,0 +1,1070 @@
+#include "GraphNodes.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <kfr/dft.hpp>
+#include <stdexcept>
+#include <utility>
+
+#include "BurstExtractor.h"
+#include "FastFir.h"
+#include "IqCorrection.h"
+#include "IqRecording.h"
+#include "Metrics.h"
+#include "SpectrumReducer.h"
+#include "TxSource.h"
+#include "Waterfall.h"
+
+namespace graph_nodes {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr KindInfo kKinds[] = {
+    {"device", PortType::None, PortType::Raw},
+    {"replay", PortType::None, PortType::Raw},
+    {"generator", PortType::None, PortType::Raw},
+    {"convert", PortType::Raw, PortType::Complex},
+    {"ddc", PortType::Complex, PortType::Complex},
+    {"fir", PortType::Complex, PortType::Complex},
+    {"fft", PortType::Complex, PortType::Spectrum},
+    {"detector", PortType::Spectrum, PortType::Spectrum},
+    {"burst", PortType::Raw, PortType::Burst},
+    {"recorder", PortType::Any, PortType::None},
+    {"network", PortType::Any, PortType::None},
+    {"shm", PortType::Any, PortType::None},
+    {"waterfall", PortType::Spectrum, PortType::None},
+    {"traces", PortType::Spectrum, PortType::None}};
+
+constexpr double kPi = 3.14159265358979323846;
+
+/**
+ * @brief Typed access to the key=value settings of a node
+ */
+class CParams {
+   public:
+    CParams(const pipeline_graph::NodeSpec& spec, const int deviceNumber)
+        : mSpec(spec), mDevice(std::to_string(deviceNumber)) {}
+
+    bool Has(const std::string& key) const {
+        return mSpec.params.count(key) != 0u;
+    }
+
+    std::string String(const std::string& key,
+                       const std::string& fallback = std::string()) const {
+        const auto found = mSpec.params.find(key);
+        auto value = mSpec.params.end() == found ? fallback : found->second;
+        for (auto pos = value.find("{device}"); std::string::npos != pos;
+             pos = value.find("{device}", pos)) {
+            value.replace(pos, 8u, mDevice);
+        }
+        return value;
+    }
+
+    std::string Required(const std::string& key) const {
+        if (not Has(key)) {
+            throw std::runtime_error("Graph node " + mSpec.name + " needs " +
+                                     key + "=");
+        }
+        return String(key);
+    }
+
+    double Number(const std::string& key, const double fallback) const {
+        if (not Has(key)) {
+            return fallback;
+        }
+        try {
+            return std::stod(String(key));
+        } catch (const std::exception&) {
+            throw std::runtime_error("Graph node " + mSpec.name + ": " +
+                                     key + " is not a number");
+        }
+    }
+
+    size_t Count(const std::string& key, const size_t fallback) const {
+        const auto value = Number(key, static_cast<double>(fallback));
+        if (value < 0.0) {
+            throw std::runtime_error("Graph node " + mSpec.name + ": " +
+                                     key + " is negative");
+        }
+        return static_cast<size_t>(value);
+    }
+
+   private:
+    const pipeline_graph::NodeSpec& mSpec;
+    const std::string mDevice;
+};
+
+/**
+ * @brief Returns the packet of the previous output for reuse if no edge
+ * or node holds it any more, a new one otherwise. The steady state
+ * doesn't allocate once every packet in flight has been recycled.
+ */
+template <class Sample>
+Packet<Sample>& Recycle(std::shared_ptr<Packet<Sample>>& slot) {
+    if (slot && 1 == slot.use_count()) {
+        // pairs with the release of the last consumer dropping it
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } else {
+        slot = std::make_shared<Packet<Sample>>();
+    }
+    return *slot;
+}
+
+template <class Sample>
+void CopyMeta(const Packet<Sample>& from, Packet<Sample>& to) {
+    to.timeNs = from.timeNs;
+    to.stamps = from.stamps;
+    to.traced = from.traced;
+}
+
+template <class Sample>
+std::pair<const void*, size_t> Payload(const Packet<Sample>& packet) {
+    switch (packet.type) {
+        case PortType::Raw:
+            return {packet.raw.data.data(),
+                    packet.raw.data.size() *
+                        sizeof(typename Sample::Component)};
+        case PortType::Complex:
+            return {packet.samples.data(),
+                    packet.samples.size() * sizeof(packet.samples[0])};
+        case PortType::Spectrum:
+            return {packet.spectrum.data(),
+                    packet.spectrum.size() * sizeof(packet.spectrum[0])};
+        case PortType::Burst:
+            return {packet.bursts.data(), packet.bursts.size()};
+        default:
+            return {nullptr, 0u};
+    }
+}
+
+template <class Sample>
+class CDeviceSource : public INode<Sample> {
+   public:
+    explicit CDeviceSource(data_queue::BlockQueue<Sample>& queue)
+        : mQueue(queue) {}
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>&) override {
+        if (mQueue.Empty()) {
+            return nullptr;
+        }
+        auto& packet = Recycle(mOutput);
+        // stamped before the pop, the dispatch is the pop and the copy of
+        // the block out of the queue
+        const auto ready = latency_tracer::NowNs();
+        if (not mQueue.Pop(packet.raw)) {
+            return nullptr;
+        }
+
+        packet.type = PortType::Raw;
+        packet.timeNs = packet.raw.timeNs;
+        packet.stamps = packet.raw.stamps;
+        if (packet.stamps.sampled) {
+            // a block pushed after the stamp waited for no one
+            packet.stamps.dequeue = std::max(packet.stamps.enqueue, ready);
+            packet.stamps.processStart = latency_tracer::NowNs();
+            packet.traced = std::make_shared<std::atomic<bool>>(false);
+        } else {
+            packet.traced.reset();
+        }
+        return mOutput;
+    }
+
+   private:
+    data_queue::BlockQueue<Sample>& mQueue;
+    std::shared_ptr<Packet<Sample>> mOutput;
+};
+
+/**
+ * @brief Replay and generator sources, paced at the sample rate unless
+ * realtime=0 lets backpressure alone set the pace
+ */
+template <class Sample>
+class CPacedSource : public INode<Sample> {
+   public:
+    CPacedSource(std::unique_ptr<tx_source::ITxSource<Sample>> source,
+                 const size_t blockSamples,
+                 const double sampleRate,
+                 const bool realtime)
+        : mSource(std::move(source))
+        , mBlockSamples(std::max<size_t>(1u, blockSamples))
+        , mSampleRate(sampleRate)
+        , mRealtime(realtime && sampleRate > 0.0) {}
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>&) override {
+        if (mDone) {
+            return nullptr;
+        }
+        const auto now = Clock::now();
+        if (0u == mSamples) {
+            mStart = now;
+        } else if (mRealtime && now < mNext) {
+            return nullptr;
+        }
+
+        auto& packet = Recycle(mOutput);
+        auto& data = packet.raw.data;
+        data.resize(2u * mBlockSamples);
+        const auto filled = mSource->Fill(data.data(), mBlockSamples);
+        if (0u == filled) {
+            mDone = true;
+            return nullptr;
+        }
+        data.resize(2u * filled);
+
+        packet.type = PortType::Raw;
+        packet.timeNs = mSampleRate > 0.0
+                            ? static_cast<long long>(mSamples * 1e9 /
+                                                     mSampleRate)
+                            : 0;
+        packet.stamps = latency_tracer::BlockStamps();
+        packet.traced.reset();
+        mSamples += filled;
+        if (mRealtime) {
+            mNext = mStart + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(
+                                     mSamples / mSampleRate));
+        }
+        return mOutput;
+    }
+
+   private:
+    std::unique_ptr<tx_source::ITxSource<Sample>> mSource;
+    const size_t mBlockSamples;
+    const double mSampleRate;
+    const bool mRealtime;
+    std::shared_ptr<Packet<Sample>> mOutput;
+    std::uint64_t mSamples{0u};
+    Clock::time_point mStart;
+    Clock::time_point mNext;
+    bool mDone{false};
+};
+
+template <class Sample>
+class CConvert : public INode<Sample> {
+   public:
+    CConvert(const CParams& params, const int deviceNumber) {
+        iq_correction::CorrectionConfig config;
+        config.updateBlocks = params.Count("iq-update", 0u);
+        config.dcAlpha = params.Number("dc-alpha", config.dcAlpha);
+        config.imbalanceAlpha =
+            params.Number("iq-alpha", config.imbalanceAlpha);
+        if (0u != config.updateBlocks) {
+            mCorrector = std::make_unique<iq_correction::CIqCorrector>(
+                deviceNumber, config);
+        }
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        auto& packet = Recycle(mOutput);
+        CopyMeta(*input, packet);
+        packet.type = PortType::Complex;
+
+        const auto size = input->raw.Samples();
+        packet.samples.resize(size);
+        if (mCorrector) {
+            mCorrector->Convert<Sample>(
+                input->raw.data.data(), size, packet.samples.data());
+        } else {
+            dsp_kernels::Convert<Sample>(
+                input->raw.data.data(), size, packet.samples.data());
+        }
+        return mOutput;
+    }
+
+   private:
+    std::unique_ptr<iq_correction::CIqCorrector> mCorrector;
+    std::shared_ptr<Packet<Sample>> mOutput;
+};
+
+/**
+ * @brief Shifts offset Hz to zero and decimates by an integer factor with
+ * a boxcar average, phase and partial sums carry over between packets
+ */
+template <class Sample>
+class CDdc : public INode<Sample> {
+   public:
+    CDdc(const CParams& params, const double sampleRate)
+        : mDecimation(std::max<size_t>(1u, params.Count("decimation", 1u))) {
+        const auto offset = params.Number("offset", 0.0);
+        if (sampleRate > 0.0) {
+            mStep = std::polar(1.0, -2.0 * kPi * offset / sampleRate);
+        }
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        const auto& in = input->samples;
+        const auto produced = (mCount + in.size()) / mDecimation;
+        if (0u == produced) {
+            Accumulate(in, nullptr);
+            return nullptr;
+        }
+
+        auto& packet = Recycle(mOutput);
+        CopyMeta(*input, packet);
+        packet.type = PortType::Complex;
+        packet.samples.resize(produced);
+        Accumulate(in, packet.samples.data());
+        return mOutput;
+    }
+
+   private:
+    void Accumulate(const kfr::univector<dsp_kernels::Complex>& in,
+                    dsp_kernels::Complex* out) {
+        const auto scale = 1.0 / mDecimation;
+        for (const auto& sample : in) {
+            mSum += std::complex<double>(sample.real(), sample.imag()) *
+                    mRotator;
+            mRotator *= mStep;
+            if (++mCount == mDecimation) {
+                *out++ = dsp_kernels::Complex(mSum.real() * scale,
+                                              mSum.imag() * scale);
+                mSum = 0.0;
+                mCount = 0u;
+            }
+        }
+        // the recursion drifts off the unit circle, renormalize per packet
+        mRotator /= std::abs(mRotator);
+    }
+
+    const size_t mDecimation;
+    std::complex<double> mStep{1.0, 0.0};
+    std::complex<double> mRotator{1.0, 0.0};
+    std::complex<double> mSum{0.0, 0.0};
+    size_t mCount{0u};
+    std::shared_ptr<Packet<Sample>> mOutput;
+};
+
+/**
+ * @brief Fast convolution filter, a windowed-sinc low pass of cutoff Hz
+ * and length taps or the taps of a file, one "re" or "re im" per line.
+ * The file is reloaded when it changes, the swap is crossfaded.
+ */
+template <class Sample>
+class CFir : public INode<Sample> {
+   public:
+    CFir(const pipeline_graph::NodeSpec& spec,
+         const CParams& params,
+         const double sampleRate)
+        : mName(spec.name), mPath(params.String("taps")) {
+        std::vector<dsp_kernels::Complex> taps;
+        if (mPath.empty()) {
+            const auto cutoff = params.Number("cutoff", 0.0);
+            if (cutoff <= 0.0 || sampleRate <= 0.0) {
+                throw std::runtime_error("Graph node " + mName +
+                                         " needs taps= or cutoff=");
+            }
+            const auto lowpass = fast_fir::DesignLowpass(
+                params.Count("length", 255u), cutoff / sampleRate);
+            taps.assign(lowpass.begin(), lowpass.end());
+        } else {
+            taps = LoadTaps();
+            if (taps.empty()) {
+                throw std::runtime_error("Graph node " + mName +
+                                         ": no taps in " + mPath);
+            }
+        }
+
+        // a reloaded file may grow up to max-taps
+        mFir = std::make_unique<fast_fir::CFastFir>(
+            std::max(params.Count("max-taps", 0u), taps.size()));
+        mFir->SetTaps(taps);
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "Graph %s: %zu taps, FFT %zu, %zu samples per block",
+                       mName.c_str(),
+                       taps.size(),
+                       mFir->FftSize(),
+                       mFir->BlockSize());
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        ReloadTaps();
+
+        auto& packet = Recycle(mOutput);
+        packet.samples.clear();
+        mFir->Process(
+            input->samples.data(), input->samples.size(), packet.samples);
+        if (packet.samples.empty()) {
+            return nullptr;
+        }
+        CopyMeta(*input, packet);
+        packet.type = PortType::Complex;
+        return mOutput;
+    }
+
+   private:
+    std::vector<dsp_kernels::Complex> LoadTaps() {
+        struct stat info {};
+        if (0 == stat(mPath.c_str(), &info)) {
+            mModified = info.st_mtime;
+        }
+
+        std::vector<dsp_kernels::Complex> taps;
+        std::ifstream file(mPath);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::replace(line.begin(), line.end(), ',', ' ');
+            float re(0.0f);
+            float im(0.0f);
+            if (std::sscanf(line.c_str(), "%f %f", &re, &im) >= 1) {
+                taps.emplace_back(re, im);
+            }
+        }
+        return taps;
+    }
+
+    void ReloadTaps() {
+        if (mPath.empty()) {
+            return;
+        }
+        const auto now = Clock::now();
+        if (now < mNextCheck) {
+            return;
+        }
+        mNextCheck = now + std::chrono::seconds(1);
+
+        struct stat info {};
+        if (0 != stat(mPath.c_str(), &info) || info.st_mtime == mModified) {
+            return;
+        }
+        const auto taps = LoadTaps();
+        if (not mFir->SetTaps(taps)) {
+            SoapySDR::logf(SOAPY_SDR_ERROR,
+                           "Graph %s: %zu taps in %s not applied",
+                           mName.c_str(),
+                           taps.size(),
+                           mPath.c_str());
+            return;
+        }
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "Graph %s: %zu taps reloaded",
+                       mName.c_str(),
+                       taps.size());
+    }
+
+    const std::string mName;
+    const std::string mPath;
+    std::unique_ptr<fast_fir::CFastFir> mFir;
+    time_t mModified{0};
+    Clock::time_point mNextCheck;
+    std::shared_ptr<Packet<Sample>> mOutput;
+};
+
+/**
+ * @brief Spectra of frames of size samples, the packets are gathered
+ * into frames whatever their sizes. A packet completing several frames
+ * yields the spectrum of the latest one.
+ */
+template <class Sample>
+class CFft : public INode<Sample> {
+   public:
+    explicit CFft(const CParams& params)
+        : mSize(params.Count("size", 1024u)) {
+        if (0u == mSize) {
+            throw std::runtime_error("Graph node fft: size= is 1 or more");
+        }
+        mPlan = std::make_unique<kfr::dft_plan<kfr::fbase>>(mSize);
+        mIn.resize(mSize);
+        mOut.resize(mSize);
+        mTemp.resize(mPlan->temp_size);
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        const auto& in = input->samples;
+        bool transformed(false);
+        for (size_t pos = 0; pos < in.size();) {
+            const auto take = std::min(mSize - mFill, in.size() - pos);
+            std::copy(in.begin() + pos,
+                      in.begin() + pos + take,
+                      mIn.begin() + mFill);
+            pos += take;
+            mFill += take;
+            if (mSize != mFill) {
+                break;
+            }
+            mFill = 0u;
+            // a later frame of the packet supersedes this one
+            if (in.size() - pos < mSize) {
+                mPlan->execute(mOut, mIn, mTemp);
+                transformed = true;
+            }
+        }
+        if (not transformed) {
+            return nullptr;
+        }
+        mOut = mOut / mSize;
+
+        auto& packet = Recycle(mOutput);
+        CopyMeta(*input, packet);
+        packet.type = PortType::Spectrum;
+        dsp_kernels::MagnitudeDb(mOut, packet.spectrum);
+        return mOutput;
+    }
+
+   private:
+    const size_t mSize;
+    // samples of the current frame gathered in mIn
+    size_t mFill{0u};
+    std::unique_ptr<kfr::dft_plan<kfr::fbase>> mPlan;
+    kfr::univector<dsp_kernels::Complex> mIn;
+    kfr::univector<dsp_kernels::Complex> mOut;
+    kfr::univector<kfr::u8> mTemp;
+    std::shared_ptr<Packet<Sample>> mOutput;
+};
+
+/**
+ * @brief Passes on the spectra whose peak reaches the threshold, the
+ * start of a detection is logged
+ */
+template <class Sample>
+class CDetector : public INode<Sample> {
+   public:
+    CDetector(const pipeline_graph::NodeSpec& spec,
+              const CParams& params,
+              const int deviceNumber)
+        : mName(spec.name)
+        , mDeviceNumber(deviceNumber)
+        , mThreshold(static_cast<float>(params.Number("threshold", -40.0)))
+        , mDetections(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_graph_detections_total",
+              "Spectra of a detector node above its threshold",
+              {{"device", std::to_string(deviceNumber)},
+               {"node", spec.name}})) {}
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        const auto& dB = input->spectrum;
+        if (dB.empty()) {
+            return nullptr;
+        }
+
+        const auto peak = std::max_element(dB.begin(), dB.end());
+        if (*peak < mThreshold) {
+            mActive = false;
+            return nullptr;
+        }
+
+        if (not mActive) {
+            SoapySDR::logf(SOAPY_SDR_INFO,
+                           "Graph %d %s: %.1f dB at bin %zu",
+                           mDeviceNumber,
+                           mName.c_str(),
+                           static_cast<float>(*peak),
+                           static_cast<size_t>(peak - dB.begin()));
+            mActive = true;
+        }
+        mDetections.Add();
+        // forwarded as is, nothing is copied
+        return input;
+    }
+
+   private:
+    const std::string mName;
+    const int mDeviceNumber;
+    const float mThreshold;
+    bool mActive{false};
+    metrics::CCounter& mDetections;
+};
+
+/**
+ * @brief Forwards only the active segments of the raw stream, as the
+ * packets of burst_extractor::CBurstExtractor. on= and off= are the
+ * thresholds in dB above the noise floor, pre= and post= the padding,
+ * envelope= and max= in samples. A block completing no burst produces
+ * nothing, one completing several produces them in one payload.
+ */
+template <class Sample>
+class CBurstNode : public INode<Sample> {
+   public:
+    CBurstNode(const pipeline_graph::NodeSpec& spec,
+               const CParams& params,
+               const int deviceNumber,
+               const double sampleRate) {
+        burst_extractor::BurstConfig config;
+        config.onDb = static_cast<float>(params.Number("on", config.onDb));
+        config.offDb = static_cast<float>(params.Number("off", config.offDb));
+        config.preSamples = params.Count("pre", config.preSamples);
+        config.postSamples = params.Count("post", config.postSamples);
+        config.envelopeSamples =
+            params.Count("envelope", config.envelopeSamples);
+        config.maxSamples = params.Count("max", config.maxSamples);
+        config.sampleRate = sampleRate;
+        if (config.offDb > config.onDb) {
+            throw std::runtime_error("Graph node " + spec.name +
+                                     ": off= is above on=");
+        }
+        mExtractor = std::make_unique<burst_extractor::CBurstExtractor>(
+            deviceNumber,
+            config,
+            Sample::kFormat,
+            2u * sizeof(typename Sample::Component));
+    }
+
+    void SetTunedFrequency(const double frequency) override {
+        mExtractor->SetTunedFrequency(frequency);
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        const auto& raw = input->raw;
+        const auto size = raw.Samples();
+        mSamples.resize(size);
+        dsp_kernels::Convert<Sample>(raw.data.data(), size, mSamples.data());
+
+        auto& packet = Recycle(mOutput);
+        packet.bursts.clear();
+        if (0u == mExtractor->AddBlock(raw.data.data(),
+                                       mSamples.data(),
+                                       size,
+                                       input->timeNs,
+                                       packet.bursts)) {
+            return nullptr;
+        }
+        CopyMeta(*input, packet);
+        packet.type = PortType::Burst;
+        return mOutput;
+    }
+
+   private:
+    std::unique_ptr<burst_extractor::CBurstExtractor> mExtractor;
+    kfr::univector<dsp_kernels::Complex> mSamples;
+    std::shared_ptr<Packet<Sample>> mOutput;
+};
+
+/**
+ * @brief Appends the payloads to a file: raw components, complex f32, dB
+ * f32 or burst packets depending on the input
+ */
+template <class Sample>
+class CRecorder : public INode<Sample> {
+   public:
+    explicit CRecorder(const CParams& params)
+        : mPath(params.Required("path")) {
+        mFile = fopen(mPath.c_str(), "wb");
+        if (nullptr == mFile) {
+            throw std::runtime_error("Can't open recording " + mPath + ": " +
+                                     strerror(errno));
+        }
+    }
+
+    ~CRecorder() override {
+        fclose(mFile);
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        const auto payload = Payload(*input);
+        if (fwrite(payload.first, 1u, payload.second, mFile) !=
+                payload.second &&
+            not mFailed) {
+            SoapySDR::logf(
+                SOAPY_SDR_ERROR, "Graph: can't write %s", mPath.c_str());
+            mFailed = true;
+        }
+        return nullptr;
+    }
+
+   private:
+    const std::string mPath;
+    FILE* mFile{nullptr};
+    bool mFailed{false};
+};
+
+/**
+ * @brief Records raw blocks compressed, codec=delta on a recorder node.
+ * bits= keeps that many high bits of each component (lossy), ratio=
+ * drops more low bits from a block whose coding falls short of that
+ * ratio, workers= and queue= size the encoder pool and its block queue.
+ */
+template <class Sample>
+class CCompressedRecorder : public INode<Sample> {
+   public:
+    CCompressedRecorder(const CParams& params,
+                        const int deviceNumber,
+                        const double sampleRate)
+        : mPath(params.Required("path")) {
+        constexpr auto kBits = 8u * sizeof(typename Sample::Component);
+        const auto bits = params.Count("bits", kBits);
+        if (0u == bits || bits > kBits) {
+            throw std::runtime_error("Graph node recorder " + mPath +
+                                     ": bits= is 1.." + std::to_string(kBits));
+        }
+
+        iq_recording::RecordingConfig config;
+        config.dropBits = static_cast<unsigned>(kBits - bits);
+        config.minRatio = params.Number("ratio", config.minRatio);
+        if (config.minRatio < 0.0) {
+            throw std::runtime_error("Graph node recorder " + mPath +
+                                     ": ratio= is 0 or more");
+        }
+        config.workers = params.Count("workers", config.workers);
+        config.queueBlocks = params.Count("queue", config.queueBlocks);
+        mWriter = std::make_unique<iq_recording::CRecordingWriter<Sample>>(
+            mPath, sampleRate, config, deviceNumber);
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        if (PortType::Raw == input->type) {
+            const auto& data = input->raw.data;
+            mWriter->Append(data.data(), data.size() / 2u, input->timeNs);
+        } else if (not mFailed) {
+            SoapySDR::logf(SOAPY_SDR_ERROR,
+                           "Graph: %s compresses raw blocks only",
+                           mPath.c_str());
+            mFailed = true;
+        }
+        return nullptr;
+    }
+
+   private:
+    const std::string mPath;
+    std::unique_ptr<iq_recording::CRecordingWriter<Sample>> mWriter;
+    bool mFailed{false};
+};
+
+/**
+ * @brief Sends the payloads as UDP datagrams. Each datagram starts with
+ * u32 sequence number, u16 payload type (1 raw, 2 complex, 3 spectrum,
+ * 4 bursts) and u16 1 on the last datagram of a packet, little-endian. A full
+ * socket buffer drops the rest of the packet, the receiver sees the gap.
+ */
+template <class Sample>
+class CNetworkSink : public INode<Sample> {
+   public:
+    explicit CNetworkSink(const CParams& params)
+        : mDatagram(std::max<size_t>(
+              kHeaderSize + 1u, params.Count("datagram", 1400u))) {
+        const auto host = params.String("host", "127.0.0.1");
+        const auto port = params.Required("port");
+
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* result(nullptr);
+        if (0 != getaddrinfo(host.c_str(), port.c_str(), &hints, &result)) {
+            throw std::runtime_error("Can't resolve " + host + ":" + port);
+        }
+        for (auto* address = result; nullptr != address;
+             address = address->ai_next) {
+            mSocket = socket(address->ai_family,
+                             address->ai_socktype | SOCK_NONBLOCK,
+                             address->ai_protocol);
+            if (mSocket < 0) {
+                continue;
+            }
+            if (0 == connect(mSocket, address->ai_addr, address->ai_addrlen)) {
+                break;
+            }
+            close(mSocket);
+            mSocket = -1;
+        }
+        freeaddrinfo(result);
+        if (mSocket < 0) {
+            throw std::runtime_error("Can't connect to " + host + ":" + port);
+        }
+        mBuffer.resize(mDatagram);
+    }
+
+    ~CNetworkSink() override {
+        close(mSocket);
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        const auto payload = Payload(*input);
+        const auto* bytes = static_cast<const std::uint8_t*>(payload.first);
+        const auto type = static_cast<std::uint16_t>(input->type);
+        const auto chunk = mDatagram - kHeaderSize;
+
+        size_t sent(0u);
+        do {
+            const auto size = std::min(chunk, payload.second - sent);
+            const std::uint16_t last = sent + size == payload.second;
+            std::memcpy(&mBuffer[0], &mSequence, 4u);
+            std::memcpy(&mBuffer[4], &type, 2u);
+            std::memcpy(&mBuffer[6], &last, 2u);
+            std::memcpy(&mBuffer[kHeaderSize], bytes + sent, size);
+            ++mSequence;
+            if (send(mSocket, mBuffer.data(), kHeaderSize + size, 0) < 0) {
+                break;
+            }
+            sent += size;
+        } while (sent < payload.second);
+        return nullptr;
+    }
+
+   private:
+    static constexpr size_t kHeaderSize = 8u;
+
+    const size_t mDatagram;
+    int mSocket{-1};
+    std::uint32_t mSequence{0u};
+    std::vector<std::uint8_t> mBuffer;
+};
+
+/**
+ * @brief Publishes the payloads into a POSIX shared memory ring.
+ *
+ * Header of 64 bytes: "KSH2", u32 slots, u32 slot bytes, u32 0, u64
+ * packets written. Slot n % slots holds packet n: u64 sequence, u32
+ * payload bytes, u32 payload type, i64 time ns, then the payload,
+ * truncated to the slot. The slot bytes are a multiple of 8.
+ *
+ * The sequence is 2n + 1 while packet n is written and 2n + 2 once it is
+ * complete. A reader loads the sequence with acquire, copies the slot,
+ * issues an acquire fence and loads the sequence again: the copy holds
+ * packet n only if both loads returned the same even value 2n + 2.
+ */
+template <class Sample>
+class CShmSink : public INode<Sample> {
+   public:
+    explicit CShmSink(const CParams& params)
+        : mName(params.Required("name"))
+        , mSlots(std::max<size_t>(1u, params.Count("slots", 16u)))
+        , mSlotBytes(SlotBytes(params.Count("slot-bytes", 1u << 20))) {
+        mSize = kHeaderSize + mSlots * mSlotBytes;
+        const auto fd = shm_open(mName.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Can't open shared memory " + mName +
+                                     ": " + strerror(errno));
+        }
+        if (0 != ftruncate(fd, mSize)) {
+            close(fd);
+            throw std::runtime_error("Can't size shared memory " + mName);
+        }
+        auto* base =
+            mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (MAP_FAILED == base) {
+            throw std::runtime_error("Can't map shared memory " + mName);
+        }
+
+        mBase = static_cast<std::uint8_t*>(base);
+        // the sequences of a previous run would match the new packets
+        std::memset(mBase, 0, mSize);
+        const std::uint32_t header[] = {
+            0x3248534bu,  // "KSH2"
+            static_cast<std::uint32_t>(mSlots),
+            static_cast<std::uint32_t>(mSlotBytes),
+            0u};
+        std::memcpy(mBase, header, sizeof(header));
+        Count().store(0u, std::memory_order_release);
+    }
+
+    ~CShmSink() override {
+        munmap(mBase, mSize);
+        shm_unlink(mName.c_str());
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        const auto payload = Payload(*input);
+        const auto size = std::min(payload.second, mSlotBytes - kSlotHeader);
+        auto* slot = mBase + kHeaderSize + (mWritten % mSlots) * mSlotBytes;
+        auto& sequence = *reinterpret_cast<std::atomic<std::uint64_t>*>(slot);
+
+        // odd while written, the fence keeps the data writes after it
+        sequence.store(2u * mWritten + 1u, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const std::uint32_t info[] = {
+            static_cast<std::uint32_t>(size),
+            static_cast<std::uint32_t>(input->type)};
+        const std::int64_t timeNs = input->timeNs;
+        std::memcpy(slot + 8u, info, sizeof(info));
+        std::memcpy(slot + 8u + sizeof(info), &timeNs, sizeof(timeNs));
+        std::memcpy(slot + kSlotHeader, payload.first, size);
+
+        sequence.store(2u * mWritten + 2u, std::memory_order_release);
+        Count().store(++mWritten, std::memory_order_release);
+        return nullptr;
+    }
+
+   private:
+    static constexpr size_t kHeaderSize = 64u;
+    static constexpr size_t kSlotHeader = 24u;
+
+    // a header and a byte at least, a multiple of 8 aligns the sequences
+    static size_t SlotBytes(const size_t requested) {
+        return (std::max(kSlotHeader + 1u, requested) + 7u) & ~size_t(7u);
+    }
+
+    std::atomic<std::uint64_t>& Count() {
+        return *reinterpret_cast<std::atomic<std::uint64_t>*>(mBase + 16u);
+    }
+
+    const std::string mName;
+    const size_t mSlots;
+    const size_t mSlotBytes;
+    size_t mSize{0u};
+    std::uint8_t* mBase{nullptr};
+    std::uint64_t mWritten{0u};
+};
+
+template <class Sample>
+class CWaterfallSink : public INode<Sample> {
+   public:
+    CWaterfallSink(const CParams& params, const int deviceNumber) {
+        waterfall::WaterfallConfig config;
+        config.outputDir = params.Required("dir");
+        config.width = params.Count("width", config.width);
+        config.tileRows = params.Count("rows", config.tileRows);
+        config.minDb = params.Number("min", config.minDb);
+        config.maxDb = params.Number("max", config.maxDb);
+        config.maxTiles = params.Count("tiles", config.maxTiles);
+        mWaterfall = std::make_unique<waterfall::CWaterfall>(deviceNumber,
+                                                             config);
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        mWaterfall->AddFrame(input->spectrum);
+        return nullptr;
+    }
+
+   private:
+    std::unique_ptr<waterfall::CWaterfall> mWaterfall;
+};
+
+template <class Sample>
+class CTracesSink : public INode<Sample> {
+   public:
+    CTracesSink(const CParams& params, const int deviceNumber) {
+        spectrum_reducer::ReducerConfig config;
+        config.outputDir = params.Required("dir");
+        config.width = params.Count("width", config.width);
+        config.rate = params.Number("rate", config.rate);
+        config.holdTime = std::chrono::milliseconds(
+            params.Count("hold", config.holdTime.count()));
+        mReducer = std::make_unique<spectrum_reducer::CSpectrumReducer>(
+            deviceNumber, config);
+    }
+
+    PacketPtr<Sample> Process(const PacketPtr<Sample>& input) override {
+        mReducer->AddFrame(input->spectrum);
+        return nullptr;
+    }
+
+   private:
+    std::unique_ptr<spectrum_reducer::CSpectrumReducer> mReducer;
+};
+}  // namespace
+
+const KindInfo* FindKind(const std::string& kind) {
+    for (const auto& info : kKinds) {
+        if (kind == info.kind) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+template <class Sample>
+std::unique_ptr<INode<Sample>> CreateNode(
+    const pipeline_graph::NodeSpec& spec,
+    const int deviceNumber,
+    const double sampleRate,
+    data_queue::BlockQueue<Sample>& deviceQueue) {
+    const CParams params(spec, deviceNumber);
+    const auto& kind = spec.kind;
+
+    if ("device" == kind) {
+        return std::make_unique<CDeviceSource<Sample>>(deviceQueue);
+    }
+    if ("replay" == kind || "generator" == kind) {
+        const auto blockSamples = params.Count("block", 16384u);
+        std::unique_ptr<tx_source::ITxSource<Sample>> source;
+        if ("replay" == kind) {
+            // start= seconds into a compressed recording
+            source = tx_source::OpenFile<Sample>(
+                params.Required("path"),
+                0.0 != params.Number("loop", 0.0),
+                8u * blockSamples * 2u * sizeof(typename Sample::Component),
+                params.Number("start", 0.0));
+        } else {
+            source = std::make_unique<tx_source::CToneSource<Sample>>(
+                params.Number("offset", 100e3),
+                sampleRate,
+                params.Number("amplitude", 0.5));
+        }
+        return std::make_unique<CPacedSource<Sample>>(
+            std::move(source),
+            blockSamples,
+            sampleRate,
+            0.0 != params.Number("realtime", 1.0));
+    }
+    if ("convert" == kind) {
+        return std::make_unique<CConvert<Sample>>(params, deviceNumber);
+    }
+    if ("ddc" == kind) {
+        return std::make_unique<CDdc<Sample>>(params, sampleRate);
+    }
+    if ("fir" == kind) {
+        return std::make_unique<CFir<Sample>>(spec, params, sampleRate);
+    }
+    if ("fft" == kind) {
+        return std::make_unique<CFft<Sample>>(params);
+    }
+    if ("detector" == kind) {
+        return std::make_unique<CDetector<Sample>>(spec, params, deviceNumber);
+    }
+    if ("burst" == kind) {
+        return std::make_unique<CBurstNode<Sample>>(
+            spec, params, deviceNumber, sampleRate);
+    }
+    if ("recorder" == kind) {
+        const auto codec = params.String("codec", "raw");
+        if ("delta" == codec) {
+            return std::make_unique<CCompressedRecorder<Sample>>(
+                params, deviceNumber, sampleRate);
+        }
+        if ("raw" != codec) {
+            throw std::runtime_error("Graph node " + spec.name +
+                                     ": unknown codec " + codec);
+        }
+        return std::make_unique<CRecorder<Sample>>(params);
+    }
+    if ("network" == kind) {
+        return std::make_unique<CNetworkSink<Sample>>(params);
+    }
+    if ("shm" == kind) {
+        return std::make_unique<CShmSink<Sample>>(params);
+    }
+    if ("waterfall" == kind) {
+        return std::make_unique<CWaterfallSink<Sample>>(params, deviceNumber);
+    }
+    if ("traces" == kind) {
+        return std::make_unique<CTracesSink<Sample>>(params, deviceNumber);
+    }
+    throw std::runtime_error("Graph node " + spec.name + ": unknown kind " +
+                             kind);
+}
+
+template std::unique_ptr<INode<sample_types::CS8>> CreateNode(
+    const pipeline_graph::NodeSpec&,
+    const int,
+    const double,
+    data_queue::BlockQueue<sample_types::CS8>&);
+template std::unique_ptr<INode<sample_types::CU8>> CreateNode(
+    const pipeline_graph::NodeSpec&,
+    const int,
+    const double,
+    data_queue::BlockQueue<sample_types::CU8>&);
+template std::unique_ptr<INode<sample_types::CS16>> CreateNode(
+    const pipeline_graph::NodeSpec&,
+    const int,
+    const double,
+    data_queue::BlockQueue<sample_types::CS16>&);
+template std::unique_ptr<INode<sample_types::CF32>> CreateNode(
+    const pipeline_graph::NodeSpec&,
+    const int,
+    const double,
+    data_queue::BlockQueue<sample_types::CF32>&);
+
+}  // namespace graph_nodes
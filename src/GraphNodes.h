@@ -0,0 +1,91 @@
+#ifndef __GRAPH_NODES_H__
+#define __GRAPH_NODES_H__
+
+#include <atomic>
+#include <cstdint>
+#include <kfr/base.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DataQueue.h"
+#include "DspKernels.h"
+#include "LatencyTracer.h"
+#include "PipelineGraph.h"
+
+namespace graph_nodes {
+using pipeline_graph::PortType;
+
+/**
+ * @brief Payload passed along the graph edges, shared read-only by all
+ * consumers of a node, only the member of its type is valid
+ */
+template <class Sample>
+struct Packet {
+    PortType type{PortType::None};
+    data_queue::DataBlock<Sample> raw;
+    kfr::univector<dsp_kernels::Complex> samples;
+    kfr::univector<kfr::fbase> spectrum;
+    // KBP1 packets of burst_extractor::CBurstExtractor
+    std::vector<std::uint8_t> bursts;
+    // time of the first sample, hardware time for the device source
+    long long timeNs{0};
+    latency_tracer::BlockStamps stamps;
+    // set by the first sink a sampled block reaches, shared by the
+    // packets derived from it so a fan out is traced once
+    std::shared_ptr<std::atomic<bool>> traced;
+};
+
+template <class Sample>
+using PacketPtr = std::shared_ptr<const Packet<Sample>>;
+
+struct KindInfo {
+    const char* kind;
+    PortType input;
+    PortType output;
+};
+
+/**
+ * @brief Returns the ports of a node kind, nullptr if it is unknown
+ */
+const KindInfo* FindKind(const std::string& kind);
+
+/**
+ * @brief A graph node, called by one worker at a time
+ */
+template <class Sample>
+class INode {
+   public:
+    /**
+     * @brief Sources get no input and return the next packet, transforms
+     * return the result of the input and sinks consume it
+     * @return nullptr if nothing is produced this time
+     */
+    virtual PacketPtr<Sample> Process(const PacketPtr<Sample>& input) = 0;
+
+    /**
+     * @brief Tells the node about a retune of the device, called from any
+     * thread, ignored by the nodes working in relative frequencies
+     */
+    virtual void SetTunedFrequency(const double) {}
+
+    virtual ~INode(){};
+};
+
+/**
+ * @brief Creates the node of a spec, throws std::runtime_error on a bad
+ * setting or if a file, socket or shared memory can't be opened
+ * @param deviceNumber number device, replaces "{device}" in the settings
+ * @param sampleRate stream sample rate
+ * @param deviceQueue blocks of the RX stream, read by the device source
+ */
+template <class Sample>
+std::unique_ptr<INode<Sample>> CreateNode(
+    const pipeline_graph::NodeSpec& spec,
+    const int deviceNumber,
+    const double sampleRate,
+    data_queue::BlockQueue<Sample>& deviceQueue);
+
+}  // namespace graph_nodes
+
+#endif  // __GRAPH_NODES_H__
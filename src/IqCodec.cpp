@@ -0,0 +1,345 @@
+#include "IqCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "SampleTypes.h"
+
+namespace iq_codec {
+namespace {
+// a quotient this large escapes to kRawBits of the residual
+constexpr unsigned kEscapeQuotient = 24u;
+constexpr unsigned kRiceBits = 5u;
+constexpr unsigned kHeaderBits = 2u + kRiceBits;
+// none, delta and second order delta
+constexpr unsigned kPredictors = 3u;
+
+/**
+ * @brief Component range of the integer formats, offset binary turned
+ * signed
+ */
+template <class Component>
+struct IntegerTraits {
+    static constexpr unsigned kBits = 8u * sizeof(Component);
+    static constexpr std::int32_t kOffset =
+        std::is_unsigned<Component>::value ? 1 << (kBits - 1u) : 0;
+    static constexpr std::int32_t kMin = -(1 << (kBits - 1u));
+    static constexpr std::int32_t kMax = (1 << (kBits - 1u)) - 1;
+    // a second order residual spans 4 times the range, zigzag doubles it
+    static constexpr unsigned kRawBits = kBits + 3u;
+};
+
+std::uint32_t ZigZag(const std::int32_t value) {
+    return (static_cast<std::uint32_t>(value) << 1u) ^
+           static_cast<std::uint32_t>(value >> 31);
+}
+
+std::int32_t UnZigZag(const std::uint32_t value) {
+    return static_cast<std::int32_t>(value >> 1u) ^
+           -static_cast<std::int32_t>(value & 1u);
+}
+
+std::uint64_t Mask(const unsigned bits) {
+    return (std::uint64_t(1u) << bits) - 1u;
+}
+
+/**
+ * @brief MSB first bit packer, the caller sizes the output for the worst
+ * case
+ */
+class CBitWriter {
+   public:
+    explicit CBitWriter(std::uint8_t* out) : mOut(out) {}
+
+    // at most 56 bits at a time
+    void Put(const std::uint64_t value, const unsigned bits) {
+        mBuffer = (mBuffer << bits) | value;
+        mBits += bits;
+        while (mBits >= 8u) {
+            mBits -= 8u;
+            *mOut++ = static_cast<std::uint8_t>(mBuffer >> mBits);
+        }
+    }
+
+    // pads the last byte, returns the end of the output
+    std::uint8_t* Flush() {
+        if (0u != mBits) {
+            *mOut++ = static_cast<std::uint8_t>(mBuffer << (8u - mBits));
+            mBits = 0u;
+        }
+        return mOut;
+    }
+
+   private:
+    std::uint8_t* mOut;
+    std::uint64_t mBuffer{0u};
+    unsigned mBits{0u};
+};
+
+class CBitReader {
+   public:
+    CBitReader(const std::uint8_t* in, const size_t bytes)
+        : mIn(in), mEnd(in + bytes) {}
+
+    // at most 56 bits at a time, reading past the end sets the overrun
+    std::uint64_t Get(const unsigned bits) {
+        if (0u == bits) {
+            return 0u;
+        }
+        if (mBits < bits) {
+            Refill();
+            if (mBits < bits) {
+                mOverrun = true;
+                mBits = 0u;
+                return 0u;
+            }
+        }
+        mBits -= bits;
+        return (mBuffer >> mBits) & Mask(bits);
+    }
+
+    /**
+     * @brief Consumes up to limit zeros and the one ending them
+     * @return the zeros, limit if there were limit zeros and no one
+     */
+    unsigned Zeros(const unsigned limit) {
+        const auto peek = Peek(limit + 1u);
+        if (0u == peek) {
+            Get(limit);
+            return limit;
+        }
+        const auto zeros = limit + 1u - (64u - __builtin_clzll(peek));
+        Get(zeros + 1u);
+        return zeros;
+    }
+
+    bool Overrun() const {
+        return mOverrun;
+    }
+
+   private:
+    void Refill() {
+        while (mBits <= 56u && mIn < mEnd) {
+            mBuffer = (mBuffer << 8u) | *mIn++;
+            mBits += 8u;
+        }
+    }
+
+    // the next bits, zeros past the end
+    std::uint64_t Peek(const unsigned bits) {
+        if (mBits < bits) {
+            Refill();
+        }
+        if (mBits < bits) {
+            return (mBuffer << (bits - mBits)) & Mask(bits);
+        }
+        return (mBuffer >> (mBits - bits)) & Mask(bits);
+    }
+
+    const std::uint8_t* mIn;
+    const std::uint8_t* const mEnd;
+    std::uint64_t mBuffer{0u};
+    unsigned mBits{0u};
+    bool mOverrun{false};
+};
+
+// the two previous values of a channel
+struct History {
+    std::int32_t x1{0};
+    std::int32_t x2{0};
+};
+
+template <class Sample>
+void EncodeGroup(const typename Sample::Component* in,
+                 const size_t count,
+                 const unsigned dropBits,
+                 History& history,
+                 CBitWriter& writer) {
+    using Traits = IntegerTraits<typename Sample::Component>;
+    const std::int32_t half = 0u == dropBits ? 0 : 1 << (dropBits - 1u);
+    const std::int32_t high = Traits::kMax >> dropBits;
+
+    std::uint32_t residuals[kPredictors][CBlockCodec<Sample>::kGroupSamples];
+    std::uint64_t sums[kPredictors] = {0u, 0u, 0u};
+    auto x1 = history.x1;
+    auto x2 = history.x2;
+    for (size_t i = 0; i < count; ++i) {
+        // the stride skips the other channel
+        const auto raw = static_cast<std::int32_t>(in[2u * i]) -
+                         Traits::kOffset;
+        const auto value = std::min(high, (raw + half) >> dropBits);
+        residuals[0][i] = ZigZag(value);
+        residuals[1][i] = ZigZag(value - x1);
+        residuals[2][i] = ZigZag(value - 2 * x1 + x2);
+        sums[0] += residuals[0][i];
+        sums[1] += residuals[1][i];
+        sums[2] += residuals[2][i];
+        x2 = x1;
+        x1 = value;
+    }
+    history.x1 = x1;
+    history.x2 = x2;
+
+    const auto predictor = static_cast<unsigned>(
+        std::min_element(sums, sums + kPredictors) - sums);
+    const auto sum = sums[predictor];
+    // the Rice parameter close to log2 of the mean residual
+    unsigned k(0u);
+    while (k < Traits::kRawBits && (std::uint64_t(count) << (k + 1u)) <= sum) {
+        ++k;
+    }
+
+    writer.Put((predictor << kRiceBits) | k, kHeaderBits);
+    for (size_t i = 0; i < count; ++i) {
+        const auto residual = residuals[predictor][i];
+        const auto quotient = residual >> k;
+        if (quotient < kEscapeQuotient) {
+            // quotient zeros, a one and the k low bits
+            writer.Put((std::uint64_t(1u) << k) | (residual & Mask(k)),
+                       quotient + 1u + k);
+        } else {
+            writer.Put(0u, kEscapeQuotient);
+            writer.Put(residual, Traits::kRawBits);
+        }
+    }
+}
+
+template <class Sample>
+bool DecodeGroup(CBitReader& reader,
+                 const size_t count,
+                 const unsigned dropBits,
+                 History& history,
+                 typename Sample::Component* out) {
+    using Component = typename Sample::Component;
+    using Traits = IntegerTraits<Component>;
+    const auto header = static_cast<unsigned>(reader.Get(kHeaderBits));
+    const auto predictor = header >> kRiceBits;
+    const auto k = header & static_cast<unsigned>(Mask(kRiceBits));
+    if (predictor >= kPredictors || k > Traits::kRawBits) {
+        return false;
+    }
+
+    // a corrupt block decodes to clipped noise, never out of range
+    const std::int32_t low = Traits::kMin >> dropBits;
+    const std::int32_t high = Traits::kMax >> dropBits;
+    auto x1 = history.x1;
+    auto x2 = history.x2;
+    for (size_t i = 0; i < count; ++i) {
+        const auto quotient = reader.Zeros(kEscapeQuotient);
+        const auto residual =
+            kEscapeQuotient == quotient
+                ? static_cast<std::uint32_t>(reader.Get(Traits::kRawBits))
+                : static_cast<std::uint32_t>((quotient << k) | reader.Get(k));
+        const auto prediction =
+            0u == predictor ? 0 : (1u == predictor ? x1 : 2 * x1 - x2);
+        const auto value =
+            std::clamp(prediction + UnZigZag(residual), low, high);
+        x2 = x1;
+        x1 = value;
+        out[2u * i] = static_cast<Component>(value * (1 << dropBits) +
+                                             Traits::kOffset);
+    }
+    history.x1 = x1;
+    history.x2 = x2;
+    return not reader.Overrun();
+}
+}  // namespace
+
+template <class Sample>
+CBlockCodec<Sample>::CBlockCodec(const unsigned dropBits)
+    : mDropBits(std::is_floating_point<Component>::value
+                    ? 0u
+                    : std::min<unsigned>(dropBits,
+                                         8u * sizeof(Component) - 1u)) {}
+
+template <class Sample>
+Method CBlockCodec<Sample>::Encode(const Component* in,
+                                   const size_t samples,
+                                   std::vector<std::uint8_t>& out) const {
+    const auto rawBytes = 2u * samples * sizeof(Component);
+    const auto store = [&]() {
+        out.resize(rawBytes);
+        std::memcpy(out.data(), in, rawBytes);
+        return Method::Stored;
+    };
+
+    if constexpr (std::is_floating_point<Component>::value) {
+        return store();
+    } else {
+        using Traits = IntegerTraits<Component>;
+        // every residual escaping plus the group headers
+        const auto groups = (samples + kGroupSamples - 1u) / kGroupSamples;
+        out.resize((2u * samples * (kEscapeQuotient + Traits::kRawBits) +
+                    2u * groups * kHeaderBits) /
+                       8u +
+                   8u);
+
+        CBitWriter writer(out.data());
+        History histories[2];
+        for (size_t begin = 0; begin < samples; begin += kGroupSamples) {
+            const auto count = std::min(kGroupSamples, samples - begin);
+            for (size_t channel = 0; channel < 2u; ++channel) {
+                EncodeGroup<Sample>(in + 2u * begin + channel,
+                                    count,
+                                    mDropBits,
+                                    histories[channel],
+                                    writer);
+            }
+        }
+
+        const auto bytes = static_cast<size_t>(writer.Flush() - out.data());
+        // noise at full scale doesn't shrink, lossless stays lossless
+        if (0u == mDropBits && bytes >= rawBytes) {
+            return store();
+        }
+        out.resize(bytes);
+        return Method::Rice;
+    }
+}
+
+template <class Sample>
+bool CBlockCodec<Sample>::Decode(const Method method,
+                                 const std::uint8_t* in,
+                                 const size_t bytes,
+                                 const size_t samples,
+                                 Component* out) const {
+    if (Method::Stored == method) {
+        if (bytes != 2u * samples * sizeof(Component)) {
+            return false;
+        }
+        std::memcpy(out, in, bytes);
+        return true;
+    }
+
+    if constexpr (std::is_floating_point<Component>::value) {
+        return false;
+    } else {
+        if (Method::Rice != method) {
+            return false;
+        }
+        CBitReader reader(in, bytes);
+        History histories[2];
+        for (size_t begin = 0; begin < samples; begin += kGroupSamples) {
+            const auto count = std::min(kGroupSamples, samples - begin);
+            for (size_t channel = 0; channel < 2u; ++channel) {
+                if (not DecodeGroup<Sample>(reader,
+                                            count,
+                                            mDropBits,
+                                            histories[channel],
+                                            out + 2u * begin + channel)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+template class CBlockCodec<sample_types::CS8>;
+template class CBlockCodec<sample_types::CU8>;
+template class CBlockCodec<sample_types::CS16>;
+template class CBlockCodec<sample_types::CF32>;
+
+}  // namespace iq_codec
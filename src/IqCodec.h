@@ -0,0 +1,75 @@
+#ifndef __IQ_CODEC_H__
+#define __IQ_CODEC_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace iq_codec {
+enum class Method : std::uint8_t {
+    // the components as they are
+    Stored = 0,
+    // predicted, Rice coded residuals
+    Rice = 1
+};
+
+/**
+ * @brief Encodes one block of interleaved I/Q components on its own, a
+ * block decodes without the blocks before it.
+ *
+ * The I and Q components are coded as two channels in groups of
+ * kGroupSamples. Each group picks the fixed predictor, none, delta or
+ * second order delta, with the smallest residuals and the Rice parameter
+ * fitting their mean. The group costs 7 bits of header, a residual
+ * k + 1 bits plus its quotient, large ones escape to a fixed width.
+ *
+ * Dropping low bits before the prediction requantises the components,
+ * each dropped bit saves about one bit per component. A block the coder
+ * can't shrink and every CF32 block is stored.
+ * @tparam Sample stream element type from SampleTypes.h, instantiated for
+ * CS8, CU8, CS16 and CF32
+ */
+template <class Sample>
+class CBlockCodec {
+   public:
+    using Component = typename Sample::Component;
+
+    static constexpr size_t kGroupSamples = 128u;
+
+    /**
+     * @param dropBits low bits of every component dropped with rounding,
+     * 0 - lossless, ignored for CF32
+     */
+    explicit CBlockCodec(const unsigned dropBits = 0u);
+
+    /**
+     * @brief Encodes the samples into out, resized to the encoded bytes.
+     * Reuses the capacity of out, a steady block size doesn't allocate.
+     * @return the method the decoder needs
+     */
+    Method Encode(const Component* in,
+                  const size_t samples,
+                  std::vector<std::uint8_t>& out) const;
+
+    /**
+     * @brief Decodes a block encoded with the same dropBits
+     * @param out room for 2 * samples components
+     * @return false if the data is truncated or corrupt
+     */
+    bool Decode(const Method method,
+                const std::uint8_t* in,
+                const size_t bytes,
+                const size_t samples,
+                Component* out) const;
+
+    unsigned DropBits() const {
+        return mDropBits;
+    }
+
+   private:
+    const unsigned mDropBits;
+};
+
+}  // namespace iq_codec
+
+#endif  // __IQ_CODEC_H__
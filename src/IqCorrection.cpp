@@ -0,0 +1,138 @@
+#include "IqCorrection.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "Metrics.h"
+
+namespace iq_correction {
+namespace {
+// below it a component carries no signal, the imbalance isn't estimated
+constexpr double kMinPower = 1e-12;
+constexpr double kRadToDeg = 180.0 / 3.14159265358979323846;
+}  // namespace
+
+struct CIqCorrector::Impl {
+    Impl(const int deviceNumber, const CorrectionConfig& config)
+        : mDeviceNumber(deviceNumber)
+        , mConfig(config)
+        , mUpdates(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_iq_updates_total",
+              "Updates of the DC and IQ imbalance estimates",
+              {{"device", std::to_string(deviceNumber)}})) {
+        mConfig.updateBlocks = std::max<size_t>(1u, mConfig.updateBlocks);
+        mConfig.dcAlpha = std::clamp(mConfig.dcAlpha, 0.0f, 1.0f);
+        mConfig.imbalanceAlpha = std::clamp(mConfig.imbalanceAlpha, 0.0f, 1.0f);
+    }
+
+    void Update();
+
+    const int mDeviceNumber;
+    CorrectionConfig mConfig;
+    dsp_kernels::IqCoefficients mCoefficients;
+    dsp_kernels::IqMoments mMoments;
+    size_t mBlocks{0u};
+    // smoothed covariance of the raw components
+    double mPowerI{0.0};
+    double mPowerQ{0.0};
+    double mCross{0.0};
+    bool mValid{false};
+    metrics::CCounter& mUpdates;
+};
+
+void CIqCorrector::Impl::Update() {
+    const auto& moments = mMoments;
+    if (0u == moments.count) {
+        return;
+    }
+
+    const auto count = static_cast<double>(moments.count);
+    const auto meanI = moments.i / count;
+    const auto meanQ = moments.q / count;
+    const auto powerI = moments.ii / count - meanI * meanI;
+    const auto powerQ = moments.qq / count - meanQ * meanQ;
+    const auto cross = moments.iq / count - meanI * meanQ;
+    mMoments = dsp_kernels::IqMoments();
+
+    if (not mValid) {
+        // the first estimate is taken as is, the IIRs start from it
+        mCoefficients.dcI = static_cast<float>(meanI);
+        mCoefficients.dcQ = static_cast<float>(meanQ);
+        mPowerI = powerI;
+        mPowerQ = powerQ;
+        mCross = cross;
+        mValid = true;
+    } else {
+        const auto dcAlpha = mConfig.dcAlpha;
+        mCoefficients.dcI += dcAlpha * (meanI - mCoefficients.dcI);
+        mCoefficients.dcQ += dcAlpha * (meanQ - mCoefficients.dcQ);
+        const double alpha = mConfig.imbalanceAlpha;
+        mPowerI += alpha * (powerI - mPowerI);
+        mPowerQ += alpha * (powerQ - mPowerQ);
+        mCross += alpha * (cross - mCross);
+    }
+    mUpdates.Add();
+
+    // Q' = gain * Q + cross * I: the I part of Q is removed, the rest is
+    // scaled to the power of I
+    if (mPowerI < kMinPower) {
+        return;
+    }
+    const auto residual = mPowerQ - mCross * mCross / mPowerI;
+    if (residual < kMinPower) {
+        return;
+    }
+    const auto gain = std::sqrt(mPowerI / residual);
+    mCoefficients.gain = static_cast<float>(gain);
+    mCoefficients.cross = static_cast<float>(-gain * mCross / mPowerI);
+
+    SoapySDR::logf(SOAPY_SDR_DEBUG,
+                   "IQ %d: dc %.5f %.5f, gain %.3f dB, phase %.3f deg",
+                   mDeviceNumber,
+                   mCoefficients.dcI,
+                   mCoefficients.dcQ,
+                   10.0 * std::log10(mPowerQ / mPowerI),
+                   std::asin(mCross / std::sqrt(mPowerI * mPowerQ)) *
+                       kRadToDeg);
+}
+
+CIqCorrector::CIqCorrector(const int deviceNumber,
+                           const CorrectionConfig& config)
+    : mImpl(std::make_unique<CIqCorrector::Impl>(deviceNumber, config)) {
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "IQ correction %d: update every %zu blocks, dc alpha %g, "
+                   "imbalance alpha %g",
+                   deviceNumber,
+                   mImpl->mConfig.updateBlocks,
+                   mImpl->mConfig.dcAlpha,
+                   mImpl->mConfig.imbalanceAlpha);
+}
+
+CIqCorrector::~CIqCorrector() = default;
+
+template <class Sample>
+void CIqCorrector::Convert(const typename Sample::Component* data,
+                           const size_t count,
+                           dsp_kernels::Complex* out) {
+    auto& impl = *mImpl;
+    dsp_kernels::ConvertCorrected<Sample>(
+        data, count, impl.mCoefficients, out, impl.mMoments);
+
+    if (++impl.mBlocks >= impl.mConfig.updateBlocks) {
+        impl.mBlocks = 0u;
+        impl.Update();
+    }
+}
+
+template void CIqCorrector::Convert<sample_types::CS8>(
+    const std::int8_t*, const size_t, dsp_kernels::Complex*);
+template void CIqCorrector::Convert<sample_types::CU8>(
+    const std::uint8_t*, const size_t, dsp_kernels::Complex*);
+template void CIqCorrector::Convert<sample_types::CS16>(
+    const std::int16_t*, const size_t, dsp_kernels::Complex*);
+template void CIqCorrector::Convert<sample_types::CF32>(
+    const float*, const size_t, dsp_kernels::Complex*);
+
+}  // namespace iq_correction
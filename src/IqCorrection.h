@@ -0,0 +1,61 @@
+#ifndef __IQ_CORRECTION_H__
+#define __IQ_CORRECTION_H__
+
+#include <memory>
+
+#include "DspKernels.h"
+
+namespace iq_correction {
+struct CorrectionConfig {
+    // blocks between two estimate updates, 0 - no correction
+    size_t updateBlocks{4u};
+    // pole of the DC estimate, weight of the newest block means
+    float dcAlpha{0.1f};
+    // weight of the newest statistics in the imbalance estimate
+    float imbalanceAlpha{0.05f};
+};
+
+/**
+ * @brief Adaptive DC removal and blind IQ gain and phase imbalance
+ * correction of one device.
+ *
+ * The correction is fused with the conversion of the raw components, the
+ * samples are traversed once. The moments of the uncorrected samples are
+ * gathered in the same pass and every updateBlocks blocks update the
+ * estimates: the DC follows the means through a single-pole IIR, the
+ * imbalance is derived from the smoothed covariance, so Q is made
+ * orthogonal to I and of the same power. The estimates persist across
+ * blocks and retunes, the corrector lives as long as its handler.
+ */
+class CIqCorrector {
+   public:
+    /**
+     * @param deviceNumber number device, labels the logs and metrics
+     * @param config update interval and smoothing of the estimates
+     */
+    CIqCorrector(const int deviceNumber, const CorrectionConfig& config);
+    CIqCorrector(const CIqCorrector&) = delete;
+    CIqCorrector& operator=(const CIqCorrector&) = delete;
+    ~CIqCorrector();
+
+    /**
+     * @brief Converts and corrects one block, updates the estimates when
+     * updateBlocks blocks have been seen
+     * @tparam Sample stream element type from SampleTypes.h
+     * @param data interleaved I/Q components, 2 * count values
+     * @param count number of complex samples
+     * @param out destination, at least count samples
+     */
+    template <class Sample>
+    void Convert(const typename Sample::Component* data,
+                 const size_t count,
+                 dsp_kernels::Complex* out);
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace iq_correction
+
+#endif  // __IQ_CORRECTION_H__
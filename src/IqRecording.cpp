@@ -0,0 +1,706 @@
+#include "IqRecording.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "IqCodec.h"
+#include "Metrics.h"
+#include "SampleTypes.h"
+#include "Utility.h"
+
+namespace iq_recording {
+namespace {
+constexpr char kFileMagic[] = {'K', 'I', 'Q', '1'};
+constexpr char kBlockMagic[] = {'K', 'I', 'Q', 'B'};
+constexpr char kIndexMagic[] = {'K', 'I', 'X', '1'};
+constexpr size_t kFormatSize = 8u;
+// samples between indexed blocks, a seek walks the block headers of at
+// most this span and decodes one block
+constexpr double kIndexIntervalSeconds = 0.25;
+
+#pragma pack(push, 1)
+struct FileHeader {
+    char magic[4];
+    char format[kFormatSize];
+    double sampleRate;
+};
+
+struct BlockHeader {
+    char magic[4];
+    std::uint8_t method;
+    std::uint8_t dropBits;
+    std::uint16_t reserved;
+    std::uint32_t samples;
+    std::uint32_t bytes;
+    std::int64_t timeNs;
+    std::uint64_t firstSample;
+};
+
+struct IndexEntry {
+    std::int64_t timeNs;
+    std::uint64_t firstSample;
+    std::uint64_t offset;
+};
+
+struct Trailer {
+    std::uint64_t indexOffset;
+    std::uint32_t entries;
+    char magic[4];
+};
+#pragma pack(pop)
+
+enum class SlotState { Free, Queued, Encoded };
+}  // namespace
+
+bool IsRecording(const std::string& path) {
+    auto* file = std::fopen(path.c_str(), "rb");
+    if (nullptr == file) {
+        return false;
+    }
+    char magic[sizeof(kFileMagic)];
+    const auto read = std::fread(magic, sizeof(magic), 1u, file);
+    std::fclose(file);
+    return 1u == read && 0 == std::memcmp(magic, kFileMagic, sizeof(magic));
+}
+
+template <class Sample>
+struct CRecordingWriter<Sample>::Impl {
+    // a block from Append to the file, owned by the producer while free,
+    // by one encoder while queued and by the writer while encoded
+    struct Slot {
+        std::vector<Component> input;
+        std::vector<std::uint8_t> output;
+        BlockHeader header{};
+        SlotState state{SlotState::Free};
+    };
+
+    Impl(const std::string& path,
+         const double sampleRate,
+         const RecordingConfig& config,
+         const int deviceNumber);
+
+    void Encode(Slot& slot) const;
+    void EncoderLoop();
+    void WriterLoop();
+    void WriteBlock(Slot& slot);
+    void Close();
+
+    const std::string mPath;
+    const unsigned mDropBits;
+    const double mMinRatio;
+    const std::uint64_t mIndexInterval;
+    std::vector<Slot> mSlots;
+
+    std::mutex mLock;
+    std::condition_variable mQueued;
+    std::condition_variable mEncoded;
+    // sequence numbers of the blocks, slot = sequence % slots
+    std::uint64_t mSubmitted{0u};
+    std::uint64_t mEncodeNext{0u};
+    std::uint64_t mWriteNext{0u};
+    bool mStopping{false};
+
+    // producer only
+    std::uint64_t mNextSample{0u};
+    bool mDropping{false};
+
+    // writer thread only, Close after it is joined
+    std::FILE* mFile{nullptr};
+    std::uint64_t mOffset{sizeof(FileHeader)};
+    std::vector<IndexEntry> mIndex;
+    std::uint64_t mNextIndexSample{0u};
+    std::uint64_t mRawTotal{0u};
+    std::uint64_t mWrittenTotal{sizeof(FileHeader)};
+    bool mFailed{false};
+
+    std::vector<std::future<void>> mEncoderHandles;
+    std::future<void> mWriterHandle;
+
+    metrics::CCounter& mRawBytes;
+    metrics::CCounter& mCompressedBytes;
+    metrics::CCounter& mDropped;
+    metrics::CGauge& mRatio;
+    metrics::CGauge& mDroppedBits;
+};
+
+template <class Sample>
+CRecordingWriter<Sample>::Impl::Impl(const std::string& path,
+                                     const double sampleRate,
+                                     const RecordingConfig& config,
+                                     const int deviceNumber)
+    : mPath(path)
+    , mDropBits(iq_codec::CBlockCodec<Sample>(config.dropBits).DropBits())
+    , mMinRatio(config.minRatio)
+    , mIndexInterval(std::max<std::uint64_t>(
+          1u, std::llround(sampleRate * kIndexIntervalSeconds)))
+    , mSlots(std::max<size_t>(1u, config.queueBlocks))
+    , mRawBytes(metrics::CMetricsRegistry::Instance().GetCounter(
+          "kraken_record_raw_bytes_total",
+          "Bytes of the raw blocks given to the compressed recordings",
+          {{"device", std::to_string(deviceNumber)}}))
+    , mCompressedBytes(metrics::CMetricsRegistry::Instance().GetCounter(
+          "kraken_record_compressed_bytes_total",
+          "Bytes written to the compressed recordings",
+          {{"device", std::to_string(deviceNumber)}}))
+    , mDropped(metrics::CMetricsRegistry::Instance().GetCounter(
+          "kraken_record_dropped_blocks_total",
+          "Blocks dropped because the encoders or the disk fell behind",
+          {{"device", std::to_string(deviceNumber)}}))
+    , mRatio(metrics::CMetricsRegistry::Instance().GetGauge(
+          "kraken_record_compression_ratio_percent",
+          "Raw bytes per 100 bytes written of the current recording",
+          {{"device", std::to_string(deviceNumber)}}))
+    , mDroppedBits(metrics::CMetricsRegistry::Instance().GetGauge(
+          "kraken_record_dropped_bits",
+          "Low bits dropped from the components of the last block written",
+          {{"device", std::to_string(deviceNumber)}})) {}
+
+template <class Sample>
+void CRecordingWriter<Sample>::Impl::Encode(Slot& slot) const {
+    constexpr unsigned kMaxDropBits =
+        std::is_floating_point<Component>::value
+            ? 0u
+            : 8u * sizeof(Component) - 1u;
+    auto& header = slot.header;
+    const auto components = 2.0 * header.samples;
+    // bytes the block may take, a CF32 block is stored whatever it takes
+    const auto budget = mMinRatio > 0.0
+                            ? components * sizeof(Component) / mMinRatio
+                            : HUGE_VAL;
+
+    auto dropBits = mDropBits;
+    while (true) {
+        const iq_codec::CBlockCodec<Sample> codec(dropBits);
+        const auto method =
+            codec.Encode(slot.input.data(), header.samples, slot.output);
+        header.method = static_cast<std::uint8_t>(method);
+        header.dropBits = static_cast<std::uint8_t>(codec.DropBits());
+        const auto bytes = static_cast<double>(slot.output.size());
+        if (bytes <= budget || dropBits >= kMaxDropBits) {
+            return;
+        }
+        // a dropped bit saves about one bit per component, usually one
+        // more pass reaches the budget
+        const auto excess = std::ceil(8.0 * (bytes - budget) / components);
+        dropBits = std::min(
+            kMaxDropBits,
+            dropBits + std::max(1u, static_cast<unsigned>(excess)));
+    }
+}
+
+template <class Sample>
+void CRecordingWriter<Sample>::Impl::EncoderLoop() {
+    while (true) {
+        Slot* slot(nullptr);
+        {
+            std::unique_lock lock(mLock);
+            mQueued.wait(lock, [this] {
+                return mEncodeNext < mSubmitted || mStopping;
+            });
+            // stopping only once every queued block is claimed
+            if (mEncodeNext == mSubmitted) {
+                return;
+            }
+            slot = &mSlots[mEncodeNext++ % mSlots.size()];
+        }
+
+        // the encoders run in parallel, the writer restores the order
+        Encode(*slot);
+
+        {
+            std::lock_guard lock(mLock);
+            slot->state = SlotState::Encoded;
+        }
+        mEncoded.notify_one();
+    }
+}
+
+template <class Sample>
+void CRecordingWriter<Sample>::Impl::WriteBlock(Slot& slot) {
+    auto& header = slot.header;
+    std::memcpy(header.magic, kBlockMagic, sizeof(kBlockMagic));
+    header.bytes = static_cast<std::uint32_t>(slot.output.size());
+
+    if (header.firstSample >= mNextIndexSample) {
+        mIndex.push_back({header.timeNs, header.firstSample, mOffset});
+        mNextIndexSample = header.firstSample + mIndexInterval;
+    }
+
+    const auto ok =
+        1u == std::fwrite(&header, sizeof(header), 1u, mFile) &&
+        slot.output.size() ==
+            std::fwrite(slot.output.data(), 1u, slot.output.size(), mFile);
+    if (not ok && not mFailed) {
+        SoapySDR::logf(
+            SOAPY_SDR_ERROR, "Recording: can't write %s", mPath.c_str());
+        mFailed = true;
+    }
+
+    const auto raw = 2u * std::uint64_t(header.samples) * sizeof(Component);
+    const auto written = sizeof(header) + slot.output.size();
+    mOffset += written;
+    mRawTotal += raw;
+    mWrittenTotal += written;
+    mRawBytes.Add(raw);
+    mCompressedBytes.Add(written);
+    mRatio.Set(static_cast<std::int64_t>(100u * mRawTotal / mWrittenTotal));
+    mDroppedBits.Set(header.dropBits);
+}
+
+template <class Sample>
+void CRecordingWriter<Sample>::Impl::WriterLoop() {
+    while (true) {
+        Slot* slot(nullptr);
+        {
+            std::unique_lock lock(mLock);
+            mEncoded.wait(lock, [this] {
+                return SlotState::Encoded ==
+                           mSlots[mWriteNext % mSlots.size()].state ||
+                       (mStopping && mWriteNext == mSubmitted);
+            });
+            slot = &mSlots[mWriteNext % mSlots.size()];
+            if (SlotState::Encoded != slot->state) {
+                return;
+            }
+        }
+
+        // the file I/O runs without the lock, Append keeps going
+        WriteBlock(*slot);
+
+        {
+            std::lock_guard lock(mLock);
+            slot->state = SlotState::Free;
+            ++mWriteNext;
+        }
+    }
+}
+
+template <class Sample>
+void CRecordingWriter<Sample>::Impl::Close() {
+    const Trailer trailer{mOffset,
+                          static_cast<std::uint32_t>(mIndex.size()),
+                          {kIndexMagic[0],
+                           kIndexMagic[1],
+                           kIndexMagic[2],
+                           kIndexMagic[3]}};
+    const auto ok = mIndex.size() == std::fwrite(mIndex.data(),
+                                                 sizeof(IndexEntry),
+                                                 mIndex.size(),
+                                                 mFile) &&
+                    1u == std::fwrite(&trailer, sizeof(trailer), 1u, mFile);
+    const auto failed = mFailed || not ok || 0 != std::ferror(mFile);
+    std::fclose(mFile);
+    mFile = nullptr;
+
+    const auto tmpPath = mPath + ".tmp";
+    if (failed) {
+        SoapySDR::logf(SOAPY_SDR_ERROR,
+                       "Recording: %s is incomplete, left as %s",
+                       mPath.c_str(),
+                       tmpPath.c_str());
+        return;
+    }
+    std::rename(tmpPath.c_str(), mPath.c_str());
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Recording: %s, %.1f MB raw in %.1f MB, ratio %.2f, "
+                   "%llu samples",
+                   mPath.c_str(),
+                   mRawTotal / 1e6,
+                   mWrittenTotal / 1e6,
+                   static_cast<double>(mRawTotal) / mWrittenTotal,
+                   static_cast<unsigned long long>(mNextSample));
+}
+
+template <class Sample>
+CRecordingWriter<Sample>::CRecordingWriter(const std::string& path,
+                                           const double sampleRate,
+                                           const RecordingConfig& config,
+                                           const int deviceNumber)
+    : mImpl(std::make_unique<CRecordingWriter<Sample>::Impl>(
+          path, sampleRate, config, deviceNumber)) {
+    LOG_FUNC();
+
+    // write aside and rename so readers never see a recording in progress
+    const auto tmpPath = path + ".tmp";
+    mImpl->mFile = std::fopen(tmpPath.c_str(), "wb");
+    if (nullptr == mImpl->mFile) {
+        throw std::runtime_error("Can't open recording " + tmpPath + ": " +
+                                 strerror(errno));
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+    std::strncpy(header.format, Sample::kFormat, kFormatSize);
+    header.sampleRate = sampleRate;
+    std::fwrite(&header, sizeof(header), 1u, mImpl->mFile);
+
+    const auto workers = std::max<size_t>(1u, config.workers);
+    for (size_t i = 0; i < workers; ++i) {
+        mImpl->mEncoderHandles.push_back(
+            std::async(std::launch::async,
+                       &CRecordingWriter<Sample>::Impl::EncoderLoop,
+                       mImpl.get()));
+    }
+    mImpl->mWriterHandle =
+        std::async(std::launch::async,
+                   &CRecordingWriter<Sample>::Impl::WriterLoop,
+                   mImpl.get());
+
+    const auto dropBits = mImpl->mDropBits;
+    const auto coding = 0u == dropBits
+                            ? std::string("lossless")
+                            : std::to_string(dropBits) + " bits dropped";
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Recording: %s, %s %s, min ratio %.2f, %zu encoders, "
+                   "%zu blocks queued",
+                   path.c_str(),
+                   Sample::kFormat,
+                   coding.c_str(),
+                   config.minRatio,
+                   workers,
+                   mImpl->mSlots.size());
+}
+
+template <class Sample>
+CRecordingWriter<Sample>::~CRecordingWriter() {
+    LOG_FUNC();
+
+    {
+        std::lock_guard lock(mImpl->mLock);
+        mImpl->mStopping = true;
+    }
+    mImpl->mQueued.notify_all();
+    mImpl->mEncoded.notify_all();
+    for (auto& handle : mImpl->mEncoderHandles) {
+        if (handle.valid()) {
+            handle.get();
+        }
+    }
+    if (mImpl->mWriterHandle.valid()) {
+        mImpl->mWriterHandle.get();
+    }
+    mImpl->Close();
+}
+
+template <class Sample>
+bool CRecordingWriter<Sample>::Append(const Component* data,
+                                      const size_t samples,
+                                      const long long timeNs) {
+    auto& impl = *mImpl;
+    const auto firstSample = impl.mNextSample;
+    impl.mNextSample += samples;
+
+    // only the producer takes free slots, the slot stays its own unlocked
+    typename Impl::Slot* slot(nullptr);
+    {
+        std::lock_guard lock(impl.mLock);
+        auto& next = impl.mSlots[impl.mSubmitted % impl.mSlots.size()];
+        if (SlotState::Free == next.state && not impl.mStopping) {
+            slot = &next;
+        }
+    }
+    if (nullptr == slot) {
+        impl.mDropped.Add();
+        if (not impl.mDropping) {
+            SoapySDR::logf(SOAPY_SDR_WARNING,
+                           "Recording: %s falls behind, dropping blocks",
+                           impl.mPath.c_str());
+            impl.mDropping = true;
+        }
+        return false;
+    }
+    impl.mDropping = false;
+
+    slot->input.assign(data, data + 2u * samples);
+    slot->header.samples = static_cast<std::uint32_t>(samples);
+    slot->header.timeNs = timeNs;
+    slot->header.firstSample = firstSample;
+    {
+        std::lock_guard lock(impl.mLock);
+        slot->state = SlotState::Queued;
+        ++impl.mSubmitted;
+    }
+    impl.mQueued.notify_one();
+    return true;
+}
+
+template <class Sample>
+struct CRecordingReader<Sample>::Impl {
+    ~Impl() {
+        if (MAP_FAILED != mData) {
+            munmap(mData, mBytes);
+        }
+    }
+
+    const std::uint8_t* Data() const {
+        return static_cast<const std::uint8_t*>(mData);
+    }
+
+    bool ReadHeader(const std::uint64_t offset, BlockHeader& header) const;
+    void LoadIndex();
+    bool DecodeNext();
+
+    /**
+     * @brief Decodes the last block starting at or before the target
+     * @param position sample position of a block from its time and first
+     * sample, increasing through the file
+     */
+    template <class Position>
+    void Seek(const Position& position, const double target);
+
+    std::string mPath;
+    void* mData{MAP_FAILED};
+    size_t mBytes{0u};
+    FileHeader mHeader{};
+    std::vector<IndexEntry> mIndex;
+    // end of the blocks, the index if there is one
+    std::uint64_t mEnd{0u};
+
+    // the next block to decode
+    std::uint64_t mOffset{sizeof(FileHeader)};
+    std::vector<Component> mBlock;
+    BlockHeader mCurrent{};
+    size_t mPosition{0u};
+};
+
+template <class Sample>
+bool CRecordingReader<Sample>::Impl::ReadHeader(const std::uint64_t offset,
+                                                BlockHeader& header) const {
+    if (offset + sizeof(header) > mEnd) {
+        return false;
+    }
+    std::memcpy(&header, Data() + offset, sizeof(header));
+    return 0 == std::memcmp(header.magic, kBlockMagic, sizeof(kBlockMagic)) &&
+           offset + sizeof(header) + header.bytes <= mEnd;
+}
+
+template <class Sample>
+void CRecordingReader<Sample>::Impl::LoadIndex() {
+    Trailer trailer{};
+    if (mBytes >= sizeof(FileHeader) + sizeof(trailer)) {
+        std::memcpy(&trailer, Data() + mBytes - sizeof(trailer),
+                    sizeof(trailer));
+    }
+    const auto indexBytes = std::uint64_t(trailer.entries) * sizeof(IndexEntry);
+    if (0 == std::memcmp(trailer.magic, kIndexMagic, sizeof(kIndexMagic)) &&
+        trailer.indexOffset >= sizeof(FileHeader) &&
+        trailer.indexOffset + indexBytes + sizeof(trailer) == mBytes) {
+        mEnd = trailer.indexOffset;
+        mIndex.resize(trailer.entries);
+        std::memcpy(mIndex.data(), Data() + mEnd, indexBytes);
+        return;
+    }
+
+    // not closed, every complete block is indexed
+    mEnd = mBytes;
+    std::uint64_t offset(sizeof(FileHeader));
+    BlockHeader header{};
+    while (ReadHeader(offset, header)) {
+        mIndex.push_back({header.timeNs, header.firstSample, offset});
+        offset += sizeof(header) + header.bytes;
+    }
+    mEnd = offset;
+    SoapySDR::logf(SOAPY_SDR_WARNING,
+                   "Recording %s has no index, %zu blocks found",
+                   mPath.c_str(),
+                   mIndex.size());
+}
+
+template <class Sample>
+bool CRecordingReader<Sample>::Impl::DecodeNext() {
+    BlockHeader header{};
+    if (not ReadHeader(mOffset, header)) {
+        return false;
+    }
+
+    mBlock.resize(2u * header.samples);
+    const iq_codec::CBlockCodec<Sample> codec(header.dropBits);
+    if (not codec.Decode(static_cast<iq_codec::Method>(header.method),
+                         Data() + mOffset + sizeof(header),
+                         header.bytes,
+                         header.samples,
+                         mBlock.data())) {
+        SoapySDR::logf(SOAPY_SDR_ERROR,
+                       "Recording %s: corrupt block at offset %llu",
+                       mPath.c_str(),
+                       static_cast<unsigned long long>(mOffset));
+        mOffset = mEnd;
+        mCurrent.samples = 0u;
+        mPosition = 0u;
+        return false;
+    }
+
+    mOffset += sizeof(header) + header.bytes;
+    mCurrent = header;
+    mPosition = 0u;
+    return true;
+}
+
+template <class Sample>
+template <class Position>
+void CRecordingReader<Sample>::Impl::Seek(const Position& position,
+                                          const double target) {
+    const auto entry = std::upper_bound(
+        mIndex.begin(),
+        mIndex.end(),
+        target,
+        [&](const double value, const IndexEntry& indexed) {
+            return value < position(indexed.timeNs, indexed.firstSample);
+        });
+    mOffset = mIndex.begin() == entry ? sizeof(FileHeader)
+                                      : std::prev(entry)->offset;
+
+    // the headers up to the next indexed block, nothing is decoded
+    BlockHeader header{};
+    BlockHeader next{};
+    while (ReadHeader(mOffset, header) &&
+           ReadHeader(mOffset + sizeof(header) + header.bytes, next) &&
+           position(next.timeNs, next.firstSample) <= target) {
+        mOffset += sizeof(header) + header.bytes;
+    }
+
+    mCurrent.samples = 0u;
+    mPosition = 0u;
+    if (not DecodeNext()) {
+        return;
+    }
+    // before the first block the recording starts at its beginning, a
+    // target in a gap or past the end of the block starts the next one
+    const auto skip = std::llround(
+        target - position(mCurrent.timeNs, mCurrent.firstSample));
+    mPosition = static_cast<size_t>(
+        std::clamp<long long>(skip, 0, mCurrent.samples));
+}
+
+template <class Sample>
+CRecordingReader<Sample>::CRecordingReader(const std::string& path)
+    : mImpl(std::make_unique<CRecordingReader<Sample>::Impl>()) {
+    LOG_FUNC();
+
+    auto& impl = *mImpl;
+    impl.mPath = path;
+    const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Can't open recording " + path + ": " +
+                                 strerror(errno));
+    }
+
+    struct stat info {};
+    if (0 != fstat(fd, &info) ||
+        static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+        close(fd);
+        throw std::runtime_error("Recording " + path + " has no header");
+    }
+
+    impl.mBytes = info.st_size;
+    impl.mData = mmap(nullptr, impl.mBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (MAP_FAILED == impl.mData) {
+        throw std::runtime_error("Can't map recording " + path + ": " +
+                                 strerror(errno));
+    }
+    madvise(impl.mData, impl.mBytes, MADV_SEQUENTIAL);
+
+    std::memcpy(&impl.mHeader, impl.mData, sizeof(impl.mHeader));
+    if (0 != std::memcmp(impl.mHeader.magic, kFileMagic, sizeof(kFileMagic))) {
+        throw std::runtime_error(path + " is not a recording");
+    }
+    const std::string format(impl.mHeader.format,
+                             strnlen(impl.mHeader.format, kFormatSize));
+    if (Sample::kFormat != format) {
+        throw std::runtime_error("Recording " + path + " holds " + format +
+                                 " samples, the stream is " +
+                                 Sample::kFormat);
+    }
+
+    impl.LoadIndex();
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Recording %s: %s at %.3f Msps, %zu index entries",
+                   path.c_str(),
+                   Sample::kFormat,
+                   impl.mHeader.sampleRate / 1e6,
+                   impl.mIndex.size());
+}
+
+template <class Sample>
+CRecordingReader<Sample>::~CRecordingReader() = default;
+
+template <class Sample>
+size_t CRecordingReader<Sample>::Read(Component* out, const size_t samples) {
+    auto& impl = *mImpl;
+    size_t written(0u);
+    while (written < samples) {
+        if (impl.mPosition == impl.mCurrent.samples && not impl.DecodeNext()) {
+            break;
+        }
+        const auto count =
+            std::min<size_t>(samples - written,
+                             impl.mCurrent.samples - impl.mPosition);
+        std::memcpy(out + 2u * written,
+                    impl.mBlock.data() + 2u * impl.mPosition,
+                    2u * count * sizeof(Component));
+        written += count;
+        impl.mPosition += count;
+    }
+    return written;
+}
+
+template <class Sample>
+void CRecordingReader<Sample>::SeekTime(const long long timeNs) {
+    // the stamps in samples, the block start times are exact
+    const auto rate = mImpl->mHeader.sampleRate * 1e-9;
+    mImpl->Seek(
+        [rate](const std::int64_t time, const std::uint64_t) {
+            return time * rate;
+        },
+        timeNs * rate);
+}
+
+template <class Sample>
+void CRecordingReader<Sample>::SeekSample(const unsigned long long sample) {
+    mImpl->Seek(
+        [](const std::int64_t, const std::uint64_t first) {
+            return static_cast<double>(first);
+        },
+        static_cast<double>(sample));
+}
+
+template <class Sample>
+double CRecordingReader<Sample>::SampleRate() const {
+    return mImpl->mHeader.sampleRate;
+}
+
+template <class Sample>
+unsigned long long CRecordingReader<Sample>::FirstSample() const {
+    return mImpl->mIndex.empty() ? 0u : mImpl->mIndex.front().firstSample;
+}
+
+template class CRecordingWriter<sample_types::CS8>;
+template class CRecordingWriter<sample_types::CU8>;
+template class CRecordingWriter<sample_types::CS16>;
+template class CRecordingWriter<sample_types::CF32>;
+
+template class CRecordingReader<sample_types::CS8>;
+template class CRecordingReader<sample_types::CU8>;
+template class CRecordingReader<sample_types::CS16>;
+template class CRecordingReader<sample_types::CF32>;
+
+}  // namespace iq_recording
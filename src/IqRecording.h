@@ -0,0 +1,142 @@
+#ifndef __IQ_RECORDING_H__
+#define __IQ_RECORDING_H__
+
+#include <memory>
+#include <string>
+
+namespace iq_recording {
+struct RecordingConfig {
+    // low bits of every component dropped, 0 - lossless
+    unsigned dropBits{0u};
+    // raw bytes per byte written each block reaches, a block short of it
+    // drops more low bits than dropBits, 0 - dropBits only
+    double minRatio{0.0};
+    // encoder threads
+    size_t workers{2u};
+    // blocks waiting for the encoders and the file, a block finding the
+    // queue full is dropped
+    size_t queueBlocks{16u};
+};
+
+/**
+ * @brief Returns true if the file starts like a compressed recording
+ */
+bool IsRecording(const std::string& path);
+
+/**
+ * @brief Writes raw blocks to a compressed recording, encoded by a pool of
+ * worker threads and written in order by a writer thread. Append copies
+ * the block and returns, it never waits for the encoders or the disk.
+ *
+ * Recording file, little-endian, see iq_codec::CBlockCodec for the block
+ * coding:
+ *   header "KIQ1", char[8] format, f64 sample rate
+ *   blocks "KIQB", u8 method, u8 dropped bits, u16 0, u32 samples,
+ *     u32 bytes, i64 time of the first sample in ns, u64 index of the
+ *     first sample in the stream, then the encoded bytes
+ *   index of the first block of every quarter second of samples, each
+ *     i64 time, u64 first sample, u64 file offset of the block
+ *   trailer u64 file offset of the index, u32 entries, "KIX1"
+ * The dropped bits are chosen per block, a block of a minRatio recording
+ * is lossless only while the lossless coding reaches the ratio.
+ * The file is written aside and renamed when closed. A file without the
+ * index, e.g. after a crash, still plays: the reader scans the blocks.
+ * @tparam Sample stream element type from SampleTypes.h, instantiated for
+ * CS8, CU8, CS16 and CF32
+ */
+template <class Sample>
+class CRecordingWriter {
+   public:
+    using Component = typename Sample::Component;
+
+    /**
+     * @brief Creates the file, throws std::runtime_error if it can't
+     * @param path recording file, written to path + ".tmp" until closed
+     * @param sampleRate stream sample rate, stored in the header
+     * @param config coding and queueing of the blocks
+     * @param deviceNumber number device, labels the metrics
+     */
+    CRecordingWriter(const std::string& path,
+                     const double sampleRate,
+                     const RecordingConfig& config,
+                     const int deviceNumber);
+    CRecordingWriter(const CRecordingWriter&) = delete;
+    CRecordingWriter& operator=(const CRecordingWriter&) = delete;
+
+    /**
+     * @brief Encodes and writes the queued blocks, writes the index and
+     * renames the file
+     */
+    ~CRecordingWriter();
+
+    /**
+     * @brief Queues a block, never blocks. Steady block sizes don't
+     * allocate once every queue slot was used.
+     * @param data interleaved components
+     * @param samples complex samples in the block
+     * @param timeNs time of the first sample
+     * @return false if the queue was full and the block was dropped, the
+     * sample indices of the file show the gap
+     */
+    bool Append(const Component* data,
+                const size_t samples,
+                const long long timeNs);
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+/**
+ * @brief Plays a recording of CRecordingWriter, seeks through the index
+ * and decodes only the block the position is in
+ */
+template <class Sample>
+class CRecordingReader {
+   public:
+    using Component = typename Sample::Component;
+
+    /**
+     * @brief Maps the file and loads its index, throws std::runtime_error
+     * if it isn't a recording of the Sample format
+     */
+    explicit CRecordingReader(const std::string& path);
+    CRecordingReader(const CRecordingReader&) = delete;
+    CRecordingReader& operator=(const CRecordingReader&) = delete;
+    ~CRecordingReader();
+
+    /**
+     * @brief Writes up to samples complex samples, the gaps of dropped
+     * blocks are skipped
+     * @param out room for 2 * samples components
+     * @return samples written, 0 - the end or a corrupt block was reached
+     */
+    size_t Read(Component* out, const size_t samples);
+
+    /**
+     * @brief Moves to the sample taken at timeNs, the first one after a
+     * gap, the end past the last block
+     */
+    void SeekTime(const long long timeNs);
+
+    /**
+     * @brief Moves to the sample with the index in the stream, the first
+     * one after a gap, the end past the last block
+     */
+    void SeekSample(const unsigned long long sample);
+
+    double SampleRate() const;
+
+    /**
+     * @brief Index in the stream of the first recorded sample
+     */
+    unsigned long long FirstSample() const;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace iq_recording
+
+#endif  // __IQ_RECORDING_H__
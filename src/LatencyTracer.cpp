@@ -0,0 +1,168 @@
+#include "LatencyTracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace latency_tracer {
+namespace {
+constexpr std::uint32_t kDefaultSampleInterval = 8u;
+constexpr auto kSubBuckets = 1u << CHdrHistogram::kSubBucketBits;
+constexpr auto kMaxValue =
+    (std::uint64_t(1u) << CHdrHistogram::kMaxValueBits) - 1u;
+
+std::atomic<std::uint32_t> gSampleInterval{kDefaultSampleInterval};
+
+unsigned HighestBit(const std::uint64_t value) {
+    return 63u - __builtin_clzll(value);
+}
+
+size_t BucketIndex(std::uint64_t value) {
+    value = std::min(value, kMaxValue);
+    if (value < kSubBuckets) {
+        return value;
+    }
+
+    // the leading bit selects the power of two, the next kSubBucketBits
+    // bits the linear sub-bucket inside it
+    const auto shift = HighestBit(value) - CHdrHistogram::kSubBucketBits;
+    const auto subBucket = (value >> shift) - kSubBuckets;
+    return kSubBuckets + shift * kSubBuckets + subBucket;
+}
+
+std::uint64_t BucketUpperBound(const size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+
+    const auto shift = (index - kSubBuckets) / kSubBuckets;
+    const auto subBucket = (index - kSubBuckets) % kSubBuckets;
+    return ((kSubBuckets + subBucket + 1u) << shift) - 1u;
+}
+}  // namespace
+
+std::uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void SetSampleInterval(const std::uint32_t interval) {
+    gSampleInterval.store(interval, std::memory_order_relaxed);
+}
+
+std::uint32_t GetSampleInterval() {
+    return gSampleInterval.load(std::memory_order_relaxed);
+}
+
+void CHdrHistogram::Record(const std::uint64_t value) {
+    mBuckets[BucketIndex(value)].fetch_add(1u, std::memory_order_relaxed);
+    mCount.fetch_add(1u, std::memory_order_relaxed);
+    if (value > mMax.load(std::memory_order_relaxed)) {
+        mMax.store(value, std::memory_order_relaxed);
+    }
+}
+
+std::uint64_t CHdrHistogram::ValueAtQuantile(const double quantile) const {
+    const auto count = Count();
+    if (0u == count) {
+        return 0u;
+    }
+    if (quantile >= 1.0) {
+        return Max();
+    }
+
+    const auto rank = std::max<std::uint64_t>(
+        1u, static_cast<std::uint64_t>(quantile * count + 0.5));
+    std::uint64_t seen(0u);
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += mBuckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(BucketUpperBound(i), Max());
+        }
+    }
+    return Max();
+}
+
+void CHdrHistogram::Reset() {
+    for (auto& bucket : mBuckets) {
+        bucket.store(0u, std::memory_order_relaxed);
+    }
+    mCount.store(0u, std::memory_order_relaxed);
+    mMax.store(0u, std::memory_order_relaxed);
+}
+
+struct CLatencyTracer::Impl {
+    // readStream return -> push to the queue
+    CHdrHistogram mRead;
+    // time spent waiting in the queue
+    CHdrHistogram mQueue;
+    // the pop: the queue lock and the copy of the block
+    CHdrHistogram mDispatch;
+    // processing start -> DSP result
+    CHdrHistogram mProcess;
+    // readStream return -> DSP result
+    CHdrHistogram mTotal;
+};
+
+CLatencyTracer::CLatencyTracer()
+    : mImpl(std::make_unique<CLatencyTracer::Impl>()) {}
+
+CLatencyTracer::CLatencyTracer(CLatencyTracer&&) = default;
+
+CLatencyTracer::~CLatencyTracer() = default;
+
+void CLatencyTracer::Record(const BlockStamps& stamps) {
+    if (not stamps.sampled) {
+        return;
+    }
+
+    mImpl->mRead.Record(stamps.enqueue - stamps.read);
+    mImpl->mQueue.Record(stamps.dequeue - stamps.enqueue);
+    mImpl->mDispatch.Record(stamps.processStart - stamps.dequeue);
+    mImpl->mProcess.Record(stamps.processEnd - stamps.processStart);
+    mImpl->mTotal.Record(stamps.processEnd - stamps.read);
+}
+
+std::string CLatencyTracer::Report(const std::string& title) const {
+    const auto interval = GetSampleInterval();
+
+    char line[160];
+    snprintf(line,
+             sizeof(line),
+             "%s latency, %llu blocks traced (1 of %u), in us:\n",
+             title.c_str(),
+             static_cast<unsigned long long>(mImpl->mTotal.Count()),
+             interval);
+    std::string report = line;
+
+    const std::pair<const char*, const CHdrHistogram*> segments[] = {
+        {"read->enqueue", &mImpl->mRead},
+        {"queue", &mImpl->mQueue},
+        {"dispatch", &mImpl->mDispatch},
+        {"process", &mImpl->mProcess},
+        {"end-to-end", &mImpl->mTotal}};
+    for (const auto& [name, histogram] : segments) {
+        snprintf(line,
+                 sizeof(line),
+                 "  %-14s p50 %10.1f p99 %10.1f p99.9 %10.1f max %10.1f\n",
+                 name,
+                 histogram->ValueAtQuantile(0.5) / 1e3,
+                 histogram->ValueAtQuantile(0.99) / 1e3,
+                 histogram->ValueAtQuantile(0.999) / 1e3,
+                 histogram->ValueAtQuantile(1.0) / 1e3);
+        report += line;
+    }
+
+    return report;
+}
+
+void CLatencyTracer::Reset() {
+    mImpl->mRead.Reset();
+    mImpl->mQueue.Reset();
+    mImpl->mDispatch.Reset();
+    mImpl->mProcess.Reset();
+    mImpl->mTotal.Reset();
+}
+
+}  // namespace latency_tracer
@@ -0,0 +1,110 @@
+#ifndef __LATENCY_TRACER_H__
+#define __LATENCY_TRACER_H__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace latency_tracer {
+/**
+ * @brief Monotonic time in ns used for all block stamps
+ */
+std::uint64_t NowNs();
+
+/**
+ * @brief Sets how many blocks share one traced block, 1 traces every
+ * block, 0 disables tracing. Applies to blocks read afterwards.
+ */
+void SetSampleInterval(const std::uint32_t interval);
+
+std::uint32_t GetSampleInterval();
+
+/**
+ * @brief Stamps of a block on its way from readStream to the DSP result,
+ * all zero unless the block is sampled
+ */
+struct BlockStamps {
+    bool sampled{false};
+    // readStream returned the samples
+    std::uint64_t read{0u};
+    // the block is pushed to the data queue
+    std::uint64_t enqueue{0u};
+    // the handler is ready to pop the block
+    std::uint64_t dequeue{0u};
+    // the block is out of the queue, its processing begins
+    std::uint64_t processStart{0u};
+    std::uint64_t processEnd{0u};
+};
+
+/**
+ * @brief Log-linear histogram in the spirit of HdrHistogram: 32 linear
+ * sub-buckets per power of two, ~3% value error, 1 ns .. 18 minutes.
+ * Single writer, relaxed atomics so readers on other threads are safe.
+ */
+class CHdrHistogram {
+   public:
+    static constexpr unsigned kSubBucketBits = 5u;
+    static constexpr unsigned kMaxValueBits = 40u;
+    static constexpr size_t kBuckets =
+        (kMaxValueBits - kSubBucketBits + 1u) << kSubBucketBits;
+
+    void Record(const std::uint64_t value);
+
+    /**
+     * @brief Returns the upper bound of the bucket holding the quantile
+     * @param quantile 0.0 .. 1.0, 1.0 returns the max
+     */
+    std::uint64_t ValueAtQuantile(const double quantile) const;
+
+    std::uint64_t Count() const {
+        return mCount.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t Max() const {
+        return mMax.load(std::memory_order_relaxed);
+    }
+
+    void Reset();
+
+   private:
+    std::array<std::atomic<std::uint64_t>, kBuckets> mBuckets{};
+    std::atomic<std::uint64_t> mCount{0u};
+    std::atomic<std::uint64_t> mMax{0u};
+};
+
+class CLatencyTracer {
+   public:
+    CLatencyTracer();
+    CLatencyTracer(const CLatencyTracer&) = delete;
+    CLatencyTracer& operator=(const CLatencyTracer&) = delete;
+    CLatencyTracer(CLatencyTracer&&);
+    ~CLatencyTracer();
+
+    /**
+     * @brief Adds the segments of a fully stamped block, blocks which are
+     * not sampled are ignored. Call it from the processing thread only.
+     */
+    void Record(const BlockStamps& stamps);
+
+    /**
+     * @brief Returns p50/p99/p99.9/max of every segment in us
+     * @param title first line of the report, e.g. "Device #1"
+     */
+    std::string Report(const std::string& title) const;
+
+    /**
+     * @brief Clears the histograms, races with Record only by losing
+     * the blocks recorded meanwhile
+     */
+    void Reset();
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace latency_tracer
+
+#endif  // __LATENCY_TRACER_H__
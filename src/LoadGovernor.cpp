@@ -0,0 +1,231 @@
+#include "LoadGovernor.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <string>
+
+#include "Metrics.h"
+
+namespace load_governor {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// the load is judged over this much time, a level changes at most once
+constexpr auto kEvaluationPeriod = std::chrono::milliseconds(250);
+// the backed off recover time stays below this multiple of the configured
+constexpr int kMaxBackOff = 16;
+
+struct LevelSettings {
+    // one block of this many is transformed
+    size_t frameStride;
+    // one spectrum of this many goes to the waterfall and traces
+    size_t displayStride;
+    // the FFT covers the block divided by this
+    size_t fftDivider;
+};
+
+// indexed by Quality
+constexpr LevelSettings kLevels[] = {
+    {1u, 1u, 1u}, {2u, 1u, 1u}, {2u, 2u, 1u}, {2u, 2u, 4u}, {8u, 2u, 4u}};
+constexpr size_t kWorst = sizeof(kLevels) / sizeof(kLevels[0]) - 1u;
+}  // namespace
+
+const char* QualityName(const Quality quality) {
+    switch (quality) {
+        case Quality::Full:
+            return "full";
+        case Quality::SkipFrames:
+            return "skip-frames";
+        case Quality::ShallowAverage:
+            return "shallow-average";
+        case Quality::SmallFft:
+            return "small-fft";
+        case Quality::Decimated:
+            return "decimated";
+    }
+    return "?";
+}
+
+struct CLoadGovernor::Impl {
+    Impl(const int deviceNumber, const GovernorConfig& config)
+        : mDeviceNumber(deviceNumber)
+        , mConfig(config)
+        , mWindowStart(Clock::now())
+        , mRecoverTime(config.recoverTime)
+        , mLevelGauge(metrics::CMetricsRegistry::Instance().GetGauge(
+              "kraken_quality_level",
+              "Processing quality, 0 full .. 4 decimated input",
+              {{"device", std::to_string(deviceNumber)}}))
+        , mShedFrames(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_shed_frames_total",
+              "Work shed by the load governor",
+              {{"device", std::to_string(deviceNumber)}, {"stage", "fft"}}))
+        , mShedDisplay(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_shed_frames_total",
+              "Work shed by the load governor",
+              {{"device", std::to_string(deviceNumber)},
+               {"stage", "display"}})) {}
+
+    void Evaluate(const Clock::time_point now);
+    void SetLevel(const size_t level,
+                  const size_t depth,
+                  const double load,
+                  const Clock::time_point now);
+
+    const int mDeviceNumber;
+    const GovernorConfig mConfig;
+    size_t mLevel{0u};
+    // blocks and transformed frames since the level changed
+    std::uint64_t mBlocks{0u};
+    std::uint64_t mFrames{0u};
+
+    Clock::time_point mWindowStart;
+    std::uint64_t mBusyNs{0u};
+    size_t mMaxDepth{0u};
+    size_t mPreviousDepth{0u};
+
+    std::chrono::milliseconds mRecoverTime;
+    bool mHeadroom{false};
+    Clock::time_point mHeadroomSince;
+    // a better level overloading before this backs the recovery off
+    Clock::time_point mTrialUntil;
+    bool mTrial{false};
+    bool mWorstLogged{false};
+
+    metrics::CGauge& mLevelGauge;
+    metrics::CCounter& mShedFrames;
+    metrics::CCounter& mShedDisplay;
+};
+
+void CLoadGovernor::Impl::SetLevel(const size_t level,
+                                   const size_t depth,
+                                   const double load,
+                                   const Clock::time_point now) {
+    SoapySDR::logf(level > mLevel ? SOAPY_SDR_WARNING : SOAPY_SDR_INFO,
+                   "Load governor: device #%d %s -> %s, queue %zu, busy "
+                   "%.0f%%",
+                   mDeviceNumber,
+                   QualityName(static_cast<Quality>(mLevel)),
+                   QualityName(static_cast<Quality>(level)),
+                   depth,
+                   100.0 * load);
+    mTrial = level < mLevel;
+    mTrialUntil = now + mConfig.recoverTime;
+    mLevel = level;
+    mBlocks = 0u;
+    mFrames = 0u;
+    mHeadroom = false;
+    mWorstLogged = false;
+    mLevelGauge.Set(static_cast<std::int64_t>(level));
+}
+
+void CLoadGovernor::Impl::Evaluate(const Clock::time_point now) {
+    const auto elapsedNs =
+        std::chrono::duration<double, std::nano>(now - mWindowStart).count();
+    const auto load = mBusyNs / std::max(1.0, elapsedNs);
+    const auto depth = mMaxDepth;
+    // a queue draining its backlog is catching up, even while busy
+    const auto growing = depth > mConfig.lowWater && depth >= mPreviousDepth;
+    const auto overloaded =
+        growing && (depth >= mConfig.highWater || load >= mConfig.highLoad);
+    const auto headroom =
+        depth <= mConfig.lowWater && load < mConfig.lowLoad;
+    mPreviousDepth = depth;
+
+    if (mTrial && not overloaded && now >= mTrialUntil) {
+        // the better level held
+        mRecoverTime = mConfig.recoverTime;
+        mTrial = false;
+    }
+
+    if (overloaded) {
+        mHeadroom = false;
+        if (mTrial) {
+            // the better level didn't hold, wait longer before the next try
+            mRecoverTime = std::min(mRecoverTime * 2,
+                                    mConfig.recoverTime * kMaxBackOff);
+        }
+        if (mLevel < kWorst) {
+            SetLevel(mLevel + 1u, depth, load, now);
+        } else if (not mWorstLogged) {
+            SoapySDR::logf(SOAPY_SDR_WARNING,
+                           "Load governor: device #%d falls behind at the "
+                           "lowest quality, queue %zu",
+                           mDeviceNumber,
+                           depth);
+            mWorstLogged = true;
+        }
+        return;
+    }
+
+    if (not headroom || 0u == mLevel) {
+        mHeadroom = false;
+        return;
+    }
+    if (not mHeadroom) {
+        mHeadroom = true;
+        mHeadroomSince = now;
+    } else if (now - mHeadroomSince >= mRecoverTime) {
+        SetLevel(mLevel - 1u, depth, load, now);
+    }
+}
+
+CLoadGovernor::CLoadGovernor(const int deviceNumber,
+                             const GovernorConfig& config)
+    : mImpl(std::make_unique<CLoadGovernor::Impl>(deviceNumber, config)) {
+    if (config.enabled) {
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "Load governor: device #%d sheds at queue %zu or "
+                       "%.0f%% busy, recovers after %lld ms",
+                       deviceNumber,
+                       config.highWater,
+                       100.0 * config.highLoad,
+                       static_cast<long long>(config.recoverTime.count()));
+    }
+}
+
+CLoadGovernor::~CLoadGovernor() = default;
+
+BlockPlan CLoadGovernor::Plan(const size_t samples) {
+    auto& impl = *mImpl;
+    const auto& settings = kLevels[impl.mLevel];
+
+    BlockPlan plan;
+    plan.transform = 0u == impl.mBlocks++ % settings.frameStride;
+    if (not plan.transform) {
+        plan.display = false;
+        impl.mShedFrames.Add();
+        return plan;
+    }
+    plan.display = 0u == impl.mFrames++ % settings.displayStride;
+    if (not plan.display) {
+        impl.mShedDisplay.Add();
+    }
+    plan.fftSize = std::max<size_t>(1u, samples / settings.fftDivider);
+    return plan;
+}
+
+void CLoadGovernor::Account(const std::uint64_t busyNs,
+                            const size_t queueDepth) {
+    auto& impl = *mImpl;
+    if (not impl.mConfig.enabled) {
+        return;
+    }
+
+    impl.mBusyNs += busyNs;
+    impl.mMaxDepth = std::max(impl.mMaxDepth, queueDepth);
+    const auto now = Clock::now();
+    if (now - impl.mWindowStart < kEvaluationPeriod) {
+        return;
+    }
+    impl.Evaluate(now);
+    impl.mWindowStart = now;
+    impl.mBusyNs = 0u;
+    impl.mMaxDepth = 0u;
+}
+
+Quality CLoadGovernor::GetQuality() const {
+    return static_cast<Quality>(mImpl->mLevel);
+}
+
+}  // namespace load_governor
@@ -0,0 +1,102 @@
+#ifndef __LOAD_GOVERNOR_H__
+#define __LOAD_GOVERNOR_H__
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace load_governor {
+/**
+ * @brief Processing quality of a device, each level sheds the work of the
+ * ones before it and more
+ */
+enum class Quality {
+    // every block transformed at its full size
+    Full,
+    // every second block transformed
+    SkipFrames,
+    // and the waterfall and traces take every second spectrum, the
+    // traces average half as many frames
+    ShallowAverage,
+    // and the FFT covers a quarter of the block
+    SmallFft,
+    // and one block in eight enters the DSP chain
+    Decimated
+};
+
+struct GovernorConfig {
+    // false - always Full
+    bool enabled{true};
+    // blocks waiting in the queue that count as falling behind
+    size_t highWater{8u};
+    // at or below, the queue keeps up
+    size_t lowWater{1u};
+    // busy fraction of the DSP thread that counts as overload
+    double highLoad{0.9};
+    // busy fraction below which the next better level is tried
+    double lowLoad{0.4};
+    // headroom held this long before a better level is tried, doubled
+    // each time the better level overloads again
+    std::chrono::milliseconds recoverTime{5000};
+};
+
+/**
+ * @brief What a block gets at the current quality
+ */
+struct BlockPlan {
+    // the block is converted and transformed, false - shed
+    bool transform{true};
+    // the spectrum goes to the waterfall and traces
+    bool display{true};
+    // samples transformed from the start of the block
+    size_t fftSize{0u};
+};
+
+/**
+ * @brief Watches the queue depth and the busy time of the DSP thread of
+ * one device and degrades the processing one level at a time while it
+ * falls behind. Overload is judged once per evaluation period: a queue at
+ * highWater or a busy fraction at highLoad steps down at once, headroom
+ * held for the recover time steps up one level. A better level that
+ * overloads again doubles the recover time, so the levels don't flap.
+ * Called by the DSP thread only.
+ */
+class CLoadGovernor {
+   public:
+    /**
+     * @param deviceNumber number device, labels the metrics
+     * @param config thresholds, disabled keeps Full
+     */
+    CLoadGovernor(const int deviceNumber, const GovernorConfig& config);
+    CLoadGovernor(const CLoadGovernor&) = delete;
+    CLoadGovernor& operator=(const CLoadGovernor&) = delete;
+    ~CLoadGovernor();
+
+    /**
+     * @brief Plans the next block, counts the shed frames
+     * @param samples complex samples in the block
+     */
+    BlockPlan Plan(const size_t samples);
+
+    /**
+     * @brief Accounts a block, may change the quality
+     * @param busyNs time spent on the block
+     * @param queueDepth blocks waiting after it
+     */
+    void Account(const std::uint64_t busyNs, const size_t queueDepth);
+
+    Quality GetQuality() const;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+/**
+ * @brief Returns the name of the quality, e.g. "skip-frames"
+ */
+const char* QualityName(const Quality quality);
+
+}  // namespace load_governor
+
+#endif  // __LOAD_GOVERNOR_H__
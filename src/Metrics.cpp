@@ -0,0 +1,252 @@
+#include "Metrics.h"
+
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+
+namespace metrics {
+namespace {
+constexpr auto kNsPerSecond = 1e9;
+
+enum class MetricType { Counter, Gauge, Histogram };
+
+const char* TypeName(const MetricType type) {
+    switch (type) {
+        case MetricType::Counter:
+            return "counter";
+        case MetricType::Gauge:
+            return "gauge";
+        case MetricType::Histogram:
+            return "histogram";
+    }
+    return "untyped";
+}
+
+std::string FormatLabels(const Labels& labels) {
+    std::string result;
+    for (const auto& label : labels) {
+        result += result.empty() ? "" : ",";
+        result += label.first + "=\"" + label.second + "\"";
+    }
+    return result;
+}
+
+bool EndsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() &&
+           0 == value.compare(
+                    value.size() - suffix.size(), suffix.size(), suffix);
+}
+
+std::string FormatNumber(const double value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+}  // namespace
+
+std::uint64_t CCounter::Value() const {
+    std::uint64_t value(0u);
+    for (const auto& shard : mShards) {
+        value += shard.mValue.load(std::memory_order_relaxed);
+    }
+    return value;
+}
+
+CHistogram::CHistogram(std::vector<std::uint64_t> bounds)
+    : mBounds(std::move(bounds)) {
+    if (mBounds.size() > kMaxBuckets) {
+        throw std::invalid_argument("CHistogram: too many buckets");
+    }
+}
+
+std::vector<std::uint64_t> CHistogram::GetCounts() const {
+    std::vector<std::uint64_t> counts(mBounds.size() + 1u, 0u);
+    for (const auto& shard : mShards) {
+        for (size_t i = 0; i < counts.size(); ++i) {
+            counts[i] += shard.mBuckets[i].load(std::memory_order_relaxed);
+        }
+    }
+    return counts;
+}
+
+std::uint64_t CHistogram::GetSum() const {
+    std::uint64_t sum(0u);
+    for (const auto& shard : mShards) {
+        sum += shard.mSum.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+std::vector<std::uint64_t> LatencyBoundsNs() {
+    std::vector<std::uint64_t> bounds;
+    for (std::uint64_t bound = 1000u; bounds.size() < kMaxBuckets;
+         bound *= 2u) {
+        bounds.push_back(bound);
+    }
+    return bounds;
+}
+
+struct CMetricsRegistry::Impl {
+    struct Family {
+        MetricType mType;
+        std::string mHelp;
+        std::map<std::string, std::unique_ptr<CCounter>> mCounters;
+        std::map<std::string, std::unique_ptr<CGauge>> mGauges;
+        std::map<std::string, std::unique_ptr<CHistogram>> mHistograms;
+    };
+
+    Family& GetFamily(const std::string& name,
+                      const std::string& help,
+                      const MetricType type) {
+        auto it = mFamilies.find(name);
+        if (mFamilies.end() == it) {
+            it = mFamilies.emplace(name, Family{type, help, {}, {}, {}}).first;
+        }
+        if (type != it->second.mType) {
+            throw std::invalid_argument("Metric type mismatch: " + name);
+        }
+        return it->second;
+    }
+
+    void RenderHistogram(std::string& out,
+                         const std::string& name,
+                         const std::string& labels,
+                         const CHistogram& histogram) const;
+
+    mutable std::mutex mLock;
+    std::map<std::string, Family> mFamilies;
+};
+
+void CMetricsRegistry::Impl::RenderHistogram(
+    std::string& out,
+    const std::string& name,
+    const std::string& labels,
+    const CHistogram& histogram) const {
+    const auto scale = EndsWith(name, "_seconds") ? 1.0 / kNsPerSecond : 1.0;
+    const auto prefix = labels.empty() ? std::string() : labels + ",";
+    const auto counts = histogram.GetCounts();
+    const auto& bounds = histogram.GetBounds();
+
+    std::uint64_t cumulative(0u);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        cumulative += counts[i];
+        const auto le = i < bounds.size() ? FormatNumber(bounds[i] * scale)
+                                          : std::string("+Inf");
+        out += name + "_bucket{" + prefix + "le=\"" + le + "\"} " +
+               std::to_string(cumulative) + "\n";
+    }
+
+    const auto braces = labels.empty() ? labels : "{" + labels + "}";
+    out += name + "_sum" + braces + " " +
+           FormatNumber(histogram.GetSum() * scale) + "\n";
+    out += name + "_count" + braces + " " + std::to_string(cumulative) + "\n";
+}
+
+CMetricsRegistry::CMetricsRegistry()
+    : mImpl(std::make_unique<CMetricsRegistry::Impl>()) {}
+
+CMetricsRegistry::~CMetricsRegistry() = default;
+
+CMetricsRegistry& CMetricsRegistry::Instance() {
+    static CMetricsRegistry registry;
+    return registry;
+}
+
+CCounter& CMetricsRegistry::GetCounter(const std::string& name,
+                                       const std::string& help,
+                                       const Labels& labels) {
+    std::lock_guard guard(mImpl->mLock);
+
+    auto& series =
+        mImpl->GetFamily(name, help, MetricType::Counter).mCounters;
+    auto& counter = series[FormatLabels(labels)];
+    if (not counter) {
+        counter = std::make_unique<CCounter>();
+    }
+    return *counter;
+}
+
+CGauge& CMetricsRegistry::GetGauge(const std::string& name,
+                                   const std::string& help,
+                                   const Labels& labels) {
+    std::lock_guard guard(mImpl->mLock);
+
+    auto& series = mImpl->GetFamily(name, help, MetricType::Gauge).mGauges;
+    auto& gauge = series[FormatLabels(labels)];
+    if (not gauge) {
+        gauge = std::make_unique<CGauge>();
+    }
+    return *gauge;
+}
+
+CHistogram& CMetricsRegistry::GetHistogram(
+    const std::string& name,
+    const std::string& help,
+    const Labels& labels,
+    const std::vector<std::uint64_t>& bounds) {
+    std::lock_guard guard(mImpl->mLock);
+
+    auto& series =
+        mImpl->GetFamily(name, help, MetricType::Histogram).mHistograms;
+    auto& histogram = series[FormatLabels(labels)];
+    if (not histogram) {
+        histogram = std::make_unique<CHistogram>(bounds);
+    }
+    return *histogram;
+}
+
+std::uint64_t CMetricsRegistry::GetCounterValue(const std::string& name,
+                                                const Labels& labels) const {
+    std::lock_guard guard(mImpl->mLock);
+
+    const auto family = mImpl->mFamilies.find(name);
+    if (mImpl->mFamilies.end() == family) {
+        return 0u;
+    }
+
+    const auto& series = family->second.mCounters;
+    const auto counter = series.find(FormatLabels(labels));
+    return series.end() == counter ? 0u : counter->second->Value();
+}
+
+std::int64_t CMetricsRegistry::GetGaugeValue(const std::string& name,
+                                             const Labels& labels) const {
+    std::lock_guard guard(mImpl->mLock);
+
+    const auto family = mImpl->mFamilies.find(name);
+    if (mImpl->mFamilies.end() == family) {
+        return 0;
+    }
+
+    const auto& series = family->second.mGauges;
+    const auto gauge = series.find(FormatLabels(labels));
+    return series.end() == gauge ? 0 : gauge->second->Value();
+}
+
+std::string CMetricsRegistry::Render() const {
+    std::lock_guard guard(mImpl->mLock);
+
+    std::string out;
+    for (const auto& [name, family] : mImpl->mFamilies) {
+        out += "# HELP " + name + " " + family.mHelp + "\n";
+        out += "# TYPE " + name + " " + TypeName(family.mType) + "\n";
+
+        for (const auto& [labels, counter] : family.mCounters) {
+            const auto braces = labels.empty() ? labels : "{" + labels + "}";
+            out += name + braces + " " + std::to_string(counter->Value()) +
+                   "\n";
+        }
+        for (const auto& [labels, gauge] : family.mGauges) {
+            const auto braces = labels.empty() ? labels : "{" + labels + "}";
+            out +=
+                name + braces + " " + std::to_string(gauge->Value()) + "\n";
+        }
+        for (const auto& [labels, histogram] : family.mHistograms) {
+            mImpl->RenderHistogram(out, name, labels, *histogram);
+        }
+    }
+
+    return out;
+}
+
+}  // namespace metrics
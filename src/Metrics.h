@@ -0,0 +1,184 @@
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace metrics {
+constexpr size_t kCacheLineSize = 64u;
+constexpr size_t kShards = 8u;
+constexpr size_t kMaxBuckets = 16u;
+
+using Labels = std::map<std::string, std::string>;
+
+/**
+ * @brief Returns the shard of the calling thread, threads are spread
+ * round-robin over the shards on their first metric update
+ */
+inline size_t ThreadShard() {
+    static std::atomic<size_t> nextShard{0u};
+    static thread_local const size_t shard =
+        nextShard.fetch_add(1u, std::memory_order_relaxed) % kShards;
+    return shard;
+}
+
+class CCounter {
+   public:
+    /**
+     * @brief Increments the counter, a relaxed add on the shard of the
+     * calling thread so concurrent writers never share a cache line
+     */
+    void Add(const std::uint64_t value = 1u) {
+        mShards[ThreadShard()].mValue.fetch_add(value,
+                                                std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Returns the sum of all shards
+     */
+    std::uint64_t Value() const;
+
+   private:
+    struct alignas(kCacheLineSize) Shard {
+        std::atomic<std::uint64_t> mValue{0u};
+    };
+    std::array<Shard, kShards> mShards;
+};
+
+class CGauge {
+   public:
+    void Set(const std::int64_t value) {
+        mValue.store(value, std::memory_order_relaxed);
+    }
+
+    void Add(const std::int64_t value) {
+        mValue.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    std::int64_t Value() const {
+        return mValue.load(std::memory_order_relaxed);
+    }
+
+   private:
+    alignas(kCacheLineSize) std::atomic<std::int64_t> mValue{0};
+};
+
+class CHistogram {
+   public:
+    /**
+     * @brief ctor
+     * @param bounds ascending bucket upper bounds, at most kMaxBuckets,
+     * values above the last bound go to the +Inf bucket
+     */
+    explicit CHistogram(std::vector<std::uint64_t> bounds);
+
+    /**
+     * @brief Adds one observation, relaxed adds on the shard of the
+     * calling thread
+     * @param value in the unit of the bounds (nanoseconds for latencies)
+     */
+    void Observe(const std::uint64_t value) {
+        size_t bucket(0u);
+        while (bucket < mBounds.size() && value > mBounds[bucket]) {
+            ++bucket;
+        }
+
+        auto& shard = mShards[ThreadShard()];
+        shard.mBuckets[bucket].fetch_add(1u, std::memory_order_relaxed);
+        shard.mSum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    const std::vector<std::uint64_t>& GetBounds() const {
+        return mBounds;
+    }
+
+    /**
+     * @brief Returns non cumulative counts, GetBounds().size() + 1 values
+     */
+    std::vector<std::uint64_t> GetCounts() const;
+
+    std::uint64_t GetSum() const;
+
+   private:
+    struct alignas(kCacheLineSize) Shard {
+        std::array<std::atomic<std::uint64_t>, kMaxBuckets + 1u> mBuckets{};
+        std::atomic<std::uint64_t> mSum{0u};
+    };
+    const std::vector<std::uint64_t> mBounds;
+    std::array<Shard, kShards> mShards;
+};
+
+/**
+ * @brief Default bounds for processing times: 1 us .. 32 ms, in ns
+ */
+std::vector<std::uint64_t> LatencyBoundsNs();
+
+class CMetricsRegistry {
+   public:
+    /**
+     * @brief Returns the process wide registry
+     */
+    static CMetricsRegistry& Instance();
+
+    CMetricsRegistry(const CMetricsRegistry&) = delete;
+    CMetricsRegistry& operator=(const CMetricsRegistry&) = delete;
+
+    /**
+     * @brief Returns the counter of the series, creates it on first use.
+     * Takes a lock, look metrics up once at setup and keep the reference
+     * @param name metric family name, e.g. "kraken_samples_total"
+     * @param help one line description of the family
+     * @param labels series labels, e.g. {{"device", "1"}}
+     */
+    CCounter& GetCounter(const std::string& name,
+                         const std::string& help,
+                         const Labels& labels = Labels());
+
+    CGauge& GetGauge(const std::string& name,
+                     const std::string& help,
+                     const Labels& labels = Labels());
+
+    /**
+     * @brief Returns the histogram of the series, creates it on first use.
+     * Observations in ns are exported in seconds when the name ends
+     * with "_seconds"
+     */
+    CHistogram& GetHistogram(
+        const std::string& name,
+        const std::string& help,
+        const Labels& labels = Labels(),
+        const std::vector<std::uint64_t>& bounds = LatencyBoundsNs());
+
+    /**
+     * @brief Returns the value of a counter series, 0 if it doesn't exist
+     */
+    std::uint64_t GetCounterValue(const std::string& name,
+                                  const Labels& labels = Labels()) const;
+
+    /**
+     * @brief Returns the value of a gauge series, 0 if it doesn't exist
+     */
+    std::int64_t GetGaugeValue(const std::string& name,
+                               const Labels& labels = Labels()) const;
+
+    /**
+     * @brief Renders all metrics in the Prometheus text exposition format
+     */
+    std::string Render() const;
+
+   private:
+    CMetricsRegistry();
+    ~CMetricsRegistry();
+
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace metrics
+
+#endif  // __METRICS_H__
@@ -0,0 +1,201 @@
+#include "MetricsExporter.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <thread>
+
+#include "Metrics.h"
+#include "Utility.h"
+
+namespace metrics_exporter {
+namespace {
+constexpr auto kPollPeriod = std::chrono::milliseconds(200);
+constexpr auto kRequestBufferSize = 1024u;
+constexpr auto kHttpHeader =
+    "HTTP/1.0 200 OK\r\n"
+    "Content-Type: text/plain; version=0.0.4\r\n"
+    "Connection: close\r\n\r\n";
+}  // namespace
+
+struct CMetricsExporter::Impl {
+    ~Impl() {
+        LOG_FUNC();
+
+        mStopRequested = true;
+
+        if (mThreadHandle.valid()) {
+            mThreadHandle.get();
+        }
+
+        if (mListenFd >= 0) {
+            close(mListenFd);
+        }
+    }
+
+    bool Listen();
+    void ExportLoop();
+    void WriteTextFile() const;
+    void ServeClient() const;
+
+    ExporterConfig mConfig;
+    int mListenFd{-1};
+    std::atomic_bool mStopRequested{false};
+    std::future<void> mThreadHandle;
+};
+
+bool CMetricsExporter::Impl::Listen() {
+    mListenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (mListenFd < 0) {
+        SoapySDR::logf(
+            SOAPY_SDR_ERROR, "Metrics: socket: %s", std::strerror(errno));
+        return false;
+    }
+
+    const int reuse(1);
+    setsockopt(mListenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(mConfig.httpPort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (0 != bind(mListenFd,
+                  reinterpret_cast<const sockaddr*>(&address),
+                  sizeof(address)) ||
+        0 != listen(mListenFd, SOMAXCONN)) {
+        SoapySDR::logf(SOAPY_SDR_ERROR,
+                       "Metrics: can't listen on 127.0.0.1:%u: %s",
+                       mConfig.httpPort,
+                       std::strerror(errno));
+        return false;
+    }
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Metrics: serving http://127.0.0.1:%u/metrics",
+                   mConfig.httpPort);
+    return true;
+}
+
+void CMetricsExporter::Impl::ExportLoop() {
+    LOG_FUNC();
+
+    auto nextWrite = std::chrono::steady_clock::now();
+    while (not mStopRequested) {
+        const auto now = std::chrono::steady_clock::now();
+        if (not mConfig.textFilePath.empty() && nextWrite <= now) {
+            WriteTextFile();
+            nextWrite = now + mConfig.period;
+        }
+
+        if (mListenFd < 0) {
+            std::this_thread::sleep_for(kPollPeriod);
+            continue;
+        }
+
+        pollfd listenPoll{mListenFd, POLLIN, 0};
+        if (poll(&listenPoll, 1, kPollPeriod.count()) > 0) {
+            ServeClient();
+        }
+    }
+
+    if (not mConfig.textFilePath.empty()) {
+        WriteTextFile();
+    }
+}
+
+void CMetricsExporter::Impl::WriteTextFile() const {
+    // node_exporter may read any time, never let it see a partial file
+    const auto tmpPath = mConfig.textFilePath + ".tmp";
+    auto file = fopen(tmpPath.c_str(), "w");
+    if (nullptr == file) {
+        SoapySDR::logf(
+            SOAPY_SDR_ERROR, "Metrics: can't open %s", tmpPath.c_str());
+        return;
+    }
+
+    const auto text = metrics::CMetricsRegistry::Instance().Render();
+    fwrite(text.data(), 1u, text.size(), file);
+    fclose(file);
+
+    std::rename(tmpPath.c_str(), mConfig.textFilePath.c_str());
+}
+
+void CMetricsExporter::Impl::ServeClient() const {
+    const auto clientFd = accept4(mListenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (clientFd < 0) {
+        return;
+    }
+
+    // the request is not parsed, every path returns the metrics
+    char request[kRequestBufferSize];
+    pollfd clientPoll{clientFd, POLLIN, 0};
+    if (poll(&clientPoll, 1, kPollPeriod.count()) > 0) {
+        [[maybe_unused]] const auto size =
+            recv(clientFd, request, sizeof(request), 0);
+    }
+
+    const auto response =
+        kHttpHeader + metrics::CMetricsRegistry::Instance().Render();
+    size_t sent(0u);
+    while (sent < response.size()) {
+        const auto size = send(clientFd,
+                               response.data() + sent,
+                               response.size() - sent,
+                               MSG_NOSIGNAL);
+        if (size <= 0) {
+            break;
+        }
+        sent += size;
+    }
+
+    close(clientFd);
+}
+
+CMetricsExporter::CMetricsExporter(const ExporterConfig& config)
+    : mImpl(std::make_unique<CMetricsExporter::Impl>()) {
+    mImpl->mConfig = config;
+}
+
+CMetricsExporter::CMetricsExporter(CMetricsExporter&&) = default;
+
+CMetricsExporter::~CMetricsExporter() {
+    LOG_FUNC();
+}
+
+bool CMetricsExporter::Start() {
+    LOG_FUNC();
+
+    if (mImpl->mConfig.textFilePath.empty() && 0u == mImpl->mConfig.httpPort) {
+        return false;
+    }
+
+    if (0u != mImpl->mConfig.httpPort && not mImpl->Listen()) {
+        return false;
+    }
+
+    mImpl->mThreadHandle = std::async(std::launch::async,
+                                      &CMetricsExporter::Impl::ExportLoop,
+                                      mImpl.get());
+    return true;
+}
+
+void CMetricsExporter::Stop() {
+    LOG_FUNC();
+
+    mImpl->mStopRequested = true;
+
+    if (mImpl->mThreadHandle.valid()) {
+        mImpl->mThreadHandle.get();
+    }
+}
+
+}  // namespace metrics_exporter
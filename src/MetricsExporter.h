@@ -0,0 +1,44 @@
+#ifndef __METRICS_EXPORTER_H__
+#define __METRICS_EXPORTER_H__
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace metrics_exporter {
+struct ExporterConfig {
+    // Prometheus node_exporter textfile, rewritten atomically every period
+    std::string textFilePath;
+    // local HTTP endpoint on 127.0.0.1, 0 - disabled
+    unsigned short httpPort{0u};
+    std::chrono::milliseconds period{std::chrono::seconds(5)};
+};
+
+class CMetricsExporter {
+   public:
+    explicit CMetricsExporter(const ExporterConfig& config);
+    CMetricsExporter(const CMetricsExporter&) = delete;
+    CMetricsExporter& operator=(const CMetricsExporter&) = delete;
+    CMetricsExporter(CMetricsExporter&&);
+    ~CMetricsExporter();
+
+    /**
+     * @brief Starts the exporter thread, start it after the control reactor
+     * so the thread inherits the blocked shutdown signals
+     * @return false if nothing is configured or the port can't be bound
+     */
+    bool Start();
+
+    /**
+     * @brief Stops the exporter thread, writes the textfile one last time
+     */
+    void Stop();
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace metrics_exporter
+
+#endif  // __METRICS_EXPORTER_H__
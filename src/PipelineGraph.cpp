@@ -0,0 +1,534 @@
+#include "PipelineGraph.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "AllocationTracker.h"
+#include "GraphNodes.h"
+#include "Metrics.h"
+#include "ThreadPlacement.h"
+#include "Utility.h"
+
+namespace pipeline_graph {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// idle workers poll this often for blocks of the RX stream, which pushes
+// to the device queue without waking the graph
+constexpr auto kIdleWait = std::chrono::milliseconds(1);
+
+std::uint64_t ElapsedNs(const Clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                                since)
+        .count();
+}
+
+const NodeSpec* FindNode(const GraphSpec& spec, const std::string& name) {
+    for (const auto& node : spec.nodes) {
+        if (name == node.name) {
+            return &node;
+        }
+    }
+    return nullptr;
+}
+
+const char* PortName(const PortType type) {
+    switch (type) {
+        case PortType::Raw:
+            return "raw";
+        case PortType::Complex:
+            return "complex";
+        case PortType::Spectrum:
+            return "spectrum";
+        case PortType::Burst:
+            return "burst";
+        case PortType::Any:
+            return "any";
+        default:
+            return "none";
+    }
+}
+
+/**
+ * @brief Bounded edge between two nodes. Only its producer pushes, after
+ * it saw room, so a push never fails and never allocates.
+ */
+template <class Sample>
+class CEdge {
+   public:
+    explicit CEdge(const size_t capacity) : mRing(capacity) {}
+
+    bool Full() const {
+        std::lock_guard lock(mLock);
+        return mSize == mRing.size();
+    }
+
+    void Push(const graph_nodes::PacketPtr<Sample>& packet) {
+        std::lock_guard lock(mLock);
+        mRing[(mHead + mSize) % mRing.size()] = packet;
+        ++mSize;
+    }
+
+    bool Pop(graph_nodes::PacketPtr<Sample>& packet) {
+        std::lock_guard lock(mLock);
+        if (0u == mSize) {
+            return false;
+        }
+        packet = std::move(mRing[mHead]);
+        mHead = (mHead + 1u) % mRing.size();
+        --mSize;
+        return true;
+    }
+
+   private:
+    mutable std::mutex mLock;
+    std::vector<graph_nodes::PacketPtr<Sample>> mRing;
+    size_t mHead{0u};
+    size_t mSize{0u};
+};
+
+template <class Sample>
+struct NodeSlot {
+    NodeSlot(const std::string& name,
+             std::unique_ptr<graph_nodes::INode<Sample>> node,
+             const std::string& device)
+        : mName(name)
+        , mNode(std::move(node))
+        , mPackets(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_graph_packets_total",
+              "Packets a graph node produced or consumed",
+              {{"device", device}, {"node", name}}))
+        , mStalls(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_graph_stalls_total",
+              "Times a graph node was held back by a full output edge",
+              {{"device", device}, {"node", name}}))
+        , mTime(metrics::CMetricsRegistry::Instance().GetHistogram(
+              "kraken_stage_seconds",
+              "Processing time per block and stage",
+              {{"device", device}, {"stage", name}})) {}
+
+    const std::string mName;
+    std::unique_ptr<graph_nodes::INode<Sample>> mNode;
+    CEdge<Sample>* mInput{nullptr};
+    std::vector<CEdge<Sample>*> mOutputs;
+    // taken by the worker running the node
+    std::atomic_flag mBusy = ATOMIC_FLAG_INIT;
+    bool mStalled{false};
+    metrics::CCounter& mPackets;
+    metrics::CCounter& mStalls;
+    metrics::CHistogram& mTime;
+};
+}  // namespace
+
+void ValidateGraphSpec(const GraphSpec& spec) {
+    if (0u == spec.threads || 0u == spec.capacity) {
+        throw std::runtime_error("Graph needs at least one thread and a "
+                                 "capacity of one packet");
+    }
+
+    std::set<std::string> names;
+    size_t devices(0u);
+    for (const auto& node : spec.nodes) {
+        if (nullptr == graph_nodes::FindKind(node.kind)) {
+            throw std::runtime_error("Graph node " + node.name +
+                                     ": unknown kind " + node.kind);
+        }
+        if (not names.insert(node.name).second) {
+            throw std::runtime_error("Graph node " + node.name +
+                                     " is declared twice");
+        }
+        if ("device" == node.kind && ++devices > 1u) {
+            throw std::runtime_error("Graph has more than one device node");
+        }
+    }
+
+    // the single input of every node, a fan in is not supported
+    std::map<std::string, std::string> inputs;
+    std::set<std::string> fed;
+    for (const auto& edge : spec.edges) {
+        fed.insert(edge.from);
+        const auto* from = FindNode(spec, edge.from);
+        const auto* to = FindNode(spec, edge.to);
+        if (nullptr == from || nullptr == to) {
+            throw std::runtime_error("Graph edge " + edge.from + " -> " +
+                                     edge.to + " names an unknown node");
+        }
+        const auto output = graph_nodes::FindKind(from->kind)->output;
+        const auto input = graph_nodes::FindKind(to->kind)->input;
+        if (PortType::None == output) {
+            throw std::runtime_error("Graph node " + from->name +
+                                     " is a sink, it has no output");
+        }
+        if (PortType::None == input) {
+            throw std::runtime_error("Graph node " + to->name +
+                                     " is a source, it has no input");
+        }
+        if (PortType::Any != input && input != output) {
+            throw std::runtime_error(
+                "Graph edge " + edge.from + " -> " + edge.to + " connects " +
+                PortName(output) + " to " + PortName(input));
+        }
+        if (not inputs.emplace(edge.to, edge.from).second) {
+            throw std::runtime_error("Graph node " + edge.to +
+                                     " has more than one input");
+        }
+    }
+
+    for (const auto& node : spec.nodes) {
+        // a source nobody reads would run for nothing
+        const auto* info = graph_nodes::FindKind(node.kind);
+        if (PortType::None == info->input && 0u == fed.count(node.name)) {
+            throw std::runtime_error("Graph node " + node.name +
+                                     " is a source without consumers");
+        }
+
+        // following the inputs must reach a source, not loop
+        auto current = node.name;
+        for (size_t steps = 0; steps <= spec.nodes.size(); ++steps) {
+            const auto* info =
+                graph_nodes::FindKind(FindNode(spec, current)->kind);
+            if (PortType::None == info->input) {
+                break;
+            }
+            const auto input = inputs.find(current);
+            if (inputs.end() == input) {
+                throw std::runtime_error("Graph node " + node.name +
+                                         " is not fed by a source");
+            }
+            if (spec.nodes.size() == steps) {
+                throw std::runtime_error("Graph node " + node.name +
+                                         " is part of a loop");
+            }
+            current = input->second;
+        }
+    }
+}
+
+GraphSpec LoadGraphSpec(const std::string& path) {
+    std::ifstream file(path);
+    if (not file) {
+        throw std::runtime_error("Can't open graph " + path);
+    }
+
+    GraphSpec spec;
+    std::string line;
+    size_t lineNumber(0u);
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        const auto fail = [&](const std::string& message) {
+            return std::runtime_error("Graph " + path + ":" +
+                                      std::to_string(lineNumber) + ": " +
+                                      message);
+        };
+
+        std::istringstream tokens(line.substr(0u, line.find('#')));
+        std::string statement;
+        if (not(tokens >> statement)) {
+            continue;
+        }
+
+        if ("threads" == statement || "capacity" == statement) {
+            long value(0);
+            if (not(tokens >> value) || value <= 0) {
+                throw fail(statement + " needs a positive number");
+            }
+            ("threads" == statement ? spec.threads : spec.capacity) =
+                static_cast<size_t>(value);
+        } else if ("node" == statement) {
+            NodeSpec node;
+            if (not(tokens >> node.name >> node.kind)) {
+                throw fail("node needs a name and a kind");
+            }
+            std::string param;
+            while (tokens >> param) {
+                const auto pos = param.find('=');
+                if (std::string::npos == pos || 0u == pos) {
+                    throw fail("expected key=value, got " + param);
+                }
+                node.params[param.substr(0u, pos)] = param.substr(pos + 1u);
+            }
+            spec.nodes.push_back(std::move(node));
+        } else if ("edge" == statement) {
+            std::string from;
+            std::string to;
+            if (not(tokens >> from >> to)) {
+                throw fail("edge needs a source and at least one target");
+            }
+            do {
+                spec.edges.push_back({from, to});
+            } while (tokens >> to);
+        } else {
+            throw fail("unknown statement " + statement);
+        }
+    }
+
+    try {
+        ValidateGraphSpec(spec);
+    } catch (const std::runtime_error& error) {
+        throw std::runtime_error("Graph " + path + ": " + error.what());
+    }
+    return spec;
+}
+
+template <class Sample>
+struct CPipelineGraph<Sample>::Impl {
+    Impl(const int deviceNumber, const GraphSpec& spec, const double rate);
+
+    ~Impl() {
+        LOG_FUNC();
+
+        Stop();
+        for (auto& worker : mWorkers) {
+            worker.get();
+        }
+    }
+
+    void Stop() {
+        mQueue.StopQueue();
+        mStopped = true;
+        mWake.notify_all();
+    }
+
+    void Worker(const size_t index);
+    bool RunNode(NodeSlot<Sample>& slot);
+
+    data_queue::BlockQueue<Sample> mQueue;
+    const int mDeviceNumber;
+    const size_t mThreads;
+    // sources first, then every node after its input
+    std::vector<std::unique_ptr<NodeSlot<Sample>>> mNodes;
+    std::vector<std::unique_ptr<CEdge<Sample>>> mEdges;
+    latency_tracer::CLatencyTracer mLatencyTracer;
+    std::mutex mTracerLock;
+    std::atomic<bool> mStopped{false};
+    // counts the passes that did work, idle workers wait for a change
+    std::atomic<std::uint64_t> mEpoch{0u};
+    std::mutex mWakeLock;
+    std::condition_variable mWake;
+    std::vector<std::future<void>> mWorkers;
+};
+
+template <class Sample>
+CPipelineGraph<Sample>::Impl::Impl(const int deviceNumber,
+                                   const GraphSpec& spec,
+                                   const double rate)
+    : mDeviceNumber(deviceNumber), mThreads(spec.threads) {
+    ValidateGraphSpec(spec);
+    const auto device = std::to_string(deviceNumber);
+
+    std::map<std::string, std::string> inputs;
+    for (const auto& edge : spec.edges) {
+        inputs[edge.to] = edge.from;
+    }
+
+    // breadth first from the sources, a worker pass then carries a packet
+    // through several nodes
+    std::map<std::string, NodeSlot<Sample>*> created;
+    bool hasDevice(false);
+    while (created.size() < spec.nodes.size()) {
+        for (const auto& node : spec.nodes) {
+            if (created.count(node.name) != 0u) {
+                continue;
+            }
+            const auto input = inputs.find(node.name);
+            if (inputs.end() != input && 0u == created.count(input->second)) {
+                continue;
+            }
+
+            mNodes.push_back(std::make_unique<NodeSlot<Sample>>(
+                node.name,
+                graph_nodes::CreateNode<Sample>(
+                    node, deviceNumber, rate, mQueue),
+                device));
+            auto* slot = mNodes.back().get();
+            created[node.name] = slot;
+            hasDevice = hasDevice || "device" == node.kind;
+
+            if (inputs.end() != input) {
+                mEdges.push_back(
+                    std::make_unique<CEdge<Sample>>(spec.capacity));
+                slot->mInput = mEdges.back().get();
+                created[input->second]->mOutputs.push_back(slot->mInput);
+            }
+        }
+    }
+
+    if (not hasDevice) {
+        // nothing reads the RX stream, stopping the queue ends it
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "Graph %d has no device node, the RX stream stops",
+                       deviceNumber);
+        mQueue.StopQueue();
+    }
+}
+
+template <class Sample>
+bool CPipelineGraph<Sample>::Impl::RunNode(NodeSlot<Sample>& slot) {
+    // backpressure: a node waits until all its consumers have room
+    for (const auto* output : slot.mOutputs) {
+        if (output->Full()) {
+            if (not slot.mStalled) {
+                slot.mStalled = true;
+                slot.mStalls.Add();
+            }
+            return false;
+        }
+    }
+    slot.mStalled = false;
+
+    graph_nodes::PacketPtr<Sample> input;
+    if (nullptr != slot.mInput && not slot.mInput->Pop(input)) {
+        return false;
+    }
+
+    const auto start = Clock::now();
+    graph_nodes::PacketPtr<Sample> output;
+    {
+        allocation_tracker::CStageScope stage(slot.mName.c_str());
+        output = slot.mNode->Process(input);
+    }
+    if (not input && not output) {
+        // an idle source
+        return false;
+    }
+    slot.mTime.Observe(ElapsedNs(start));
+    slot.mPackets.Add();
+
+    // a transform passing nothing on, e.g. a detector below its threshold
+    if (output) {
+        for (auto* edge : slot.mOutputs) {
+            edge->Push(output);
+        }
+    }
+
+    // the first sink a sampled block reaches ends its latency trace, a
+    // source has no input to trace
+    if (slot.mOutputs.empty() && input && input->traced &&
+        not input->traced->exchange(true)) {
+        auto stamps = input->stamps;
+        stamps.processEnd = latency_tracer::NowNs();
+        std::lock_guard lock(mTracerLock);
+        mLatencyTracer.Record(stamps);
+    }
+    return true;
+}
+
+template <class Sample>
+void CPipelineGraph<Sample>::Impl::Worker(const size_t index) {
+    LOG_FUNC();
+
+    thread_placement::ApplyCurrentThread(
+        thread_placement::ThreadRole::Dsp,
+        "kraken-g" + std::to_string(mDeviceNumber) + "-" +
+            std::to_string(index));
+
+    const auto count = mNodes.size();
+    while (not mStopped) {
+        const auto epoch = mEpoch.load();
+        bool worked(false);
+        for (size_t i = 0; i < count; ++i) {
+            // workers start at different nodes so they spread over the
+            // graph, a node taken by another worker is skipped
+            auto& slot = *mNodes[(index + i) % count];
+            if (slot.mBusy.test_and_set(std::memory_order_acquire)) {
+                continue;
+            }
+            worked = RunNode(slot) || worked;
+            slot.mBusy.clear(std::memory_order_release);
+        }
+
+        if (worked) {
+            ++mEpoch;
+            mWake.notify_all();
+            continue;
+        }
+
+        std::unique_lock lock(mWakeLock);
+        mWake.wait_for(lock, kIdleWait, [&]() {
+            return mStopped || epoch != mEpoch.load();
+        });
+    }
+}
+
+template <class Sample>
+CPipelineGraph<Sample>::CPipelineGraph(const int deviceNumber,
+                                       const GraphSpec& spec,
+                                       const double sampleRate)
+    : mImpl(std::make_unique<CPipelineGraph<Sample>::Impl>(
+          deviceNumber, spec, sampleRate)) {
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Graph %d: %zu nodes, %zu edges, %zu threads",
+                   deviceNumber,
+                   mImpl->mNodes.size(),
+                   mImpl->mEdges.size(),
+                   mImpl->mThreads);
+}
+
+template <class Sample>
+CPipelineGraph<Sample>::~CPipelineGraph() = default;
+
+template <class Sample>
+void CPipelineGraph<Sample>::StartHandling() const {
+    LOG_FUNC();
+
+    for (size_t index = 0; index < mImpl->mThreads; ++index) {
+        mImpl->mWorkers.push_back(
+            std::async(std::launch::async,
+                       &CPipelineGraph<Sample>::Impl::Worker,
+                       mImpl.get(),
+                       index));
+    }
+}
+
+template <class Sample>
+void CPipelineGraph<Sample>::StopQueue() const {
+    mImpl->Stop();
+}
+
+template <class Sample>
+size_t CPipelineGraph<Sample>::GetQueueSize() const {
+    return mImpl->mQueue.Size();
+}
+
+template <class Sample>
+latency_tracer::CLatencyTracer& CPipelineGraph<Sample>::GetLatencyTracer()
+    const {
+    return mImpl->mLatencyTracer;
+}
+
+template <class Sample>
+bool CPipelineGraph<Sample>::TriggerCapture() const {
+    return false;
+}
+
+template <class Sample>
+bool CPipelineGraph<Sample>::SetZoomBand(const double, const double) const {
+    return false;
+}
+
+template <class Sample>
+void CPipelineGraph<Sample>::SetTunedFrequency(const double frequency) const {
+    for (auto& slot : mImpl->mNodes) {
+        slot->mNode->SetTunedFrequency(frequency);
+    }
+}
+
+template <class Sample>
+data_queue::BlockQueue<Sample>& CPipelineGraph<Sample>::GetQueue() const {
+    return mImpl->mQueue;
+}
+
+template class CPipelineGraph<sample_types::CS8>;
+template class CPipelineGraph<sample_types::CU8>;
+template class CPipelineGraph<sample_types::CS16>;
+template class CPipelineGraph<sample_types::CF32>;
+
+}  // namespace pipeline_graph
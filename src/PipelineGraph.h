@@ -0,0 +1,158 @@
+#ifndef __PIPELINE_GRAPH_H__
+#define __PIPELINE_GRAPH_H__
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DataHandler.h"
+#include "DataQueue.h"
+#include "LatencyTracer.h"
+
+namespace pipeline_graph {
+/**
+ * @brief Payload types of the graph edges
+ */
+enum class PortType {
+    // no port: the input of a source, the output of a sink
+    None,
+    // blocks of interleaved components in the stream format
+    Raw,
+    // complex float samples
+    Complex,
+    // dB spectra in the FFT order
+    Spectrum,
+    // self-describing packets of the active segments, back to back
+    Burst,
+    // input of the sinks that take every payload
+    Any
+};
+
+struct NodeSpec {
+    std::string name;
+    // device, replay, generator, convert, ddc, fir, fft, detector, burst,
+    // recorder, network, shm, waterfall or traces
+    std::string kind;
+    // key=value settings of the node, "{device}" in a value is replaced
+    // by the device number
+    std::map<std::string, std::string> params;
+};
+
+struct EdgeSpec {
+    std::string from;
+    std::string to;
+};
+
+struct GraphSpec {
+    std::vector<NodeSpec> nodes;
+    std::vector<EdgeSpec> edges;
+    // worker threads running all the nodes of a device
+    size_t threads{2u};
+    // packets an edge holds before its producer is held back
+    size_t capacity{8u};
+};
+
+/**
+ * @brief Reads and validates a graph file, throws std::runtime_error
+ * naming the line or node at fault.
+ *
+ * One statement per line, '#' starts a comment:
+ *   threads <n>
+ *   capacity <packets>
+ *   node <name> <kind> [key=value ...]
+ *   edge <from> <to> [<to> ...]
+ * A node has at most one input edge and fans out to any number of
+ * outputs, the payload types of an edge must match, every node must be
+ * fed by a source and every source must feed a node.
+ */
+GraphSpec LoadGraphSpec(const std::string& path);
+
+/**
+ * @brief Checks node kinds, names, edges and payload types, throws
+ * std::runtime_error on the first fault
+ */
+void ValidateGraphSpec(const GraphSpec& spec);
+
+/**
+ * @brief Dataflow graph of one device, a configurable replacement of
+ * CDataHandler.
+ *
+ * Sources produce packets, transforms turn one packet into at most one
+ * and sinks consume them. Packets are shared read-only between the
+ * outputs of a node, a fan out copies no samples. Every edge is a bounded
+ * queue and a node runs only while all its output edges have room, so a
+ * slow consumer holds back its producers up to the device source. The
+ * USB reader never blocks: its blocks wait in the device queue.
+ *
+ * A fixed number of workers runs the nodes, a node runs on one worker at
+ * a time so its state needs no locking and its packets keep their order.
+ * @tparam Sample stream element type from SampleTypes.h, instantiated for
+ * CS8, CU8, CS16 and CF32
+ */
+template <class Sample>
+class CPipelineGraph : public data_handler::IDataHandler {
+   public:
+    /**
+     * @brief Builds the nodes, throws std::runtime_error if the spec is
+     * invalid or a node can't open its file, socket or shared memory
+     * @param deviceNumber number device, labels metrics and threads
+     * @param spec validated graph
+     * @param sampleRate stream sample rate, paces the generator and replay
+     * sources and scales the DDC offset
+     */
+    CPipelineGraph(const int deviceNumber,
+                   const GraphSpec& spec,
+                   const double sampleRate);
+    CPipelineGraph(const CPipelineGraph&) = delete;
+    CPipelineGraph& operator=(const CPipelineGraph&) = delete;
+    ~CPipelineGraph() override;
+
+    /**
+     * @brief Starts the workers
+     */
+    void StartHandling() const override;
+
+    /**
+     * @brief Stops the device queue and the workers
+     */
+    void StopQueue() const override;
+
+    /**
+     * @brief Returns the number of blocks waiting in the device queue
+     */
+    size_t GetQueueSize() const override;
+
+    latency_tracer::CLatencyTracer& GetLatencyTracer() const override;
+
+    /**
+     * @brief The graph records with its recorder nodes
+     * @return false
+     */
+    bool TriggerCapture() const override;
+
+    /**
+     * @brief The graph has no zoom, a narrow band is a ddc and fft node
+     * @return false
+     */
+    bool SetZoomBand(const double center, const double span) const override;
+
+    /**
+     * @brief Passes a retune of the device to the nodes, the burst nodes
+     * label their packets with it
+     */
+    void SetTunedFrequency(const double frequency) const override;
+
+    /**
+     * @brief Returns the queue the RX stream feeds the device source with
+     */
+    data_queue::BlockQueue<Sample>& GetQueue() const;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace pipeline_graph
+
+#endif  // __PIPELINE_GRAPH_H__
@@ -0,0 +1,93 @@
+#include "PsdEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <kfr/base.hpp>
+#include <kfr/dft.hpp>
+
+namespace psd_estimator {
+namespace {
+constexpr auto kPowerFloor = 1e-20;
+}  // namespace
+
+struct CPsdEstimator::Impl {
+    explicit Impl(const size_t fftSize)
+        : mPlan(fftSize)
+        , mWindow(fftSize)
+        , mIn(fftSize)
+        , mOut(fftSize)
+        , mTemp(mPlan.temp_size)
+        , mAccum(fftSize, 0.0) {
+        double windowSum(0.0);
+        for (size_t i = 0; i < fftSize; ++i) {
+            mWindow[i] = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / fftSize);
+            windowSum += mWindow[i];
+        }
+        // normalise to the coherent gain so a full scale tone reads 0 dB
+        mScale = 1.0 / (windowSum * windowSum);
+    }
+
+    const kfr::dft_plan<kfr::fbase> mPlan;
+    kfr::univector<kfr::fbase> mWindow;
+    kfr::univector<kfr::complex<kfr::fbase>> mIn;
+    kfr::univector<kfr::complex<kfr::fbase>> mOut;
+    kfr::univector<kfr::u8> mTemp;
+    std::vector<double> mAccum;
+    double mScale{1.0};
+    size_t mFrames{0u};
+};
+
+CPsdEstimator::CPsdEstimator(const size_t fftSize)
+    : mImpl(std::make_unique<CPsdEstimator::Impl>(fftSize)) {}
+
+CPsdEstimator::CPsdEstimator(CPsdEstimator&&) = default;
+
+CPsdEstimator::~CPsdEstimator() = default;
+
+size_t CPsdEstimator::GetFftSize() const {
+    return mImpl->mAccum.size();
+}
+
+size_t CPsdEstimator::GetFrameCount() const {
+    return mImpl->mFrames;
+}
+
+void CPsdEstimator::Accumulate(const std::complex<float>* frame) {
+    auto& impl = *mImpl;
+    const auto size = impl.mAccum.size();
+
+    for (size_t i = 0; i < size; ++i) {
+        impl.mIn[i] =
+            kfr::complex<kfr::fbase>(frame[i].real() * impl.mWindow[i],
+                                     frame[i].imag() * impl.mWindow[i]);
+    }
+
+    impl.mPlan.execute(impl.mOut, impl.mIn, impl.mTemp);
+
+    for (size_t i = 0; i < size; ++i) {
+        const double re = impl.mOut[i].real();
+        const double im = impl.mOut[i].imag();
+        impl.mAccum[i] += re * re + im * im;
+    }
+
+    ++impl.mFrames;
+}
+
+void CPsdEstimator::GetPowerDb(std::vector<float>& powerDb) const {
+    const auto& impl = *mImpl;
+    const auto size = impl.mAccum.size();
+    const auto scale = 0u != impl.mFrames ? impl.mScale / impl.mFrames : 0.0;
+
+    powerDb.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        powerDb[(i + size / 2) % size] = static_cast<float>(
+            10.0 * std::log10(impl.mAccum[i] * scale + kPowerFloor));
+    }
+}
+
+void CPsdEstimator::Reset() {
+    std::fill(mImpl->mAccum.begin(), mImpl->mAccum.end(), 0.0);
+    mImpl->mFrames = 0u;
+}
+
+}  // namespace psd_estimator
@@ -0,0 +1,63 @@
+#ifndef __PSD_ESTIMATOR_H__
+#define __PSD_ESTIMATOR_H__
+
+#include <complex>
+#include <memory>
+#include <vector>
+
+namespace psd_estimator {
+class CPsdEstimator {
+   public:
+    /**
+     * @brief ctor
+     * @param fftSize number of points of the transform, any positive value
+     */
+    explicit CPsdEstimator(const size_t fftSize);
+
+    /**
+     * @brief Move ctor
+     */
+    CPsdEstimator(CPsdEstimator&&);
+
+    /**
+     * @brief dtor
+     */
+    ~CPsdEstimator();
+
+    /**
+     * @brief Returns the number of points of the transform
+     */
+    size_t GetFftSize() const;
+
+    /**
+     * @brief Returns the number of frames averaged since the last Reset
+     */
+    size_t GetFrameCount() const;
+
+    /**
+     * @brief Windows (Hann) and transforms one frame, adds its power
+     * to the running average
+     * @param frame pointer to exactly GetFftSize() complex samples
+     */
+    void Accumulate(const std::complex<float>* frame);
+
+    /**
+     * @brief Returns the averaged power spectrum in dB, DC in the middle
+     * (bin i corresponds to (i - fftSize / 2) * sampleRate / fftSize)
+     * @param powerDb receives GetFftSize() values
+     */
+    void GetPowerDb(std::vector<float>& powerDb) const;
+
+    /**
+     * @brief Drops all accumulated frames
+     */
+    void Reset();
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace psd_estimator
+
+#endif  // __PSD_ESTIMATOR_H__
@@ -0,0 +1,246 @@
+#include "ResultLog.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "DspKernels.h"
+
+namespace result_log {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+std::int64_t NowUnixNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// the spectra since the last console summary
+struct Summary {
+    size_t spectra{0u};
+    float maxDb{0.0f};
+    float minDb{0.0f};
+    double meanDb{0.0};
+    double rmsDb{0.0};
+    std::uint64_t detections{0u};
+};
+}  // namespace
+
+struct CResultLog::Impl {
+    Impl(const int deviceNumber, const ResultConfig& config)
+        : mDeviceNumber(deviceNumber)
+        , mConfig(config)
+        , mCapacity(std::max<size_t>(1u, config.fileRecords))
+        , mFiles(std::max<size_t>(1u, config.files))
+        , mNextSummary(Clock::now() + config.consoleInterval) {
+        if (config.outputDir.empty()) {
+            return;
+        }
+        char name[48];
+        snprintf(name, sizeof(name), "/results_dev%d", deviceNumber);
+        mBase = config.outputDir + name;
+        // the active file of an earlier run is kept as the first rotated
+        Shift();
+        Open();
+    }
+
+    ~Impl() {
+        Close();
+    }
+
+    std::string PathOf(const size_t index) const {
+        return 0u == index ? mBase + ".bin"
+                           : mBase + "." + std::to_string(index) + ".bin";
+    }
+
+    std::atomic<std::uint64_t>& Count() {
+        return *reinterpret_cast<std::atomic<std::uint64_t>*>(
+            mMap + offsetof(FileHeader, count));
+    }
+
+    void Open();
+    void Close();
+    void Shift();
+    void Summarize();
+
+    const int mDeviceNumber;
+    const ResultConfig mConfig;
+    const size_t mCapacity;
+    const size_t mFiles;
+    // path of the files without the suffix, empty - no files
+    std::string mBase;
+    int mFd{-1};
+    std::uint8_t* mMap{nullptr};
+    size_t mMapSize{0u};
+    // records in the active file
+    std::uint64_t mWritten{0u};
+    std::uint64_t mSequence{0u};
+    Summary mSummary;
+    Clock::time_point mNextSummary;
+};
+
+void CResultLog::Impl::Open() {
+    const auto path = PathOf(0u);
+    mFd = open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (mFd < 0) {
+        SoapySDR::logf(SOAPY_SDR_ERROR,
+                       "Results device #%d: can't open %s: %s",
+                       mDeviceNumber,
+                       path.c_str(),
+                       strerror(errno));
+        return;
+    }
+
+    mMapSize = kHeaderSize + mCapacity * sizeof(ResultRecord);
+    void* base(MAP_FAILED);
+    if (0 == ftruncate(mFd, mMapSize)) {
+        base = mmap(
+            nullptr, mMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    }
+    if (MAP_FAILED == base) {
+        SoapySDR::logf(SOAPY_SDR_ERROR,
+                       "Results device #%d: can't map %s: %s",
+                       mDeviceNumber,
+                       path.c_str(),
+                       strerror(errno));
+        close(mFd);
+        mFd = -1;
+        return;
+    }
+
+    mMap = static_cast<std::uint8_t*>(base);
+    FileHeader header{};
+    header.magic = kMagic;
+    header.recordSize = sizeof(ResultRecord);
+    header.capacity = static_cast<std::uint32_t>(mCapacity);
+    header.device = mDeviceNumber;
+    header.createdNs = NowUnixNs();
+    std::memcpy(mMap, &header, sizeof(header));
+    mWritten = 0u;
+    Count().store(0u, std::memory_order_release);
+}
+
+void CResultLog::Impl::Close() {
+    if (nullptr == mMap) {
+        return;
+    }
+    munmap(mMap, mMapSize);
+    mMap = nullptr;
+
+    // a reader of a rotated file finds no unwritten records
+    if (0 != ftruncate(mFd, kHeaderSize + mWritten * sizeof(ResultRecord))) {
+        SoapySDR::logf(SOAPY_SDR_WARNING,
+                       "Results device #%d: can't cut %s",
+                       mDeviceNumber,
+                       PathOf(0u).c_str());
+    }
+    close(mFd);
+    mFd = -1;
+}
+
+void CResultLog::Impl::Shift() {
+    std::remove(PathOf(mFiles - 1u).c_str());
+    for (auto index = mFiles - 1u; index > 0u; --index) {
+        std::rename(PathOf(index - 1u).c_str(), PathOf(index).c_str());
+    }
+}
+
+void CResultLog::Impl::Summarize() {
+    const auto& summary = mSummary;
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Results device #%d: %zu spectra, max %.1f dB, min "
+                   "%.1f dB, mean %.1f dB, rms %.1f dB, %llu detections",
+                   mDeviceNumber,
+                   summary.spectra,
+                   summary.maxDb,
+                   summary.minDb,
+                   summary.meanDb / summary.spectra,
+                   summary.rmsDb / summary.spectra,
+                   static_cast<unsigned long long>(summary.detections));
+    mSummary = Summary();
+}
+
+CResultLog::CResultLog(const int deviceNumber, const ResultConfig& config)
+    : mImpl(std::make_unique<CResultLog::Impl>(deviceNumber, config)) {
+    if (not config.outputDir.empty()) {
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "Results device #%d: %s.bin, %zu records per file, "
+                       "%zu files",
+                       deviceNumber,
+                       mImpl->mBase.c_str(),
+                       mImpl->mCapacity,
+                       mImpl->mFiles);
+    }
+}
+
+CResultLog::~CResultLog() = default;
+
+void CResultLog::Add(const dsp_kernels::SpectrumStats& stats,
+                     const float* dB,
+                     const size_t bins,
+                     const long long blockTimeNs) {
+    auto& impl = *mImpl;
+
+    std::uint32_t detections(0u);
+    const auto level = impl.mConfig.levelDb;
+    for (size_t i = 0; i < bins; ++i) {
+        detections += dB[i] >= level;
+    }
+
+    if (nullptr != impl.mMap && impl.mCapacity == impl.mWritten) {
+        impl.Close();
+        impl.Shift();
+        impl.Open();
+    }
+    if (nullptr != impl.mMap) {
+        ResultRecord record{};
+        record.timeNs = NowUnixNs();
+        record.blockTimeNs = blockTimeNs;
+        record.sequence = impl.mSequence;
+        record.device = impl.mDeviceNumber;
+        record.detections = detections;
+        record.maxDb = stats.max;
+        record.minDb = stats.min;
+        record.meanDb = stats.mean;
+        record.rmsDb = stats.rms;
+
+        std::memcpy(
+            impl.mMap + kHeaderSize + impl.mWritten * sizeof(ResultRecord),
+            &record,
+            sizeof(record));
+        impl.Count().store(++impl.mWritten, std::memory_order_release);
+    }
+    ++impl.mSequence;
+
+    if (0 == impl.mConfig.consoleInterval.count()) {
+        return;
+    }
+    auto& summary = impl.mSummary;
+    if (0u == summary.spectra++) {
+        summary.maxDb = stats.max;
+        summary.minDb = stats.min;
+    } else {
+        summary.maxDb = std::max<float>(summary.maxDb, stats.max);
+        summary.minDb = std::min<float>(summary.minDb, stats.min);
+    }
+    summary.meanDb += stats.mean;
+    summary.rmsDb += stats.rms;
+    summary.detections += detections;
+
+    const auto now = Clock::now();
+    if (now >= impl.mNextSummary) {
+        impl.Summarize();
+        impl.mNextSummary = now + impl.mConfig.consoleInterval;
+    }
+}
+
+}  // namespace result_log
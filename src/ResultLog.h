@@ -0,0 +1,117 @@
+#ifndef __RESULT_LOG_H__
+#define __RESULT_LOG_H__
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// the reader tool includes this header and builds without kfr
+namespace dsp_kernels {
+struct SpectrumStats;
+}  // namespace dsp_kernels
+
+namespace result_log {
+// "KRL1", the first bytes of a result file
+constexpr std::uint32_t kMagic = 0x314c524bu;
+constexpr size_t kHeaderSize = 64u;
+
+#pragma pack(push, 1)
+/**
+ * @brief Start of a result file, the records follow at kHeaderSize
+ */
+struct FileHeader {
+    std::uint32_t magic;
+    // bytes of one record, sizeof(ResultRecord)
+    std::uint32_t recordSize;
+    // records the file has room for
+    std::uint32_t capacity;
+    std::int32_t device;
+    // wall clock in ns since the epoch
+    std::int64_t createdNs;
+    // records written, stored after the record so a reader of a live
+    // file never sees a partial one
+    std::uint64_t count;
+};
+
+/**
+ * @brief Result of one spectrum, little-endian
+ */
+struct ResultRecord {
+    // wall clock in ns since the epoch when the spectrum was computed
+    std::int64_t timeNs;
+    // hardware time of the block, 0 if the stream has none
+    std::int64_t blockTimeNs;
+    // number of the spectrum since the handler started
+    std::uint64_t sequence;
+    std::int32_t device;
+    // bins at or above the detection level
+    std::uint32_t detections;
+    float maxDb;
+    float minDb;
+    float meanDb;
+    float rmsDb;
+};
+#pragma pack(pop)
+
+struct ResultConfig {
+    // directory of the result files, empty - none written
+    std::string outputDir;
+    // records per file, the full file is rotated
+    size_t fileRecords{1u << 20};
+    // files kept, the active one included
+    size_t files{4u};
+    // a bin at or above this counts as a detection
+    float levelDb{-40.0f};
+    // the console summary is logged this often, 0 - never
+    std::chrono::milliseconds consoleInterval{1000};
+};
+
+/**
+ * @brief Sink of the per spectrum results of one device, in place of
+ * printing every spectrum: records go to a memory mapped file of
+ * fixed-size ResultRecord and a summary of the interval goes to the log
+ * at most every consoleInterval. Appending a record is a copy into the
+ * mapping, no system call.
+ *
+ * The active file is <outputDir>/results_dev<N>.bin, sized for
+ * fileRecords up front. A full file is cut to its records and renamed to
+ * results_dev<N>.1.bin, the older ones move up one number and the oldest
+ * beyond files is deleted.
+ */
+class CResultLog {
+   public:
+    /**
+     * @param deviceNumber number device, names the files
+     * @param config files, detection level and console interval
+     */
+    CResultLog(const int deviceNumber, const ResultConfig& config);
+    CResultLog(const CResultLog&) = delete;
+    CResultLog& operator=(const CResultLog&) = delete;
+
+    /**
+     * @brief Cuts the active file to its records
+     */
+    ~CResultLog();
+
+    /**
+     * @brief Records the result of a spectrum, logs the summary when the
+     * interval passed. Called by the DSP thread only.
+     * @param stats max, min, mean and rms of the spectrum
+     * @param dB the spectrum, its detections are counted
+     * @param bins values in dB
+     * @param blockTimeNs hardware time of the block, 0 if none
+     */
+    void Add(const dsp_kernels::SpectrumStats& stats,
+             const float* dB,
+             const size_t bins,
+             const long long blockTimeNs);
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace result_log
+
+#endif  // __RESULT_LOG_H__
@@ -0,0 +1,68 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "ResultLog.h"
+
+namespace {
+bool Export(const char* path) {
+    auto file = fopen(path, "rb");
+    if (nullptr == file) {
+        fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    result_log::FileHeader header{};
+    if (1u != fread(&header, sizeof(header), 1u, file) ||
+        result_log::kMagic != header.magic ||
+        sizeof(result_log::ResultRecord) != header.recordSize) {
+        fprintf(stderr, "%s is not a result file\n", path);
+        fclose(file);
+        return false;
+    }
+
+    // a rotated file is cut to its records, a live one stops at the count
+    fseek(file, result_log::kHeaderSize, SEEK_SET);
+    result_log::ResultRecord record{};
+    for (std::uint64_t index = 0u;
+         index < header.count &&
+         1u == fread(&record, sizeof(record), 1u, file);
+         ++index) {
+        printf("%lld,%lld,%llu,%d,%u,%.2f,%.2f,%.2f,%.2f\n",
+               static_cast<long long>(record.timeNs),
+               static_cast<long long>(record.blockTimeNs),
+               static_cast<unsigned long long>(record.sequence),
+               record.device,
+               record.detections,
+               record.maxDb,
+               record.minDb,
+               record.meanDb,
+               record.rmsDb);
+    }
+    fclose(file);
+    return true;
+}
+}  // namespace
+
+/**
+ * @brief Exports result files of result_log::CResultLog as CSV to stdout,
+ * of a file still being appended to the records written so far:
+ *   <name>Results <results_dev0.bin> [<results_dev0.1.bin> ...]
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <results.bin> [<results.bin> ...]\n",
+                argv[0]);
+        return 1;
+    }
+
+    printf("time_ns,block_time_ns,sequence,device,detections,max_db,min_db,"
+           "mean_db,rms_db\n");
+    auto status = 0;
+    for (auto index = 1; index < argc; ++index) {
+        if (not Export(argv[index])) {
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,66 @@
+#ifndef __SAMPLE_TYPES_H__
+#define __SAMPLE_TYPES_H__
+
+#include <SoapySDR/Formats.h>
+
+#include <cstdint>
+#include <string>
+
+namespace sample_types {
+/**
+ * @brief Stream element types, one interleaved I/Q pair per sample.
+ * kFullScale maps the components to the -1.0 .. 1.0 range, kOffset is
+ * the component value of zero (offset binary for CU8).
+ */
+struct CS8 {
+    using Component = std::int8_t;
+    static constexpr const char* kFormat = SOAPY_SDR_CS8;
+    static constexpr float kFullScale = 128.0f;
+    static constexpr float kOffset = 0.0f;
+};
+
+struct CU8 {
+    using Component = std::uint8_t;
+    static constexpr const char* kFormat = SOAPY_SDR_CU8;
+    static constexpr float kFullScale = 127.5f;
+    static constexpr float kOffset = 127.5f;
+};
+
+struct CS16 {
+    using Component = std::int16_t;
+    static constexpr const char* kFormat = SOAPY_SDR_CS16;
+    static constexpr float kFullScale = 32768.0f;
+    static constexpr float kOffset = 0.0f;
+};
+
+struct CF32 {
+    using Component = float;
+    static constexpr const char* kFormat = SOAPY_SDR_CF32;
+    static constexpr float kFullScale = 1.0f;
+    static constexpr float kOffset = 0.0f;
+};
+
+/**
+ * @brief Calls visitor(Sample()) with the sample type of the format,
+ * the only place a format string turns into a type
+ * @return false if the format is not supported, the visitor isn't called
+ */
+template <class Visitor>
+bool DispatchFormat(const std::string& format, Visitor&& visitor) {
+    if (CS8::kFormat == format) {
+        visitor(CS8());
+    } else if (CU8::kFormat == format) {
+        visitor(CU8());
+    } else if (CS16::kFormat == format) {
+        visitor(CS16());
+    } else if (CF32::kFormat == format) {
+        visitor(CF32());
+    } else {
+        return false;
+    }
+    return true;
+}
+
+}  // namespace sample_types
+
+#endif  // __SAMPLE_TYPES_H__
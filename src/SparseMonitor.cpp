@@ -0,0 +1,363 @@
+#include "SparseMonitor.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+
+#include "Metrics.h"
+
+namespace sparse_monitor {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr double kPi = 3.14159265358979323846;
+// frequencies further from the center than this part of the sample rate
+// are in the roll-off of the tuner filters and aren't watched
+constexpr double kUsableHalfBand = 0.45;
+constexpr double kPowerFloor = 1e-20;
+
+std::int64_t NowUnixNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+FILE* OpenOutput(const std::string& path, const int deviceNumber) {
+    auto file = fopen(path.c_str(), "w");
+    if (nullptr == file) {
+        SoapySDR::logf(SOAPY_SDR_ERROR,
+                       "Monitor device #%d: can't open %s",
+                       deviceNumber,
+                       path.c_str());
+    }
+    return file;
+}
+}  // namespace
+
+bool ParseFrequencies(const std::string& text,
+                      std::vector<double>& frequencies) {
+    frequencies.clear();
+
+    std::string values;
+    std::ifstream file(text);
+    if (file) {
+        std::string line;
+        while (std::getline(file, line)) {
+            values += line.substr(0, line.find('#')) + ' ';
+        }
+    } else {
+        values = text;
+    }
+    std::replace(values.begin(), values.end(), ',', ' ');
+
+    std::istringstream stream(values);
+    std::string item;
+    while (stream >> item) {
+        try {
+            size_t used(0u);
+            frequencies.push_back(std::stod(item, &used));
+            if (used != item.size()) {
+                return false;
+            }
+        } catch (const std::logic_error&) {
+            return false;
+        }
+    }
+
+    return not frequencies.empty();
+}
+
+struct CSparseMonitor::Impl {
+    Impl(const int deviceNumber, const MonitorConfig& config);
+    ~Impl();
+
+    void TakePending();
+    void Configure(const double tuned);
+    void Finish();
+
+    const int mDeviceNumber;
+    const MonitorConfig mConfig;
+    const Clock::duration mPeriod;
+    // Hann window, applied to the samples once for all filters
+    std::vector<double> mWindow;
+    double mScale{1.0};
+
+    // per watched frequency inside the stream, structure of arrays so the
+    // loop over them vectorises
+    std::vector<size_t> mIndex;
+    std::vector<double> mCoefficient;
+    std::vector<double> mCos;
+    std::vector<double> mSin;
+    std::vector<double> mS1Re;
+    std::vector<double> mS1Im;
+    std::vector<double> mS2Re;
+    std::vector<double> mS2Im;
+
+    // per configured frequency
+    std::vector<float> mPowerDb;
+    std::vector<bool> mActive;
+
+    bool mRunning{false};
+    size_t mFilled{0u};
+    Clock::time_point mNextStart;
+    std::string mLine;
+    FILE* mSeries{nullptr};
+    FILE* mEvents{nullptr};
+
+    // set by SetTunedFrequency, taken before an evaluation starts
+    std::mutex mPendingLock;
+    double mRequestedTuning{0.0};
+    std::atomic<bool> mHasPending{false};
+
+    metrics::CCounter& mEventCount;
+    metrics::CGauge& mActiveCount;
+};
+
+CSparseMonitor::Impl::Impl(const int deviceNumber,
+                           const MonitorConfig& config)
+    : mDeviceNumber(deviceNumber)
+    , mConfig(config)
+    , mPeriod(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(1.0 / std::max(config.rate, 1e-3))))
+    , mWindow(std::max<size_t>(1u, config.window))
+    , mPowerDb(config.frequencies.size(), 0.0f)
+    , mActive(config.frequencies.size(), false)
+    , mEventCount(metrics::CMetricsRegistry::Instance().GetCounter(
+          "kraken_monitor_events_total",
+          "Monitored frequencies turning active or idle",
+          {{"device", std::to_string(deviceNumber)}}))
+    , mActiveCount(metrics::CMetricsRegistry::Instance().GetGauge(
+          "kraken_monitor_active",
+          "Monitored frequencies above the threshold",
+          {{"device", std::to_string(deviceNumber)}})) {
+    double windowSum(0.0);
+    for (size_t i = 0; i < mWindow.size(); ++i) {
+        mWindow[i] = 0.5 - 0.5 * std::cos(2.0 * kPi * i / mWindow.size());
+        windowSum += mWindow[i];
+    }
+    // normalise to the coherent gain so a full scale tone reads 0 dB
+    mScale = 1.0 / (windowSum * windowSum);
+
+    // the benchmark runs the filters without files
+    if (mConfig.outputDir.empty()) {
+        Configure(config.tunedFrequency);
+        return;
+    }
+
+    const auto device = std::to_string(deviceNumber);
+    mSeries = OpenOutput(
+        mConfig.outputDir + "/monitor_dev" + device + ".csv", deviceNumber);
+    mEvents = OpenOutput(
+        mConfig.outputDir + "/monitor_events_dev" + device + ".csv",
+        deviceNumber);
+    if (nullptr != mSeries) {
+        fprintf(mSeries, "time_ns");
+        for (const auto frequency : mConfig.frequencies) {
+            fprintf(mSeries, ",%.0f", frequency);
+        }
+        fprintf(mSeries, "\n");
+        fflush(mSeries);
+    }
+    if (nullptr != mEvents) {
+        fprintf(mEvents, "time_ns,frequency_hz,event,power_db\n");
+        fflush(mEvents);
+    }
+
+    Configure(config.tunedFrequency);
+}
+
+CSparseMonitor::Impl::~Impl() {
+    if (nullptr != mSeries) {
+        fclose(mSeries);
+    }
+    if (nullptr != mEvents) {
+        fclose(mEvents);
+    }
+}
+
+void CSparseMonitor::Impl::TakePending() {
+    if (not mHasPending.exchange(false, std::memory_order_acquire)) {
+        return;
+    }
+
+    double tuned(0.0);
+    {
+        std::lock_guard lock(mPendingLock);
+        tuned = mRequestedTuning;
+    }
+    Configure(tuned);
+}
+
+void CSparseMonitor::Impl::Configure(const double tuned) {
+    mIndex.clear();
+    mCoefficient.clear();
+    mCos.clear();
+    mSin.clear();
+
+    const auto sampleRate = mConfig.sampleRate;
+    const auto& frequencies = mConfig.frequencies;
+    for (size_t i = 0; i < frequencies.size(); ++i) {
+        const auto offset = frequencies[i] - tuned;
+        if (sampleRate <= 0.0 ||
+            std::abs(offset) > kUsableHalfBand * sampleRate) {
+            continue;
+        }
+        const auto omega = 2.0 * kPi * offset / sampleRate;
+        mIndex.push_back(i);
+        mCoefficient.push_back(2.0 * std::cos(omega));
+        mCos.push_back(std::cos(omega));
+        mSin.push_back(std::sin(omega));
+    }
+    mS1Re.assign(mIndex.size(), 0.0);
+    mS1Im.assign(mIndex.size(), 0.0);
+    mS2Re.assign(mIndex.size(), 0.0);
+    mS2Im.assign(mIndex.size(), 0.0);
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Monitor device #%d: %zu of %zu frequencies inside the "
+                   "stream at %.0f Hz, %.4g Hz bins",
+                   mDeviceNumber,
+                   mIndex.size(),
+                   frequencies.size(),
+                   tuned,
+                   sampleRate / mWindow.size());
+}
+
+void CSparseMonitor::Impl::Finish() {
+    mRunning = false;
+    const auto timeNs = NowUnixNs();
+
+    // the outputs are skipped while a frequency is outside the stream
+    std::fill(mPowerDb.begin(),
+              mPowerDb.end(),
+              std::numeric_limits<float>::quiet_NaN());
+    for (size_t k = 0; k < mIndex.size(); ++k) {
+        // y = s1 - e^(-jw) s2, the DFT of the window at w
+        const auto re = mS1Re[k] - mCos[k] * mS2Re[k] - mSin[k] * mS2Im[k];
+        const auto im = mS1Im[k] - mCos[k] * mS2Im[k] + mSin[k] * mS2Re[k];
+        mPowerDb[mIndex[k]] = static_cast<float>(
+            10.0 * std::log10((re * re + im * im) * mScale + kPowerFloor));
+    }
+
+    char value[32];
+    snprintf(value, sizeof(value), "%lld", static_cast<long long>(timeNs));
+    mLine.assign(value);
+    std::int64_t active(0);
+    for (size_t i = 0; i < mPowerDb.size(); ++i) {
+        const auto power = mPowerDb[i];
+        if (std::isnan(power)) {
+            mLine += ',';
+            active += mActive[i] ? 1 : 0;
+            continue;
+        }
+        snprintf(value, sizeof(value), ",%.2f", power);
+        mLine += value;
+
+        const auto on = mActive[i] ? power >= mConfig.thresholdDb -
+                                                  mConfig.hysteresisDb
+                                   : power >= mConfig.thresholdDb;
+        active += on ? 1 : 0;
+        if (on == mActive[i]) {
+            continue;
+        }
+        mActive[i] = on;
+        mEventCount.Add();
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "Monitor device #%d: %.0f Hz %s at %.1f dB",
+                       mDeviceNumber,
+                       mConfig.frequencies[i],
+                       on ? "on" : "off",
+                       power);
+        if (nullptr != mEvents) {
+            fprintf(mEvents,
+                    "%lld,%.0f,%s,%.2f\n",
+                    static_cast<long long>(timeNs),
+                    mConfig.frequencies[i],
+                    on ? "on" : "off",
+                    power);
+            fflush(mEvents);
+        }
+    }
+    mActiveCount.Set(active);
+
+    if (nullptr != mSeries) {
+        mLine += '\n';
+        fwrite(mLine.data(), 1u, mLine.size(), mSeries);
+        fflush(mSeries);
+    }
+}
+
+CSparseMonitor::CSparseMonitor(const int deviceNumber,
+                               const MonitorConfig& config)
+    : mImpl(std::make_unique<CSparseMonitor::Impl>(deviceNumber, config)) {}
+
+CSparseMonitor::~CSparseMonitor() = default;
+
+void CSparseMonitor::SetTunedFrequency(const double frequency) {
+    std::lock_guard lock(mImpl->mPendingLock);
+    mImpl->mRequestedTuning = frequency;
+    mImpl->mHasPending.store(true, std::memory_order_release);
+}
+
+void CSparseMonitor::AddSamples(const dsp_kernels::Complex* in,
+                                const size_t count) {
+    auto& impl = *mImpl;
+    size_t used(0u);
+    while (used < count) {
+        if (not impl.mRunning) {
+            const auto now = Clock::now();
+            if (now < impl.mNextStart) {
+                return;
+            }
+            // a late start doesn't make the following ones hurry
+            impl.mNextStart = std::max(impl.mNextStart + impl.mPeriod,
+                                       now + impl.mPeriod / 2);
+            impl.TakePending();
+            std::fill(impl.mS1Re.begin(), impl.mS1Re.end(), 0.0);
+            std::fill(impl.mS1Im.begin(), impl.mS1Im.end(), 0.0);
+            std::fill(impl.mS2Re.begin(), impl.mS2Re.end(), 0.0);
+            std::fill(impl.mS2Im.begin(), impl.mS2Im.end(), 0.0);
+            impl.mFilled = 0u;
+            impl.mRunning = true;
+        }
+
+        const auto samples =
+            std::min(count - used, impl.mWindow.size() - impl.mFilled);
+        const auto filters = impl.mIndex.size();
+        const auto* __restrict coefficient = impl.mCoefficient.data();
+        auto* __restrict s1Re = impl.mS1Re.data();
+        auto* __restrict s1Im = impl.mS1Im.data();
+        auto* __restrict s2Re = impl.mS2Re.data();
+        auto* __restrict s2Im = impl.mS2Im.data();
+        const auto* window = impl.mWindow.data() + impl.mFilled;
+        for (size_t i = 0; i < samples; ++i) {
+            const auto& sample = in[used + i];
+            const double re = sample.real() * window[i];
+            const double im = sample.imag() * window[i];
+            // s0 = x + 2 cos(w) s1 - s2 of every filter
+            for (size_t k = 0; k < filters; ++k) {
+                const auto nextRe = re + coefficient[k] * s1Re[k] - s2Re[k];
+                const auto nextIm = im + coefficient[k] * s1Im[k] - s2Im[k];
+                s2Re[k] = s1Re[k];
+                s2Im[k] = s1Im[k];
+                s1Re[k] = nextRe;
+                s1Im[k] = nextIm;
+            }
+        }
+        used += samples;
+        impl.mFilled += samples;
+
+        if (impl.mWindow.size() == impl.mFilled) {
+            impl.Finish();
+        }
+    }
+}
+
+}  // namespace sparse_monitor
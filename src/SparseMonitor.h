@@ -0,0 +1,87 @@
+#ifndef __SPARSE_MONITOR_H__
+#define __SPARSE_MONITOR_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DspKernels.h"
+
+namespace sparse_monitor {
+struct MonitorConfig {
+    // directory of the power series and events, empty - no monitor in a
+    // data handler, no files written by the monitor itself
+    std::string outputDir;
+    // absolute frequencies watched in Hz
+    std::vector<double> frequencies;
+    // samples of every evaluation, the bins are sample rate / window wide
+    size_t window{4096u};
+    // evaluations per second
+    double rate{20.0};
+    // a channel turns active at this power and idle hysteresisDb below
+    float thresholdDb{-40.0f};
+    float hysteresisDb{3.0f};
+    // samples per second of the stream and center frequency the device is
+    // tuned to, set by the stream factory
+    double sampleRate{0.0};
+    double tunedFrequency{0.0};
+};
+
+/**
+ * @brief Reads the frequencies of a file, whitespace or comma separated,
+ * '#' starts a comment, or of a comma separated list if no such file
+ * exists
+ * @return false if there are none or one isn't a number
+ */
+bool ParseFrequencies(const std::string& text,
+                      std::vector<double>& frequencies);
+
+/**
+ * @brief Power of a fixed list of frequencies, rate times per second over
+ * window samples, with one Goertzel filter per frequency. All filters run
+ * in one pass over the samples, the loop over the filters vectorises, so
+ * the cost is window * rate * frequencies and doesn't depend on the FFT
+ * size. A window may span blocks.
+ *
+ * Files of <outputDir>, written as the evaluations complete:
+ *   monitor_dev<N>.csv "time_ns,<frequency>,..." then a power in dB per
+ *     frequency and evaluation, empty while the frequency is outside the
+ *     stream
+ *   monitor_events_dev<N>.csv "time_ns,frequency_hz,event,power_db",
+ *     event "on" when a frequency reaches the threshold, "off" when it
+ *     falls hysteresisDb below
+ * Times are the wall clock in ns since the epoch. The powers read 0 dB
+ * for a full scale tone in the middle of its bin.
+ */
+class CSparseMonitor {
+   public:
+    /**
+     * @param deviceNumber number device, names the files and labels the
+     * metrics
+     * @param config frequencies, timing and output of the monitor
+     */
+    CSparseMonitor(const int deviceNumber, const MonitorConfig& config);
+    CSparseMonitor(const CSparseMonitor&) = delete;
+    CSparseMonitor& operator=(const CSparseMonitor&) = delete;
+    ~CSparseMonitor();
+
+    /**
+     * @brief Tells the monitor about a retune of the device, thread safe,
+     * applied at the next evaluation
+     */
+    void SetTunedFrequency(const double frequency);
+
+    /**
+     * @brief Feeds a block, completes an evaluation when its window is
+     * filled. Called by the DSP thread only.
+     */
+    void AddSamples(const dsp_kernels::Complex* in, const size_t count);
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace sparse_monitor
+
+#endif  // __SPARSE_MONITOR_H__
@@ -0,0 +1,197 @@
+#include "SpectrumReducer.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "DspKernels.h"
+#include "Metrics.h"
+
+namespace spectrum_reducer {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr char kMagic[] = {'K', 'S', 'R', '1'};
+
+template <class Value>
+void Append(std::vector<std::uint8_t>& out, const Value value) {
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+}  // namespace
+
+struct CSpectrumReducer::Impl {
+    Impl(const int deviceNumber, const ReducerConfig& config)
+        : mConfig(config)
+        , mPeriod(std::chrono::duration_cast<Clock::duration>(
+              std::chrono::duration<double>(1.0 / std::max(config.rate, 0.1))))
+        , mEmitted(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_traces_emitted_total",
+              "Reduced spectrum traces written",
+              {{"device", std::to_string(deviceNumber)}})) {
+        mConfig.width = std::max<size_t>(1u, mConfig.width);
+
+        char name[48];
+        snprintf(name, sizeof(name), "/spectrum_dev%d.ksr", deviceNumber);
+        mPath = mConfig.outputDir + name;
+
+        mOutput.reserve(32u + 3u * mConfig.width * sizeof(float));
+    }
+
+    void Prepare(const size_t size);
+    void Emit(const Clock::time_point now);
+    void Decimate(const std::vector<float>& trace, const bool useMax);
+
+    ReducerConfig mConfig;
+    const Clock::duration mPeriod;
+    std::string mPath;
+    // full resolution traces in the display order, lowest frequency first
+    std::vector<float> mMax;
+    std::vector<float> mMin;
+    std::vector<float> mAvg;
+    // first bin of every output column and the end of the last one
+    std::vector<size_t> mBinEdges;
+    std::vector<std::uint8_t> mOutput;
+    size_t mFrames{0u};
+    bool mHoldsValid{false};
+    bool mAvgValid{false};
+    Clock::time_point mNextEmit;
+    Clock::time_point mHoldStart;
+    metrics::CCounter& mEmitted;
+};
+
+void CSpectrumReducer::Impl::Prepare(const size_t size) {
+    if (size == mMax.size()) {
+        return;
+    }
+
+    mMax.resize(size);
+    mMin.resize(size);
+    mAvg.resize(size);
+    mHoldsValid = false;
+    mAvgValid = false;
+    mFrames = 0u;
+
+    const auto width = mConfig.width;
+    mBinEdges.resize(width + 1u);
+    for (size_t column = 0; column <= width; ++column) {
+        mBinEdges[column] = column * size / width;
+    }
+}
+
+void CSpectrumReducer::Impl::Decimate(const std::vector<float>& trace,
+                                      const bool useMax) {
+    for (size_t column = 0; column < mConfig.width; ++column) {
+        const auto begin = mBinEdges[column];
+        // narrower spectra than the width repeat their bins
+        const auto count =
+            std::max<size_t>(1u, mBinEdges[column + 1u] - begin);
+        Append(mOutput,
+               useMax ? dsp_kernels::RangeMax(&trace[begin], count)
+                      : dsp_kernels::RangeMin(&trace[begin], count));
+    }
+}
+
+void CSpectrumReducer::Impl::Emit(const Clock::time_point now) {
+    mOutput.clear();
+    mOutput.insert(mOutput.end(), kMagic, kMagic + sizeof(kMagic));
+    Append(mOutput, static_cast<std::uint32_t>(mConfig.width));
+    Append(mOutput, static_cast<std::uint32_t>(mFrames));
+    Append(mOutput,
+           static_cast<std::int64_t>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count()));
+    Decimate(mMax, true);
+    Decimate(mMin, false);
+    Decimate(mAvg, true);
+
+    // write aside and rename so the UI never reads a partial trace
+    const auto tmpPath = mPath + ".tmp";
+    auto file = fopen(tmpPath.c_str(), "wb");
+    if (nullptr == file) {
+        SoapySDR::logf(
+            SOAPY_SDR_ERROR, "Traces: can't open %s", tmpPath.c_str());
+    } else {
+        fwrite(mOutput.data(), 1u, mOutput.size(), file);
+        fclose(file);
+        std::rename(tmpPath.c_str(), mPath.c_str());
+        mEmitted.Add();
+    }
+
+    // a late frame doesn't shift the schedule, a long stall skips traces
+    mNextEmit = std::max(mNextEmit + mPeriod, now);
+    mFrames = 0u;
+    if (Averaging::Linear == mConfig.averaging) {
+        mAvgValid = false;
+    }
+    if (0 != mConfig.holdTime.count() &&
+        now - mHoldStart >= mConfig.holdTime) {
+        mHoldsValid = false;
+    }
+}
+
+CSpectrumReducer::CSpectrumReducer(const int deviceNumber,
+                                   const ReducerConfig& config)
+    : mImpl(std::make_unique<CSpectrumReducer::Impl>(deviceNumber, config)) {
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Traces: %zu bins at %g Hz, %s average in %s",
+                   mImpl->mConfig.width,
+                   config.rate,
+                   Averaging::Linear == config.averaging ? "linear"
+                                                         : "exponential",
+                   mImpl->mPath.c_str());
+}
+
+CSpectrumReducer::~CSpectrumReducer() = default;
+
+void CSpectrumReducer::AddFrame(const kfr::univector<kfr::fbase>& dB) {
+    auto& impl = *mImpl;
+    const auto size = dB.size();
+    if (0u == size) {
+        return;
+    }
+    impl.Prepare(size);
+
+    // fftshift on the fly: the upper half of the FFT holds the negative
+    // frequencies, it goes first
+    const auto half = size / 2u;
+    const auto offset = size - half;
+    const float* upper = dB.data() + offset;
+    const float* lower = dB.data();
+
+    const auto now = Clock::now();
+    if (not impl.mHoldsValid) {
+        std::copy(upper, upper + half, impl.mMax.begin());
+        std::copy(lower, lower + offset, impl.mMax.begin() + half);
+        impl.mMin = impl.mMax;
+        impl.mHoldsValid = true;
+        impl.mHoldStart = now;
+    } else {
+        dsp_kernels::MaxHold(upper, half, impl.mMax.data());
+        dsp_kernels::MaxHold(lower, offset, impl.mMax.data() + half);
+        dsp_kernels::MinHold(upper, half, impl.mMin.data());
+        dsp_kernels::MinHold(lower, offset, impl.mMin.data() + half);
+    }
+
+    ++impl.mFrames;
+    if (not impl.mAvgValid) {
+        // copied, the previous average may hold -inf of an empty bin
+        std::copy(upper, upper + half, impl.mAvg.begin());
+        std::copy(lower, lower + offset, impl.mAvg.begin() + half);
+        impl.mAvgValid = true;
+    } else {
+        const auto alpha = Averaging::Linear == impl.mConfig.averaging
+                               ? 1.0f / impl.mFrames
+                               : impl.mConfig.alpha;
+        dsp_kernels::Average(upper, half, alpha, impl.mAvg.data());
+        dsp_kernels::Average(lower, offset, alpha, impl.mAvg.data() + half);
+    }
+
+    if (now >= impl.mNextEmit) {
+        impl.Emit(now);
+    }
+}
+
+}  // namespace spectrum_reducer
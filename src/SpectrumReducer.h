@@ -0,0 +1,69 @@
+#ifndef __SPECTRUM_REDUCER_H__
+#define __SPECTRUM_REDUCER_H__
+
+#include <chrono>
+#include <kfr/base.hpp>
+#include <memory>
+#include <string>
+
+namespace spectrum_reducer {
+enum class Averaging {
+    // mean of the frames since the last emitted trace
+    Linear,
+    // running average, weight alpha for the newest frame
+    Exponential
+};
+
+struct ReducerConfig {
+    // directory of the trace files, empty - no reduction
+    std::string outputDir;
+    // bins of an emitted trace, independent of the FFT size
+    size_t width{1024u};
+    // traces emitted per second
+    double rate{20.0};
+    Averaging averaging{Averaging::Linear};
+    // weight of the newest frame in the exponential average
+    float alpha{0.1f};
+    // the max and min holds restart after this time, 0 - hold forever
+    std::chrono::milliseconds holdTime{0};
+};
+
+/**
+ * @brief Keeps max-hold, min-hold and average traces of the dB spectra of
+ * one device and emits them, decimated to the display width, at a fixed
+ * rate instead of once per block.
+ *
+ * The traces of a device are rewritten into one file, little-endian:
+ *   "KSR1", u32 width, u32 frames since the previous trace,
+ *   i64 time in ns since the epoch, then width f32 each of the max, min
+ *   and average traces in dB, lowest frequency first.
+ * Decimation keeps the max of the bins of a column for the max and
+ * average traces and their min for the min trace, so no peak is lost.
+ */
+class CSpectrumReducer {
+   public:
+    /**
+     * @param deviceNumber number device, names the trace file and labels
+     * the metrics
+     * @param config width, rate, averaging and output of the traces
+     */
+    CSpectrumReducer(const int deviceNumber, const ReducerConfig& config);
+    CSpectrumReducer(const CSpectrumReducer&) = delete;
+    CSpectrumReducer& operator=(const CSpectrumReducer&) = delete;
+    ~CSpectrumReducer();
+
+    /**
+     * @brief Updates the traces with one frame, emits them when the rate
+     * period has passed
+     * @param dB spectrum in the FFT order, DC first
+     */
+    void AddFrame(const kfr::univector<kfr::fbase>& dB);
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace spectrum_reducer
+
+#endif  // __SPECTRUM_REDUCER_H__
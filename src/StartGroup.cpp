@@ -0,0 +1,219 @@
+#include "StartGroup.h"
+
+#include <SoapySDR/Device.hpp>
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "LatencyTracer.h"
+#include "Metrics.h"
+
+namespace start_group {
+namespace {
+// a stream not ready after this long releases the group, the others
+// activate without it
+constexpr auto kReadyTimeout = std::chrono::seconds(5);
+
+long long NowNs() {
+    return static_cast<long long>(latency_tracer::NowNs());
+}
+}  // namespace
+
+struct CStartGroup::Impl {
+    Impl(const size_t streams, const std::chrono::milliseconds lead)
+        : mExpected(streams)
+        , mLeadNs(std::chrono::duration_cast<std::chrono::nanoseconds>(lead)
+                      .count()) {}
+
+    // with mLock held
+    void SetEpochIfReady();
+    void Finish();
+    DeviceStart ActivateAtEpoch(const int deviceNumber,
+                                SoapySDR::Device& device,
+                                SoapySDR::Stream* stream,
+                                const double sampleRate,
+                                const long long epochNs);
+
+    mutable std::mutex mLock;
+    std::condition_variable mReady;
+    size_t mExpected;
+    size_t mArrived{0u};
+    const long long mLeadNs;
+    // steady clock ns, 0 until every stream is ready
+    long long mEpochNs{0};
+    bool mCancelled{false};
+    GroupReport mReport;
+};
+
+void CStartGroup::Impl::SetEpochIfReady() {
+    if (0 != mEpochNs || mCancelled || mArrived < mExpected) {
+        return;
+    }
+    mEpochNs = NowNs() + mLeadNs;
+    mReady.notify_all();
+}
+
+void CStartGroup::Impl::Finish() {
+    auto& devices = mReport.devices;
+    if (mReport.complete || devices.size() < mExpected || devices.empty()) {
+        return;
+    }
+
+    const auto [first, last] = std::minmax_element(
+        devices.begin(), devices.end(), [](const auto& a, const auto& b) {
+            return a.startNs < b.startNs;
+        });
+    mReport.skewNs = last->startNs - first->startNs;
+
+    // the epoch stamps leave the uncertainty of two starts
+    long long uncertaintyNs(0);
+    double sampleRate(0.0);
+    size_t timed(0u);
+    for (const auto& start : devices) {
+        uncertaintyNs = std::max(uncertaintyNs, start.uncertaintyNs);
+        sampleRate = std::max(sampleRate, start.sampleRate);
+        timed += start.timed ? 1u : 0u;
+    }
+    mReport.alignmentWindow = static_cast<size_t>(
+        std::ceil(2.0 * uncertaintyNs * sampleRate / 1e9));
+    mReport.complete = true;
+
+    auto& registry = metrics::CMetricsRegistry::Instance();
+    registry
+        .GetGauge("kraken_start_skew_nanoseconds",
+                  "Spread of the first samples of the grouped start")
+        .Set(mReport.skewNs);
+    registry
+        .GetGauge("kraken_alignment_window_samples",
+                  "+- samples a cross-device alignment has to search")
+        .Set(static_cast<std::int64_t>(mReport.alignmentWindow));
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Start group: %zu streams, %zu timed, skew %.1f us, "
+                   "alignment window +-%zu samples",
+                   devices.size(),
+                   timed,
+                   mReport.skewNs / 1e3,
+                   mReport.alignmentWindow);
+    for (const auto& start : devices) {
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "Start group: device #%d %s start %+.1f us +-%.1f us, "
+                       "epoch sample %lld",
+                       start.deviceNumber,
+                       start.timed ? "timed" : "untimed",
+                       start.startNs / 1e3,
+                       start.uncertaintyNs / 1e3,
+                       start.epochSample);
+    }
+}
+
+DeviceStart CStartGroup::Impl::ActivateAtEpoch(const int deviceNumber,
+                                               SoapySDR::Device& device,
+                                               SoapySDR::Stream* stream,
+                                               const double sampleRate,
+                                               const long long epochNs) {
+    DeviceStart start;
+    start.deviceNumber = deviceNumber;
+    start.sampleRate = sampleRate;
+    start.synchronized = true;
+
+    if (device.hasHardwareTime()) {
+        // the device clock against the host clock, the read is in between
+        const auto before = NowNs();
+        const auto hardwareNs = device.getHardwareTime();
+        const auto after = NowNs();
+        start.hwEpochNs = epochNs + hardwareNs - (before + after) / 2;
+        start.timed = 0 == device.activateStream(
+                               stream, SOAPY_SDR_HAS_TIME, start.hwEpochNs);
+        start.uncertaintyNs = (after - before) / 2;
+    }
+
+    if (not start.timed) {
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+            std::chrono::nanoseconds(epochNs)));
+        const auto before = NowNs();
+        device.activateStream(stream);
+        const auto after = NowNs();
+        // the samples start somewhere inside the activation
+        start.startNs = (before + after) / 2 - epochNs;
+        start.uncertaintyNs = (after - before) / 2;
+    }
+
+    start.epochSample = std::llround(-start.startNs * sampleRate / 1e9);
+    return start;
+}
+
+CStartGroup::CStartGroup(const size_t streams,
+                         const std::chrono::milliseconds lead)
+    : mImpl(std::make_unique<CStartGroup::Impl>(streams, lead)) {}
+
+CStartGroup::~CStartGroup() = default;
+
+DeviceStart CStartGroup::Activate(const int deviceNumber,
+                                  SoapySDR::Device& device,
+                                  SoapySDR::Stream* stream,
+                                  const double sampleRate) {
+    auto& impl = *mImpl;
+
+    long long epochNs(0);
+    {
+        std::unique_lock lock(impl.mLock);
+        ++impl.mArrived;
+        impl.SetEpochIfReady();
+        const auto ready = impl.mReady.wait_for(lock, kReadyTimeout, [&] {
+            return 0 != impl.mEpochNs || impl.mCancelled;
+        });
+        if (not ready) {
+            SoapySDR::logf(SOAPY_SDR_WARNING,
+                           "Start group: device #%d waited %lld s for %zu "
+                           "streams, starting unsynchronized",
+                           deviceNumber,
+                           static_cast<long long>(kReadyTimeout.count()),
+                           impl.mExpected - impl.mArrived);
+            impl.mCancelled = true;
+            impl.mReady.notify_all();
+        }
+        epochNs = impl.mEpochNs;
+    }
+
+    if (0 == epochNs) {
+        device.activateStream(stream);
+        DeviceStart start;
+        start.deviceNumber = deviceNumber;
+        start.sampleRate = sampleRate;
+        return start;
+    }
+
+    const auto start =
+        impl.ActivateAtEpoch(deviceNumber, device, stream, sampleRate, epochNs);
+
+    std::lock_guard lock(impl.mLock);
+    impl.mReport.devices.push_back(start);
+    impl.Finish();
+    return start;
+}
+
+void CStartGroup::Leave() {
+    std::lock_guard lock(mImpl->mLock);
+    if (0u != mImpl->mExpected) {
+        --mImpl->mExpected;
+    }
+    mImpl->SetEpochIfReady();
+    mImpl->Finish();
+}
+
+void CStartGroup::Cancel() {
+    std::lock_guard lock(mImpl->mLock);
+    mImpl->mCancelled = true;
+    mImpl->mReady.notify_all();
+}
+
+GroupReport CStartGroup::GetReport() const {
+    std::lock_guard lock(mImpl->mLock);
+    return mImpl->mReport;
+}
+
+}  // namespace start_group
@@ -0,0 +1,113 @@
+#ifndef __START_GROUP_H__
+#define __START_GROUP_H__
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace SoapySDR {
+class Device;
+class Stream;
+}  // namespace SoapySDR
+
+namespace start_group {
+/**
+ * @brief Start of one stream of a group, times are host steady clock
+ * nanoseconds relative to the common epoch
+ */
+struct DeviceStart {
+    int deviceNumber{0};
+    double sampleRate{0.0};
+    // activated at the common epoch, false if the group was cancelled
+    bool synchronized{false};
+    // activated with SOAPY_SDR_HAS_TIME at the hardware time of the epoch
+    bool timed{false};
+    // the epoch in the device clock, valid if timed
+    long long hwEpochNs{0};
+    // estimated time of the first sample
+    long long startNs{0};
+    // half width of the interval the first sample is in
+    long long uncertaintyNs{0};
+    // index of the sample taken at the epoch in the samples of the stream,
+    // negative if the stream started after the epoch
+    long long epochSample{0};
+
+    /**
+     * @brief Time of a sample of the stream since the epoch
+     * @param sample index of the sample in the stream
+     */
+    long long EpochTimeNs(const unsigned long long sample) const {
+        return static_cast<long long>(
+            (static_cast<long long>(sample) - epochSample) * 1e9 / sampleRate);
+    }
+};
+
+struct GroupReport {
+    std::vector<DeviceStart> devices;
+    // spread of the first samples of the streams
+    long long skewNs{0};
+    // +- samples a cross-device alignment of epoch stamped blocks has to
+    // search, what the start can't tell apart
+    size_t alignmentWindow{0u};
+    // every stream of the group is activated
+    bool complete{false};
+};
+
+/**
+ * @brief Activates the RX streams of several devices together: every
+ * stream is set up and waits at a barrier, the last one ready sets a
+ * common epoch shortly ahead and each stream is activated at it, timed
+ * where the driver has a hardware time. Streams stamp their blocks with
+ * the time since the epoch.
+ */
+class CStartGroup {
+   public:
+    /**
+     * @brief ctor
+     * @param streams streams joining the group
+     * @param lead time between the last stream ready and the epoch, lets
+     * every stream thread issue its activation before the epoch
+     */
+    explicit CStartGroup(
+        const size_t streams,
+        const std::chrono::milliseconds lead = std::chrono::milliseconds(100));
+    CStartGroup(const CStartGroup&) = delete;
+    CStartGroup& operator=(const CStartGroup&) = delete;
+    ~CStartGroup();
+
+    /**
+     * @brief Called by a stream thread in place of activateStream, blocks
+     * until every stream of the group is ready or the group is cancelled
+     * @param deviceNumber number device, labels the report
+     * @param device the device of the stream
+     * @param stream set up and not activated
+     * @param sampleRate sample rate of the stream
+     * @return the start of the stream, an untimed start without epoch if
+     * the group was cancelled
+     */
+    DeviceStart Activate(const int deviceNumber,
+                         SoapySDR::Device& device,
+                         SoapySDR::Stream* stream,
+                         const double sampleRate);
+
+    /**
+     * @brief A stream that can't be started leaves the group, the others
+     * stop waiting for it
+     */
+    void Leave();
+
+    /**
+     * @brief Releases the waiting streams, they activate at once
+     */
+    void Cancel();
+
+    GroupReport GetReport() const;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace start_group
+
+#endif  // __START_GROUP_H__
@@ -0,0 +1,215 @@
+#include "StreamFactory.h"
+
+#include <SoapySDR/Device.hpp>
+#include <stdexcept>
+
+#include "DeviceStreamRtl.h"
+#include "SampleTypes.h"
+#include "Utility.h"
+
+namespace stream_factory {
+namespace {
+/**
+ * @brief Returns the format the pipeline is instantiated for, the native
+ * one if none is requested, CF32 if the native one has no instantiation
+ * @return an empty string if the requested format is not supported
+ */
+std::string NegotiateFormat(SoapySDR::Device& device,
+                            const int direction,
+                            const std::string& format,
+                            const size_t channel) {
+    const auto supported = [](const std::string& candidate) {
+        return sample_types::DispatchFormat(candidate, [](auto) {});
+    };
+
+    if (not format.empty()) {
+        if (supported(format)) {
+            return format;
+        }
+        SoapySDR::logf(SOAPY_SDR_ERROR,
+                       "Stream format %s is not supported",
+                       format.c_str());
+        return std::string();
+    }
+
+    double fullScale(0.0);
+    const auto native =
+        device.getNativeStreamFormat(direction, channel, fullScale);
+    if (supported(native)) {
+        return native;
+    }
+
+    // the driver converts to CF32 when the native format has no pipeline
+    SoapySDR::logf(SOAPY_SDR_WARNING,
+                   "Native format %s is not supported, using %s",
+                   native.c_str(),
+                   SOAPY_SDR_CF32);
+    return SOAPY_SDR_CF32;
+}
+
+/**
+ * @brief Starts the handler, then the RX stream feeding its queue
+ */
+template <class Sample, class Handler>
+void StartTyped(StreamPipeline& pipeline,
+                std::unique_ptr<Handler> handler,
+                const int deviceNumber,
+                std::shared_ptr<SoapySDR::Device> device,
+                const std::vector<size_t>& channels,
+                const SoapySDR::Kwargs& args,
+                std::shared_ptr<start_group::CStartGroup> startGroup) {
+    auto stream =
+        std::make_unique<device_stream::CDeviceStreamRtl<Sample>>(deviceNumber);
+
+    handler->StartHandling();
+    try {
+        stream->RunStreamLoop(handler->GetQueue(),
+                              std::move(device),
+                              channels,
+                              args,
+                              std::move(startGroup));
+    } catch (...) {
+        // let the handler thread finish before it is destroyed
+        handler->StopQueue();
+        throw;
+    }
+
+    pipeline.handler = std::move(handler);
+    pipeline.stream = std::move(stream);
+}
+}  // namespace
+
+StreamPipeline StartRxPipeline(
+    const int deviceNumber,
+    std::shared_ptr<SoapySDR::Device> device,
+    const std::string& format,
+    const std::vector<size_t>& channels,
+    const SoapySDR::Kwargs& args,
+    const data_handler::HandlerConfig& handlerConfig,
+    std::shared_ptr<start_group::CStartGroup> startGroup) {
+    LOG_FUNC();
+
+    StreamPipeline pipeline;
+    const auto streamFormat =
+        NegotiateFormat(*device, SOAPY_SDR_RX, format, channels.front());
+
+    sample_types::DispatchFormat(streamFormat, [&](auto sample) {
+        using Sample = decltype(sample);
+
+        // the capture ring holds a time span of the stream, the zoom, the
+        // monitor and the demodulators work in absolute Hz
+        auto config = handlerConfig;
+        config.capture.sampleRate =
+            device->getSampleRate(SOAPY_SDR_RX, channels.front());
+        config.zoom.sampleRate = config.capture.sampleRate;
+        config.zoom.tunedFrequency =
+            device->getFrequency(SOAPY_SDR_RX, channels.front());
+        config.monitor.sampleRate = config.capture.sampleRate;
+        config.monitor.tunedFrequency = config.zoom.tunedFrequency;
+        config.demod.sampleRate = config.capture.sampleRate;
+        config.demod.tunedFrequency = config.zoom.tunedFrequency;
+
+        StartTyped<Sample>(
+            pipeline,
+            std::make_unique<data_handler::CDataHandler<Sample>>(deviceNumber,
+                                                                 config),
+            deviceNumber,
+            std::move(device),
+            channels,
+            args,
+            std::move(startGroup));
+    });
+
+    return pipeline;
+}
+
+StreamPipeline StartGraphPipeline(const int deviceNumber,
+                                  std::shared_ptr<SoapySDR::Device> device,
+                                  const std::string& format,
+                                  const pipeline_graph::GraphSpec& spec,
+                                  const std::vector<size_t>& channels,
+                                  const SoapySDR::Kwargs& args,
+                                  std::shared_ptr<start_group::CStartGroup>
+                                      startGroup) {
+    LOG_FUNC();
+
+    StreamPipeline pipeline;
+    const auto streamFormat =
+        NegotiateFormat(*device, SOAPY_SDR_RX, format, channels.front());
+
+    sample_types::DispatchFormat(streamFormat, [&](auto sample) {
+        using Sample = decltype(sample);
+
+        std::unique_ptr<pipeline_graph::CPipelineGraph<Sample>> graph;
+        try {
+            graph = std::make_unique<pipeline_graph::CPipelineGraph<Sample>>(
+                deviceNumber,
+                spec,
+                device->getSampleRate(SOAPY_SDR_RX, channels.front()));
+        } catch (const std::runtime_error& error) {
+            SoapySDR::logf(SOAPY_SDR_ERROR, "%s", error.what());
+            return;
+        }
+        // the burst nodes label their packets in absolute Hz
+        graph->SetTunedFrequency(
+            device->getFrequency(SOAPY_SDR_RX, channels.front()));
+
+        StartTyped<Sample>(pipeline,
+                           std::move(graph),
+                           deviceNumber,
+                           std::move(device),
+                           channels,
+                           args,
+                           std::move(startGroup));
+    });
+
+    return pipeline;
+}
+
+TxPipeline StartTxPipeline(const int deviceNumber,
+                           std::shared_ptr<SoapySDR::Device> device,
+                           const std::string& format,
+                           const tx_feeder::TxConfig& config,
+                           const std::vector<size_t>& channels,
+                           const SoapySDR::Kwargs& args) {
+    LOG_FUNC();
+
+    TxPipeline pipeline;
+    const auto streamFormat =
+        NegotiateFormat(*device, SOAPY_SDR_TX, format, channels.front());
+
+    sample_types::DispatchFormat(streamFormat, [&](auto sample) {
+        using Sample = decltype(sample);
+
+        std::unique_ptr<tx_feeder::CTxFeeder<Sample>> feeder;
+        try {
+            feeder = std::make_unique<tx_feeder::CTxFeeder<Sample>>(
+                deviceNumber,
+                config,
+                device->getSampleRate(SOAPY_SDR_TX, channels.front()));
+        } catch (const std::runtime_error& error) {
+            SoapySDR::logf(SOAPY_SDR_ERROR, "%s", error.what());
+            return;
+        }
+        auto stream =
+            std::make_unique<device_stream::CDeviceStreamRtl<Sample>>(
+                deviceNumber);
+
+        // the stream thread waits for the prefetched blocks
+        feeder->StartFeeding();
+        try {
+            stream->RunTxStreamLoop(
+                feeder->GetQueue(), std::move(device), channels, args);
+        } catch (...) {
+            feeder->StopQueue();
+            throw;
+        }
+
+        pipeline.feeder = std::move(feeder);
+        pipeline.stream = std::move(stream);
+    });
+
+    return pipeline;
+}
+
+}  // namespace stream_factory
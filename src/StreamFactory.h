@@ -0,0 +1,100 @@
+#ifndef __STREAM_FACTORY_H__
+#define __STREAM_FACTORY_H__
+
+#include <SoapySDR/Types.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DataHandler.h"
+#include "DeviceStream.h"
+#include "PipelineGraph.h"
+#include "StartGroup.h"
+#include "TxFeeder.h"
+
+namespace stream_factory {
+struct StreamPipeline {
+    // declared first so it outlives the stream thread pushing to its queue
+    std::unique_ptr<data_handler::IDataHandler> handler;
+    std::unique_ptr<device_stream::IDeviceStream> stream;
+};
+
+struct TxPipeline {
+    // declared first so it outlives the stream thread popping its queue
+    std::unique_ptr<tx_feeder::ITxFeeder> feeder;
+    std::unique_ptr<device_stream::IDeviceStream> stream;
+};
+
+/**
+ * @brief Dispatches once on the element format and starts the typed data
+ * handler and RX stream of a device, everything downstream is typed
+ * @param deviceNumber number device, labels metrics and threads
+ * @param device the device to read
+ * @param format element format, empty selects the native format of the
+ * device or CF32 if the native one is not supported
+ * @param channels a list of channels
+ * @param args stream args or empty for defaults
+ * @param handlerConfig optional stages of the data handler
+ * @param startGroup activates the stream with the other streams of the
+ * group, nullptr - activated at once
+ * @return an empty pipeline if the format is not supported
+ */
+StreamPipeline StartRxPipeline(
+    const int deviceNumber,
+    std::shared_ptr<SoapySDR::Device> device,
+    const std::string& format,
+    const std::vector<size_t>& channels = std::vector<size_t>(1, 0),
+    const SoapySDR::Kwargs& args = SoapySDR::Kwargs(),
+    const data_handler::HandlerConfig& handlerConfig =
+        data_handler::HandlerConfig(),
+    std::shared_ptr<start_group::CStartGroup> startGroup = nullptr);
+
+/**
+ * @brief Like StartRxPipeline with the processing graph of the spec in
+ * place of the data handler, the device node of the graph reads the RX
+ * stream
+ * @param deviceNumber number device, labels metrics and threads
+ * @param device the device to read
+ * @param format element format, empty selects the native format
+ * @param spec validated graph, instantiated for this device
+ * @param channels a list of channels
+ * @param args stream args or empty for defaults
+ * @param startGroup activates the stream with the other streams of the
+ * group, nullptr - activated at once
+ * @return an empty pipeline if the format is not supported or a node
+ * can't be created
+ */
+StreamPipeline StartGraphPipeline(
+    const int deviceNumber,
+    std::shared_ptr<SoapySDR::Device> device,
+    const std::string& format,
+    const pipeline_graph::GraphSpec& spec,
+    const std::vector<size_t>& channels = std::vector<size_t>(1, 0),
+    const SoapySDR::Kwargs& args = SoapySDR::Kwargs(),
+    std::shared_ptr<start_group::CStartGroup> startGroup = nullptr);
+
+/**
+ * @brief Dispatches once on the element format and starts the typed
+ * feeder and TX stream of a device
+ * @param deviceNumber number device, labels metrics and threads
+ * @param device the device to write
+ * @param format element format, empty selects the native format of the
+ * device or CF32 if the native one is not supported. A TX file must be in
+ * this format.
+ * @param config source, prefetch and burst settings
+ * @param channels a list of channels
+ * @param args stream args or empty for defaults
+ * @return an empty pipeline if the format is not supported or the source
+ * can't be opened
+ */
+TxPipeline StartTxPipeline(
+    const int deviceNumber,
+    std::shared_ptr<SoapySDR::Device> device,
+    const std::string& format,
+    const tx_feeder::TxConfig& config,
+    const std::vector<size_t>& channels = std::vector<size_t>(1, 0),
+    const SoapySDR::Kwargs& args = SoapySDR::Kwargs());
+
+}  // namespace stream_factory
+
+#endif  // __STREAM_FACTORY_H__
@@ -0,0 +1,451 @@
+#include "SweepScanner.h"
+
+#include <SoapySDR/Device.hpp>
+#include <SoapySDR/Errors.hpp>
+#include <SoapySDR/Formats.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <future>
+#include <stdexcept>
+
+#include "DeviceStream.h"
+#include "PsdEstimator.h"
+#include "Utility.h"
+
+namespace sweep_scanner {
+namespace {
+constexpr auto kReadTimeoutUs = 100000l;
+constexpr auto kNsPerSecond = 1e9;
+
+using Clock = std::chrono::steady_clock;
+
+struct RetuneStats {
+    void Add(const Clock::duration latency) {
+        mMin = 0u == mCount ? latency : std::min(mMin, latency);
+        mMax = std::max(mMax, latency);
+        mTotal += latency;
+        ++mCount;
+    }
+
+    static double ToMs(const Clock::duration value) {
+        return std::chrono::duration<double, std::milli>(value).count();
+    }
+
+    size_t mCount{0u};
+    Clock::duration mMin{Clock::duration::zero()};
+    Clock::duration mMax{Clock::duration::zero()};
+    Clock::duration mTotal{Clock::duration::zero()};
+};
+}  // namespace
+
+struct DeviceSweep {
+    explicit DeviceSweep(std::shared_ptr<SoapySDR::Device> device)
+        : mDevice(std::move(device))
+        , mStream(nullptr, device_stream::CStreamDeleter(mDevice)) {}
+
+    std::shared_ptr<SoapySDR::Device> mDevice;
+    std::unique_ptr<SoapySDR::Stream, device_stream::CStreamDeleter> mStream;
+    size_t mMtu{0u};
+    bool mHasTime{false};
+    // steps [mFirstStep, mLastStep) of the plan are scanned by this device
+    size_t mFirstStep{0u};
+    size_t mLastStep{0u};
+    RetuneStats mRetune;
+    unsigned int mOverflows{0u};
+};
+
+struct CSweepScanner::Impl {
+    ~Impl() {
+        LOG_FUNC();
+
+        mStopRequested = true;
+
+        if (mThreadHandle.valid()) {
+            mThreadHandle.get();
+        }
+    }
+
+    bool IsStopRequested() const {
+        return mStopRequested;
+    }
+
+    bool SetupDevices();
+    void SweepLoop();
+    void ScanSteps(DeviceSweep& deviceSweep);
+    bool ReadSettled(DeviceSweep& deviceSweep,
+                     const double centerFrequency,
+                     psd_estimator::CPsdEstimator& psd);
+    void ReportPass(const size_t pass, const Clock::duration duration) const;
+    void WriteSpectrum() const;
+
+    // the last step is pulled back to end at the end of the spectrum, it
+    // overlaps the one before instead of tuning past stopFrequency
+    size_t StepFirstBin(const size_t step) const {
+        return std::min(step * mKeptBins, mSpectrum.size() - mKeptBins);
+    }
+
+    double StepCenter(const size_t step) const {
+        return mPlan.startFrequency +
+               (StepFirstBin(step) + mKeptBins * 0.5) * mBinWidth;
+    }
+
+    SweepPlan mPlan;
+    size_t mChannel{0u};
+    std::vector<DeviceSweep> mDevices;
+
+    double mSampleRate{0.0};
+    double mBinWidth{0.0};
+    size_t mCropBins{0u};
+    size_t mKeptBins{0u};
+    size_t mNumSteps{0u};
+    size_t mFramesPerStep{1u};
+    // stitched wideband spectrum, bin i is at startFrequency + i * mBinWidth
+    std::vector<float> mSpectrum;
+
+    std::atomic_bool mStopRequested{false};
+    std::atomic_bool mIsDone{false};
+    std::function<void()> mOnDone;
+    std::future<void> mThreadHandle;
+};
+
+CSweepScanner::CSweepScanner(
+    const SweepPlan& plan,
+    std::vector<std::shared_ptr<SoapySDR::Device>> devices,
+    const size_t channel)
+    : mImpl(std::make_unique<CSweepScanner::Impl>()) {
+    mImpl->mPlan = plan;
+    mImpl->mChannel = channel;
+    for (auto& device : devices) {
+        mImpl->mDevices.emplace_back(std::move(device));
+    }
+}
+
+CSweepScanner::CSweepScanner(CSweepScanner&&) = default;
+
+CSweepScanner::~CSweepScanner() {
+    LOG_FUNC();
+}
+
+bool CSweepScanner::Start(std::function<void()> onDone) {
+    LOG_FUNC();
+
+    if (not mImpl->SetupDevices()) {
+        mImpl->mIsDone = true;
+        return false;
+    }
+
+    mImpl->mOnDone = std::move(onDone);
+
+    mImpl->mThreadHandle = std::async(std::launch::async,
+                                      &CSweepScanner::Impl::SweepLoop,
+                                      mImpl.get());
+
+    return true;
+}
+
+void CSweepScanner::Stop() {
+    LOG_FUNC();
+
+    mImpl->mStopRequested = true;
+}
+
+bool CSweepScanner::IsDone() const {
+    return mImpl->mIsDone;
+}
+
+bool CSweepScanner::Impl::SetupDevices() {
+    LOG_FUNC();
+
+    const auto span = mPlan.stopFrequency - mPlan.startFrequency;
+    if (mDevices.empty() || span <= 0.0 || mPlan.fftSize < 2u ||
+        mPlan.cropRatio < 0.0 || mPlan.cropRatio >= 1.0) {
+        SoapySDR::logf(SOAPY_SDR_ERROR,
+                       "Sweep plan not valid: %zu devices, %f - %f Hz",
+                       mDevices.size(),
+                       mPlan.startFrequency,
+                       mPlan.stopFrequency);
+        return false;
+    }
+
+    mSampleRate =
+        mDevices.front().mDevice->getSampleRate(SOAPY_SDR_RX, mChannel);
+    for (const auto& deviceSweep : mDevices) {
+        const auto rate =
+            deviceSweep.mDevice->getSampleRate(SOAPY_SDR_RX, mChannel);
+        if (std::abs(rate - mSampleRate) > 1.0) {
+            SoapySDR::logf(SOAPY_SDR_WARNING,
+                           "Sweep: sample rate %f differs from %f, spectra "
+                           "won't line up",
+                           rate,
+                           mSampleRate);
+        }
+    }
+
+    // keep an even number of bins so the kept band is centred on the tuner
+    mBinWidth = mSampleRate / mPlan.fftSize;
+    mCropBins = static_cast<size_t>(mPlan.fftSize * mPlan.cropRatio * 0.5);
+    mKeptBins = mPlan.fftSize - 2u * mCropBins;
+    mKeptBins -= mKeptBins % 2u;
+    mCropBins = (mPlan.fftSize - mKeptBins) / 2u;
+    mNumSteps =
+        static_cast<size_t>(std::ceil(span / (mKeptBins * mBinWidth)));
+    mFramesPerStep = std::max<size_t>(
+        1u,
+        static_cast<size_t>(std::ceil(
+            std::chrono::duration<double>(mPlan.dwell).count() * mSampleRate /
+            mPlan.fftSize)));
+    // a span narrower than one step still takes a whole step
+    mSpectrum.assign(
+        std::max(mKeptBins,
+                 static_cast<size_t>(std::ceil(span / mBinWidth - 1e-6))),
+        0.0f);
+
+    // contiguous chunks keep the retune distance short on every tuner
+    const auto numDevices = std::min(mDevices.size(), mNumSteps);
+    mDevices.erase(mDevices.begin() + numDevices, mDevices.end());
+    for (size_t i = 0; i < numDevices; ++i) {
+        auto& deviceSweep = mDevices[i];
+        deviceSweep.mFirstStep = i * mNumSteps / numDevices;
+        deviceSweep.mLastStep = (i + 1) * mNumSteps / numDevices;
+
+        auto& device = deviceSweep.mDevice;
+        auto stream = device->setupStream(
+            SOAPY_SDR_RX, SOAPY_SDR_CF32, std::vector<size_t>{mChannel});
+        deviceSweep.mStream =
+            std::unique_ptr<SoapySDR::Stream, device_stream::CStreamDeleter>(
+                stream, device_stream::CStreamDeleter(device));
+        deviceSweep.mMtu = device->getStreamMTU(stream);
+        deviceSweep.mHasTime = device->hasHardwareTime();
+        device->activateStream(stream);
+    }
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Sweep %f - %f Hz: %zu steps of %f Hz, %zu bins of %f Hz "
+                   "kept per step, %zu frames per step, %zu devices",
+                   mPlan.startFrequency,
+                   mPlan.stopFrequency,
+                   mNumSteps,
+                   mKeptBins * mBinWidth,
+                   mKeptBins,
+                   mBinWidth,
+                   mFramesPerStep,
+                   numDevices);
+
+    return true;
+}
+
+void CSweepScanner::Impl::SweepLoop() {
+    LOG_FUNC();
+
+    for (size_t pass = 1;
+         not IsStopRequested() && (0u == mPlan.passes || pass <= mPlan.passes);
+         ++pass) {
+        const auto passStart = Clock::now();
+
+        std::vector<std::future<void>> scans;
+        for (auto& deviceSweep : mDevices) {
+            deviceSweep.mRetune = RetuneStats();
+            scans.push_back(std::async(std::launch::async,
+                                       &CSweepScanner::Impl::ScanSteps,
+                                       this,
+                                       std::ref(deviceSweep)));
+        }
+
+        for (auto& scan : scans) {
+            scan.get();
+        }
+
+        if (IsStopRequested()) {
+            break;
+        }
+
+        ReportPass(pass, Clock::now() - passStart);
+        WriteSpectrum();
+    }
+
+    mDevices.clear();
+    mIsDone = true;
+
+    if (mOnDone) {
+        mOnDone();
+    }
+}
+
+void CSweepScanner::Impl::ScanSteps(DeviceSweep& deviceSweep) {
+    psd_estimator::CPsdEstimator psd(mPlan.fftSize);
+    std::vector<float> powerDb;
+
+    try {
+        for (auto step = deviceSweep.mFirstStep;
+             step < deviceSweep.mLastStep && not IsStopRequested();
+             ++step) {
+            if (not ReadSettled(deviceSweep, StepCenter(step), psd)) {
+                return;
+            }
+
+            // drop the roll-off at both edges, the kept part tiles the band
+            psd.GetPowerDb(powerDb);
+            std::copy(powerDb.begin() + mCropBins,
+                      powerDb.begin() + mCropBins + mKeptBins,
+                      mSpectrum.begin() + StepFirstBin(step));
+        }
+    } catch (const std::runtime_error& error) {
+        SoapySDR::logf(SOAPY_SDR_ERROR, "Sweep: %s", error.what());
+        mStopRequested = true;
+    }
+}
+
+bool CSweepScanner::Impl::ReadSettled(DeviceSweep& deviceSweep,
+                                      const double centerFrequency,
+                                      psd_estimator::CPsdEstimator& psd) {
+    auto& device = deviceSweep.mDevice;
+    auto stream = deviceSweep.mStream.get();
+
+    std::vector<std::complex<float>> buff(deviceSweep.mMtu);
+    std::vector<std::complex<float>> frame(mPlan.fftSize);
+    void* buffs[] = {buff.data()};
+    size_t frameFill(0u);
+
+    const auto settleNs = std::chrono::nanoseconds(mPlan.settle).count();
+    const auto retuneStart = Clock::now();
+    device->setFrequency(SOAPY_SDR_RX, mChannel, centerFrequency);
+    const auto validFromNs =
+        deviceSweep.mHasTime ? device->getHardwareTime() + settleNs : 0ll;
+
+    auto settleSamples = static_cast<long long>(
+        std::chrono::duration<double>(mPlan.settle).count() * mSampleRate);
+    if (not deviceSweep.mHasTime) {
+        // without timestamps flush what was buffered before the retune
+        int flags(0);
+        long long timeNs(0);
+        while (device->readStream(
+                   stream, buffs, buff.size(), flags, timeNs, 0) > 0) {
+        }
+    }
+
+    bool settled(false);
+    psd.Reset();
+    while (psd.GetFrameCount() < mFramesPerStep) {
+        if (IsStopRequested()) {
+            return false;
+        }
+
+        int flags(0);
+        long long timeNs(0);
+        const auto ret = device->readStream(
+            stream, buffs, buff.size(), flags, timeNs, kReadTimeoutUs);
+
+        if (SOAPY_SDR_TIMEOUT == ret) {
+            continue;
+        }
+        if (SOAPY_SDR_OVERFLOW == ret) {
+            deviceSweep.mOverflows++;
+            continue;
+        }
+        if (ret < 0) {
+            SoapySDR::logf(SOAPY_SDR_ERROR,
+                           "Sweep: unexpected stream error %s",
+                           SoapySDR::errToStr(ret));
+            // the stream is gone, retuning it again reads nothing
+            mStopRequested = true;
+            return false;
+        }
+
+        long long offset(0);
+        if (not settled) {
+            if (deviceSweep.mHasTime && 0 != (flags & SOAPY_SDR_HAS_TIME)) {
+                // samples stamped before validFromNs are still settling
+                offset = static_cast<long long>(
+                    std::ceil((validFromNs - timeNs) * mSampleRate /
+                              kNsPerSecond));
+            } else {
+                offset = settleSamples;
+                settleSamples -= std::min<long long>(settleSamples, ret);
+            }
+
+            if (offset >= ret) {
+                continue;
+            }
+
+            offset = std::max(0ll, offset);
+            settled = true;
+            deviceSweep.mRetune.Add(Clock::now() - retuneStart);
+        }
+
+        for (auto i = offset; i < ret; ++i) {
+            frame[frameFill++] = buff[i];
+            if (frame.size() == frameFill) {
+                psd.Accumulate(frame.data());
+                frameFill = 0u;
+                if (psd.GetFrameCount() == mFramesPerStep) {
+                    break;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void CSweepScanner::Impl::ReportPass(const size_t pass,
+                                     const Clock::duration duration) const {
+    const auto peak = std::max_element(mSpectrum.begin(), mSpectrum.end());
+    const auto peakBin = std::distance(mSpectrum.begin(), peak);
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Sweep pass %zu: %.1f ms, %zu bins, peak %f dB at %f Hz",
+                   pass,
+                   RetuneStats::ToMs(duration),
+                   mSpectrum.size(),
+                   *peak,
+                   mPlan.startFrequency + peakBin * mBinWidth);
+
+    for (size_t i = 0; i < mDevices.size(); ++i) {
+        const auto& deviceSweep = mDevices[i];
+        const auto& retune = deviceSweep.mRetune;
+        if (0u == retune.mCount) {
+            continue;
+        }
+
+        SoapySDR::logf(SOAPY_SDR_INFO,
+                       "Sweep device #%zu: %zu retunes, retune to valid data "
+                       "min %.2f ms avg %.2f ms max %.2f ms, overflows %u",
+                       i + 1,
+                       retune.mCount,
+                       RetuneStats::ToMs(retune.mMin),
+                       RetuneStats::ToMs(retune.mTotal / retune.mCount),
+                       RetuneStats::ToMs(retune.mMax),
+                       deviceSweep.mOverflows);
+    }
+}
+
+void CSweepScanner::Impl::WriteSpectrum() const {
+    if (mPlan.outputPath.empty()) {
+        return;
+    }
+
+    // write aside and rename so readers never see a partial spectrum
+    const auto tmpPath = mPlan.outputPath + ".tmp";
+    auto file = fopen(tmpPath.c_str(), "w");
+    if (nullptr == file) {
+        SoapySDR::logf(
+            SOAPY_SDR_ERROR, "Sweep: can't open %s", tmpPath.c_str());
+        return;
+    }
+
+    fprintf(file, "frequency_hz,power_db\n");
+    for (size_t i = 0; i < mSpectrum.size(); ++i) {
+        fprintf(file,
+                "%.1f,%.2f\n",
+                mPlan.startFrequency + i * mBinWidth,
+                mSpectrum[i]);
+    }
+    fclose(file);
+
+    std::rename(tmpPath.c_str(), mPlan.outputPath.c_str());
+}
+
+}  // namespace sweep_scanner
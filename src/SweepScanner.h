@@ -0,0 +1,78 @@
+#ifndef __SWEEP_SCANNER_H__
+#define __SWEEP_SCANNER_H__
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace SoapySDR {
+class Device;
+}  // namespace SoapySDR
+
+namespace sweep_scanner {
+struct SweepPlan {
+    // lower edge of the surveyed band in Hz
+    double startFrequency{0.0};
+    // upper edge of the surveyed band in Hz
+    double stopFrequency{0.0};
+    // time spent collecting valid samples on every step
+    std::chrono::milliseconds dwell{50};
+    // time discarded after every retune while the tuner PLL settles
+    std::chrono::milliseconds settle{20};
+    // points of the transform used for every PSD frame
+    size_t fftSize{1024u};
+    // part of the instantaneous bandwidth dropped at the band edges,
+    // half on every side, the rest is stitched into the wideband spectrum
+    double cropRatio{0.25};
+    // number of full sweeps to run, 0 - sweep until stopped
+    size_t passes{0u};
+    // CSV file rewritten with the stitched spectrum after every pass
+    std::string outputPath;
+};
+
+class CSweepScanner {
+   public:
+    /**
+     * @brief ctor
+     * @param plan frequency plan and timing of the sweep
+     * @param devices the devices the plan is split between
+     * @param channel an available RX channel on every device
+     */
+    CSweepScanner(const SweepPlan& plan,
+                  std::vector<std::shared_ptr<SoapySDR::Device>> devices,
+                  const size_t channel = 0u);
+    CSweepScanner(const CSweepScanner&) = delete;
+    CSweepScanner& operator=(const CSweepScanner&) = delete;
+    CSweepScanner(CSweepScanner&&);
+    ~CSweepScanner();
+
+    /**
+     * @brief Sets up streams on all devices and starts sweeping
+     * in the background
+     * @param onDone called from the sweep thread once all passes are done
+     * or the sweep is stopped
+     * @return false if the plan is not valid, otherwise true
+     */
+    bool Start(std::function<void()> onDone = nullptr);
+
+    /**
+     * @brief Requests the sweep to stop after the current block
+     */
+    void Stop();
+
+    /**
+     * @brief Indicates if all requested passes are finished or the sweep
+     * was stopped
+     */
+    bool IsDone() const;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace sweep_scanner
+
+#endif  // __SWEEP_SCANNER_H__
@@ -0,0 +1,216 @@
+#include "ThreadPlacement.h"
+
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+
+#include "AllocationTracker.h"
+#include "Utility.h"
+
+namespace thread_placement {
+namespace {
+constexpr size_t kStackPrefault = 256u * 1024u;
+constexpr size_t kMaxThreadName = 15u;
+
+struct State {
+    std::mutex mLock;
+    PlacementConfig mConfig;
+    bool mMemoryLocked{false};
+    std::atomic<size_t> mNextReaderSlot{0u};
+    std::atomic<size_t> mNextDspSlot{0u};
+};
+
+State& GetState() {
+    static State state;
+    return state;
+}
+
+const char* RoleName(const ThreadRole role) {
+    return ThreadRole::Reader == role ? "reader" : "dsp";
+}
+
+// touches the stack the thread will use so the pages are resident,
+// the volatile buffer can't be optimized out
+__attribute__((noinline)) void PrefaultStack() {
+    [[maybe_unused]] volatile char stack[kStackPrefault];
+    for (size_t i = 0; i < kStackPrefault; i += 4096u) {
+        stack[i] = 0;
+    }
+}
+
+std::string CurrentAffinity() {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (0 != pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet)) {
+        return "?";
+    }
+
+    std::string cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpuSet)) {
+            cpus += (cpus.empty() ? "" : ",") + std::to_string(cpu);
+        }
+    }
+    return cpus;
+}
+
+void LockMemory(const PlacementConfig& config, State& state) {
+    // freed memory stays in the heap instead of going back to the kernel,
+    // large blocks come from the heap too, so a reused block never faults
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    if (0 != mlockall(MCL_CURRENT | MCL_FUTURE)) {
+        SoapySDR::logf(SOAPY_SDR_WARNING,
+                       "Placement: mlockall failed (%s), memory stays "
+                       "pageable. Raise 'ulimit -l' or grant CAP_IPC_LOCK",
+                       std::strerror(errno));
+    } else {
+        state.mMemoryLocked = true;
+    }
+
+    if (0u != config.heapReserve) {
+        auto reserve = std::malloc(config.heapReserve);
+        if (nullptr != reserve) {
+            PrefaultBuffer(reserve, config.heapReserve);
+            std::free(reserve);
+        }
+    }
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Placement: memory %s, heap reserve %zu MB",
+                   state.mMemoryLocked ? "locked" : "not locked",
+                   config.heapReserve / (1024u * 1024u));
+}
+}  // namespace
+
+void Configure(const PlacementConfig& config) {
+    LOG_FUNC();
+
+    auto& state = GetState();
+    std::lock_guard guard(state.mLock);
+
+    state.mConfig = config;
+    if (config.lockMemory) {
+        LockMemory(config, state);
+    }
+}
+
+void ApplyCurrentThread(const ThreadRole role, const std::string& name) {
+    auto& state = GetState();
+
+    RolePlacement placement;
+    bool memoryLocked(false);
+    {
+        std::lock_guard guard(state.mLock);
+        placement = ThreadRole::Reader == role ? state.mConfig.reader
+                                               : state.mConfig.dsp;
+        memoryLocked = state.mMemoryLocked;
+    }
+
+    pthread_setname_np(pthread_self(),
+                       name.substr(0, kMaxThreadName).c_str());
+
+    if (not placement.cpus.empty()) {
+        auto& nextSlot = ThreadRole::Reader == role ? state.mNextReaderSlot
+                                                    : state.mNextDspSlot;
+        const auto slot = nextSlot.fetch_add(1u) % placement.cpus.size();
+
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(placement.cpus[slot], &cpuSet);
+        const auto ret =
+            pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        if (0 != ret) {
+            SoapySDR::logf(SOAPY_SDR_WARNING,
+                           "Placement: %s can't be pinned to cpu %d: %s",
+                           name.c_str(),
+                           placement.cpus[slot],
+                           std::strerror(ret));
+        }
+    }
+
+    if (0 != placement.priority) {
+        sched_param param{};
+        param.sched_priority = placement.priority;
+        const auto ret =
+            pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (0 != ret) {
+            SoapySDR::logf(SOAPY_SDR_WARNING,
+                           "Placement: SCHED_FIFO %d refused for %s (%s), "
+                           "staying on SCHED_OTHER. Grant CAP_SYS_NICE or "
+                           "set 'ulimit -r'",
+                           placement.priority,
+                           name.c_str(),
+                           std::strerror(ret));
+        }
+    }
+
+    if (memoryLocked) {
+        PrefaultStack();
+    }
+
+    // report what the kernel actually applied, not what was asked for
+    int policy(SCHED_OTHER);
+    sched_param param{};
+    pthread_getschedparam(pthread_self(), &policy, &param);
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Placement: %s (%s) cpus %s policy %s priority %d",
+                   name.c_str(),
+                   RoleName(role),
+                   CurrentAffinity().c_str(),
+                   SCHED_FIFO == policy ? "SCHED_FIFO" : "SCHED_OTHER",
+                   param.sched_priority);
+
+    // every placed thread streams or processes samples
+    allocation_tracker::RegisterThread(name.c_str(), true);
+}
+
+void PrefaultBuffer(void* data, const size_t size) {
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    auto bytes = static_cast<volatile char*>(data);
+    for (size_t i = 0; i < size; i += pageSize) {
+        bytes[i] = bytes[i];
+    }
+    if (0u != size) {
+        bytes[size - 1] = bytes[size - 1];
+    }
+}
+
+bool ParseCpuList(const std::string& list, std::vector<int>& cpus) {
+    cpus.clear();
+
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        const auto dash = item.find('-');
+        try {
+            const auto first = std::stoi(item.substr(0, dash));
+            const auto last = std::string::npos == dash
+                                  ? first
+                                  : std::stoi(item.substr(dash + 1));
+            if (first < 0 || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            for (auto cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::logic_error&) {
+            return false;
+        }
+    }
+
+    return not cpus.empty();
+}
+
+}  // namespace thread_placement
@@ -0,0 +1,62 @@
+#ifndef __THREAD_PLACEMENT_H__
+#define __THREAD_PLACEMENT_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace thread_placement {
+enum class ThreadRole { Reader, Dsp };
+
+struct RolePlacement {
+    // cores the threads of the role are pinned to, round-robin one core
+    // per thread, empty - no pinning
+    std::vector<int> cpus;
+    // SCHED_FIFO priority 1..99, 0 - keep the default CFS policy
+    int priority{0};
+};
+
+struct PlacementConfig {
+    // USB reader and TX writer threads of CDeviceStreamRtl
+    RolePlacement reader;
+    // processing threads of CDataHandler and CTxFeeder
+    RolePlacement dsp;
+    // mlockall the process and keep the heap resident
+    bool lockMemory{false};
+    // heap touched at startup so later allocations don't page fault
+    size_t heapReserve{32u * 1024u * 1024u};
+};
+
+/**
+ * @brief Stores the placement used by ApplyCurrentThread and locks memory
+ * if requested. Call it once at startup before the streams start.
+ * Missing privileges are logged and the process continues unlocked.
+ * @param config placement of the thread roles
+ */
+void Configure(const PlacementConfig& config);
+
+/**
+ * @brief Pins the calling thread and sets its scheduling policy according
+ * to the configured role placement, logs what was actually applied
+ * @param role role of the calling thread
+ * @param name thread name shown by top/htop, at most 15 characters
+ */
+void ApplyCurrentThread(const ThreadRole role, const std::string& name);
+
+/**
+ * @brief Writes every page of the buffer so it is resident before
+ * streaming starts
+ * @param data buffer begin
+ * @param size buffer size in bytes
+ */
+void PrefaultBuffer(void* data, const size_t size);
+
+/**
+ * @brief Parses a core list like "2,3" or "1-3"
+ * @return false on a malformed list
+ */
+bool ParseCpuList(const std::string& list, std::vector<int>& cpus);
+
+}  // namespace thread_placement
+
+#endif  // __THREAD_PLACEMENT_H__
@@ -0,0 +1,450 @@
+#include "ThroughputBench.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <SoapySDR/Device.hpp>
+#include <SoapySDR/Formats.hpp>
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "Metrics.h"
+#include "StreamFactory.h"
+#include "Utility.h"
+
+namespace throughput_bench {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kMtu = 16384u;
+// blocks the emulated driver ring holds before it overflows, like the
+// rtlsdr default of 15 async buffers
+constexpr size_t kDriverBuffers = 15u;
+constexpr auto kWarmUp = std::chrono::seconds(1);
+constexpr auto kDepthPollPeriod = std::chrono::milliseconds(20);
+
+/**
+ * @brief SoapySDR device replaying a CS8 pattern at a fixed sample rate.
+ * A read blocks until its samples are due. A reader falling further
+ * behind than the driver ring gets SOAPY_SDR_OVERFLOW, as from hardware.
+ */
+class CMemoryDevice : public SoapySDR::Device {
+   public:
+    explicit CMemoryDevice(const double rate)
+        : mRate(rate), mPattern(2u * kMtu * kDriverBuffers) {
+        // noise around a tone so the FFT and dB math see realistic input
+        std::mt19937 generator(1u);
+        std::normal_distribution<float> noise(0.0f, 8.0f);
+        for (size_t i = 0; i < mPattern.size() / 2u; ++i) {
+            const auto phase = 0.05 * i;
+            mPattern[2u * i] = Clamp(64.0 * std::cos(phase) + noise(generator));
+            mPattern[2u * i + 1u] =
+                Clamp(64.0 * std::sin(phase) + noise(generator));
+        }
+    }
+
+    std::string getDriverKey() const override {
+        return "memory";
+    }
+
+    std::string getHardwareKey() const override {
+        return "memory";
+    }
+
+    std::vector<std::string> getStreamFormats(const int,
+                                              const size_t) const override {
+        return {SOAPY_SDR_CS8};
+    }
+
+    std::string getNativeStreamFormat(const int,
+                                      const size_t,
+                                      double& fullScale) const override {
+        fullScale = 128.0;
+        return SOAPY_SDR_CS8;
+    }
+
+    SoapySDR::Stream* setupStream(const int direction,
+                                  const std::string& format,
+                                  const std::vector<size_t>&,
+                                  const SoapySDR::Kwargs&) override {
+        if (SOAPY_SDR_RX != direction || SOAPY_SDR_CS8 != format) {
+            throw std::runtime_error("CMemoryDevice: only RX CS8 streams");
+        }
+        return reinterpret_cast<SoapySDR::Stream*>(this);
+    }
+
+    void closeStream(SoapySDR::Stream*) override {}
+
+    size_t getStreamMTU(SoapySDR::Stream*) const override {
+        return kMtu;
+    }
+
+    int activateStream(SoapySDR::Stream*,
+                       const int,
+                       const long long,
+                       const size_t) override {
+        mStart = Clock::now();
+        mSamplesOut = 0u;
+        return 0;
+    }
+
+    int deactivateStream(SoapySDR::Stream*,
+                         const int,
+                         const long long) override {
+        return 0;
+    }
+
+    int readStream(SoapySDR::Stream*,
+                   void* const* buffs,
+                   const size_t numElems,
+                   int& flags,
+                   long long& timeNs,
+                   const long timeoutUs) override {
+        const auto count = std::min(numElems, kMtu);
+        const auto due = SampleTime(mSamplesOut + count);
+        const auto now = Clock::now();
+
+        if (due > now) {
+            if (due - now > std::chrono::microseconds(timeoutUs)) {
+                std::this_thread::sleep_for(
+                    std::chrono::microseconds(timeoutUs));
+                return SOAPY_SDR_TIMEOUT;
+            }
+            std::this_thread::sleep_until(due);
+        } else if (now - due > SampleTime(kMtu * kDriverBuffers) - mStart) {
+            // the ring wrapped, drop what the reader missed
+            mSamplesOut = static_cast<size_t>(
+                std::chrono::duration<double>(now - mStart).count() * mRate);
+            return SOAPY_SDR_OVERFLOW;
+        }
+
+        const auto offset = 2u * (mSamplesOut % (kMtu * kDriverBuffers));
+        const auto bytes = std::min(2u * count, mPattern.size() - offset);
+        std::memcpy(buffs[0], mPattern.data() + offset, bytes);
+        std::memcpy(static_cast<std::int8_t*>(buffs[0]) + bytes,
+                    mPattern.data(),
+                    2u * count - bytes);
+
+        flags = SOAPY_SDR_HAS_TIME;
+        timeNs = static_cast<long long>(mSamplesOut / mRate * 1e9);
+        mSamplesOut += count;
+        return static_cast<int>(count);
+    }
+
+    void setSampleRate(const int, const size_t, const double rate) override {
+        mRate = rate;
+    }
+
+    double getSampleRate(const int, const size_t) const override {
+        return mRate;
+    }
+
+   private:
+    static std::int8_t Clamp(const double value) {
+        return static_cast<std::int8_t>(std::clamp(value, -128.0, 127.0));
+    }
+
+    Clock::time_point SampleTime(const size_t sample) const {
+        return mStart + std::chrono::duration_cast<Clock::duration>(
+                            std::chrono::duration<double>(sample / mRate));
+    }
+
+    double mRate;
+    std::vector<std::int8_t> mPattern;
+    Clock::time_point mStart;
+    size_t mSamplesOut{0u};
+};
+
+// counters of one step, snapshots are subtracted to get the step values
+struct PipelineCounters {
+    std::uint64_t samples{0u};
+    std::uint64_t overflows{0u};
+    std::uint64_t drops{0u};
+    std::uint64_t queued{0u};
+    std::uint64_t processed{0u};
+    std::uint64_t shed{0u};
+    double convertSeconds{0.0};
+    double fftSeconds{0.0};
+    double statsSeconds{0.0};
+    // CPU time of the threads, by thread id
+    std::map<std::string, double> readerCpu;
+    std::map<std::string, double> dspCpu;
+};
+
+struct StepResult {
+    size_t devices{0u};
+    double rate{0.0};
+    bool sustainable{false};
+    double msps{0.0};
+    std::uint64_t overflows{0u};
+    std::uint64_t drops{0u};
+    // frames the load governor shed, none while it is disabled
+    std::uint64_t shed{0u};
+    size_t maxQueueDepth{0u};
+    // share of one core per tuner spent in the stage
+    std::map<std::string, double> load;
+    std::string limitingStage;
+};
+
+double ThreadCpuSeconds(const std::string& taskPath) {
+    std::ifstream stat(taskPath + "/stat");
+    std::string line;
+    std::getline(stat, line);
+
+    // utime and stime are fields 14 and 15, counted after the (comm)
+    const auto commEnd = line.rfind(')');
+    if (std::string::npos == commEnd) {
+        return 0.0;
+    }
+    std::istringstream fields(line.substr(commEnd + 2u));
+    std::string field;
+    unsigned long long ticks(0u);
+    for (int index = 3; fields >> field && index <= 15; ++index) {
+        if (index >= 14) {
+            ticks += std::stoull(field);
+        }
+    }
+    return static_cast<double>(ticks) / sysconf(_SC_CLK_TCK);
+}
+
+// CPU time of the pipeline threads, found by the names
+// thread_placement::ApplyCurrentThread gives them
+void SampleThreadCpu(PipelineCounters& counters) {
+    const std::string taskRoot = "/proc/self/task";
+    auto dir = opendir(taskRoot.c_str());
+    if (nullptr == dir) {
+        return;
+    }
+
+    while (auto entry = readdir(dir)) {
+        if ('.' == entry->d_name[0]) {
+            continue;
+        }
+        const auto taskPath = taskRoot + "/" + entry->d_name;
+        std::ifstream commFile(taskPath + "/comm");
+        std::string comm;
+        std::getline(commFile, comm);
+
+        if (0 == comm.rfind("kraken-rx", 0)) {
+            counters.readerCpu[entry->d_name] = ThreadCpuSeconds(taskPath);
+        } else if (0 == comm.rfind("kraken-dsp", 0)) {
+            counters.dspCpu[entry->d_name] = ThreadCpuSeconds(taskPath);
+        }
+    }
+    closedir(dir);
+}
+
+PipelineCounters Snapshot(const size_t devices) {
+    auto& registry = metrics::CMetricsRegistry::Instance();
+    constexpr auto kHelp = "Processing time per block and stage";
+
+    PipelineCounters counters;
+    for (size_t i = 1; i <= devices; ++i) {
+        const auto device = std::to_string(i);
+        const metrics::Labels labels{{"device", device}};
+        counters.samples +=
+            registry.GetCounterValue("kraken_samples_total", labels);
+        counters.overflows +=
+            registry.GetCounterValue("kraken_overflows_total", labels);
+        counters.drops +=
+            registry.GetCounterValue("kraken_queue_drops_total", labels);
+        counters.queued +=
+            registry.GetCounterValue("kraken_blocks_queued_total", labels);
+        counters.processed +=
+            registry.GetCounterValue("kraken_blocks_processed_total", labels);
+        for (const auto stage : {"fft", "display"}) {
+            counters.shed += registry.GetCounterValue(
+                "kraken_shed_frames_total",
+                {{"device", device}, {"stage", stage}});
+        }
+
+        const auto stageSeconds = [&](const std::string& stage) {
+            return 1e-9 *
+                   registry
+                       .GetHistogram("kraken_stage_seconds",
+                                     kHelp,
+                                     {{"device", device}, {"stage", stage}})
+                       .GetSum();
+        };
+        counters.convertSeconds += stageSeconds("convert");
+        counters.fftSeconds += stageSeconds("fft");
+        counters.statsSeconds += stageSeconds("stats");
+    }
+    SampleThreadCpu(counters);
+    return counters;
+}
+
+double CpuDelta(const std::map<std::string, double>& before,
+                const std::map<std::string, double>& after) {
+    double seconds(0.0);
+    for (const auto& [tid, cpu] : after) {
+        const auto it = before.find(tid);
+        seconds += cpu - (before.end() == it ? 0.0 : it->second);
+    }
+    return seconds;
+}
+
+StepResult RunStep(const BenchConfig& config,
+                   const size_t devices,
+                   const double rate) {
+    StepResult result;
+    result.devices = devices;
+    result.rate = rate;
+
+    // a governor shedding frames would let an overloaded step keep up
+    data_handler::HandlerConfig handlerConfig;
+    handlerConfig.governor.enabled = false;
+
+    std::vector<stream_factory::StreamPipeline> pipelines;
+    for (size_t i = 1; i <= devices; ++i) {
+        pipelines.push_back(stream_factory::StartRxPipeline(
+            static_cast<int>(i),
+            std::make_shared<CMemoryDevice>(rate),
+            SOAPY_SDR_CS8,
+            std::vector<size_t>(1, 0),
+            SoapySDR::Kwargs(),
+            handlerConfig));
+    }
+
+    std::this_thread::sleep_for(kWarmUp);
+    const auto before = Snapshot(devices);
+    const auto start = Clock::now();
+    const auto deadline = start + config.stepDuration - kWarmUp;
+
+    while (Clock::now() < deadline) {
+        for (const auto& pipeline : pipelines) {
+            result.maxQueueDepth = std::max(result.maxQueueDepth,
+                                            pipeline.handler->GetQueueSize());
+        }
+        std::this_thread::sleep_for(kDepthPollPeriod);
+    }
+
+    const auto after = Snapshot(devices);
+    const auto wall = std::chrono::duration<double>(Clock::now() - start);
+
+    for (const auto& pipeline : pipelines) {
+        pipeline.handler->StopQueue();
+    }
+    pipelines.clear();
+
+    result.msps = (after.samples - before.samples) / wall.count() / 1e6;
+    result.overflows = after.overflows - before.overflows;
+    result.drops = after.drops - before.drops;
+    result.shed = after.shed - before.shed;
+
+    // load of one tuner chain, 1.0 - a core fully busy with the stage
+    const auto perTuner = 1.0 / (wall.count() * devices);
+    const auto dspCpu = CpuDelta(before.dspCpu, after.dspCpu);
+    const auto convert = after.convertSeconds - before.convertSeconds;
+    const auto fft = after.fftSeconds - before.fftSeconds;
+    const auto stats = after.statsSeconds - before.statsSeconds;
+    result.load["reader"] =
+        CpuDelta(before.readerCpu, after.readerCpu) * perTuner;
+    result.load["convert"] = convert * perTuner;
+    result.load["fft"] = fft * perTuner;
+    result.load["stats"] = stats * perTuner;
+    // logging and printing in the handler thread outside the timed stages
+    result.load["output"] =
+        std::max(0.0, dspCpu - convert - fft - stats) * perTuner;
+
+    result.limitingStage =
+        std::max_element(result.load.begin(),
+                         result.load.end(),
+                         [](const auto& lh, const auto& rh) {
+                             return lh.second < rh.second;
+                         })
+            ->first;
+
+    const auto backlog = (after.queued - before.queued) -
+                         (after.processed - before.processed);
+    result.sustainable = 0u == result.overflows && 0u == result.drops &&
+                         0u == result.shed &&
+                         result.maxQueueDepth <= config.maxQueueDepth &&
+                         backlog <= config.maxQueueDepth * devices;
+    return result;
+}
+
+void LogStep(const StepResult& result) {
+    std::string load;
+    for (const auto& [stage, value] : result.load) {
+        char buffer[64];
+        snprintf(
+            buffer, sizeof(buffer), " %s %.1f%%", stage.c_str(), 100 * value);
+        load += buffer;
+    }
+
+    // the pipeline runs at the warning level, lift it for the report
+    SoapySDR::setLogLevel(SOAPY_SDR_INFO);
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Bench: %zu x %.3f Msps -> %.3f Msps %s, overflows %llu "
+                   "drops %llu shed %llu max queue %zu, load per tuner:%s",
+                   result.devices,
+                   result.rate / 1e6,
+                   result.msps,
+                   result.sustainable ? "OK" : "FAIL",
+                   static_cast<unsigned long long>(result.overflows),
+                   static_cast<unsigned long long>(result.drops),
+                   static_cast<unsigned long long>(result.shed),
+                   result.maxQueueDepth,
+                   load.c_str());
+    SoapySDR::setLogLevel(SOAPY_SDR_WARNING);
+}
+}  // namespace
+
+bool RunBenchmark(const BenchConfig& config) {
+    LOG_FUNC();
+
+    // the pipeline traces its calls, keep the measurement free of it
+    SoapySDR::setLogLevel(SOAPY_SDR_WARNING);
+
+    StepResult best;
+    StepResult firstFailure;
+    for (size_t devices = 1; devices <= config.maxDevices; ++devices) {
+        for (const auto rate : config.rates) {
+            const auto result = RunStep(config, devices, rate);
+            LogStep(result);
+
+            if (not result.sustainable) {
+                if (0u == firstFailure.devices ||
+                    result.devices * result.rate <
+                        firstFailure.devices * firstFailure.rate) {
+                    firstFailure = result;
+                }
+                break;
+            }
+            if (result.devices * result.rate > best.devices * best.rate) {
+                best = result;
+            }
+        }
+    }
+
+    SoapySDR::setLogLevel(SOAPY_SDR_INFO);
+    if (0u == best.devices) {
+        SoapySDR::logf(SOAPY_SDR_WARNING,
+                       "Bench: no step is sustainable, limited by %s",
+                       firstFailure.limitingStage.c_str());
+        return false;
+    }
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Bench: max sustainable %.3f Msps aggregate (%zu x %.3f "
+                   "Msps), limiting stage: %s",
+                   best.devices * best.rate / 1e6,
+                   best.devices,
+                   best.rate / 1e6,
+                   (0u == firstFailure.devices ? best : firstFailure)
+                       .limitingStage.c_str());
+    return true;
+}
+
+}  // namespace throughput_bench
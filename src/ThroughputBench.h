@@ -0,0 +1,33 @@
+#ifndef __THROUGHPUT_BENCH_H__
+#define __THROUGHPUT_BENCH_H__
+
+#include <chrono>
+#include <vector>
+
+namespace throughput_bench {
+struct BenchConfig {
+    // the tuner count grows from 1 up to this value
+    size_t maxDevices{1u};
+    // per tuner sample rates tried in ascending order, in Sps
+    std::vector<double> rates{
+        250e3, 1.024e6, 1.4e6, 1.8e6, 2.048e6, 2.4e6, 2.56e6, 3.2e6};
+    // time every rate step runs, the first second is warm up
+    std::chrono::milliseconds stepDuration{4000};
+    // a step fails once a queue holds more blocks than this
+    size_t maxQueueDepth{16u};
+};
+
+/**
+ * @brief Runs the StreamLoop -> CDataQueue -> CDataHandler pipeline on
+ * paced in-memory devices at increasing rates and tuner counts, logs
+ * per stage CPU usage of every step and the highest sustainable
+ * aggregate rate with the stage that limits it. No hardware is used,
+ * the load governor is disabled and a step that sheds frames fails.
+ * @param config rate steps and the failure criteria
+ * @return true if at least the first step was sustainable
+ */
+bool RunBenchmark(const BenchConfig& config);
+
+}  // namespace throughput_bench
+
+#endif  // __THROUGHPUT_BENCH_H__
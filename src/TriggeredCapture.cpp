@@ -0,0 +1,416 @@
+#include "TriggeredCapture.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include "Metrics.h"
+#include "ThreadPlacement.h"
+
+namespace triggered_capture {
+namespace {
+constexpr char kMagic[] = {'K', 'C', 'P', '1'};
+constexpr size_t kFormatSize = 8u;
+// bytes the writer copies out of the ring at a time, whole samples of
+// every format
+constexpr size_t kChunkSize = 256u * 1024u;
+
+using Clock = std::chrono::steady_clock;
+
+std::int64_t NowUnixNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+const char* SourceName(const TriggerSource source) {
+    switch (source) {
+        case TriggerSource::Level:
+            return "level";
+        case TriggerSource::Command:
+            return "command";
+        case TriggerSource::Schedule:
+            return "schedule";
+    }
+    return "?";
+}
+
+// TriggerSource values
+constexpr size_t kSources = 3u;
+
+#pragma pack(push, 1)
+struct FileHeader {
+    char magic[4];
+    char format[kFormatSize];
+    double sampleRate;
+    std::int64_t firstSampleNs;
+    std::uint64_t firstSample;
+    std::uint32_t triggers;
+    std::uint32_t sources;
+};
+#pragma pack(pop)
+
+// positions count the bytes appended since the start, a position p is in
+// the ring at p % capacity while p >= head - capacity
+struct Capture {
+    std::uint64_t start{0u};
+    std::uint64_t end{0u};
+    std::uint32_t triggers{0u};
+    std::uint32_t sources{0u};
+    std::int64_t startNs{0};
+    // overtaken by the ring, its end is final
+    bool cut{false};
+};
+}  // namespace
+
+struct CTriggeredCapture::Impl {
+    Impl(const int deviceNumber,
+         const CaptureConfig& config,
+         const std::string& format,
+         const size_t sampleSize);
+
+    std::uint64_t SpanBytes(const std::chrono::milliseconds span) const {
+        return static_cast<std::uint64_t>(
+                   std::llround(span.count() * 1e-3 * mConfig.sampleRate)) *
+               mSampleSize;
+    }
+
+    void WriterLoop();
+    // with mLock held
+    bool HasWork() const;
+    void CopyChunk(const std::uint64_t position, const size_t size);
+    FileHeader MakeHeader(const Capture& capture) const;
+    void OpenFile(const Capture& capture);
+    void CloseFile(const Capture& capture);
+
+    const int mDeviceNumber;
+    const CaptureConfig mConfig;
+    const std::string mFormat;
+    const size_t mSampleSize;
+    const std::uint64_t mPreBytes;
+    const std::uint64_t mPostBytes;
+    // allocated once, the history and the unwritten captured samples
+    std::vector<std::uint8_t> mRing;
+    std::vector<std::uint8_t> mStaging;
+
+    std::mutex mLock;
+    std::condition_variable mWake;
+    std::uint64_t mHead{0u};
+    std::int64_t mHeadNs{0};
+    // the next byte of the capture the writer copies
+    std::uint64_t mWritePos{0u};
+    bool mActive{false};
+    Capture mCapture;
+    bool mStopping{false};
+
+    Clock::time_point mNextSchedule;
+    // writer thread only
+    std::FILE* mFile{nullptr};
+    std::string mPath;
+    std::uint64_t mCaptureIndex{0u};
+    std::future<void> mWriterHandle;
+
+    metrics::CCounter& mCaptures;
+    metrics::CCounter& mBytes;
+    metrics::CCounter& mOverruns;
+    // kraken_capture_triggers_total by TriggerSource, resolved once so a
+    // trigger on the DSP thread only counts
+    std::array<metrics::CCounter*, kSources> mTriggers{};
+};
+
+CTriggeredCapture::Impl::Impl(const int deviceNumber,
+                              const CaptureConfig& config,
+                              const std::string& format,
+                              const size_t sampleSize)
+    : mDeviceNumber(deviceNumber)
+    , mConfig(config)
+    , mFormat(format)
+    , mSampleSize(std::max<size_t>(1u, sampleSize))
+    , mPreBytes(SpanBytes(config.preTrigger))
+    , mPostBytes(SpanBytes(config.postTrigger))
+    , mRing(std::max<std::uint64_t>(kChunkSize, mPreBytes + mPostBytes))
+    , mStaging(kChunkSize)
+    , mNextSchedule(Clock::now() + config.schedulePeriod)
+    , mCaptures(metrics::CMetricsRegistry::Instance().GetCounter(
+          "kraken_captures_total",
+          "Triggered captures written",
+          {{"device", std::to_string(deviceNumber)}}))
+    , mBytes(metrics::CMetricsRegistry::Instance().GetCounter(
+          "kraken_capture_bytes_total",
+          "Bytes of the triggered captures written",
+          {{"device", std::to_string(deviceNumber)}}))
+    , mOverruns(metrics::CMetricsRegistry::Instance().GetCounter(
+          "kraken_capture_overruns_total",
+          "Captures cut because the ring overtook the writer",
+          {{"device", std::to_string(deviceNumber)}})) {
+    for (size_t source = 0; source < kSources; ++source) {
+        mTriggers[source] = &metrics::CMetricsRegistry::Instance().GetCounter(
+            "kraken_capture_triggers_total",
+            "Capture triggers, merged ones included",
+            {{"device", std::to_string(deviceNumber)},
+             {"source", SourceName(static_cast<TriggerSource>(source))}});
+    }
+    thread_placement::PrefaultBuffer(mRing.data(), mRing.size());
+}
+
+bool CTriggeredCapture::Impl::HasWork() const {
+    if (mStopping) {
+        return true;
+    }
+    // a chunk to copy or a finished capture to close
+    return mActive && (mWritePos < std::min(mHead, mCapture.end) ||
+                       mWritePos >= mCapture.end);
+}
+
+void CTriggeredCapture::Impl::CopyChunk(const std::uint64_t position,
+                                        const size_t size) {
+    const auto offset = position % mRing.size();
+    const auto first = std::min<size_t>(size, mRing.size() - offset);
+    std::memcpy(mStaging.data(), &mRing[offset], first);
+    std::memcpy(&mStaging[first], mRing.data(), size - first);
+}
+
+FileHeader CTriggeredCapture::Impl::MakeHeader(const Capture& capture) const {
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    std::strncpy(header.format, mFormat.c_str(), kFormatSize);
+    header.sampleRate = mConfig.sampleRate;
+    header.firstSampleNs = capture.startNs;
+    header.firstSample = capture.start / mSampleSize;
+    header.triggers = capture.triggers;
+    header.sources = capture.sources;
+    return header;
+}
+
+void CTriggeredCapture::Impl::OpenFile(const Capture& capture) {
+    char name[64];
+    snprintf(name,
+             sizeof(name),
+             "/capture_dev%d_%06llu.kcp",
+             mDeviceNumber,
+             static_cast<unsigned long long>(mCaptureIndex++));
+    mPath = mConfig.outputDir + name;
+
+    // write aside and rename so readers never see a partial capture
+    const auto tmpPath = mPath + ".tmp";
+    mFile = std::fopen(tmpPath.c_str(), "wb");
+    if (nullptr == mFile) {
+        SoapySDR::logf(
+            SOAPY_SDR_ERROR, "Capture: can't open %s", tmpPath.c_str());
+        return;
+    }
+
+    // rewritten by CloseFile with the final triggers
+    const auto header = MakeHeader(capture);
+    std::fwrite(&header, sizeof(header), 1u, mFile);
+}
+
+void CTriggeredCapture::Impl::CloseFile(const Capture& capture) {
+    if (nullptr == mFile) {
+        return;
+    }
+
+    const auto header = MakeHeader(capture);
+    std::fseek(mFile, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1u, mFile);
+    const auto failed = 0 != std::ferror(mFile);
+    std::fclose(mFile);
+    mFile = nullptr;
+
+    const auto tmpPath = mPath + ".tmp";
+    if (failed) {
+        SoapySDR::logf(
+            SOAPY_SDR_ERROR, "Capture: can't write %s", tmpPath.c_str());
+        return;
+    }
+    std::rename(tmpPath.c_str(), mPath.c_str());
+    mCaptures.Add();
+
+    const auto samples = (capture.end - capture.start) / mSampleSize;
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Capture: %s, %llu samples, %u triggers",
+                   mPath.c_str(),
+                   static_cast<unsigned long long>(samples),
+                   capture.triggers);
+}
+
+void CTriggeredCapture::Impl::WriterLoop() {
+    while (true) {
+        Capture capture;
+        size_t size(0u);
+        bool open(false);
+        bool done(false);
+        {
+            std::unique_lock lock(mLock);
+            mWake.wait(lock, [this] { return HasWork(); });
+            if (mStopping && mActive) {
+                // what is in the ring is all the capture gets
+                mCapture.end = std::min(mCapture.end, mHead);
+            }
+            if (not mActive) {
+                if (mStopping) {
+                    return;
+                }
+                continue;
+            }
+
+            capture = mCapture;
+            open = mWritePos == mCapture.start;
+            if (mWritePos >= mCapture.end) {
+                mActive = false;
+                done = true;
+            } else {
+                size = static_cast<size_t>(std::min<std::uint64_t>(
+                    kChunkSize, std::min(mHead, mCapture.end) - mWritePos));
+                CopyChunk(mWritePos, size);
+                mWritePos += size;
+            }
+        }
+
+        // the file I/O runs without the lock, the producer keeps going
+        if (open && nullptr == mFile && not done) {
+            OpenFile(capture);
+        }
+        if (done) {
+            CloseFile(capture);
+            continue;
+        }
+        if (nullptr != mFile &&
+            size == std::fwrite(mStaging.data(), 1u, size, mFile)) {
+            mBytes.Add(size);
+        }
+    }
+}
+
+CTriggeredCapture::CTriggeredCapture(const int deviceNumber,
+                                     const CaptureConfig& config,
+                                     const std::string& format,
+                                     const size_t sampleSize)
+    : mImpl(std::make_unique<CTriggeredCapture::Impl>(
+          deviceNumber, config, format, sampleSize)) {
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Capture: %lld ms before and %lld ms after a trigger, "
+                   "%.1f MB ring, to %s",
+                   static_cast<long long>(config.preTrigger.count()),
+                   static_cast<long long>(config.postTrigger.count()),
+                   mImpl->mRing.size() / 1e6,
+                   config.outputDir.c_str());
+    mImpl->mWriterHandle = std::async(
+        std::launch::async, &CTriggeredCapture::Impl::WriterLoop, mImpl.get());
+}
+
+CTriggeredCapture::~CTriggeredCapture() {
+    {
+        std::lock_guard lock(mImpl->mLock);
+        mImpl->mStopping = true;
+    }
+    mImpl->mWake.notify_one();
+    if (mImpl->mWriterHandle.valid()) {
+        mImpl->mWriterHandle.get();
+    }
+}
+
+void CTriggeredCapture::AddBlock(const void* data, const size_t bytes) {
+    auto& impl = *mImpl;
+    const auto capacity = impl.mRing.size();
+    // a block larger than the ring keeps its newest part
+    const auto skip = bytes > capacity ? bytes - capacity : 0u;
+    const auto* source = static_cast<const std::uint8_t*>(data) + skip;
+    const auto size = bytes - skip;
+
+    {
+        std::lock_guard lock(impl.mLock);
+        const auto head = impl.mHead + skip;
+        // the block overwrites the oldest bytes, the writer must be past
+        // them
+        if (impl.mActive && not impl.mCapture.cut &&
+            head + size > impl.mWritePos + capacity) {
+            impl.mCapture.end = impl.mWritePos;
+            impl.mCapture.cut = true;
+            impl.mOverruns.Add();
+            SoapySDR::logf(SOAPY_SDR_WARNING,
+                           "Capture: device #%d writer overtaken, capture cut",
+                           impl.mDeviceNumber);
+        }
+        impl.mHead = head;
+    }
+
+    // the writer never reads at or past mHead, so the copy needs no lock
+    const auto offset = impl.mHead % capacity;
+    const auto first = std::min<size_t>(size, capacity - offset);
+    std::memcpy(&impl.mRing[offset], source, first);
+    std::memcpy(impl.mRing.data(), source + first, size - first);
+
+    {
+        std::lock_guard lock(impl.mLock);
+        impl.mHead += size;
+        impl.mHeadNs = NowUnixNs();
+    }
+    impl.mWake.notify_one();
+
+    if (0 != impl.mConfig.schedulePeriod.count()) {
+        const auto now = Clock::now();
+        if (now >= impl.mNextSchedule) {
+            impl.mNextSchedule = now + impl.mConfig.schedulePeriod;
+            Trigger(TriggerSource::Schedule);
+        }
+    }
+}
+
+void CTriggeredCapture::CheckLevel(const float maxDb) {
+    if (maxDb > mImpl->mConfig.levelDb) {
+        Trigger(TriggerSource::Level);
+    }
+}
+
+void CTriggeredCapture::Trigger(const TriggerSource source) {
+    auto& impl = *mImpl;
+
+    impl.mTriggers[static_cast<size_t>(source)]->Add();
+
+    std::lock_guard lock(impl.mLock);
+    const auto end = impl.mHead + impl.mPostBytes;
+    const auto bit = 1u << static_cast<unsigned>(source);
+    if (impl.mActive) {
+        if (impl.mCapture.cut) {
+            // the samples after the cut are gone, the writer is behind
+            return;
+        }
+        // overlaps the capture being written, extends it
+        impl.mCapture.end = std::max(impl.mCapture.end, end);
+        ++impl.mCapture.triggers;
+        impl.mCapture.sources |= bit;
+        return;
+    }
+
+    // the history reaches back to the oldest byte the ring still holds,
+    // but not into the previous capture
+    const auto capacity = impl.mRing.size();
+    auto start = impl.mHead > impl.mPreBytes ? impl.mHead - impl.mPreBytes : 0u;
+    start = std::max(start, impl.mHead > capacity ? impl.mHead - capacity : 0u);
+    start = std::max(start, impl.mWritePos);
+
+    const auto bytesPerSecond = impl.mConfig.sampleRate * impl.mSampleSize;
+    impl.mCapture = Capture();
+    impl.mCapture.start = start;
+    impl.mCapture.end = end;
+    impl.mCapture.triggers = 1u;
+    impl.mCapture.sources = bit;
+    impl.mCapture.startNs =
+        impl.mHeadNs -
+        (bytesPerSecond > 0.0
+             ? std::llround((impl.mHead - start) * 1e9 / bytesPerSecond)
+             : 0);
+    impl.mWritePos = start;
+    impl.mActive = true;
+}
+
+}  // namespace triggered_capture
@@ -0,0 +1,97 @@
+#ifndef __TRIGGERED_CAPTURE_H__
+#define __TRIGGERED_CAPTURE_H__
+
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+
+namespace triggered_capture {
+enum class TriggerSource {
+    // the spectrum max above the threshold
+    Level,
+    // a console command
+    Command,
+    // the schedule period passed
+    Schedule
+};
+
+struct CaptureConfig {
+    // directory of the capture files, empty - no capture
+    std::string outputDir;
+    // raw history written ahead of the first trigger of a capture
+    std::chrono::milliseconds preTrigger{1000};
+    // recorded after the last trigger of a capture
+    std::chrono::milliseconds postTrigger{1000};
+    // a spectrum max above this fires, infinity - no level trigger
+    float levelDb{std::numeric_limits<float>::infinity()};
+    // period of the scheduled triggers, 0 - none
+    std::chrono::seconds schedulePeriod{0};
+    // samples per second of the stream, sizes the ring. Set by the stream
+    // factory, a stream of several channels fills the ring that much
+    // faster.
+    double sampleRate{0.0};
+};
+
+/**
+ * @brief Keeps the last preTrigger of the raw blocks of one device in a
+ * ring allocated once, a trigger writes the ring plus postTrigger of the
+ * following blocks to a file in the background. A trigger while a capture
+ * is being written extends it, so overlapping triggers make one file.
+ * The producer never waits: a capture the writer can't keep up with is
+ * cut where the ring overtook it.
+ *
+ * Capture file, little-endian:
+ *   "KCP1", char[8] format, f64 sample rate, i64 first sample time in ns
+ *   since the epoch, u64 first sample index of the stream, u32 triggers,
+ *   u32 sources (bit 1 << TriggerSource), then the interleaved samples
+ *   as they were read
+ */
+class CTriggeredCapture {
+   public:
+    /**
+     * @param deviceNumber number device, names the capture files and
+     * labels the metrics
+     * @param config ring, spans and triggers of the capture
+     * @param format stream element format, e.g. "CS8"
+     * @param sampleSize bytes of one complex sample
+     */
+    CTriggeredCapture(const int deviceNumber,
+                      const CaptureConfig& config,
+                      const std::string& format,
+                      const size_t sampleSize);
+    CTriggeredCapture(const CTriggeredCapture&) = delete;
+    CTriggeredCapture& operator=(const CTriggeredCapture&) = delete;
+
+    /**
+     * @brief Writes the captured samples already in the ring, joins the
+     * writer thread
+     */
+    ~CTriggeredCapture();
+
+    /**
+     * @brief Appends a raw block to the ring, fires the schedule trigger
+     * @param data interleaved samples
+     * @param bytes size of the data, whole samples
+     */
+    void AddBlock(const void* data, const size_t bytes);
+
+    /**
+     * @brief Fires the level trigger if the spectrum max is above the
+     * configured level
+     */
+    void CheckLevel(const float maxDb);
+
+    /**
+     * @brief Captures around the last appended block, thread safe
+     */
+    void Trigger(const TriggerSource source);
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace triggered_capture
+
+#endif  // __TRIGGERED_CAPTURE_H__
@@ -0,0 +1,154 @@
+#include "TxFeeder.h"
+
+#include <SoapySDR/Constants.h>
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <future>
+
+#include "ThreadPlacement.h"
+#include "TxSource.h"
+#include "Utility.h"
+
+namespace tx_feeder {
+template <class Sample>
+struct CTxFeeder<Sample>::Impl {
+    Impl(const int deviceNumber,
+         const TxConfig& config,
+         const double sampleRate)
+        : mDeviceNumber(deviceNumber), mConfig(config) {
+        if (mConfig.filePath.empty()) {
+            mSource = std::make_unique<tx_source::CToneSource<Sample>>(
+                mConfig.toneOffset, sampleRate, mConfig.amplitude);
+        } else {
+            // page in as much of the file as the queue holds
+            const auto readAhead = mConfig.prefetch * mConfig.blockSamples *
+                                   2u * sizeof(typename Sample::Component);
+            mSource = tx_source::OpenFile<Sample>(
+                mConfig.filePath, mConfig.loop, readAhead);
+        }
+        mQueue.SetCapacity(std::max<size_t>(1u, mConfig.prefetch));
+    }
+
+    ~Impl() {
+        LOG_FUNC();
+
+        mQueue.StopQueue();
+        if (mFeedHandle.valid()) {
+            mFeedHandle.get();
+        }
+    }
+
+    void Feeder();
+
+    data_queue::BlockQueue<Sample> mQueue;
+    const int mDeviceNumber;
+    const TxConfig mConfig;
+    std::unique_ptr<tx_source::ITxSource<Sample>> mSource;
+    std::future<void> mFeedHandle;
+};
+
+template <class Sample>
+void CTxFeeder<Sample>::Impl::Feeder() {
+    LOG_FUNC();
+
+    thread_placement::ApplyCurrentThread(
+        thread_placement::ThreadRole::Dsp,
+        "kraken-txf" + std::to_string(mDeviceNumber));
+
+    const auto burstSamples = mConfig.burstSamples;
+    const auto blockSamples = std::max<size_t>(1u, mConfig.blockSamples);
+    // samples of the current burst already queued
+    size_t burstQueued(0u);
+    long long burstIndex(0);
+
+    data_queue::DataBlock<Sample> block;
+    while (not mQueue.IsQueueStopped()) {
+        mQueue.WaitSpaceAvailable();
+        if (mQueue.IsQueueStopped()) {
+            break;
+        }
+
+        auto samples = blockSamples;
+        block.flags = 0;
+        block.timeNs = 0;
+        if (0u != burstSamples) {
+            samples = std::min(samples, burstSamples - burstQueued);
+            if (0u == burstQueued) {
+                block.flags |= SOAPY_SDR_HAS_TIME;
+                block.timeNs =
+                    std::chrono::nanoseconds(mConfig.startDelay +
+                                             burstIndex * mConfig.burstPeriod)
+                        .count();
+            }
+        }
+
+        block.data.resize(2u * samples);
+        const auto filled = mSource->Fill(block.data.data(), samples);
+        const auto exhausted = filled < samples;
+        block.data.resize(2u * filled);
+
+        burstQueued += filled;
+        if (0u != burstSamples && burstQueued == burstSamples) {
+            block.flags |= SOAPY_SDR_END_BURST;
+            burstQueued = 0u;
+            ++burstIndex;
+        }
+        if (exhausted) {
+            // ends a continuous stream or a partial burst cleanly
+            block.flags |= SOAPY_SDR_END_BURST;
+        }
+
+        mQueue.Push(block);
+
+        if (exhausted) {
+            SoapySDR::logf(SOAPY_SDR_INFO,
+                           "Device #%d: TX source exhausted",
+                           mDeviceNumber);
+            break;
+        }
+    }
+}
+
+template <class Sample>
+CTxFeeder<Sample>::CTxFeeder(const int deviceNumber,
+                             const TxConfig& config,
+                             const double sampleRate)
+    : mImpl(std::make_unique<CTxFeeder<Sample>::Impl>(
+          deviceNumber, config, sampleRate)) {}
+
+template <class Sample>
+CTxFeeder<Sample>::CTxFeeder(CTxFeeder&&) = default;
+
+template <class Sample>
+CTxFeeder<Sample>::~CTxFeeder() = default;
+
+template <class Sample>
+void CTxFeeder<Sample>::StartFeeding() const {
+    LOG_FUNC();
+
+    mImpl->mFeedHandle = std::async(
+        std::launch::async, &CTxFeeder<Sample>::Impl::Feeder, mImpl.get());
+}
+
+template <class Sample>
+void CTxFeeder<Sample>::StopQueue() const {
+    mImpl->mQueue.StopQueue();
+}
+
+template <class Sample>
+size_t CTxFeeder<Sample>::GetQueueSize() const {
+    return mImpl->mQueue.Size();
+}
+
+template <class Sample>
+data_queue::BlockQueue<Sample>& CTxFeeder<Sample>::GetQueue() const {
+    return mImpl->mQueue;
+}
+
+template class CTxFeeder<sample_types::CS8>;
+template class CTxFeeder<sample_types::CU8>;
+template class CTxFeeder<sample_types::CS16>;
+template class CTxFeeder<sample_types::CF32>;
+
+}  // namespace tx_feeder
@@ -0,0 +1,88 @@
+#ifndef __TX_FEEDER_H__
+#define __TX_FEEDER_H__
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "DataQueue.h"
+
+namespace tx_feeder {
+struct TxConfig {
+    // raw interleaved IQ file or compressed recording in the stream
+    // format, empty - a generated tone
+    std::string filePath;
+    // replay the file from the beginning when it ends
+    bool loop{true};
+    // tone frequency relative to the center frequency in Hz
+    double toneOffset{100e3};
+    // tone peak amplitude relative to full scale
+    double amplitude{0.5};
+    // blocks produced ahead of the device, the capacity of the TX queue
+    size_t prefetch{8u};
+    // samples per block, the stream splits blocks larger than its MTU
+    size_t blockSamples{16384u};
+    // samples per timed burst, 0 - one continuous stream
+    size_t burstSamples{0u};
+    // burst start to burst start
+    std::chrono::milliseconds burstPeriod{100};
+    // first burst after the stream activation, leaves time to prefetch
+    std::chrono::milliseconds startDelay{100};
+};
+
+/**
+ * @brief Format independent view of a feeder, used by the device manager
+ */
+class ITxFeeder {
+   public:
+    virtual void StartFeeding() const = 0;
+
+    /**
+     * @brief Stops the TX queue, the feeder and the stream thread finish
+     */
+    virtual void StopQueue() const = 0;
+
+    /**
+     * @brief Returns the number of blocks prefetched for the device
+     */
+    virtual size_t GetQueueSize() const = 0;
+
+    virtual ~ITxFeeder(){};
+};
+
+/**
+ * @brief Fills the TX queue from a file or tone source, runs up to
+ * TxConfig::prefetch blocks ahead of the stream and tags the bursts
+ * @tparam Sample stream element type from SampleTypes.h, instantiated for
+ * CS8, CU8, CS16 and CF32
+ */
+template <class Sample>
+class CTxFeeder : public ITxFeeder {
+   public:
+    /**
+     * @brief Opens the source, throws std::runtime_error if the file
+     * can't be mapped
+     * @param deviceNumber number device, names the feeder thread
+     * @param config source, prefetch and burst settings
+     * @param sampleRate TX sample rate, used by the tone generator
+     */
+    CTxFeeder(const int deviceNumber,
+              const TxConfig& config,
+              const double sampleRate);
+    CTxFeeder(CTxFeeder&&);
+    ~CTxFeeder() override;
+
+    void StartFeeding() const override;
+    void StopQueue() const override;
+    size_t GetQueueSize() const override;
+
+    data_queue::BlockQueue<Sample>& GetQueue() const;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace tx_feeder
+
+#endif  // __TX_FEEDER_H__
@@ -0,0 +1,286 @@
+#include "TxSource.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "IqRecording.h"
+#include "Utility.h"
+
+namespace tx_source {
+namespace {
+template <class Sample>
+typename Sample::Component Quantize(const double value) {
+    using Component = typename Sample::Component;
+
+    const auto scaled = Sample::kOffset + value * Sample::kFullScale;
+    if constexpr (std::is_floating_point_v<Component>) {
+        return static_cast<Component>(scaled);
+    } else {
+        // +1.0 is one step above the largest code of the signed formats
+        return static_cast<Component>(
+            std::clamp<double>(std::lround(scaled),
+                               std::numeric_limits<Component>::min(),
+                               std::numeric_limits<Component>::max()));
+    }
+}
+}  // namespace
+
+template <class Sample>
+struct CFileSource<Sample>::Impl {
+    static constexpr size_t kSampleBytes =
+        2u * sizeof(typename Sample::Component);
+
+    ~Impl() {
+        if (MAP_FAILED != mData) {
+            munmap(mData, mBytes);
+        }
+    }
+
+    // pages in the window ahead of the read position, once every half
+    // window so the syscall is rare
+    void Prefetch() {
+        const auto position = mPosition * kSampleBytes;
+        if (position + mReadAhead / 2u < mAdvisedEnd) {
+            return;
+        }
+
+        static const auto kPage = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const auto begin = position / kPage * kPage;
+        const auto end = std::min(mBytes, position + mReadAhead);
+        if (begin < end) {
+            madvise(static_cast<char*>(mData) + begin,
+                    end - begin,
+                    MADV_WILLNEED);
+        }
+        mAdvisedEnd = end;
+    }
+
+    void* mData{MAP_FAILED};
+    size_t mBytes{0u};
+    // whole samples in the file, a trailing partial sample is ignored
+    size_t mSamples{0u};
+    size_t mPosition{0u};
+    size_t mAdvisedEnd{0u};
+    size_t mReadAhead{0u};
+    bool mLoop{true};
+};
+
+template <class Sample>
+CFileSource<Sample>::CFileSource(const std::string& path,
+                                 const bool loop,
+                                 const size_t readAhead)
+    : mImpl(std::make_unique<CFileSource<Sample>::Impl>()) {
+    LOG_FUNC();
+
+    const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Can't open TX file " + path + ": " +
+                                 strerror(errno));
+    }
+
+    struct stat info {};
+    if (0 != fstat(fd, &info) ||
+        static_cast<size_t>(info.st_size) < Impl::kSampleBytes) {
+        close(fd);
+        throw std::runtime_error("TX file " + path +
+                                 " holds no complete sample");
+    }
+
+    mImpl->mBytes = info.st_size;
+    mImpl->mSamples = mImpl->mBytes / Impl::kSampleBytes;
+    mImpl->mData =
+        mmap(nullptr, mImpl->mBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (MAP_FAILED == mImpl->mData) {
+        throw std::runtime_error("Can't map TX file " + path + ": " +
+                                 strerror(errno));
+    }
+    madvise(mImpl->mData, mImpl->mBytes, MADV_SEQUENTIAL);
+
+    mImpl->mLoop = loop;
+    mImpl->mReadAhead = readAhead;
+    mImpl->Prefetch();
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "TX file %s: %zu %s samples%s",
+                   path.c_str(),
+                   mImpl->mSamples,
+                   Sample::kFormat,
+                   loop ? ", looped" : "");
+}
+
+template <class Sample>
+CFileSource<Sample>::~CFileSource() = default;
+
+template <class Sample>
+size_t CFileSource<Sample>::Fill(typename Sample::Component* out,
+                                 const size_t samples) {
+    auto& impl = *mImpl;
+    const auto* data = static_cast<const typename Sample::Component*>(
+        impl.mData);
+
+    size_t written(0u);
+    while (written < samples) {
+        if (impl.mPosition == impl.mSamples) {
+            if (not impl.mLoop) {
+                break;
+            }
+            impl.mPosition = 0u;
+            impl.mAdvisedEnd = 0u;
+        }
+        impl.Prefetch();
+
+        const auto count =
+            std::min(samples - written, impl.mSamples - impl.mPosition);
+        std::memcpy(out + 2u * written,
+                    data + 2u * impl.mPosition,
+                    count * Impl::kSampleBytes);
+        written += count;
+        impl.mPosition += count;
+    }
+
+    return written;
+}
+
+template <class Sample>
+struct CToneSource<Sample>::Impl {
+    double mStep{0.0};
+    double mPhase{0.0};
+    double mAmplitude{0.0};
+};
+
+template <class Sample>
+CToneSource<Sample>::CToneSource(const double offset,
+                                 const double sampleRate,
+                                 const double amplitude)
+    : mImpl(std::make_unique<CToneSource<Sample>::Impl>()) {
+    mImpl->mStep = 2.0 * M_PI * offset / sampleRate;
+    mImpl->mAmplitude = std::clamp(amplitude, 0.0, 1.0);
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "TX tone: %+g Hz at %g Msps, amplitude %g",
+                   offset,
+                   sampleRate / 1e6,
+                   mImpl->mAmplitude);
+}
+
+template <class Sample>
+CToneSource<Sample>::~CToneSource() = default;
+
+template <class Sample>
+size_t CToneSource<Sample>::Fill(typename Sample::Component* out,
+                                 const size_t samples) {
+    auto& impl = *mImpl;
+
+    for (size_t i = 0; i < samples; ++i) {
+        out[2u * i] =
+            Quantize<Sample>(impl.mAmplitude * std::cos(impl.mPhase));
+        out[2u * i + 1u] =
+            Quantize<Sample>(impl.mAmplitude * std::sin(impl.mPhase));
+        impl.mPhase += impl.mStep;
+    }
+    // wrapped once per call, the accumulated phase stays precise
+    impl.mPhase = std::remainder(impl.mPhase, 2.0 * M_PI);
+
+    return samples;
+}
+
+template <class Sample>
+struct CRecordingSource<Sample>::Impl {
+    explicit Impl(const std::string& path) : mReader(path) {}
+
+    iq_recording::CRecordingReader<Sample> mReader;
+    bool mLoop{false};
+};
+
+template <class Sample>
+CRecordingSource<Sample>::CRecordingSource(const std::string& path,
+                                           const bool loop,
+                                           const double start)
+    : mImpl(std::make_unique<CRecordingSource<Sample>::Impl>(path)) {
+    auto& reader = mImpl->mReader;
+    mImpl->mLoop = loop;
+    if (start > 0.0) {
+        reader.SeekSample(reader.FirstSample() +
+                          std::llround(start * reader.SampleRate()));
+    }
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "TX recording %s: from %g s%s",
+                   path.c_str(),
+                   start,
+                   loop ? ", looped" : "");
+}
+
+template <class Sample>
+CRecordingSource<Sample>::~CRecordingSource() = default;
+
+template <class Sample>
+size_t CRecordingSource<Sample>::Fill(typename Sample::Component* out,
+                                      const size_t samples) {
+    auto& reader = mImpl->mReader;
+    auto written = reader.Read(out, samples);
+    // a recording shorter than the block wraps more than once
+    while (written < samples && mImpl->mLoop) {
+        reader.SeekSample(reader.FirstSample());
+        const auto count = reader.Read(out + 2u * written, samples - written);
+        // empty or unreadable, the short fill ends the stream
+        if (0u == count) {
+            break;
+        }
+        written += count;
+    }
+    return written;
+}
+
+template <class Sample>
+std::unique_ptr<ITxSource<Sample>> OpenFile(const std::string& path,
+                                            const bool loop,
+                                            const size_t readAhead,
+                                            const double start) {
+    if (iq_recording::IsRecording(path)) {
+        return std::make_unique<CRecordingSource<Sample>>(path, loop, start);
+    }
+    if (0.0 != start) {
+        throw std::runtime_error("Can't start " + path +
+                                 " later, it isn't a recording");
+    }
+    return std::make_unique<CFileSource<Sample>>(path, loop, readAhead);
+}
+
+template class CFileSource<sample_types::CS8>;
+template class CFileSource<sample_types::CU8>;
+template class CFileSource<sample_types::CS16>;
+template class CFileSource<sample_types::CF32>;
+
+template class CToneSource<sample_types::CS8>;
+template class CToneSource<sample_types::CU8>;
+template class CToneSource<sample_types::CS16>;
+template class CToneSource<sample_types::CF32>;
+
+template class CRecordingSource<sample_types::CS8>;
+template class CRecordingSource<sample_types::CU8>;
+template class CRecordingSource<sample_types::CS16>;
+template class CRecordingSource<sample_types::CF32>;
+
+template std::unique_ptr<ITxSource<sample_types::CS8>> OpenFile(
+    const std::string&, const bool, const size_t, const double);
+template std::unique_ptr<ITxSource<sample_types::CU8>> OpenFile(
+    const std::string&, const bool, const size_t, const double);
+template std::unique_ptr<ITxSource<sample_types::CS16>> OpenFile(
+    const std::string&, const bool, const size_t, const double);
+template std::unique_ptr<ITxSource<sample_types::CF32>> OpenFile(
+    const std::string&, const bool, const size_t, const double);
+
+}  // namespace tx_source
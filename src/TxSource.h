@@ -0,0 +1,119 @@
+#ifndef __TX_SOURCE_H__
+#define __TX_SOURCE_H__
+
+#include <memory>
+#include <string>
+
+#include "SampleTypes.h"
+
+namespace tx_source {
+/**
+ * @brief Produces the samples of a TX stream in the stream format
+ * @tparam Sample stream element type from SampleTypes.h
+ */
+template <class Sample>
+class ITxSource {
+   public:
+    /**
+     * @brief Writes up to samples complex samples
+     * @param out interleaved I/Q components, room for 2 * samples
+     * @param samples number of complex samples requested
+     * @return number of samples written, 0 - the source is exhausted
+     */
+    virtual size_t Fill(typename Sample::Component* out,
+                        const size_t samples) = 0;
+
+    virtual ~ITxSource(){};
+};
+
+/**
+ * @brief Plays a memory mapped file of raw interleaved components in the
+ * Sample format, the pages ahead of the read position are prefetched
+ */
+template <class Sample>
+class CFileSource : public ITxSource<Sample> {
+   public:
+    /**
+     * @brief Maps the file, throws std::runtime_error if it can't
+     * @param path IQ file in the Sample format
+     * @param loop restart at the beginning when the end is reached
+     * @param readAhead bytes ahead of the read position paged in
+     */
+    CFileSource(const std::string& path,
+                const bool loop,
+                const size_t readAhead);
+    ~CFileSource() override;
+
+    size_t Fill(typename Sample::Component* out,
+                const size_t samples) override;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+/**
+ * @brief Plays a compressed recording of iq_recording::CRecordingWriter
+ */
+template <class Sample>
+class CRecordingSource : public ITxSource<Sample> {
+   public:
+    /**
+     * @brief Opens the recording, throws std::runtime_error if it can't
+     * @param path recording in the Sample format
+     * @param loop restart at the beginning when the end is reached
+     * @param start seconds of samples skipped at the beginning
+     */
+    CRecordingSource(const std::string& path,
+                     const bool loop,
+                     const double start);
+    ~CRecordingSource() override;
+
+    size_t Fill(typename Sample::Component* out,
+                const size_t samples) override;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+/**
+ * @brief Opens a compressed recording or a raw IQ file, told apart by
+ * the magic of the recordings
+ * @param start seconds skipped at the beginning, a raw file can't skip
+ * and throws std::runtime_error
+ */
+template <class Sample>
+std::unique_ptr<ITxSource<Sample>> OpenFile(const std::string& path,
+                                            const bool loop,
+                                            const size_t readAhead,
+                                            const double start = 0.0);
+
+/**
+ * @brief Generates a complex tone, the phase is continuous between Fill
+ * calls
+ */
+template <class Sample>
+class CToneSource : public ITxSource<Sample> {
+   public:
+    /**
+     * @param offset tone frequency relative to the center frequency in Hz
+     * @param sampleRate stream sample rate in samples per second
+     * @param amplitude peak amplitude relative to full scale, 0.0 .. 1.0
+     */
+    CToneSource(const double offset,
+                const double sampleRate,
+                const double amplitude);
+    ~CToneSource() override;
+
+    size_t Fill(typename Sample::Component* out,
+                const size_t samples) override;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace tx_source
+
+#endif  // __TX_SOURCE_H__
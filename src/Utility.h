@@ -4,13 +4,14 @@
 #include <SoapySDR/Logger.hpp>
 
 struct Log {
-    Log(const std::string& funcName) : mFuncName(funcName) {
-        SoapySDR::logf(SOAPY_SDR_NOTICE, "Enter: %s", mFuncName.c_str());
+    // a string literal, so logging doesn't allocate on the hot path
+    explicit Log(const char* funcName) : mFuncName(funcName) {
+        SoapySDR::logf(SOAPY_SDR_NOTICE, "Enter: %s", mFuncName);
     }
     ~Log() {
-        SoapySDR::logf(SOAPY_SDR_NOTICE, "Exit: %s", mFuncName.c_str());
+        SoapySDR::logf(SOAPY_SDR_NOTICE, "Exit: %s", mFuncName);
     }
-    const std::string mFuncName;
+    const char* const mFuncName;
 };
 
 #define LOG_FUNC() Log log(__PRETTY_FUNCTION__)
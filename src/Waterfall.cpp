@@ -0,0 +1,265 @@
+#include "Waterfall.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "Metrics.h"
+
+namespace waterfall {
+namespace {
+constexpr char kMagic[] = {'K', 'W', 'F', '1'};
+constexpr size_t kMaxRun = 128u;
+
+std::int64_t NowUnixNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+template <class Value>
+void Append(std::vector<std::uint8_t>& out, const Value value) {
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+/**
+ * @brief PackBits: a header n of 0..127 is followed by n + 1 literal bytes,
+ * -1..-127 by one byte repeated 1 - n times
+ */
+void PackBits(const std::uint8_t* in,
+              const size_t size,
+              std::vector<std::uint8_t>& out) {
+    size_t i(0u);
+    while (i < size) {
+        size_t run(1u);
+        while (i + run < size && run < kMaxRun && in[i + run] == in[i]) {
+            ++run;
+        }
+        // a run of two costs as much as a literal, it doesn't split one
+        if (run >= 3u) {
+            out.push_back(
+                static_cast<std::uint8_t>(1 - static_cast<int>(run)));
+            out.push_back(in[i]);
+            i += run;
+            continue;
+        }
+
+        const auto start = i;
+        while (i < size && i - start < kMaxRun) {
+            if (i + 2u < size && in[i] == in[i + 1u] && in[i] == in[i + 2u]) {
+                break;
+            }
+            ++i;
+        }
+        out.push_back(static_cast<std::uint8_t>(i - start - 1u));
+        out.insert(out.end(), in + start, in + i);
+    }
+}
+WaterfallConfig Sanitize(WaterfallConfig config) {
+    config.width = std::max<size_t>(1u, config.width);
+    config.tileRows = std::max<size_t>(1u, config.tileRows);
+    if (not(config.minDb < config.maxDb)) {
+        config.maxDb = config.minDb + 1.0f;
+    }
+    return config;
+}
+}  // namespace
+
+struct CWaterfall::Impl {
+    Impl(const int deviceNumber, const WaterfallConfig& config)
+        : mDeviceNumber(deviceNumber)
+        , mConfig(Sanitize(config))
+        , mTile(mConfig.width * mConfig.tileRows)
+        , mDelta(mConfig.width)
+        , mTiles(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_waterfall_tiles_total",
+              "Waterfall tiles written",
+              {{"device", std::to_string(deviceNumber)}}))
+        , mBytes(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_waterfall_bytes_total",
+              "Bytes of the waterfall tiles written",
+              {{"device", std::to_string(deviceNumber)}})) {
+        // worst case PackBits grows a row by one header per kMaxRun bytes
+        mEncoded.reserve(64u + mConfig.tileRows *
+                                   (sizeof(std::uint32_t) + mConfig.width +
+                                    mConfig.width / kMaxRun + 1u));
+    }
+
+    void PrepareBins(const size_t frameSize);
+    void WriteTile();
+
+    const int mDeviceNumber;
+    const WaterfallConfig mConfig;
+    // first FFT bin of every column and the end of the last one, in the
+    // shifted order with the lowest frequency first
+    std::vector<size_t> mBinEdges;
+    size_t mFrameSize{0u};
+    std::vector<std::uint8_t> mTile;
+    std::vector<std::uint8_t> mDelta;
+    std::vector<std::uint8_t> mEncoded;
+    size_t mRows{0u};
+    std::uint64_t mFrames{0u};
+    std::uint64_t mTileIndex{0u};
+    std::int64_t mFirstRowNs{0};
+    std::int64_t mLastRowNs{0};
+    metrics::CCounter& mTiles;
+    metrics::CCounter& mBytes;
+};
+
+void CWaterfall::Impl::PrepareBins(const size_t frameSize) {
+    if (frameSize == mFrameSize) {
+        return;
+    }
+    if (0u != mRows) {
+        // a tile keeps one frame size
+        WriteTile();
+    }
+
+    mFrameSize = frameSize;
+    const auto width = mConfig.width;
+    mBinEdges.resize(width + 1u);
+    for (size_t column = 0; column <= width; ++column) {
+        mBinEdges[column] = column * frameSize / width;
+    }
+}
+
+void CWaterfall::Impl::WriteTile() {
+    if (0u == mRows) {
+        return;
+    }
+
+    const auto width = mConfig.width;
+    mEncoded.clear();
+    mEncoded.insert(mEncoded.end(), kMagic, kMagic + sizeof(kMagic));
+    Append(mEncoded, static_cast<std::uint32_t>(width));
+    Append(mEncoded, static_cast<std::uint32_t>(mRows));
+    Append(mEncoded, mConfig.minDb);
+    Append(mEncoded, mConfig.maxDb);
+    Append(mEncoded, mFrames - mRows);
+    Append(mEncoded, mFirstRowNs);
+    Append(mEncoded, mLastRowNs);
+
+    // neighbouring rows differ little, the deltas compress into long runs
+    for (size_t row = 0; row < mRows; ++row) {
+        const auto* current = &mTile[row * width];
+        if (0u == row) {
+            std::copy(current, current + width, mDelta.begin());
+        } else {
+            const auto* previous = current - width;
+            for (size_t column = 0; column < width; ++column) {
+                mDelta[column] = current[column] - previous[column];
+            }
+        }
+
+        const auto sizeOffset = mEncoded.size();
+        Append(mEncoded, std::uint32_t(0u));
+        PackBits(mDelta.data(), width, mEncoded);
+        const auto size =
+            static_cast<std::uint32_t>(mEncoded.size() - sizeOffset - 4u);
+        std::memcpy(&mEncoded[sizeOffset], &size, sizeof(size));
+    }
+
+    const auto slot =
+        0u == mConfig.maxTiles ? mTileIndex : mTileIndex % mConfig.maxTiles;
+    char name[64];
+    snprintf(name,
+             sizeof(name),
+             "/waterfall_dev%d_%06llu.kwf",
+             mDeviceNumber,
+             static_cast<unsigned long long>(slot));
+    const auto path = mConfig.outputDir + name;
+
+    mRows = 0u;
+    ++mTileIndex;
+
+    // write aside and rename so viewers never see a partial tile
+    const auto tmpPath = path + ".tmp";
+    auto file = fopen(tmpPath.c_str(), "wb");
+    if (nullptr == file) {
+        SoapySDR::logf(
+            SOAPY_SDR_ERROR, "Waterfall: can't open %s", tmpPath.c_str());
+        return;
+    }
+    const auto written = fwrite(mEncoded.data(), 1u, mEncoded.size(), file);
+    fclose(file);
+    if (written != mEncoded.size()) {
+        SoapySDR::logf(
+            SOAPY_SDR_ERROR, "Waterfall: can't write %s", tmpPath.c_str());
+        return;
+    }
+    std::rename(tmpPath.c_str(), path.c_str());
+
+    mTiles.Add();
+    mBytes.Add(mEncoded.size());
+}
+
+CWaterfall::CWaterfall(const int deviceNumber, const WaterfallConfig& config)
+    : mImpl(std::make_unique<CWaterfall::Impl>(deviceNumber, config)) {
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Waterfall: %zu x %zu tiles, %g .. %g dB in %s",
+                   config.width,
+                   config.tileRows,
+                   config.minDb,
+                   config.maxDb,
+                   config.outputDir.c_str());
+}
+
+CWaterfall::~CWaterfall() {
+    Flush();
+}
+
+void CWaterfall::AddFrame(const kfr::univector<kfr::fbase>& dB) {
+    auto& impl = *mImpl;
+    const auto size = dB.size();
+    if (0u == size) {
+        return;
+    }
+    impl.PrepareBins(size);
+
+    const auto width = impl.mConfig.width;
+    // fftshift: column bin p reads the FFT bin (p + offset) % size
+    const auto half = size / 2u;
+    const auto offset = size - half;
+    const auto scale = 255.0f / (impl.mConfig.maxDb - impl.mConfig.minDb);
+    auto* row = &impl.mTile[impl.mRows * width];
+    for (size_t column = 0; column < width; ++column) {
+        const auto begin = impl.mBinEdges[column];
+        // narrower frames than the width repeat their bins
+        const auto end = std::max(begin + 1u, impl.mBinEdges[column + 1u]);
+
+        // max hold keeps narrow carriers visible after the downsampling,
+        // bins are read in the shifted order, negative frequencies first
+        auto peak = -std::numeric_limits<float>::infinity();
+        for (auto bin = begin; bin < end; ++bin) {
+            const auto index = bin < half ? bin + offset : bin - half;
+            peak = std::max(peak, static_cast<float>(dB[index]));
+        }
+
+        const auto level = (peak - impl.mConfig.minDb) * scale;
+        row[column] = static_cast<std::uint8_t>(
+            std::lround(std::clamp(level, 0.0f, 255.0f)));
+    }
+
+    const auto now = NowUnixNs();
+    if (0u == impl.mRows) {
+        impl.mFirstRowNs = now;
+    }
+    impl.mLastRowNs = now;
+    ++impl.mFrames;
+
+    if (++impl.mRows == impl.mConfig.tileRows) {
+        impl.WriteTile();
+    }
+}
+
+void CWaterfall::Flush() {
+    mImpl->WriteTile();
+}
+
+}  // namespace waterfall
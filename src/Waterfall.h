@@ -0,0 +1,69 @@
+#ifndef __WATERFALL_H__
+#define __WATERFALL_H__
+
+#include <kfr/base.hpp>
+#include <memory>
+#include <string>
+
+namespace waterfall {
+struct WaterfallConfig {
+    // directory of the tile files, empty - no waterfall
+    std::string outputDir;
+    // columns of a row, every column holds the max of its FFT bins
+    size_t width{1024u};
+    // rows of a tile, a tile is written when it is full
+    size_t tileRows{256u};
+    // power mapped to the pixel values 0 and 255
+    float minDb{-120.0f};
+    float maxDb{0.0f};
+    // tile files kept per device, the oldest is overwritten, 0 - keep all
+    size_t maxTiles{0u};
+};
+
+/**
+ * @brief Turns the dB spectra of one device into waterfall tiles, one row
+ * per frame. Only the current tile is held in memory.
+ *
+ * Tile file, little-endian:
+ *   "KWF1", u32 width, u32 rows, f32 minDb, f32 maxDb, u64 first frame,
+ *   i64 first / last row time in ns since the epoch,
+ *   then per row: u32 size, PackBits of the row minus the previous row
+ *   (modulo 256, the first row of a tile minus zero)
+ * Columns run from the lowest to the highest frequency.
+ */
+class CWaterfall {
+   public:
+    /**
+     * @param deviceNumber number device, names the tile files and labels
+     * the metrics
+     * @param config geometry, dB range and output of the tiles
+     */
+    CWaterfall(const int deviceNumber, const WaterfallConfig& config);
+    CWaterfall(const CWaterfall&) = delete;
+    CWaterfall& operator=(const CWaterfall&) = delete;
+
+    /**
+     * @brief Writes the rows of an unfinished tile
+     */
+    ~CWaterfall();
+
+    /**
+     * @brief Bins, quantizes and appends one frame, writes the tile when
+     * it is full
+     * @param dB spectrum in the FFT order, DC first
+     */
+    void AddFrame(const kfr::univector<kfr::fbase>& dB);
+
+    /**
+     * @brief Writes the current tile even if it is not full
+     */
+    void Flush();
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace waterfall
+
+#endif  // __WATERFALL_H__
@@ -0,0 +1,312 @@
+#include "ZoomFft.h"
+
+#include <SoapySDR/Logger.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "FastFir.h"
+#include "Metrics.h"
+#include "PsdEstimator.h"
+
+namespace zoom_fft {
+namespace {
+using Clock = std::chrono::steady_clock;
+using Sample = std::complex<float>;
+
+constexpr double kPi = 3.14159265358979323846;
+// the band fills at most 0.8 of the decimated rate, the passband of the
+// last half-band stage
+constexpr double kOversample = 1.25;
+constexpr size_t kMaxStages = 16u;
+// the aliases into the band of the first stages lie far in their stop
+// band, the last stage cuts at the band edge and needs the long filter
+constexpr size_t kStageTaps = 19u;
+constexpr size_t kLastStageTaps = 47u;
+constexpr size_t kMinFftSize = 16u;
+
+/**
+ * @brief Half-band low pass decimating by two, a windowed sinc cut at a
+ * quarter of the rate. Every second tap of it is zero and skipped. The
+ * history carries over between blocks.
+ */
+class CHalfBand {
+   public:
+    /**
+     * @param taps 4 * n + 3, so the outer taps aren't the zero ones
+     */
+    explicit CHalfBand(const size_t taps) : mMiddle((taps - 1u) / 2u) {
+        const auto filter = fast_fir::DesignLowpass(taps, 0.25);
+        mCenter = filter[mMiddle];
+        for (auto offset = 1u; offset <= mMiddle; offset += 2u) {
+            mSides.push_back(filter[mMiddle + offset]);
+        }
+        mLine.assign(2u * mMiddle, Sample(0.0f, 0.0f));
+    }
+
+    /**
+     * @brief Filters count samples, out may be in
+     * @return outputs written, count / 2 rounded by the phase
+     */
+    size_t Decimate(const Sample* in, const size_t count, Sample* out) {
+        const auto history = 2u * mMiddle;
+        // the input is copied first, so the outputs may overwrite it
+        mLine.resize(history + count);
+        std::copy(in, in + count, mLine.begin() + history);
+
+        size_t produced(0u);
+        auto start = mPhase;
+        for (; start < count; start += 2u) {
+            const auto* middle = mLine.data() + start + mMiddle;
+            auto re = mCenter * middle->real();
+            auto im = mCenter * middle->imag();
+            for (size_t j = 0; j < mSides.size(); ++j) {
+                const auto& before = middle[-static_cast<long>(2u * j + 1u)];
+                const auto& after = middle[2u * j + 1u];
+                re += mSides[j] * (before.real() + after.real());
+                im += mSides[j] * (before.imag() + after.imag());
+            }
+            out[produced++] = Sample(re, im);
+        }
+        mPhase = start - count;
+
+        // keeps the capacity, steady blocks don't allocate
+        std::copy(mLine.end() - history, mLine.end(), mLine.begin());
+        mLine.resize(history);
+        return produced;
+    }
+
+   private:
+    const size_t mMiddle;
+    float mCenter{1.0f};
+    // the taps at the odd distances from the middle, outwards
+    std::vector<float> mSides;
+    // the last taps - 1 inputs, then the block being filtered
+    std::vector<Sample> mLine;
+    // the first window of the next block starts here, 0 or 1
+    size_t mPhase{0u};
+};
+
+struct Settings {
+    double center;
+    double span;
+    double tuned;
+};
+}  // namespace
+
+struct CZoomFft::Impl {
+    Impl(const int deviceNumber, const ZoomConfig& config)
+        : mDeviceNumber(deviceNumber)
+        , mConfig(config)
+        , mPsd(std::max(kMinFftSize, config.fftSize))
+        , mFrame(mPsd.GetFftSize())
+        , mRequested{config.center, config.span, config.tunedFrequency}
+        , mSpectra(metrics::CMetricsRegistry::Instance().GetCounter(
+              "kraken_zoom_spectra_total",
+              "Zoom spectra written",
+              {{"device", std::to_string(deviceNumber)}})) {
+        char name[48];
+        snprintf(name, sizeof(name), "/zoom_dev%d.csv", deviceNumber);
+        mPath = mConfig.outputDir + name;
+        Configure(mRequested);
+    }
+
+    void TakePending();
+    void Configure(const Settings& settings);
+    void Emit();
+
+    const int mDeviceNumber;
+    const ZoomConfig mConfig;
+    std::string mPath;
+    psd_estimator::CPsdEstimator mPsd;
+
+    Settings mSettings{};
+    // absolute center of the band, the device center if none is set
+    double mCenter{0.0};
+    // false while the band isn't inside the stream
+    bool mActive{false};
+    double mRate{0.0};
+    std::vector<CHalfBand> mStages;
+    std::complex<double> mStep{1.0, 0.0};
+    std::complex<double> mRotator{1.0, 0.0};
+    // the mixed block, decimated in place
+    std::vector<Sample> mWork;
+    std::vector<Sample> mFrame;
+    size_t mFill{0u};
+    std::vector<float> mPowerDb;
+    Clock::time_point mNextEmit;
+
+    // set by SetBand and SetTunedFrequency, taken at a block boundary
+    std::mutex mPendingLock;
+    Settings mRequested;
+    std::atomic<bool> mHasPending{false};
+
+    metrics::CCounter& mSpectra;
+};
+
+void CZoomFft::Impl::TakePending() {
+    if (not mHasPending.exchange(false, std::memory_order_acquire)) {
+        return;
+    }
+
+    Settings settings{};
+    {
+        std::lock_guard lock(mPendingLock);
+        settings = mRequested;
+    }
+    Configure(settings);
+}
+
+void CZoomFft::Impl::Configure(const Settings& settings) {
+    mSettings = settings;
+    mCenter = 0.0 == settings.center ? settings.tuned : settings.center;
+    // the frames so far belong to the old band or tuning
+    mFill = 0u;
+    mPsd.Reset();
+    mNextEmit = Clock::now() + mConfig.period;
+
+    const auto sampleRate = mConfig.sampleRate;
+    const auto offset = mCenter - settings.tuned;
+    mActive = sampleRate > 0.0 && settings.span > 0.0 &&
+              std::abs(offset) + settings.span / 2.0 <= sampleRate / 2.0;
+    if (not mActive) {
+        SoapySDR::logf(SOAPY_SDR_WARNING,
+                       "Zoom device #%d: %.0f Hz span %.0f Hz is outside "
+                       "the stream at %.0f Hz, paused",
+                       mDeviceNumber,
+                       mCenter,
+                       settings.span,
+                       settings.tuned);
+        return;
+    }
+
+    size_t stages(0u);
+    while (stages < kMaxStages &&
+           sampleRate / (2.0 * (1u << stages)) >= kOversample * settings.span) {
+        ++stages;
+    }
+    const size_t decimation = 1u << stages;
+    mStages.clear();
+    for (size_t stage = 0; stage < stages; ++stage) {
+        mStages.emplace_back(stage + 1u == stages ? kLastStageTaps
+                                                  : kStageTaps);
+    }
+    mRate = sampleRate / decimation;
+    mStep = std::polar(1.0, -2.0 * kPi * offset / sampleRate);
+    mRotator = 1.0;
+
+    SoapySDR::logf(SOAPY_SDR_INFO,
+                   "Zoom device #%d: %.0f Hz span %.0f Hz, decimation %zu "
+                   "in %zu stages, %.4g Hz bins",
+                   mDeviceNumber,
+                   mCenter,
+                   settings.span,
+                   decimation,
+                   mStages.size(),
+                   mRate / mFrame.size());
+}
+
+void CZoomFft::Impl::Emit() {
+    mPsd.GetPowerDb(mPowerDb);
+    mPsd.Reset();
+
+    // write aside and rename so readers never see a partial spectrum
+    const auto tmpPath = mPath + ".tmp";
+    auto file = fopen(tmpPath.c_str(), "w");
+    if (nullptr == file) {
+        SoapySDR::logf(SOAPY_SDR_ERROR,
+                       "Zoom device #%d: can't open %s",
+                       mDeviceNumber,
+                       tmpPath.c_str());
+        return;
+    }
+
+    // DC in the middle, the bins outside the band are dropped
+    const auto size = mPowerDb.size();
+    const auto binWidth = mRate / size;
+    const auto half = mSettings.span / 2.0;
+    fprintf(file, "frequency_hz,power_db\n");
+    for (size_t i = 0; i < size; ++i) {
+        const auto offset = (static_cast<double>(i) - size / 2u) * binWidth;
+        if (std::abs(offset) <= half) {
+            fprintf(file, "%.3f,%.2f\n", mCenter + offset, mPowerDb[i]);
+        }
+    }
+    fclose(file);
+
+    std::rename(tmpPath.c_str(), mPath.c_str());
+    mSpectra.Add();
+}
+
+CZoomFft::CZoomFft(const int deviceNumber, const ZoomConfig& config)
+    : mImpl(std::make_unique<CZoomFft::Impl>(deviceNumber, config)) {}
+
+CZoomFft::~CZoomFft() = default;
+
+bool CZoomFft::SetBand(const double center, const double span) {
+    if (span <= 0.0 || span > mImpl->mConfig.sampleRate) {
+        return false;
+    }
+
+    std::lock_guard lock(mImpl->mPendingLock);
+    mImpl->mRequested.center = center;
+    mImpl->mRequested.span = span;
+    mImpl->mHasPending.store(true, std::memory_order_release);
+    return true;
+}
+
+void CZoomFft::SetTunedFrequency(const double frequency) {
+    std::lock_guard lock(mImpl->mPendingLock);
+    mImpl->mRequested.tuned = frequency;
+    mImpl->mHasPending.store(true, std::memory_order_release);
+}
+
+void CZoomFft::AddSamples(const dsp_kernels::Complex* in,
+                          const size_t count) {
+    auto& impl = *mImpl;
+    impl.TakePending();
+    if (not impl.mActive || 0u == count) {
+        return;
+    }
+
+    auto& work = impl.mWork;
+    work.resize(count);
+    auto rotator = impl.mRotator;
+    for (size_t i = 0; i < count; ++i) {
+        const auto mixed =
+            std::complex<double>(in[i].real(), in[i].imag()) * rotator;
+        work[i] = Sample(static_cast<float>(mixed.real()),
+                         static_cast<float>(mixed.imag()));
+        rotator *= impl.mStep;
+    }
+    // the recursion drifts off the unit circle, renormalize per block
+    impl.mRotator = rotator / std::abs(rotator);
+
+    auto samples = count;
+    for (auto& stage : impl.mStages) {
+        samples = stage.Decimate(work.data(), samples, work.data());
+    }
+
+    auto& frame = impl.mFrame;
+    for (size_t i = 0; i < samples; ++i) {
+        frame[impl.mFill++] = work[i];
+        if (frame.size() != impl.mFill) {
+            continue;
+        }
+        impl.mPsd.Accumulate(frame.data());
+        impl.mFill = 0u;
+
+        const auto now = Clock::now();
+        if (impl.mPsd.GetFrameCount() >= impl.mConfig.averages &&
+            now >= impl.mNextEmit) {
+            impl.Emit();
+            impl.mNextEmit = now + impl.mConfig.period;
+        }
+    }
+}
+
+}  // namespace zoom_fft
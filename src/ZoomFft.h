@@ -0,0 +1,84 @@
+#ifndef __ZOOM_FFT_H__
+#define __ZOOM_FFT_H__
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "DspKernels.h"
+
+namespace zoom_fft {
+struct ZoomConfig {
+    // directory of the zoom spectra, empty - no zoom
+    std::string outputDir;
+    // center of the analysed band in Hz, 0 - follows the device center
+    double center{0.0};
+    // width of the analysed band in Hz, sets the decimation
+    double span{100e3};
+    // points of the transform at the decimated rate, the bins are
+    // decimated rate / fftSize apart
+    size_t fftSize{8192u};
+    // frames averaged at least into every written spectrum
+    size_t averages{4u};
+    // a spectrum is written at most this often, the frames in between are
+    // averaged as well
+    std::chrono::milliseconds period{1000};
+    // samples per second of the stream and center frequency the device is
+    // tuned to, set by the stream factory
+    double sampleRate{0.0};
+    double tunedFrequency{0.0};
+};
+
+/**
+ * @brief High resolution spectrum of a narrow band of the stream: the band
+ * is mixed to zero, decimated by a power of two in a cascade of half-band
+ * low pass filters and transformed at the reduced rate, so the resolution
+ * of a huge transform of the full rate costs a small transform and a few
+ * multiplications per input sample.
+ *
+ * The decimated rate is the lowest that keeps the band inside 0.8 of it,
+ * the passband of the last half-band stage, the bins outside the band are
+ * dropped. The spectrum is written as "frequency_hz,power_db" lines in
+ * absolute Hz to <outputDir>/zoom_dev<N>.csv, aside and renamed.
+ */
+class CZoomFft {
+   public:
+    /**
+     * @param deviceNumber number device, names the file and labels the
+     * metrics
+     * @param config band, resolution and output of the zoom
+     */
+    CZoomFft(const int deviceNumber, const ZoomConfig& config);
+    CZoomFft(const CZoomFft&) = delete;
+    CZoomFft& operator=(const CZoomFft&) = delete;
+    ~CZoomFft();
+
+    /**
+     * @brief Moves the analysed band, thread safe, applied at the next
+     * block. The frames averaged so far are dropped.
+     * @param center absolute center in Hz, 0 - follows the device center
+     * @param span width in Hz
+     * @return false if the span isn't positive or wider than the stream
+     */
+    bool SetBand(const double center, const double span);
+
+    /**
+     * @brief Tells the zoom about a retune of the device, thread safe. A
+     * fixed band stays where it is while it is inside the stream.
+     */
+    void SetTunedFrequency(const double frequency);
+
+    /**
+     * @brief Mixes, decimates and transforms a block, writes a spectrum
+     * when enough frames were averaged. Called by the DSP thread only.
+     */
+    void AddSamples(const dsp_kernels::Complex* in, const size_t count);
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace zoom_fft
+
+#endif  // __ZOOM_FFT_H__
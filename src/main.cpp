@@ -4,20 +4,98 @@
 #include <SoapySDR/Logger.hpp>
 #include <iostream>
 
+#include "AllocationTracker.h"
+#include "DemodBank.h"
 #include "DeviceManagerRtl.h"
+#include "LatencyTracer.h"
+#include "MetricsExporter.h"
+#include "SparseMonitor.h"
+#include "ThreadPlacement.h"
+#include "ThroughputBench.h"
 #include "Utility.h"
 
 int printHelp();
+bool parseRange(const std::string& range, double& first, double& second);
 
 int main(int argc, char* argv[]) try {
     static option long_options[] = {
         {"help", no_argument, nullptr, 'h'},
         {"sample rate", optional_argument, nullptr, 'r'},
         {"frequency", required_argument, nullptr, 'f'},
+        {"sweep", required_argument, nullptr, 's'},
+        {"dwell", required_argument, nullptr, 'd'},
+        {"settle", required_argument, nullptr, 't'},
+        {"passes", required_argument, nullptr, 'p'},
+        {"sweep-out", required_argument, nullptr, 'o'},
+        {"metrics-file", required_argument, nullptr, 'm'},
+        {"metrics-port", required_argument, nullptr, 'M'},
+        {"reader-cpus", required_argument, nullptr, 'R'},
+        {"dsp-cpus", required_argument, nullptr, 'D'},
+        {"reader-prio", required_argument, nullptr, 'P'},
+        {"dsp-prio", required_argument, nullptr, 'Q'},
+        {"mlock", no_argument, nullptr, 'L'},
+        {"bench", optional_argument, nullptr, 'b'},
+        {"latency-sample", required_argument, nullptr, 'l'},
+        {"tx-file", required_argument, nullptr, 'F'},
+        {"tx-tone", required_argument, nullptr, 'T'},
+        {"tx-device", required_argument, nullptr, 'x'},
+        {"tx-format", required_argument, nullptr, 'X'},
+        {"tx-prefetch", required_argument, nullptr, 'e'},
+        {"tx-burst", required_argument, nullptr, 'B'},
+        {"waterfall", required_argument, nullptr, 'w'},
+        {"waterfall-width", required_argument, nullptr, 'W'},
+        {"waterfall-rows", required_argument, nullptr, 'H'},
+        {"waterfall-range", required_argument, nullptr, 'g'},
+        {"waterfall-tiles", required_argument, nullptr, 'k'},
+        {"traces", required_argument, nullptr, 'u'},
+        {"traces-width", required_argument, nullptr, 'U'},
+        {"traces-rate", required_argument, nullptr, 'y'},
+        {"traces-average", required_argument, nullptr, 'a'},
+        {"traces-hold", required_argument, nullptr, 'Y'},
+        {"iq-update", required_argument, nullptr, 'c'},
+        {"iq-alpha", required_argument, nullptr, 'C'},
+        {"graph", required_argument, nullptr, 'G'},
+        {"alloc-arm", required_argument, nullptr, 'A'},
+        {"capture", required_argument, nullptr, 'i'},
+        {"capture-span", required_argument, nullptr, 'j'},
+        {"capture-level", required_argument, nullptr, 'n'},
+        {"capture-every", required_argument, nullptr, 'N'},
+        {"governor", required_argument, nullptr, 'v'},
+        {"zoom", required_argument, nullptr, 'z'},
+        {"zoom-band", required_argument, nullptr, 'Z'},
+        {"zoom-fft", required_argument, nullptr, 'q'},
+        {"monitor", required_argument, nullptr, 'O'},
+        {"monitor-freqs", required_argument, nullptr, 'K'},
+        {"monitor-window", required_argument, nullptr, 'J'},
+        {"monitor-level", required_argument, nullptr, 'E'},
+        {"monitor-only", no_argument, nullptr, 'I'},
+        {"results", required_argument, nullptr, 'S'},
+        {"results-rotate", required_argument, nullptr, 'V'},
+        {"results-level", required_argument, nullptr, '1'},
+        {"console", required_argument, nullptr, '2'},
+        {"demod", required_argument, nullptr, '3'},
+        {"demod-channels", required_argument, nullptr, '4'},
+        {"demod-audio", required_argument, nullptr, '5'},
+        {"demod-fm", required_argument, nullptr, '6'},
         {nullptr, no_argument, nullptr, '\0'}};
 
     double sampleRate = device_manager::CDeviceManagerRtl::kMinSampleRate;
     double frequency = device_manager::CDeviceManagerRtl::kDefFrequency;
+    bool sweep = false;
+    sweep_scanner::SweepPlan sweepPlan;
+    metrics_exporter::ExporterConfig exporterConfig;
+    thread_placement::PlacementConfig placementConfig;
+    bool bench = false;
+    throughput_bench::BenchConfig benchConfig;
+    bool transmit = false;
+    int txDevice = 1;
+    std::string txFormat;
+    tx_feeder::TxConfig txConfig;
+    data_handler::HandlerConfig handlerConfig;
+    std::shared_ptr<const pipeline_graph::GraphSpec> graph;
+    bool allocArm = false;
+    std::chrono::milliseconds allocWarmUp{0};
+    auto allocAction = allocation_tracker::ArmAction::Report;
 
     auto long_index = 0;
     auto option = 0;
@@ -34,14 +112,346 @@ int main(int argc, char* argv[]) try {
                 if (nullptr != optarg)
                     frequency = std::stod(optarg);
                 break;
+            case 's':
+                sweep = parseRange(optarg,
+                                   sweepPlan.startFrequency,
+                                   sweepPlan.stopFrequency);
+                if (not sweep)
+                    return printHelp();
+                break;
+            case 'd':
+                sweepPlan.dwell = std::chrono::milliseconds(std::stol(optarg));
+                break;
+            case 't':
+                sweepPlan.settle =
+                    std::chrono::milliseconds(std::stol(optarg));
+                break;
+            case 'p':
+                sweepPlan.passes = std::stoul(optarg);
+                break;
+            case 'o':
+                sweepPlan.outputPath = optarg;
+                break;
+            case 'm':
+                exporterConfig.textFilePath = optarg;
+                break;
+            case 'M': {
+                const auto port = std::stoul(optarg);
+                // a wider value would wrap to another port
+                if (port > 65535u)
+                    return printHelp();
+                exporterConfig.httpPort = static_cast<unsigned short>(port);
+                break;
+            }
+            case 'R':
+                if (not thread_placement::ParseCpuList(
+                        optarg, placementConfig.reader.cpus))
+                    return printHelp();
+                break;
+            case 'D':
+                if (not thread_placement::ParseCpuList(
+                        optarg, placementConfig.dsp.cpus))
+                    return printHelp();
+                break;
+            case 'P':
+                placementConfig.reader.priority = std::stoi(optarg);
+                break;
+            case 'Q':
+                placementConfig.dsp.priority = std::stoi(optarg);
+                break;
+            case 'L':
+                placementConfig.lockMemory = true;
+                break;
+            case 'b':
+                bench = true;
+                if (nullptr != optarg)
+                    benchConfig.maxDevices = std::stoul(optarg);
+                break;
+            case 'l':
+                latency_tracer::SetSampleInterval(std::stoul(optarg));
+                break;
+            case 'F':
+                transmit = true;
+                txConfig.filePath = optarg;
+                break;
+            case 'T':
+                transmit = true;
+                txConfig.toneOffset = std::stod(optarg);
+                break;
+            case 'x':
+                txDevice = std::stoi(optarg);
+                break;
+            case 'X':
+                txFormat = optarg;
+                break;
+            case 'e':
+                txConfig.prefetch = std::stoul(optarg);
+                break;
+            case 'B': {
+                const std::string burst(optarg);
+                const auto pos = burst.find(':');
+                if (std::string::npos == pos)
+                    return printHelp();
+                txConfig.burstSamples = std::stoul(burst.substr(0, pos));
+                txConfig.burstPeriod =
+                    std::chrono::milliseconds(std::stol(burst.substr(pos + 1)));
+                break;
+            }
+            case 'w':
+                handlerConfig.waterfall.outputDir = optarg;
+                break;
+            case 'W':
+                handlerConfig.waterfall.width = std::stoul(optarg);
+                break;
+            case 'H':
+                handlerConfig.waterfall.tileRows = std::stoul(optarg);
+                break;
+            case 'g': {
+                double minDb(0.0);
+                double maxDb(0.0);
+                if (not parseRange(optarg, minDb, maxDb))
+                    return printHelp();
+                handlerConfig.waterfall.minDb = minDb;
+                handlerConfig.waterfall.maxDb = maxDb;
+                break;
+            }
+            case 'k':
+                handlerConfig.waterfall.maxTiles = std::stoul(optarg);
+                break;
+            case 'u':
+                handlerConfig.reducer.outputDir = optarg;
+                break;
+            case 'U':
+                handlerConfig.reducer.width = std::stoul(optarg);
+                break;
+            case 'y':
+                handlerConfig.reducer.rate = std::stod(optarg);
+                break;
+            case 'a': {
+                const std::string average(optarg);
+                if ("linear" == average) {
+                    handlerConfig.reducer.averaging =
+                        spectrum_reducer::Averaging::Linear;
+                } else if (0 == average.rfind("exp", 0)) {
+                    handlerConfig.reducer.averaging =
+                        spectrum_reducer::Averaging::Exponential;
+                    const auto pos = average.find(':');
+                    if (std::string::npos != pos)
+                        handlerConfig.reducer.alpha =
+                            std::stof(average.substr(pos + 1));
+                } else {
+                    return printHelp();
+                }
+                break;
+            }
+            case 'Y':
+                handlerConfig.reducer.holdTime =
+                    std::chrono::milliseconds(std::stol(optarg));
+                break;
+            case 'c':
+                handlerConfig.correction.updateBlocks = std::stoul(optarg);
+                break;
+            case 'C': {
+                // two independent smoothing factors, in no particular order
+                const std::string alphas(optarg);
+                const auto pos = alphas.find(':');
+                if (std::string::npos == pos)
+                    return printHelp();
+                const auto dcAlpha = std::stof(alphas.substr(0, pos));
+                const auto imbalanceAlpha = std::stof(alphas.substr(pos + 1));
+                if (dcAlpha <= 0.0f || dcAlpha > 1.0f ||
+                    imbalanceAlpha <= 0.0f || imbalanceAlpha > 1.0f)
+                    return printHelp();
+                handlerConfig.correction.dcAlpha = dcAlpha;
+                handlerConfig.correction.imbalanceAlpha = imbalanceAlpha;
+                break;
+            }
+            case 'G':
+                try {
+                    graph = std::make_shared<pipeline_graph::GraphSpec>(
+                        pipeline_graph::LoadGraphSpec(optarg));
+                } catch (const std::runtime_error& error) {
+                    SoapySDR::logf(SOAPY_SDR_ERROR, "%s", error.what());
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'i':
+                handlerConfig.capture.outputDir = optarg;
+                break;
+            case 'j': {
+                const std::string span(optarg);
+                const auto pos = span.find(':');
+                if (std::string::npos == pos)
+                    return printHelp();
+                handlerConfig.capture.preTrigger =
+                    std::chrono::milliseconds(std::stol(span.substr(0, pos)));
+                handlerConfig.capture.postTrigger =
+                    std::chrono::milliseconds(std::stol(span.substr(pos + 1)));
+                break;
+            }
+            case 'n':
+                handlerConfig.capture.levelDb = std::stof(optarg);
+                break;
+            case 'N':
+                handlerConfig.capture.schedulePeriod =
+                    std::chrono::seconds(std::stol(optarg));
+                break;
+            case 'v': {
+                const std::string governor(optarg);
+                if ("off" == governor) {
+                    handlerConfig.governor.enabled = false;
+                    break;
+                }
+                const auto pos = governor.find(':');
+                if (std::string::npos == pos)
+                    return printHelp();
+                handlerConfig.governor.highWater =
+                    std::stoul(governor.substr(0, pos));
+                handlerConfig.governor.lowWater =
+                    std::stoul(governor.substr(pos + 1));
+                if (handlerConfig.governor.lowWater >=
+                    handlerConfig.governor.highWater)
+                    return printHelp();
+                break;
+            }
+            case 'z':
+                handlerConfig.zoom.outputDir = optarg;
+                break;
+            case 'Z': {
+                const std::string band(optarg);
+                const auto pos = band.find(':');
+                if (std::string::npos == pos)
+                    return printHelp();
+                handlerConfig.zoom.center = std::stod(band.substr(0, pos));
+                handlerConfig.zoom.span = std::stod(band.substr(pos + 1));
+                if (handlerConfig.zoom.span <= 0.0)
+                    return printHelp();
+                break;
+            }
+            case 'q': {
+                const std::string fft(optarg);
+                const auto pos = fft.find(':');
+                handlerConfig.zoom.fftSize = std::stoul(fft.substr(0, pos));
+                if (std::string::npos != pos)
+                    handlerConfig.zoom.averages =
+                        std::stoul(fft.substr(pos + 1));
+                break;
+            }
+            case 'O':
+                handlerConfig.monitor.outputDir = optarg;
+                break;
+            case 'K':
+                if (not sparse_monitor::ParseFrequencies(
+                        optarg, handlerConfig.monitor.frequencies))
+                    return printHelp();
+                break;
+            case 'J': {
+                const std::string window(optarg);
+                const auto pos = window.find(':');
+                handlerConfig.monitor.window =
+                    std::stoul(window.substr(0, pos));
+                if (std::string::npos != pos)
+                    handlerConfig.monitor.rate =
+                        std::stod(window.substr(pos + 1));
+                break;
+            }
+            case 'E': {
+                const std::string level(optarg);
+                const auto pos = level.find(':');
+                handlerConfig.monitor.thresholdDb =
+                    std::stof(level.substr(0, pos));
+                if (std::string::npos != pos)
+                    handlerConfig.monitor.hysteresisDb =
+                        std::stof(level.substr(pos + 1));
+                break;
+            }
+            case 'I':
+                handlerConfig.spectrum = false;
+                break;
+            case 'S':
+                handlerConfig.results.outputDir = optarg;
+                break;
+            case 'V': {
+                const std::string rotate(optarg);
+                const auto pos = rotate.find(':');
+                handlerConfig.results.fileRecords =
+                    std::stoul(rotate.substr(0, pos));
+                if (std::string::npos != pos)
+                    handlerConfig.results.files =
+                        std::stoul(rotate.substr(pos + 1));
+                break;
+            }
+            case '1':
+                handlerConfig.results.levelDb = std::stof(optarg);
+                break;
+            case '2':
+                handlerConfig.results.consoleInterval =
+                    std::chrono::milliseconds(std::stol(optarg));
+                break;
+            case '3':
+                handlerConfig.demod.outputDir = optarg;
+                break;
+            case '4':
+                if (not demod_bank::ParseChannels(
+                        optarg, handlerConfig.demod.channels))
+                    return printHelp();
+                break;
+            case '5':
+                handlerConfig.demod.audioRate = std::stod(optarg);
+                if (handlerConfig.demod.audioRate <= 0.0)
+                    return printHelp();
+                break;
+            case '6': {
+                const std::string fm(optarg);
+                const auto pos = fm.find(':');
+                handlerConfig.demod.deviation = std::stod(fm.substr(0, pos));
+                if (std::string::npos != pos)
+                    handlerConfig.demod.deemphasisUs =
+                        std::stod(fm.substr(pos + 1));
+                break;
+            }
+            case 'A': {
+                const std::string arm(optarg);
+                const auto pos = arm.find(':');
+                allocArm = true;
+                allocWarmUp =
+                    std::chrono::seconds(std::stol(arm.substr(0, pos)));
+                if (std::string::npos != pos) {
+                    if ("abort" != arm.substr(pos + 1))
+                        return printHelp();
+                    allocAction = allocation_tracker::ArmAction::Abort;
+                }
+                break;
+            }
         }
     }
 
+    // the monitor watches nothing without frequencies
+    if (not handlerConfig.monitor.outputDir.empty() &&
+        handlerConfig.monitor.frequencies.empty())
+        return printHelp();
+    // nor do the demodulators without channels
+    if (not handlerConfig.demod.outputDir.empty() &&
+        handlerConfig.demod.channels.empty())
+        return printHelp();
+
     SoapySDR::logf(
         SOAPY_SDR_INFO,
         "*************** Raspberry & SoapySDR & Kraken ***************\n");
 
-    device_manager::CDeviceManagerRtl deviceManager;
+    // before any stream thread starts, they apply it on their own start
+    thread_placement::Configure(placementConfig);
+
+    if (bench) {
+        return throughput_bench::RunBenchmark(benchConfig) ? EXIT_SUCCESS
+                                                           : EXIT_FAILURE;
+    }
+
+    device_manager::CDeviceManagerRtl deviceManager(handlerConfig, graph);
+
+    // after the manager, the exporter thread inherits the blocked signals
+    metrics_exporter::CMetricsExporter metricsExporter(exporterConfig);
+    metricsExporter.Start();
 
     deviceManager.DeviceSearch();
 
@@ -54,12 +464,39 @@ int main(int argc, char* argv[]) try {
         deviceManager.PrintDeviceSettings(numDev);
     }
 
-    for (size_t numDev = 1; numDev <= devCount; ++numDev) {
-        deviceManager.StartStream(numDev);
+    if (sweep) {
+        if (not deviceManager.StartSweep(sweepPlan)) {
+            return EXIT_FAILURE;
+        }
+    } else if (devCount > 1u) {
+        // coherent processing across the tuners needs a common start
+        deviceManager.StartStreamGroup();
+    } else if (1u == devCount) {
+        deviceManager.StartStream(1);
+    }
+
+    if (transmit) {
+        deviceManager.SetSampleRate(sampleRate, txDevice, SOAPY_SDR_TX);
+        deviceManager.SetFrequency(frequency, txDevice, SOAPY_SDR_TX);
+        if (not deviceManager.StartTransmit(txDevice, txConfig, txFormat)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (allocArm) {
+        if (allocation_tracker::kEnabled) {
+            allocation_tracker::Arm(allocWarmUp, allocAction);
+        } else {
+            SoapySDR::logf(SOAPY_SDR_WARNING,
+                           "--alloc-arm needs a build with "
+                           "-DKRAKEN_ALLOCATION_TRACKER=ON");
+        }
     }
 
     deviceManager.WaitShutdownSignal();
 
+    allocation_tracker::PrintReport();
+
     return EXIT_SUCCESS;
 } catch (const std::runtime_error& error) {
     LOG_EXP(error.what())
@@ -74,7 +511,176 @@ int printHelp() {
     std::cout << "    --frequency[=specifies\n"
                  "  the down-conversion frequency]\t The center frequency in Hz"
               << std::endl;
+    std::cout << "    --sweep=start:stop \t\t Sweep the band in Hz, the plan "
+                 "is split between devices"
+              << std::endl;
+    std::cout << "    --dwell=ms \t\t\t Time collecting samples per step"
+              << std::endl;
+    std::cout << "    --settle=ms \t\t\t Time discarded after every retune"
+              << std::endl;
+    std::cout << "    --passes=count \t\t\t Number of sweeps, 0 - until "
+                 "stopped"
+              << std::endl;
+    std::cout << "    --sweep-out=path \t\t CSV file with the stitched "
+                 "spectrum"
+              << std::endl;
+    std::cout << "    --metrics-file=path \t\t Prometheus textfile with "
+                 "the metrics"
+              << std::endl;
+    std::cout << "    --metrics-port=port \t\t Serve the metrics on "
+                 "http://127.0.0.1:port"
+              << std::endl;
+    std::cout << "    --reader-cpus=list \t\t Cores of the USB reader "
+                 "threads, e.g. 2,3 or 2-3"
+              << std::endl;
+    std::cout << "    --dsp-cpus=list \t\t Cores of the DSP threads"
+              << std::endl;
+    std::cout << "    --reader-prio=1..99 \t\t SCHED_FIFO priority of the "
+                 "reader threads"
+              << std::endl;
+    std::cout << "    --dsp-prio=1..99 \t\t SCHED_FIFO priority of the "
+                 "DSP threads"
+              << std::endl;
+    std::cout << "    --mlock \t\t\t Lock memory and pre-fault the heap"
+              << std::endl;
+    std::cout << "    --bench[=tuners] \t\t Find the max sustainable rate "
+                 "on in-memory devices"
+              << std::endl;
+    std::cout << "    --latency-sample=n \t\t Trace the latency of every "
+                 "n-th block, 0 - off"
+              << std::endl;
+    std::cout << "    --tx-file=path \t\t Transmit a raw IQ file in the "
+                 "TX format, looped"
+              << std::endl;
+    std::cout << "    --tx-tone=Hz \t\t\t Transmit a tone at the offset "
+                 "from the frequency"
+              << std::endl;
+    std::cout << "    --tx-device=n \t\t Device transmitting, 1 by default"
+              << std::endl;
+    std::cout << "    --tx-format=format \t\t TX buffer format, e.g. CS16, "
+                 "native by default"
+              << std::endl;
+    std::cout << "    --tx-prefetch=blocks \t\t Blocks prepared ahead of the "
+                 "device"
+              << std::endl;
+    std::cout << "    --tx-burst=samples:ms \t\t Timed bursts of samples "
+                 "every ms"
+              << std::endl;
+    std::cout << "    --waterfall=dir \t\t Write waterfall tiles of the "
+                 "spectra to the directory"
+              << std::endl;
+    std::cout << "    --waterfall-width=columns \t Columns of a row, "
+                 "max-hold binned"
+              << std::endl;
+    std::cout << "    --waterfall-rows=rows \t\t Rows of a tile file"
+              << std::endl;
+    std::cout << "    --waterfall-range=min:max \t dB mapped to the 8-bit "
+                 "pixel range"
+              << std::endl;
+    std::cout << "    --waterfall-tiles=n \t\t Tile files kept per device, "
+                 "0 - all"
+              << std::endl;
+    std::cout << "    --traces=dir \t\t\t Write max, min and average "
+                 "display traces to the directory"
+              << std::endl;
+    std::cout << "    --traces-width=bins \t\t Bins of a trace, "
+                 "peak-preserving decimation"
+              << std::endl;
+    std::cout << "    --traces-rate=Hz \t\t Traces written per second"
+              << std::endl;
+    std::cout << "    --traces-average=linear|exp[:alpha] \t Averaging of "
+                 "the average trace"
+              << std::endl;
+    std::cout << "    --traces-hold=ms \t\t Restart of the max and min "
+                 "holds, 0 - never"
+              << std::endl;
+    std::cout << "    --iq-update=blocks \t\t Blocks between DC and IQ "
+                 "imbalance estimates, 0 - no correction"
+              << std::endl;
+    std::cout << "    --iq-alpha=dc:imbalance \t Weights of the newest "
+                 "DC and imbalance estimates"
+              << std::endl;
+    std::cout << "    --graph=file \t\t\t Process every device with the "
+                 "graph of the file instead of the FFT handler"
+              << std::endl;
+    std::cout << "    --capture=dir \t\t\t Write the raw samples around "
+                 "triggers to the directory, 'capture <device>' fires one"
+              << std::endl;
+    std::cout << "    --capture-span=pre:post \t Milliseconds captured "
+                 "before and after a trigger"
+              << std::endl;
+    std::cout << "    --capture-level=dB \t\t Trigger on a spectrum max "
+                 "above the level"
+              << std::endl;
+    std::cout << "    --capture-every=s \t\t Trigger every s seconds"
+              << std::endl;
+    std::cout << "    --zoom=dir \t\t\t Write a high resolution spectrum "
+                 "of a narrow band to the directory"
+              << std::endl;
+    std::cout << "    --zoom-band=Hz:Hz \t\t Center and span of the zoom, "
+                 "center 0 follows the tuning"
+              << std::endl;
+    std::cout << "    --zoom-fft=n[:avg] \t\t Zoom points at the decimated "
+                 "rate and frames averaged"
+              << std::endl;
+    std::cout << "    --monitor=dir \t\t\t Write the power of the "
+                 "monitored frequencies and their events to the directory"
+              << std::endl;
+    std::cout << "    --monitor-freqs=list|file \t Hz, comma separated or "
+                 "listed in the file"
+              << std::endl;
+    std::cout << "    --monitor-window=n[:rate] \t Samples per evaluation "
+                 "and evaluations per second"
+              << std::endl;
+    std::cout << "    --monitor-level=dB[:hyst] \t Event threshold and "
+                 "hysteresis"
+              << std::endl;
+    std::cout << "    --monitor-only \t\t No full FFT per block, the "
+                 "monitor and zoom still run"
+              << std::endl;
+    std::cout << "    --results=dir \t\t\t Append the spectrum results to "
+                 "memory mapped files in the directory"
+              << std::endl;
+    std::cout << "    --results-rotate=n[:files] \t Records per result "
+                 "file and files kept"
+              << std::endl;
+    std::cout << "    --results-level=dB \t\t A bin counts as a "
+                 "detection at this level"
+              << std::endl;
+    std::cout << "    --console=ms \t\t\t Interval of the result "
+                 "summary, 0 - none"
+              << std::endl;
+    std::cout << "    --demod=dir \t\t\t Write the audio of the "
+                 "demodulated channels to the directory"
+              << std::endl;
+    std::cout << "    --demod-channels=list|file \t Hz[:fm|am|usb|lsb[:bw]], "
+                 "comma separated or listed in the file"
+              << std::endl;
+    std::cout << "    --demod-audio=rate \t\t Samples per second of the "
+                 "16 bit PCM written"
+              << std::endl;
+    std::cout << "    --demod-fm=Hz[:us] \t\t FM deviation at full scale "
+                 "and de-emphasis, 0 - none"
+              << std::endl;
+    std::cout << "    --governor=off|high:low \t\t Shed DSP work while "
+                 "the queue holds high blocks, recover at low"
+              << std::endl;
+    std::cout << "    --alloc-arm=s[:abort] \t\t Report or abort on heap "
+                 "allocations of the stream threads after s seconds"
+              << std::endl;
     std::cout << std::endl;
 
     return 0;
 }
+
+bool parseRange(const std::string& range, double& first, double& second) {
+    const auto pos = range.find(':');
+    if (std::string::npos == pos) {
+        return false;
+    }
+
+    first = std::stod(range.substr(0, pos));
+    second = std::stod(range.substr(pos + 1));
+
+    return first < second;
+}